@@ -0,0 +1,276 @@
+/**
+ * 异步访问日志 (JSON Lines)
+ *
+ * 请求线程把定长的二进制记录写入本线程的单生产者单消费者环形缓冲 (首次写入时分配并登记):
+ * 只有字段复制与两次原子读写, 不加锁、不格式化、不做 I/O。缓冲满时丢弃该条并计数, 从不阻塞请求。
+ * 后台线程定期取出各缓冲中的记录, 格式化为每行一个 JSON 对象后成批追加到文件
+ * (按线程成批写出, 相邻行的时间不保证递增);
+ * 文件超过 max_bytes 时轮转: <path> -> <path>.1 -> ... -> <path>.<keep>, 更旧的删除。
+ */
+
+#ifndef BYD_ACCESS_LOG_H
+#define BYD_ACCESS_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wal.h"
+
+// 定长记录, 字符串字段超长时截断
+struct AccessRecord {
+    int64_t time_ms;            // Unix 时间 (毫秒)
+    uint64_t latency_ns;
+    uint64_t bytes;             // 响应体字节数 (分块传输的流式响应为 0)
+    uint64_t rows;              // 查询扫描的车型行数
+    uint16_t status;
+    char method[8];
+    char remote[48];
+    char route[64];             // 路由模式, 路由前返回的请求为 static / unrouted 等
+    char path[128];
+    char params[256];           // 原始查询串 (未解码)
+
+    static void copy(char* dst, size_t cap, const char* src, size_t n) {
+        if (n >= cap) {
+            n = cap - 1;
+            while (n > 0 && ((unsigned char)src[n] & 0xC0) == 0x80) n--;   // 不截断在 UTF-8 字符中间
+        }
+        std::memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    static void copy(char* dst, size_t cap, const std::string& src) { copy(dst, cap, src.data(), src.size()); }
+};
+
+class AccessLog {
+public:
+    struct Options {
+        uint64_t max_bytes = 64ull << 20;   // 单个文件超过该大小时轮转
+        int keep = 5;                       // 保留的历史文件数
+        size_t ring_capacity = 1024;        // 每个线程的缓冲条数 (取 2 的幂)
+        int flush_ms = 50;                  // 后台线程取出记录的间隔
+    };
+
+    AccessLog() = default;
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+    ~AccessLog() { stop(); }
+
+    bool start(const std::string& path, const Options& opt, std::string& err) {
+        path_ = path;
+        opt_ = opt;
+        if (opt_.keep < 1) opt_.keep = 1;
+        size_t cap = 2;
+        while (cap < opt_.ring_capacity) cap <<= 1;
+        opt_.ring_capacity = cap;
+        if (!openFile(err)) return false;
+        stopping_ = false;
+        enabled_.store(true, std::memory_order_release);
+        writer_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    // 写出剩余记录后停止; 之后的记录直接丢弃 (不计数)
+    void stop() {
+        if (!writer_.joinable()) return;
+        enabled_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+        if (fd_ >= 0) wal_detail::closeFd(fd_);
+        fd_ = -1;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 请求线程: 取得本线程缓冲中的下一个空槽, 填好后调用 commit(); 缓冲满时返回 nullptr (已计入丢弃数)
+    AccessRecord* reserve() {
+        Ring& r = ring();
+        uint64_t t = r.tail.load(std::memory_order_relaxed);
+        if (t - r.head.load(std::memory_order_acquire) > r.mask) {
+            r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &r.slots[t & r.mask];
+    }
+
+    void commit() {
+        Ring& r = ring();
+        r.tail.store(r.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lk(rings_mu_);
+        uint64_t n = 0;
+        for (const auto& r : rings_) n += r->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+private:
+    struct Ring {
+        std::unique_ptr<AccessRecord[]> slots;
+        uint64_t mask;
+        alignas(64) std::atomic<uint64_t> head{ 0 };    // 后台线程
+        alignas(64) std::atomic<uint64_t> tail{ 0 };    // 所属请求线程
+        std::atomic<uint64_t> dropped{ 0 };             // 所属请求线程
+
+        explicit Ring(size_t capacity) : slots(new AccessRecord[capacity]), mask(capacity - 1) {}
+    };
+
+    std::string path_;
+    Options opt_;
+    std::atomic<bool> enabled_{ false };
+    mutable std::mutex rings_mu_;       // 只在线程登记缓冲与后台线程遍历时使用
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::thread writer_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;             // mu_
+    int fd_ = -1;                       // 以下只由后台线程使用
+    uint64_t file_bytes_ = 0;
+    std::atomic<uint64_t> written_{ 0 };
+
+    Ring& ring() {
+        struct Local {
+            const AccessLog* owner = nullptr;
+            Ring* ring = nullptr;
+        };
+        static thread_local Local t;
+        if (t.owner != this) {
+            std::unique_ptr<Ring> r(new Ring(opt_.ring_capacity));
+            std::lock_guard<std::mutex> lk(rings_mu_);
+            t.ring = r.get();
+            t.owner = this;
+            rings_.push_back(std::move(r));
+        }
+        return *t.ring;
+    }
+
+    bool openFile(std::string& err) {
+        fd_ = wal_detail::openAppend(path_.c_str());
+        if (fd_ < 0) {
+            err = "无法打开访问日志 " + path_;
+            return false;
+        }
+        std::error_code ec;
+        file_bytes_ = std::filesystem::file_size(path_, ec);
+        if (ec) file_bytes_ = 0;
+        return true;
+    }
+
+    void run() {
+        std::string buf;
+        std::vector<Ring*> rings;
+        for (;;) {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait_for(lk, std::chrono::milliseconds(opt_.flush_ms), [this]() { return stopping_; });
+                stopping = stopping_;
+            }
+            {
+                std::lock_guard<std::mutex> lk(rings_mu_);
+                rings.clear();
+                for (const auto& r : rings_) rings.push_back(r.get());
+            }
+            buf.clear();
+            uint64_t n = 0;
+            for (Ring* r : rings) n += drain(*r, buf);
+            if (n > 0) {
+                writeOut(buf);
+                written_.fetch_add(n, std::memory_order_relaxed);
+            }
+            if (stopping) break;
+        }
+    }
+
+    // 格式化一个缓冲中的全部记录并追加到 buf, 返回条数
+    uint64_t drain(Ring& r, std::string& buf) {
+        uint64_t h = r.head.load(std::memory_order_relaxed);
+        uint64_t t = r.tail.load(std::memory_order_acquire);
+        for (uint64_t i = h; i != t; i++) format(r.slots[i & r.mask], buf);
+        r.head.store(t, std::memory_order_release);
+        return t - h;
+    }
+
+    void writeOut(const std::string& buf) {
+        if (fd_ < 0) return;
+        if (!wal_detail::writeAll(fd_, buf.data(), buf.size())) {
+            std::fprintf(stderr, "Access log write failed: %s\n", path_.c_str());
+            return;
+        }
+        file_bytes_ += buf.size();
+        if (file_bytes_ >= opt_.max_bytes) rotate();
+    }
+
+    void rotate() {
+        wal_detail::closeFd(fd_);
+        fd_ = -1;
+        std::error_code ec;
+        std::filesystem::remove(path_ + "." + std::to_string(opt_.keep), ec);
+        for (int i = opt_.keep - 1; i >= 1; i--) {
+            std::filesystem::rename(path_ + "." + std::to_string(i), path_ + "." + std::to_string(i + 1), ec);
+        }
+        std::filesystem::rename(path_, path_ + ".1", ec);
+        std::string err;
+        if (!openFile(err)) std::fprintf(stderr, "Access log rotate failed: %s\n", err.c_str());
+    }
+
+    static void format(const AccessRecord& r, std::string& out) {
+        std::time_t secs = (std::time_t)(r.time_ms / 1000);
+        std::tm tm;
+#ifdef _WIN32
+        gmtime_s(&tm, &secs);
+#else
+        gmtime_r(&secs, &tm);
+#endif
+        char num[96];
+        std::snprintf(num, sizeof(num), "{\"ts\":\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\"", tm.tm_year + 1900,
+                      tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(r.time_ms % 1000));
+        out += num;
+        out += ",\"method\":"; appendString(out, r.method);
+        out += ",\"route\":"; appendString(out, r.route);
+        out += ",\"path\":"; appendString(out, r.path);
+        out += ",\"params\":"; appendString(out, r.params);
+        std::snprintf(num, sizeof(num), ",\"status\":%u,\"bytes\":%llu,\"latency_ms\":%.3f,\"rows\":%llu",
+                      (unsigned)r.status, (unsigned long long)r.bytes, r.latency_ns / 1e6,
+                      (unsigned long long)r.rows);
+        out += num;
+        out += ",\"remote\":"; appendString(out, r.remote);
+        out += "}\n";
+    }
+
+    static void appendString(std::string& out, const char* s) {
+        out += '"';
+        for (; *s; s++) {
+            unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c < 0x20) {
+                char esc[8];
+                std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            } else {
+                out += (char)c;
+            }
+        }
+        out += '"';
+    }
+};
+
+#endif // BYD_ACCESS_LOG_H
@@ -0,0 +1,178 @@
+/**
+ * 请求准入控制 (过载时快速失败)
+ *
+ *   AdaptiveLimiter   一类请求的并发上限, 按请求耗时自适应调整: 以最近一个窗口内的最小耗时为无负载基准,
+ *                     平滑耗时超过基准 tolerance 倍时按 基准/平滑耗时 的比例下调 (每轮至多一次, 最多减半),
+ *                     否则上限被用满时每完成 limit 个请求加 1。超过上限的请求最多 max_waiting 个排队,
+ *                     各等待 max_wait_ms, 其余立即拒绝。
+ *   AdmissionControl  把请求分为普通与高开销两类 (图数据、搜索、批量写入、导入), 高开销请求单独限流;
+ *                     它们被大量拒绝时不会占满工作线程, 普通请求的延迟不受影响。
+ *                     与正在计算的相同查询合并的请求另有数量上限, 不占高开销名额。
+ * 被拒绝的请求由调用方返回 503 + Retry-After。
+ */
+
+#ifndef BYD_ADMISSION_H
+#define BYD_ADMISSION_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+
+struct LimiterOptions {
+    int min_limit = 1;
+    int max_limit = 4;
+    int max_waiting = 8;            // 超过上限时排队等待的请求数
+    int max_wait_ms = 50;
+    double tolerance = 2.0;         // 平滑耗时超过基准的倍数时下调上限
+    double slack_ms = 1.0;          // 耗时很短时的绝对容差, 避免噪声触发下调
+};
+
+class AdaptiveLimiter {
+public:
+    struct Stats {
+        int limit;
+        int inflight;
+        int waiting;
+        uint64_t admitted;
+        uint64_t rejected;
+        double base_ms;
+        double avg_ms;
+    };
+
+    AdaptiveLimiter() { configure(LimiterOptions()); }
+
+    void configure(const LimiterOptions& o) {
+        std::lock_guard<std::mutex> lk(mu_);
+        opt_ = o;
+        opt_.min_limit = std::max(1, o.min_limit);
+        opt_.max_limit = std::max(opt_.min_limit, o.max_limit);
+        limit_ = opt_.max_limit;
+    }
+
+    // 成功时调用方在请求结束后必须调用 release
+    bool acquire() {
+        std::unique_lock<std::mutex> lk(mu_);
+        if (inflight_ >= (int)limit_) {
+            if (waiting_ >= opt_.max_waiting || opt_.max_wait_ms <= 0) {
+                rejected_++;
+                return false;
+            }
+            waiting_++;
+            bool ok = cv_.wait_for(lk, std::chrono::milliseconds(opt_.max_wait_ms),
+                                   [&]() { return inflight_ < (int)limit_; });
+            waiting_--;
+            if (!ok) {
+                rejected_++;
+                return false;
+            }
+        }
+        inflight_++;
+        admitted_++;
+        return true;
+    }
+
+    void release(double elapsed_ms) {
+        std::lock_guard<std::mutex> lk(mu_);
+        bool saturated = inflight_ >= (int)limit_;
+        inflight_--;
+        update(elapsed_ms, saturated);
+        cv_.notify_one();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        double base = std::min(base_ms_, window_min_);
+        return { (int)limit_, inflight_, waiting_, admitted_, rejected_, base == kNone ? 0 : base, avg_ms_ };
+    }
+
+private:
+    static constexpr double kNone = std::numeric_limits<double>::infinity();
+    static const int kWindow = 100;     // 基准耗时的采样窗口
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    LimiterOptions opt_;
+    double limit_ = 1;
+    int inflight_ = 0;
+    int waiting_ = 0;
+    uint64_t admitted_ = 0;
+    uint64_t rejected_ = 0;
+    double base_ms_ = kNone;
+    double window_min_ = kNone;
+    int window_count_ = 0;
+    double avg_ms_ = 0;
+    int since_decrease_ = 0;
+
+    void update(double ms, bool saturated) {
+        // 每个窗口结束时以窗口最小值替换基准, 负载特征变化后 (如数据量变大) 基准随之更新
+        window_min_ = std::min(window_min_, ms);
+        if (++window_count_ >= kWindow) {
+            base_ms_ = window_min_;
+            window_min_ = kNone;
+            window_count_ = 0;
+        }
+        double base = std::min(base_ms_, window_min_);
+        avg_ms_ = avg_ms_ == 0 ? ms : avg_ms_ * 0.9 + ms * 0.1;
+        since_decrease_++;
+
+        double threshold = base * opt_.tolerance + opt_.slack_ms;
+        if (avg_ms_ > threshold) {
+            if (since_decrease_ >= (int)limit_) {
+                double g = std::max(0.5, threshold / avg_ms_);
+                limit_ = std::max((double)opt_.min_limit, limit_ * g);
+                since_decrease_ = 0;
+            }
+        } else if (saturated) {
+            limit_ = std::min((double)opt_.max_limit, limit_ + 1.0 / limit_);
+        }
+    }
+};
+
+class AdmissionControl {
+public:
+    enum RouteClass { kNormal = 0, kExpensive = 1 };
+
+    void configure(bool enabled, const LimiterOptions& expensive, int max_joined) {
+        enabled_ = enabled;
+        expensive_.configure(expensive);
+        max_joined_ = std::max(0, max_joined);
+    }
+
+    bool enabled() const { return enabled_; }
+
+    static RouteClass classify(const std::string& path) {
+        return path == "/api/graph" || path == "/api/search" || path == "/api/bulk" || path == "/api/import"
+                   ? kExpensive : kNormal;
+    }
+
+    // 普通请求不限流, 返回 nullptr
+    AdaptiveLimiter* limiterFor(RouteClass c) { return enabled_ && c == kExpensive ? &expensive_ : nullptr; }
+
+    const AdaptiveLimiter& expensive() const { return expensive_; }
+
+    // 加入正在进行的相同计算的请求只等待共享结果, 不占高开销名额;
+    // 这类请求同时最多 max_joined 个, 避免一拥而上时占满工作线程。成功时调用方在请求结束后调用 leave
+    bool tryJoin() {
+        if (joined_.fetch_add(1, std::memory_order_relaxed) < max_joined_) return true;
+        joined_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    void leave() { joined_.fetch_sub(1, std::memory_order_relaxed); }
+
+    void countShed() { shed_.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t shed() const { return shed_.load(std::memory_order_relaxed); }
+
+private:
+    bool enabled_ = true;
+    AdaptiveLimiter expensive_;
+    std::atomic<uint64_t> shed_{ 0 };   // 在连接队列中等待过久或队列溢出而被拒绝的请求
+    int max_joined_ = 0;
+    std::atomic<int> joined_{ 0 };
+};
+
+#endif // BYD_ADMISSION_H
@@ -0,0 +1,683 @@
+// HTTP 负载生成与延迟基准: 按比例混合请求各查询接口与添加车型, 测量本机运行中的服务端的吞吐与延迟分位 (Linux)
+//
+//   g++ -std=c++17 -O2 -pthread -o byd_bench byd_bench.cpp
+//   ./byd_bench [--port=8080] [--connections=64] [--threads=2] [--seconds=10] [--warmup=2] [--rate=0]
+//               [--mix=models:40,search:30,model:25,graph:5,add:0] [--timeout-ms=5000]
+//
+// 启动时从服务端读取现有的系列、车型编号与名称, 请求参数从中随机选取:
+//   models  /api/models?series_id=<系列>       search  /api/search?q=<车型名称或其首字>
+//   model   /api/model?id=<车型>               graph   /api/graph
+//   add     POST /api/model/add (名称为 bench-<pid>-<序号>, 绑定一个随机技术, 会写入数据文件; 服务端随机分配编号, 冲突时返回 ok:false)
+// rate=0:  闭环, 每个连接收到响应后立即发下一个请求; 按 HdrHistogram 的方法补偿协调遗漏 (coordinated omission):
+//          一个耗时 L 的请求按预期间隔 E (全部请求的平均延迟) 补记 L-E, L-2E, ... 等本应被发出而被它挡住的请求
+// rate=R:  开环, 每个线程按 R/threads 次/秒的固定间隔产生请求, 交给空闲的连接发送, 没有空闲连接时排队;
+//          延迟从计划发送时刻算起, 包含排队时间, 因此不受协调遗漏影响; 另外给出从实际发送算起的服务时间
+// 响应只支持 Content-Length; 非 2xx、响应体以 {"ok":false 开头、超时与连接失败分别计为错误
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+enum Op { kModels, kSearch, kModel, kGraph, kAdd, kOpCount };
+const char* const kOpNames[kOpCount] = { "models", "search", "model", "graph", "add" };
+
+struct BenchOptions {
+    string host = "127.0.0.1";
+    int port = 8080;
+    unsigned connections = 64;
+    unsigned threads = 2;
+    double seconds = 10;
+    double warmup = 2;              // 预热时间, 期间的请求不计入结果
+    double rate = 0;                // 总请求速率 (次/秒), 0 表示闭环
+    int timeout_ms = 5000;
+    unsigned mix[kOpCount] = { 40, 30, 25, 5, 0 };
+};
+
+uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 对数分档直方图 (HdrHistogram 的分档方式): 每个 2 的幂区间分 128 档, 相对误差小于 0.8%
+struct Histogram {
+    static const int kSubBits = 7;
+    static const int kSub = 1 << kSubBits;
+
+    vector<uint64_t> counts = vector<uint64_t>((64 - kSubBits + 1) * kSub, 0);
+    uint64_t total = 0;
+    uint64_t max_ns = 0;
+    double sum_ns = 0;
+
+    static size_t indexOf(uint64_t v) {
+        if (v < (uint64_t)kSub) return (size_t)v;
+        int shift = 63 - __builtin_clzll(v) - kSubBits;
+        return ((size_t)(shift + 1) << kSubBits) + (size_t)(v >> shift) - kSub;
+    }
+
+    // 档位的中点
+    static uint64_t valueAt(size_t idx) {
+        if (idx < (size_t)kSub) return idx;
+        int shift = (int)(idx >> kSubBits) - 1;
+        uint64_t low = (uint64_t)((idx & (kSub - 1)) + kSub) << shift;
+        return low + ((1ull << shift) >> 1);
+    }
+
+    void add(uint64_t ns, uint64_t n = 1) {
+        counts[indexOf(ns)] += n;
+        total += n;
+        sum_ns += (double)ns * n;
+        max_ns = max(max_ns, ns);
+    }
+
+    void merge(const Histogram& o) {
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += o.counts[i];
+        total += o.total;
+        sum_ns += o.sum_ns;
+        max_ns = max(max_ns, o.max_ns);
+    }
+
+    // 补记被长耗时请求挡住的请求: 每个大于 expected 的值 v 追加 v-expected, v-2*expected, ... (不小于 expected)
+    Histogram corrected(uint64_t expected_ns) const {
+        Histogram h = *this;
+        if (expected_ns == 0) return h;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (!counts[i]) continue;
+            uint64_t v = valueAt(i);
+            for (uint64_t m = v > expected_ns ? v - expected_ns : 0; m >= expected_ns; m -= expected_ns) h.add(m, counts[i]);
+        }
+        return h;
+    }
+
+    double percentileMs(double p) const {
+        if (total == 0) return 0;
+        uint64_t target = max<uint64_t>(1, (uint64_t)ceil(p * (double)total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target) return min(valueAt(i), max_ns) / 1e6;
+        }
+        return max_ns / 1e6;
+    }
+
+    double meanMs() const { return total ? sum_ns / (double)total / 1e6 : 0; }
+};
+
+struct Errors {
+    uint64_t status = 0;            // 非 2xx
+    uint64_t rejected = 0;          // 2xx 但 {"ok":false
+    uint64_t timeouts = 0;
+    uint64_t connect = 0;           // 连接失败或被服务端中途关闭
+
+    void merge(const Errors& o) {
+        status += o.status;
+        rejected += o.rejected;
+        timeouts += o.timeouts;
+        connect += o.connect;
+    }
+    uint64_t sum() const { return status + rejected + timeouts + connect; }
+};
+
+struct ThreadResult {
+    Histogram latency[kOpCount];    // 闭环: 从发送算起; 开环: 从计划时刻算起
+    Histogram service[kOpCount];    // 从发送算起
+    Errors errors[kOpCount];
+};
+
+// 从服务端读到的请求参数
+struct Workload {
+    vector<int> series_ids;
+    vector<int> tech_ids;
+    vector<int> model_ids;
+    vector<string> keywords;        // 已做 URL 编码
+};
+
+int connectTo(const BenchOptions& opt, bool nonblocking) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | (nonblocking ? SOCK_NONBLOCK : 0), 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)opt.port);
+    ::inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 缓冲中是否已有一个完整的响应 (只支持 Content-Length), 完整时返回响应长度, body_at 为响应体的起点
+size_t completeResponse(const string& buf, size_t& body_at) {
+    size_t end = buf.find("\r\n\r\n");
+    if (end == string::npos) return 0;
+    size_t length = 0;
+    size_t p = buf.find("Content-Length: ");
+    if (p != string::npos && p < end) length = strtoul(buf.c_str() + p + 16, nullptr, 10);
+    body_at = end + 4;
+    return buf.size() >= body_at + length ? body_at + length : 0;
+}
+
+// 阻塞地发一个 GET 请求并读到连接关闭, 只用于启动时读取请求参数
+bool fetch(const BenchOptions& opt, const string& path, string& body) {
+    int fd = connectTo(opt, false);
+    if (fd < 0) return false;
+    string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    string buf;
+    if (::send(fd, req.data(), req.size(), MSG_NOSIGNAL) == (ssize_t)req.size()) {
+        char chunk[16384];
+        for (;;) {
+            pollfd p = { fd, POLLIN, 0 };
+            if (::poll(&p, 1, opt.timeout_ms) <= 0) break;
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buf.append(chunk, (size_t)n);
+        }
+    }
+    ::close(fd);
+    size_t body_at;
+    if (buf.compare(0, 12, "HTTP/1.1 200") != 0 || !completeResponse(buf, body_at)) return false;
+    body = buf.substr(body_at);
+    return true;
+}
+
+// 取出 JSON 中每个 "key": 后面的整数 / 字符串值 (只处理服务端自己输出的格式)
+vector<int> extractInts(const string& json, const string& key) {
+    vector<int> out;
+    string pat = "\"" + key + "\":";
+    for (size_t p = json.find(pat); p != string::npos; p = json.find(pat, p + pat.size())) {
+        out.push_back(atoi(json.c_str() + p + pat.size()));
+    }
+    return out;
+}
+
+vector<string> extractStrings(const string& json, const string& key) {
+    vector<string> out;
+    string pat = "\"" + key + "\":\"";
+    for (size_t p = json.find(pat); p != string::npos; p = json.find(pat, p + pat.size())) {
+        size_t start = p + pat.size();
+        size_t end = start;
+        while (end < json.size() && json[end] != '"') end += json[end] == '\\' ? 2 : 1;
+        out.push_back(json.substr(start, end - start));
+    }
+    return out;
+}
+
+string urlEncode(const string& s) {
+    static const char* hex = "0123456789ABCDEF";
+    string out;
+    for (unsigned char c : s) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += (char)c;
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+bool loadWorkload(const BenchOptions& opt, Workload& w) {
+    string series, techs, models;
+    if (!fetch(opt, "/api/series", series) || !fetch(opt, "/api/techs", techs) ||
+        !fetch(opt, "/api/models?fields=model_id,model_name", models)) {
+        return false;
+    }
+    w.series_ids = extractInts(series, "series_id");
+    w.tech_ids = extractInts(techs, "tech_id");
+    w.model_ids = extractInts(models, "model_id");
+    vector<string> names = extractStrings(models, "model_name");
+    for (const string& name : names) {
+        if (name.empty() || name.find('\\') != string::npos) continue;
+        w.keywords.push_back(urlEncode(name));
+        // 名称的首个字符 (UTF-8), 匹配多个车型的宽泛搜索
+        size_t n = 1;
+        while (n < name.size() && ((unsigned char)name[n] & 0xC0) == 0x80) n++;
+        w.keywords.push_back(urlEncode(name.substr(0, n)));
+    }
+    sort(w.keywords.begin(), w.keywords.end());
+    w.keywords.erase(unique(w.keywords.begin(), w.keywords.end()), w.keywords.end());
+    return !w.series_ids.empty() && !w.tech_ids.empty() && !w.model_ids.empty() && !w.keywords.empty();
+}
+
+// 一个工作线程: 用 epoll 驱动分到的连接, 每个连接同一时刻只有一个请求
+struct Worker {
+    enum State { kDown, kConnecting, kIdle, kBusy };
+    struct Conn {
+        int fd = -1;
+        State state = kDown;
+        uint64_t retry_at = 0;      // kDown: 重连时刻
+        Op op = kModels;
+        uint64_t intended = 0;      // 计划发送时刻 (闭环时等于实际发送时刻)
+        uint64_t sent = 0;
+        string out;
+        size_t out_off = 0;
+        string in;
+    };
+
+    const BenchOptions& opt;
+    const Workload& work;
+    unsigned id;
+    vector<Conn> conns;
+    vector<size_t> idle;            // 空闲连接的下标
+    int epfd;
+    int timerfd;
+    mt19937_64 rng;
+    unsigned mix_total = 0;
+    uint64_t measure_from = 0;      // 计划时刻早于该时刻的请求不计入 (预热)
+    uint64_t adds = 0;
+    // 开环: 第 k 个请求的计划时刻为 start + k * interval
+    uint64_t start = 0;
+    double interval_ns = 0;
+    uint64_t issued = 0;
+    ThreadResult result;
+
+    Worker(const BenchOptions& o, const Workload& w, unsigned i, unsigned nconn)
+        : opt(o), work(w), id(i), conns(nconn), rng(0x9e3779b97f4a7c15ull * (i + 1)) {
+        epfd = ::epoll_create1(0);
+        timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = UINT64_MAX;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, timerfd, &ev);
+        for (unsigned k = 0; k < kOpCount; k++) mix_total += opt.mix[k];
+    }
+
+    ~Worker() {
+        for (auto& c : conns) if (c.fd >= 0) ::close(c.fd);
+        ::close(timerfd);
+        ::close(epfd);
+    }
+
+    template <typename T>
+    const T& pick(const vector<T>& v) { return v[rng() % v.size()]; }
+
+    Op pickOp() {
+        unsigned r = (unsigned)(rng() % mix_total);
+        for (unsigned k = 0; k < kOpCount; k++) {
+            if (r < opt.mix[k]) return (Op)k;
+            r -= opt.mix[k];
+        }
+        return kModels;
+    }
+
+    void buildRequest(Conn& c) {
+        string head;
+        string body;
+        switch (c.op) {
+            case kModels: head = "GET /api/models?series_id=" + to_string(pick(work.series_ids)); break;
+            case kSearch: head = "GET /api/search?q=" + pick(work.keywords); break;
+            case kModel:  head = "GET /api/model?id=" + to_string(pick(work.model_ids)); break;
+            case kGraph:  head = "GET /api/graph"; break;
+            case kAdd:
+                head = "POST /api/model/add";
+                body = "{\"model_name\":\"bench-" + to_string(::getpid()) + "-" + to_string(id) + "-" +
+                       to_string(++adds) + "\",\"series_id\":" + to_string(pick(work.series_ids)) +
+                       ",\"price\":19.98,\"range_km\":520,\"energy_type\":\"EV\",\"body_type\":\"SUV\"," +
+                       "\"seats\":5,\"launch_year\":\"2025\",\"tech_ids\":[" + to_string(pick(work.tech_ids)) + "]}";
+                break;
+            default: break;
+        }
+        c.out = head + " HTTP/1.1\r\nHost: localhost\r\n";
+        if (c.op == kAdd) {
+            c.out += "Content-Type: application/json\r\nContent-Length: " + to_string(body.size()) + "\r\n";
+        }
+        c.out += "\r\n";
+        c.out += body;
+        c.out_off = 0;
+    }
+
+    void watch(Conn& c, uint32_t events) {
+        epoll_event ev;
+        ev.events = events;
+        ev.data.u64 = (uint64_t)(&c - conns.data());
+        ::epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    void open(Conn& c, uint64_t now) {
+        c.fd = connectTo(opt, true);
+        if (c.fd < 0) {
+            c.state = kDown;
+            c.retry_at = now + 100000000ull;
+            return;
+        }
+        c.state = kConnecting;
+        c.in.clear();
+        epoll_event ev;
+        ev.events = EPOLLOUT;
+        ev.data.u64 = (uint64_t)(&c - conns.data());
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    // 连接出错或被关闭: 正在进行的请求计为失败, 稍后重连
+    void fail(Conn& c, uint64_t now, bool timeout) {
+        // 建立连接失败不对应任何请求, 只重连
+        if (c.state == kBusy && c.intended >= measure_from) {
+            Errors& e = result.errors[c.op];
+            (timeout ? e.timeouts : e.connect)++;
+        }
+        if (c.fd >= 0) ::close(c.fd);
+        c.fd = -1;
+        c.state = kDown;
+        c.retry_at = now + (timeout ? 0 : 100000000ull);
+    }
+
+    void send(Conn& c, uint64_t intended, uint64_t now) {
+        c.op = pickOp();
+        buildRequest(c);
+        c.intended = intended;
+        c.sent = now;
+        c.state = kBusy;
+        c.in.clear();
+        flush(c, now);
+    }
+
+    void flush(Conn& c, uint64_t now) {
+        while (c.out_off < c.out.size()) {
+            ssize_t n = ::send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.out_off += (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EAGAIN) {
+                watch(c, EPOLLIN | EPOLLOUT);
+                return;
+            }
+            fail(c, now, false);
+            return;
+        }
+        watch(c, EPOLLIN);
+    }
+
+    void receive(Conn& c, uint64_t now) {
+        char buf[16384];
+        bool eof = false;
+        for (;;) {
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.in.append(buf, (size_t)n);
+                continue;
+            }
+            eof = !(n < 0 && errno == EAGAIN);
+            break;
+        }
+        // 服务端在 keep-alive 的最后一个响应后立即关闭连接, 响应与关闭可能一起读到
+        size_t body_at;
+        size_t len = completeResponse(c.in, body_at);
+        if (!len) {
+            if (eof) fail(c, now, false);
+            return;
+        }
+        if (c.intended >= measure_from) {
+            bool ok2xx = c.in.size() > 9 && c.in[9] == '2';
+            if (!ok2xx) result.errors[c.op].status++;
+            else if (c.in.compare(body_at, 11, "{\"ok\":false") == 0) result.errors[c.op].rejected++;
+            else {
+                result.latency[c.op].add(now - c.intended);
+                result.service[c.op].add(now - c.sent);
+            }
+        }
+        bool close = eof || c.in.find("Connection: close") < body_at;
+        c.in.clear();
+        if (close) {
+            ::close(c.fd);
+            c.fd = -1;
+            c.state = kDown;
+            c.retry_at = now;
+            return;
+        }
+        c.state = kIdle;
+        idle.push_back((size_t)(&c - conns.data()));
+    }
+
+    void handle(Conn& c, uint32_t events, uint64_t now) {
+        if (c.state == kConnecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            ::getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+                fail(c, now, false);
+                return;
+            }
+            c.state = kIdle;
+            watch(c, EPOLLIN);
+            idle.push_back((size_t)(&c - conns.data()));
+            return;
+        }
+        if (c.state != kBusy) {
+            // 空闲连接上的可读事件只可能是服务端关闭 (如 keep-alive 超时)
+            if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                idle.erase(remove(idle.begin(), idle.end(), (size_t)(&c - conns.data())), idle.end());
+                fail(c, now, false);
+            }
+            return;
+        }
+        if (events & EPOLLOUT) flush(c, now);
+        if (c.state == kBusy && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) receive(c, now);
+    }
+
+    // 把到期的请求交给空闲连接, 返回下一个请求的计划时刻 (闭环或无请求可发时为 0)
+    uint64_t dispatch(uint64_t now, uint64_t end) {
+        while (!idle.empty()) {
+            uint64_t intended = now;
+            if (interval_ns > 0) {
+                intended = start + (uint64_t)(issued * interval_ns);
+                if (intended > now) break;
+            }
+            if (intended >= end) break;
+            Conn& c = conns[idle.back()];
+            idle.pop_back();
+            issued++;
+            send(c, intended, now);
+        }
+        if (interval_ns <= 0) return 0;
+        uint64_t next = start + (uint64_t)(issued * interval_ns);
+        return next > now && next < end ? next : 0;
+    }
+
+    // 超时的请求与待重连的连接, 每 10 ms 检查一次
+    void sweep(uint64_t now) {
+        for (auto& c : conns) {
+            if (c.state == kBusy && now - c.sent > (uint64_t)opt.timeout_ms * 1000000ull) fail(c, now, true);
+            if (c.state == kDown && now >= c.retry_at) open(c, now);
+        }
+    }
+
+    void run(uint64_t begin, uint64_t measure, uint64_t end, double thread_rate) {
+        start = begin;
+        measure_from = measure;
+        interval_ns = thread_rate > 0 ? 1e9 / thread_rate : 0;
+        for (auto& c : conns) open(c, begin);
+        uint64_t next_sweep = begin;
+        for (;;) {
+            uint64_t now = nowNs();
+            if (now >= end) break;
+            if (now >= next_sweep) {
+                sweep(now);
+                next_sweep = now + 10000000ull;
+            }
+            uint64_t due = dispatch(now, end);
+            // 下一个计划时刻用 timerfd 精确唤醒 (epoll_wait 的超时只有毫秒精度)
+            uint64_t wake = min(next_sweep, end);
+            if (due && due < wake) wake = due;
+            itimerspec ts;
+            memset(&ts, 0, sizeof(ts));
+            ts.it_value.tv_sec = (time_t)(wake / 1000000000ull);
+            ts.it_value.tv_nsec = (long)(wake % 1000000000ull);
+            ::timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &ts, nullptr);
+            epoll_event events[256];
+            int n = ::epoll_wait(epfd, events, 256, 1000);
+            now = nowNs();
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.u64 == UINT64_MAX) {
+                    uint64_t expirations;
+                    while (::read(timerfd, &expirations, sizeof(expirations)) > 0) {}
+                    continue;
+                }
+                handle(conns[events[i].data.u64], events[i].events, now);
+            }
+        }
+    }
+};
+
+bool parseMix(const string& val, unsigned mix[kOpCount]) {
+    unsigned parsed[kOpCount] = { 0, 0, 0, 0, 0 };
+    size_t p = 0;
+    while (p < val.size()) {
+        size_t comma = val.find(',', p);
+        if (comma == string::npos) comma = val.size();
+        string item = val.substr(p, comma - p);
+        size_t colon = item.find(':');
+        if (colon == string::npos) return false;
+        string name = item.substr(0, colon);
+        int weight = atoi(item.c_str() + colon + 1);
+        unsigned k = 0;
+        while (k < kOpCount && name != kOpNames[k]) k++;
+        if (k == kOpCount || weight < 0) return false;
+        parsed[k] = (unsigned)weight;
+        p = comma + 1;
+    }
+    unsigned total = 0;
+    for (unsigned k = 0; k < kOpCount; k++) total += parsed[k];
+    if (total == 0) return false;
+    copy(parsed, parsed + kOpCount, mix);
+    return true;
+}
+
+// count 与 req/s 是实际完成的请求数, 分位取自 h (可能含补记的值)
+void printRow(const string& name, uint64_t count, const Histogram& h, const Errors& e, double seconds) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-8s %9llu %9.0f %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %7llu\n", name.c_str(),
+             (unsigned long long)count, count / seconds, h.meanMs(), h.percentileMs(0.5), h.percentileMs(0.9),
+             h.percentileMs(0.99), h.percentileMs(0.999), h.max_ns / 1e6, (unsigned long long)e.sum());
+    cout << line;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string val = eq == string::npos ? "" : arg.substr(eq + 1);
+        double v = atof(val.c_str());
+        if (key == "--host" && !val.empty()) opt.host = val;
+        else if (key == "--port" && v > 0) opt.port = (int)v;
+        else if (key == "--connections" && v >= 1) opt.connections = (unsigned)v;
+        else if (key == "--threads" && v >= 1) opt.threads = (unsigned)v;
+        else if (key == "--seconds" && v > 0) opt.seconds = v;
+        else if (key == "--warmup" && v >= 0 && !val.empty()) opt.warmup = v;
+        else if (key == "--rate" && v >= 0 && !val.empty()) opt.rate = v;
+        else if (key == "--timeout-ms" && v > 0) opt.timeout_ms = (int)v;
+        else if (key == "--mix" && parseMix(val, opt.mix)) {}
+        else {
+            cerr << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=N] [--connections=N] [--threads=N]"
+                 << " [--seconds=S] [--warmup=S] [--rate=R (0: closed loop)] [--timeout-ms=N]"
+                 << " [--mix=models:40,search:30,model:25,graph:5,add:0]" << endl;
+            return 1;
+        }
+    }
+    opt.threads = min(opt.threads, opt.connections);
+    rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    Workload work;
+    if (!loadWorkload(opt, work)) {
+        cerr << "Cannot read series/models from " << opt.host << ":" << opt.port << " (is byd_server running?)" << endl;
+        return 1;
+    }
+    cout << "target  " << opt.host << ":" << opt.port << ", " << opt.connections << " connections, " << opt.threads
+         << " threads, " << (opt.rate > 0 ? "open loop at " + to_string((long long)opt.rate) + " req/s" : "closed loop")
+         << ", " << opt.seconds << " s after " << opt.warmup << " s warmup" << endl;
+    cout << "data    " << work.series_ids.size() << " series, " << work.tech_ids.size() << " techs, "
+         << work.model_ids.size() << " models, "
+         << work.keywords.size() << " search keywords; mix";
+    for (unsigned k = 0; k < kOpCount; k++) if (opt.mix[k]) cout << " " << kOpNames[k] << ":" << opt.mix[k];
+    cout << endl;
+
+    vector<unique_ptr<Worker>> workers;
+    for (unsigned t = 0; t < opt.threads; t++) {
+        unsigned n = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        workers.emplace_back(new Worker(opt, work, t, n));
+    }
+    uint64_t begin = nowNs();
+    uint64_t measure = begin + (uint64_t)(opt.warmup * 1e9);
+    uint64_t end = measure + (uint64_t)(opt.seconds * 1e9);
+    vector<thread> threads;
+    for (auto& w : workers) {
+        Worker* wp = w.get();
+        threads.emplace_back([&, wp]() { wp->run(begin, measure, end, opt.rate / opt.threads); });
+    }
+    for (auto& t : threads) t.join();
+
+    ThreadResult all;
+    for (auto& w : workers) {
+        for (unsigned k = 0; k < kOpCount; k++) {
+            all.latency[k].merge(w->result.latency[k]);
+            all.service[k].merge(w->result.service[k]);
+            all.errors[k].merge(w->result.errors[k]);
+        }
+    }
+    Histogram total_latency, total_service;
+    Errors total_errors;
+    for (unsigned k = 0; k < kOpCount; k++) {
+        total_latency.merge(all.latency[k]);
+        total_service.merge(all.service[k]);
+        total_errors.merge(all.errors[k]);
+    }
+
+    // 闭环时的预期间隔: 每个连接两次请求之间的平均时间, 即平均延迟
+    uint64_t expected_ns = opt.rate > 0 ? 0 : (uint64_t)(total_latency.meanMs() * 1e6);
+    if (opt.rate > 0) {
+        cout << "latency from scheduled send time (ms, includes queueing behind busy connections)" << endl;
+    } else {
+        cout << "latency corrected for coordinated omission, expected interval " << expected_ns / 1e6 << " ms" << endl;
+    }
+    cout << "op           count     req/s     mean      p50      p90      p99    p99.9      max  errors" << endl;
+    for (unsigned k = 0; k < kOpCount; k++) {
+        if (!opt.mix[k]) continue;
+        printRow(kOpNames[k], all.latency[k].total, all.latency[k].corrected(expected_ns), all.errors[k], opt.seconds);
+    }
+    printRow("total", total_latency.total, total_latency.corrected(expected_ns), total_errors, opt.seconds);
+    // 开环: 从实际发送算起的服务时间; 闭环: 未补偿的原始延迟
+    printRow(opt.rate > 0 ? "service" : "raw", total_latency.total, opt.rate > 0 ? total_service : total_latency,
+             total_errors, opt.seconds);
+    cout << "errors  " << total_errors.status << " non-2xx, " << total_errors.rejected << " ok:false, "
+         << total_errors.timeouts << " timeouts, " << total_errors.connect << " connection errors" << endl;
+    if (opt.rate > 0 && total_latency.total + total_errors.sum() < opt.rate * opt.seconds * 0.95) {
+        cout << "note    completed " << (total_latency.total + total_errors.sum()) << " of "
+             << (uint64_t)(opt.rate * opt.seconds) << " scheduled requests: the server (or this client) cannot keep up"
+             << endl;
+    }
+    return 0;
+}
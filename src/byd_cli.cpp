@@ -16,11 +16,15 @@
 #include <algorithm>
 #include <sstream>
 #include <fstream>
+#include <unordered_map>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+#include "wal.h"
+#include "data_format.h"
+
 using namespace std;
 
 // =============================
@@ -408,32 +412,104 @@ KnowledgeGraph g_graph;
 // =============================
 
 const string DATA_FILE = "../data/byd_cli_data.txt";
+const string WAL_FILE = "../data/byd_cli_data.wal";
+
+// 追加写日志: 新增车型只追加一条记录, 退出时再合并进数据文件
+WriteAheadLog g_wal;
+uint64_t g_snapshot_lsn = 0;   // 数据文件中已包含的最大 lsn
 
 // 前向声明
 void buildKnowledgeGraph();
 
-string trim(const string& s) {
-    size_t start = s.find_first_not_of(" \t\r\n");
-    if (start == string::npos) return "";
-    size_t end = s.find_last_not_of(" \t\r\n");
-    return s.substr(start, end - start + 1);
+ModelRecord toRecord(const Model& m) {
+    ModelRecord r;
+    r.id = m.id;
+    r.name = m.name;
+    r.series_id = m.series_id;
+    r.price = m.price;
+    r.range_km = m.range_km;
+    r.energy_type = m.energy_type;
+    r.body_type = m.body_type;
+    r.seats = m.seats;
+    r.launch_year = m.launch_year;
+    return r;
 }
 
-// 分割字符串
-vector<string> split(const string& s, char delimiter) {
-    vector<string> tokens;
-    stringstream ss(s);
-    string token;
-    while (getline(ss, token, delimiter)) {
-        tokens.push_back(trim(token));
+// 数据文件的记录事件 -> 链表。内联技术列表直接属于同一行的车型; [MODEL_TECH] 段的关联
+// 在解析结束后并入对应车型, 因此 Web 布局的文件也可以直接加载
+struct CliLoadSink {
+    vector<Model> models;
+    vector<pair<int, int>> links;
+    size_t model_line = SIZE_MAX;
+
+    void onSeries(const SeriesRecord& r, size_t) { g_series.append({ r.id, string(r.name), string(r.intro) }); }
+    void onTech(const TechRecord& r, size_t) { g_techs.append({ r.id, string(r.name), string(r.intro) }); }
+    void onModel(const ModelRecord& r, size_t line) {
+        Model m;
+        m.id = r.id;
+        m.name = string(r.name);
+        m.series_id = r.series_id;
+        m.price = r.price;
+        m.range_km = r.range_km;
+        m.energy_type = string(r.energy_type);
+        m.body_type = string(r.body_type);
+        m.seats = r.seats;
+        m.launch_year = string(r.launch_year);
+        models.push_back(std::move(m));
+        model_line = line;
+    }
+    void onModelTech(const ModelTechRecord& r, size_t line) {
+        if (line == model_line) models.back().tech_ids.push_back(r.tech_id);
+        else links.emplace_back(r.model_id, r.tech_id);
+    }
+
+    // 把关联并入车型 (id 重复时归第一个), 然后按顺序加入 g_models
+    void finish() {
+        unordered_map<int, size_t> index;
+        for (size_t i = 0; i < models.size(); i++) index.emplace(models[i].id, i);
+        for (const auto& l : links) {
+            auto it = index.find(l.first);
+            if (it != index.end()) models[it->second].tech_ids.push_back(l.second);
+        }
+        for (const Model& m : models) g_models.append(m);
+        models.clear();
+        links.clear();
+        model_line = SIZE_MAX;
+    }
+};
+
+// 车型序列化为一行, 不含换行 (WAL 记录)
+string formatModelLine(const Model& m) {
+    string line;
+    appendModelLine(line, toRecord(m), DataLayout::Cli, m.tech_ids.data(), m.tech_ids.size());
+    line.pop_back();
+    return line;
+}
+
+// 在数据文件之上回放 WAL 中的新增车型, 然后打开 WAL 继续追加
+void replayWal() {
+    WriteAheadLog::ReplayStats stats;
+    string err;
+    CliLoadSink sink;
+    bool ok = WriteAheadLog::replay(WAL_FILE, g_snapshot_lsn, [&](uint64_t, string_view payload) {
+        TextRecord r;
+        string err;
+        if (payload.empty() || payload[0] != 'M') return;
+        r.assign(payload.substr(1));
+        r.section = TextSection::Model;
+        parseDataRecord(r, sink, err);
+    }, stats, err);
+    sink.finish();
+    if (!ok || !g_wal.open(WAL_FILE, stats.last_lsn, err)) {
+        cerr << "  警告: " << err << ", 新增数据将无法保存\n";
     }
-    return tokens;
 }
 
 // 从文件加载数据
 bool loadData() {
-    ifstream file(DATA_FILE);
-    if (!file.is_open()) {
+    TextDataLoader loader;
+    string open_err;
+    if (!loader.open(DATA_FILE, open_err)) {
         cerr << "  警告: 无法打开数据文件 " << DATA_FILE << "\n";
         return false;
     }
@@ -443,64 +519,19 @@ bool loadData() {
     g_models.clear();
     g_graph.clear();
     
-    string line;
-    string currentSection;
+    // 两种布局 (车型行内联技术列表 / 独立的 [MODEL_TECH] 段) 都可以加载
+    CliLoadSink sink;
+    loader.parse([&](const TextRecord& r, string& err) { return parseDataRecord(r, sink, err); });
+    sink.finish();
+    g_snapshot_lsn = loader.walLsn();
     
-    while (getline(file, line)) {
-        line = trim(line);
-        if (line.empty() || line[0] == '#') continue;
-        
-        if (line == "[SERIES]") {
-            currentSection = "SERIES";
-            continue;
-        } else if (line == "[TECH]") {
-            currentSection = "TECH";
-            continue;
-        } else if (line == "[MODEL]") {
-            currentSection = "MODEL";
-            continue;
-        }
-        
-        vector<string> parts = split(line, ',');
-        
-        if (currentSection == "SERIES" && parts.size() >= 3) {
-            Series s;
-            s.id = stoi(parts[0]);
-            s.name = parts[1];
-            s.intro = parts[2];
-            g_series.append(s);
-        }
-        else if (currentSection == "TECH" && parts.size() >= 3) {
-            Tech t;
-            t.id = stoi(parts[0]);
-            t.name = parts[1];
-            t.intro = parts[2];
-            g_techs.append(t);
-        }
-        else if (currentSection == "MODEL" && parts.size() >= 10) {
-            Model m;
-            m.id = stoi(parts[0]);
-            m.name = parts[1];
-            m.series_id = stoi(parts[2]);
-            m.price = stod(parts[3]);
-            m.range_km = stod(parts[4]);
-            m.energy_type = parts[5];
-            m.body_type = parts[6];
-            m.seats = stoi(parts[7]);
-            m.launch_year = parts[8];
-            
-            // 解析技术ID列表 (用|分隔)
-            vector<string> techIds = split(parts[9], '|');
-            for (const auto& tid : techIds) {
-                if (!tid.empty()) {
-                    m.tech_ids.push_back(stoi(tid));
-                }
-            }
-            g_models.append(m);
-        }
+    if (loader.errorCount() > 0) {
+        cerr << "  警告: 数据文件中有 " << loader.errorCount() << " 行格式错误, 已跳过\n";
+        for (const auto& e : loader.errors()) cerr << "    第 " << e.line << " 行: " << e.message << "\n";
     }
     
-    file.close();
+    // 回放上次退出后尚未合并的新增记录
+    replayWal();
     
     // 构建知识图谱（邻接表）
     buildKnowledgeGraph();
@@ -538,54 +569,47 @@ void buildKnowledgeGraph() {
     }
 }
 
-// 保存数据到文件
-bool saveData() {
-    ofstream file(DATA_FILE);
-    if (!file.is_open()) {
+// 保存数据到文件 (临时文件 + rename, 写入中途失败不会破坏原文件)
+bool saveData(uint64_t lsn) {
+    AtomicFileWriter file(DATA_FILE);
+    if (!file.isOpen()) {
         cerr << "  错误: 无法写入数据文件 " << DATA_FILE << "\n";
         return false;
     }
     
-    file << "# BYD汽车信息系统 - CLI版本数据文件\n";
-    file << "# 格式说明：\n";
-    file << "# [SERIES] 系列数据: id,名称,简介\n";
-    file << "# [TECH] 技术数据: id,名称,简介\n";
-    file << "# [MODEL] 车型数据: id,名称,系列id,价格,续航,能源类型,车身类型,座位数,年份,技术id列表(用|分隔)\n\n";
-    
-    // 写入系列数据（遍历链表）
-    file << "[SERIES]\n";
-    for (const auto& s : g_series) {
-        file << s.id << "," << s.name << "," << s.intro << "\n";
-    }
-    file << "\n";
-    
-    // 写入技术数据（遍历链表）
-    file << "[TECH]\n";
-    for (const auto& t : g_techs) {
-        file << t.id << "," << t.name << "," << t.intro << "\n";
-    }
-    file << "\n";
-    
-    // 写入车型数据（遍历链表）
-    file << "[MODEL]\n";
+    string out;
+    appendFileHeader(out, DataLayout::Cli, lsn);
+    out += "[SERIES]\n";
+    for (const auto& s : g_series) appendSeriesLine(out, { s.id, s.name, s.intro });
+    out += "\n[TECH]\n";
+    for (const auto& t : g_techs) appendTechLine(out, { t.id, t.name, t.intro });
+    out += "\n[MODEL]\n";
     for (const auto& m : g_models) {
-        file << m.id << "," << m.name << "," << m.series_id << ","
-             << fixed << setprecision(2) << m.price << ","
-             << (int)m.range_km << "," << m.energy_type << ","
-             << m.body_type << "," << m.seats << "," << m.launch_year << ",";
-        
-        // 写入技术ID列表
-        for (size_t i = 0; i < m.tech_ids.size(); i++) {
-            if (i > 0) file << "|";
-            file << m.tech_ids[i];
-        }
-        file << "\n";
+        appendModelLine(out, toRecord(m), DataLayout::Cli, m.tech_ids.data(), m.tech_ids.size());
+        if (out.size() >= (1u << 20)) { file.write(out); out.clear(); }
     }
+    file.write(out);
     
-    file.close();
+    string err;
+    if (!file.commit(err)) {
+        cerr << "  错误: " << err << "\n";
+        return false;
+    }
     return true;
 }
 
+// 把 WAL 合并进数据文件 (退出时调用)
+void compactData() {
+    uint64_t lsn = g_wal.lastLsn();
+    if (!g_wal.isOpen() || lsn <= g_snapshot_lsn) return;
+    string err;
+    g_wal.rotate(err);
+    if (saveData(lsn)) {
+        g_snapshot_lsn = lsn;
+        g_wal.removeRotated();
+    }
+}
+
 // 初始化数据 - 从文件加载
 void initData() {
     if (!loadData()) {
@@ -1063,11 +1087,12 @@ void addNewModel() {
         g_graph.addEdge(newModel.id, techId, EdgeType::USES_TECH);
     }
     
-    // 保存到文件
-    if (saveData()) {
-        cout << "\n✓ 车型添加成功! ID: " << newModel.id << " (已保存到文件)\n";
+    // 追加到 WAL (不再整体重写数据文件)
+    g_wal.append("M" + formatModelLine(newModel));
+    if (g_wal.isOpen() && g_wal.commit()) {
+        cout << "\n✓ 车型添加成功! ID: " << newModel.id << " (已写入日志)\n";
     } else {
-        cout << "\n✓ 车型添加成功! ID: " << newModel.id << " (警告: 保存到文件失败)\n";
+        cout << "\n✓ 车型添加成功! ID: " << newModel.id << " (警告: 写入日志失败)\n";
     }
 }
 
@@ -1176,6 +1201,7 @@ int main() {
             case 8: addNewModel(); break;
             case 9: showStats(); break;
             case 0: 
+                compactData();
                 cout << "\n  感谢使用，再见！\n\n";
                 break;
             default:
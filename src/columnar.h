@@ -0,0 +1,680 @@
+/**
+ * 压缩列式数据文件 (.bydc), 用于向只读副本分发目录数据
+ *
+ * 文件以 8 字节 "BYDCOL01" 开头, 之后是连续的块 [u8 类型][u32 长度][u32 CRC32C][数据], 以 'E' 块结尾:
+ *   'H' 文件信息: 格式版本, 行组大小, WAL lsn, 各表行数
+ *   'S' / 'T' 系列 / 技术表 (行数很少, 各一块)
+ *   'D' 车型字符串列的文件级字典 (能源类型, 车身类型, 年份)
+ *   'M' 车型行组: 行数与统计 (id / 系列 / 价格 / 续航 / 座位的最小最大值), 之后逐列编码
+ *   'L' 车型-技术关联行组 (按 model_id, tech_id 排序)
+ * 列编码:
+ *   整数      帧参考 (减去最小值后按位宽打包) 或差分 (相邻差再做帧参考), 取较小者
+ *   价格/续航 全部是两位小数时转为定点整数 (x100) 按整数编码, 否则原样存 double
+ *   字典列    字典编号按整数编码
+ *   其他字符串 前缀压缩: 与上一行的公共前缀长度、其余部分长度按整数编码, 之后是拼接的其余部分
+ * 行组统计与快照的行组统计 (snapshot.h kZoneRows) 使用同样的行数, 读者可以只看统计跳过整组;
+ * 读取时统计会与解码结果核对。整个文件直接解码进 SnapshotBuilder 的记录数组与字符串堆, 不经过文本解析。
+ */
+
+#ifndef BYD_COLUMNAR_H
+#define BYD_COLUMNAR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "crc32c.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "wal.h"
+
+namespace columnar_detail {
+
+const char kMagic[8] = { 'B', 'Y', 'D', 'C', 'O', 'L', '0', '1' };
+const uint32_t kVersion = 1;
+const size_t kBlockHeaderSize = 9;              // 类型 + 长度 + CRC
+const uint32_t kMaxBlock = 256u * 1024 * 1024;  // 单块上限, 超过视为损坏
+
+enum IntMode : uint8_t { kFrameOfReference = 0, kDelta = 1 };
+enum RealMode : uint8_t { kFixed2 = 0, kRawDouble = 1 };
+
+inline unsigned bitWidth(uint64_t v) {
+    unsigned n = 0;
+    while (v) { v >>= 1; n++; }
+    return n;
+}
+
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+class Writer {
+public:
+    std::string buf;
+
+    void putU8(uint8_t v) { buf += (char)v; }
+    void putU32(uint32_t v) { wal_detail::putU32(buf, v); }
+    void putU64(uint64_t v) { wal_detail::putU64(buf, v); }
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buf += (char)(v | 0x80);
+            v >>= 7;
+        }
+        buf += (char)v;
+    }
+    void putSigned(int64_t v) { putVarint(zigzag(v)); }
+    void putDouble(double v) {
+        uint64_t u;
+        std::memcpy(&u, &v, 8);
+        putU64(u);
+    }
+    void putBytes(std::string_view s) { buf.append(s.data(), s.size()); }
+
+    // n 个 bits 位的值, 低位在前连续存放, 共 ceil(n * bits / 8) 字节
+    void putBits(const uint64_t* v, size_t n, unsigned bits) {
+        if (bits == 0) return;
+        uint64_t acc = 0;
+        unsigned fill = 0;
+        for (size_t i = 0; i < n; i++) {
+            acc |= v[i] << fill;
+            if (fill + bits >= 64) {
+                putU64(acc);
+                acc = fill ? v[i] >> (64 - fill) : 0;
+                fill = fill + bits - 64;
+            } else {
+                fill += bits;
+            }
+        }
+        for (unsigned b = 0; b < fill; b += 8) buf += (char)(acc >> b);
+    }
+};
+
+class Reader {
+public:
+    Reader(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return p_ == end_; }
+
+    bool take(size_t n, const char*& out) {
+        if (!ok_ || (size_t)(end_ - p_) < n) return ok_ = false;
+        out = p_;
+        p_ += n;
+        return true;
+    }
+    uint8_t getU8() {
+        const char* q;
+        return take(1, q) ? (uint8_t)*q : 0;
+    }
+    uint32_t getU32() {
+        const char* q;
+        return take(4, q) ? wal_detail::getU32(q) : 0;
+    }
+    uint64_t getU64() {
+        const char* q;
+        return take(8, q) ? wal_detail::getU64(q) : 0;
+    }
+    uint64_t getVarint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t b = getU8();
+            if (!ok_) return 0;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok_ = false;
+        return 0;
+    }
+    int64_t getSigned() { return unzigzag(getVarint()); }
+    double getDouble() {
+        uint64_t u = getU64();
+        double d;
+        std::memcpy(&d, &u, 8);
+        return d;
+    }
+    // 行数来自文件内容, 先确认剩余字节足以容纳, 避免按损坏的行数分配内存
+    bool checkCount(uint64_t n, size_t min_bytes_each) {
+        if (!ok_ || n > (uint64_t)(end_ - p_) * 8 / (min_bytes_each ? min_bytes_each : 1) + 8) return ok_ = false;
+        return true;
+    }
+
+    bool getBits(size_t n, unsigned bits, uint64_t* out) {
+        if (bits > 64) return ok_ = false;
+        size_t bytes = (size_t)(((uint64_t)n * bits + 7) / 8);
+        const char* q;
+        if (!take(bytes, q)) return false;
+        if (bits == 0) {
+            std::fill(out, out + n, 0);
+            return true;
+        }
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(q);
+        const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        uint64_t bitpos = 0;
+        for (size_t i = 0; i < n; i++, bitpos += bits) {
+            size_t byte = (size_t)(bitpos >> 3);
+            unsigned shift = (unsigned)(bitpos & 7);
+            uint64_t lo = 0;
+            std::memcpy(&lo, u + byte, std::min<size_t>(8, bytes - byte));   // 小端序假设
+            uint64_t v = lo >> shift;
+            if (shift + bits > 64) v |= (uint64_t)u[byte + 8] << (64 - shift);
+            out[i] = v & mask;
+        }
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+// 整数列: 帧参考与差分中取打包后较小的一种
+inline void putIntColumn(Writer& w, const std::vector<int64_t>& v, std::vector<uint64_t>& tmp) {
+    size_t n = v.size();
+    if (n == 0) return;
+    int64_t lo = *std::min_element(v.begin(), v.end());
+    int64_t hi = *std::max_element(v.begin(), v.end());
+    unsigned for_bits = bitWidth((uint64_t)(hi - lo));
+    unsigned delta_bits = 64;
+    int64_t dlo = 0;
+    if (n >= 2) {
+        dlo = INT64_MAX;
+        int64_t dhi = INT64_MIN;
+        for (size_t i = 1; i < n; i++) {
+            int64_t d = v[i] - v[i - 1];
+            dlo = std::min(dlo, d);
+            dhi = std::max(dhi, d);
+        }
+        delta_bits = bitWidth((uint64_t)(dhi - dlo));
+    }
+    tmp.resize(n);
+    if (n >= 2 && (uint64_t)delta_bits * (n - 1) < (uint64_t)for_bits * n) {
+        w.putU8(kDelta);
+        w.putSigned(v[0]);
+        w.putSigned(dlo);
+        w.putU8((uint8_t)delta_bits);
+        for (size_t i = 1; i < n; i++) tmp[i - 1] = (uint64_t)(v[i] - v[i - 1] - dlo);
+        w.putBits(tmp.data(), n - 1, delta_bits);
+    } else {
+        w.putU8(kFrameOfReference);
+        w.putSigned(lo);
+        w.putU8((uint8_t)for_bits);
+        for (size_t i = 0; i < n; i++) tmp[i] = (uint64_t)(v[i] - lo);
+        w.putBits(tmp.data(), n, for_bits);
+    }
+}
+
+inline bool getIntColumn(Reader& r, size_t n, std::vector<int64_t>& out, std::vector<uint64_t>& tmp) {
+    out.resize(n);
+    if (n == 0) return true;
+    tmp.resize(n);
+    uint8_t mode = r.getU8();
+    if (mode == kDelta) {
+        int64_t first = r.getSigned();
+        int64_t dlo = r.getSigned();
+        unsigned bits = r.getU8();
+        if (!r.getBits(n - 1, bits, tmp.data())) return false;
+        out[0] = first;
+        for (size_t i = 1; i < n; i++) out[i] = out[i - 1] + (int64_t)tmp[i - 1] + dlo;
+        return true;
+    }
+    if (mode != kFrameOfReference) return false;
+    int64_t lo = r.getSigned();
+    unsigned bits = r.getU8();
+    if (!r.getBits(n, bits, tmp.data())) return false;
+    for (size_t i = 0; i < n; i++) out[i] = lo + (int64_t)tmp[i];
+    return r.ok();
+}
+
+// 价格、续航: 全部是两位小数 (x100 后为整数且能还原为同一个 double) 时按定点整数存
+inline void putRealColumn(Writer& w, const std::vector<double>& v, std::vector<int64_t>& fixed,
+                          std::vector<uint64_t>& tmp) {
+    fixed.resize(v.size());
+    bool exact = true;
+    for (size_t i = 0; i < v.size() && exact; i++) {
+        exact = std::fabs(v[i]) < 1e13;
+        if (exact) {
+            fixed[i] = std::llround(v[i] * 100);
+            exact = (double)fixed[i] / 100 == v[i];
+        }
+    }
+    if (exact) {
+        w.putU8(kFixed2);
+        putIntColumn(w, fixed, tmp);
+    } else {
+        w.putU8(kRawDouble);
+        for (double d : v) w.putDouble(d);
+    }
+}
+
+inline bool getRealColumn(Reader& r, size_t n, std::vector<double>& out, std::vector<int64_t>& fixed,
+                          std::vector<uint64_t>& tmp) {
+    out.resize(n);
+    if (n == 0) return true;
+    uint8_t mode = r.getU8();
+    if (mode == kFixed2) {
+        if (!getIntColumn(r, n, fixed, tmp)) return false;
+        for (size_t i = 0; i < n; i++) out[i] = (double)fixed[i] / 100;
+        return true;
+    }
+    if (mode != kRawDouble) return false;
+    for (size_t i = 0; i < n; i++) out[i] = r.getDouble();
+    return r.ok();
+}
+
+// 字符串列按前缀压缩: 每行记录与上一行的公共前缀长度和其余部分的长度 (均按整数编码), 之后是拼接的其余部分
+inline void putStringColumn(Writer& w, const std::vector<std::string_view>& v, std::vector<int64_t>& lens,
+                            std::vector<uint64_t>& tmp) {
+    std::vector<int64_t> prefix(v.size());
+    lens.resize(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        size_t p = 0;
+        if (i > 0) {
+            size_t limit = std::min(v[i].size(), v[i - 1].size());
+            while (p < limit && v[i][p] == v[i - 1][p]) p++;
+        }
+        prefix[i] = (int64_t)p;
+        lens[i] = (int64_t)(v[i].size() - p);
+    }
+    putIntColumn(w, prefix, tmp);
+    putIntColumn(w, lens, tmp);
+    for (size_t i = 0; i < v.size(); i++) w.putBytes(v[i].substr((size_t)prefix[i]));
+}
+
+// 解码结果存放在 arena 中, out 指向 arena (arena 在下一次解码前有效)
+inline bool getStringColumn(Reader& r, size_t n, std::vector<std::string_view>& out, std::string& arena,
+                            std::vector<int64_t>& prefix, std::vector<int64_t>& lens, std::vector<uint64_t>& tmp) {
+    out.resize(n);
+    if (!getIntColumn(r, n, prefix, tmp) || !getIntColumn(r, n, lens, tmp)) return false;
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t prev = i > 0 ? prefix[i - 1] + lens[i - 1] : 0;
+        if (prefix[i] < 0 || lens[i] < 0 || prefix[i] > prev || (uint64_t)lens[i] > kMaxBlock) return false;
+        total += (uint64_t)(prefix[i] + lens[i]);
+    }
+    if (total > (uint64_t)kMaxBlock * 64) return false;
+    arena.clear();
+    arena.reserve((size_t)total);     // 之后不再扩容, 已生成的 string_view 保持有效
+    size_t prev_begin = 0;
+    for (size_t i = 0; i < n; i++) {
+        const char* q;
+        if (!r.take((size_t)lens[i], q)) return false;
+        size_t begin = arena.size();
+        arena.append(arena, prev_begin, (size_t)prefix[i]);
+        arena.append(q, (size_t)lens[i]);
+        out[i] = std::string_view(arena.data() + begin, arena.size() - begin);
+        prev_begin = begin;
+    }
+    return true;
+}
+
+// 车型行组统计
+struct GroupStats {
+    int64_t min_id, max_id;
+    int64_t min_series_id, max_series_id;
+    double min_price, max_price;
+    double min_range, max_range;
+    int64_t min_seats, max_seats;
+
+    template <typename Rows>
+    static GroupStats of(const Rows& rows, size_t begin, size_t end) {
+        const auto& f = rows[begin];
+        GroupStats s = { f.id, f.id, f.series_id, f.series_id, f.price, f.price, f.range_km, f.range_km, f.seats, f.seats };
+        for (size_t i = begin + 1; i < end; i++) {
+            const auto& m = rows[i];
+            s.min_id = std::min<int64_t>(s.min_id, m.id);
+            s.max_id = std::max<int64_t>(s.max_id, m.id);
+            s.min_series_id = std::min<int64_t>(s.min_series_id, m.series_id);
+            s.max_series_id = std::max<int64_t>(s.max_series_id, m.series_id);
+            s.min_price = std::min(s.min_price, m.price);
+            s.max_price = std::max(s.max_price, m.price);
+            s.min_range = std::min(s.min_range, m.range_km);
+            s.max_range = std::max(s.max_range, m.range_km);
+            s.min_seats = std::min<int64_t>(s.min_seats, m.seats);
+            s.max_seats = std::max<int64_t>(s.max_seats, m.seats);
+        }
+        return s;
+    }
+
+    void write(Writer& w) const {
+        w.putSigned(min_id); w.putSigned(max_id);
+        w.putSigned(min_series_id); w.putSigned(max_series_id);
+        w.putDouble(min_price); w.putDouble(max_price);
+        w.putDouble(min_range); w.putDouble(max_range);
+        w.putSigned(min_seats); w.putSigned(max_seats);
+    }
+
+    void read(Reader& r) {
+        min_id = r.getSigned(); max_id = r.getSigned();
+        min_series_id = r.getSigned(); max_series_id = r.getSigned();
+        min_price = r.getDouble(); max_price = r.getDouble();
+        min_range = r.getDouble(); max_range = r.getDouble();
+        min_seats = r.getSigned(); max_seats = r.getSigned();
+    }
+
+    bool operator==(const GroupStats& o) const {
+        return min_id == o.min_id && max_id == o.max_id && min_series_id == o.min_series_id &&
+               max_series_id == o.max_series_id && min_price == o.min_price && max_price == o.max_price &&
+               min_range == o.min_range && max_range == o.max_range && min_seats == o.min_seats && max_seats == o.max_seats;
+    }
+};
+
+} // namespace columnar_detail
+
+struct ColumnarStats {
+    size_t series = 0;
+    size_t techs = 0;
+    size_t models = 0;
+    size_t model_techs = 0;
+    size_t row_groups = 0;
+    uint64_t wal_lsn = 0;
+    uint64_t bytes = 0;
+};
+
+// 由快照 (文件或 SnapshotBuilder::build 的内存映像) 写出列式文件, 经临时文件 + rename 原子写入
+inline bool writeColumnarFile(const MappedSnapshot& snap, const std::string& path, ColumnarStats& stats,
+                              std::string& err) {
+    using namespace columnar_detail;
+    AtomicFileWriter out(path);
+    if (!out.isOpen()) { err = "无法创建列式文件 " + path; return false; }
+    stats = ColumnarStats();
+    stats.wal_lsn = snap.walLsn();
+
+    std::string frame;
+    auto block = [&](char type, const Writer& w) {
+        frame.clear();
+        frame += type;
+        wal_detail::putU32(frame, (uint32_t)w.buf.size());
+        wal_detail::putU32(frame, crc32c(w.buf.data(), w.buf.size()));
+        out.write(frame);
+        out.write(w.buf);
+        stats.bytes += frame.size() + w.buf.size();
+    };
+    out.write(std::string_view(kMagic, sizeof(kMagic)));
+    stats.bytes = sizeof(kMagic);
+
+    const auto models = snap.models();
+    const auto links = snap.modelTechs();
+    Writer w;
+    w.putU32(kVersion);
+    w.putU32(snapshot_format::kZoneRows);
+    w.putU64(snap.walLsn());
+    w.putVarint(snap.series().size);
+    w.putVarint(snap.techs().size);
+    w.putVarint(models.size);
+    w.putVarint(links.size);
+    block('H', w);
+
+    std::vector<int64_t> ints, ints2;
+    std::vector<uint64_t> tmp;
+    std::vector<std::string_view> strs;
+    auto table = [&](char type, const auto& rows) {
+        Writer t;
+        t.putVarint(rows.size);
+        ints.clear();
+        for (const auto& r : rows) ints.push_back(r.id);
+        putIntColumn(t, ints, tmp);
+        strs.clear();
+        for (const auto& r : rows) strs.push_back(snap.str(r.name));
+        putStringColumn(t, strs, ints, tmp);
+        strs.clear();
+        for (const auto& r : rows) strs.push_back(snap.str(r.intro));
+        putStringColumn(t, strs, ints, tmp);
+        block(type, t);
+    };
+    table('S', snap.series());
+    table('T', snap.techs());
+
+    // 低基数字符串列的文件级字典
+    std::unordered_map<std::string_view, uint32_t> dicts[3];
+    std::vector<std::string_view> dict_values[3];
+    auto code = [&](int col, std::string_view s) {
+        auto it = dicts[col].find(s);
+        if (it != dicts[col].end()) return it->second;
+        uint32_t c = (uint32_t)dict_values[col].size();
+        dicts[col].emplace(s, c);
+        dict_values[col].push_back(s);
+        return c;
+    };
+    std::vector<uint32_t> codes[3];
+    for (int c = 0; c < 3; c++) codes[c].resize(models.size);
+    for (size_t i = 0; i < models.size; i++) {
+        codes[0][i] = code(0, snap.str(models[i].energy_type));
+        codes[1][i] = code(1, snap.str(models[i].body_type));
+        codes[2][i] = code(2, snap.str(models[i].launch_year));
+    }
+    Writer d;
+    for (auto& values : dict_values) {
+        d.putVarint(values.size());
+        putStringColumn(d, values, ints, tmp);
+    }
+    block('D', d);
+
+    std::vector<double> reals;
+    for (size_t b = 0; b < models.size; b += snapshot_format::kZoneRows) {
+        size_t e = std::min(models.size, b + (size_t)snapshot_format::kZoneRows);
+        Writer g;
+        g.putVarint(e - b);
+        GroupStats::of(models, b, e).write(g);
+        auto intCol = [&](auto get) {
+            ints.clear();
+            for (size_t i = b; i < e; i++) ints.push_back(get(models[i]));
+            putIntColumn(g, ints, tmp);
+        };
+        auto realCol = [&](auto get) {
+            reals.clear();
+            for (size_t i = b; i < e; i++) reals.push_back(get(models[i]));
+            putRealColumn(g, reals, ints2, tmp);
+        };
+        auto codeCol = [&](int c) {
+            ints.assign(codes[c].begin() + b, codes[c].begin() + e);
+            putIntColumn(g, ints, tmp);
+        };
+        intCol([](const SnapModel& m) { return (int64_t)m.id; });
+        strs.clear();
+        for (size_t i = b; i < e; i++) strs.push_back(snap.str(models[i].name));
+        putStringColumn(g, strs, ints, tmp);
+        intCol([](const SnapModel& m) { return (int64_t)m.series_id; });
+        realCol([](const SnapModel& m) { return m.price; });
+        realCol([](const SnapModel& m) { return m.range_km; });
+        codeCol(0);
+        codeCol(1);
+        intCol([](const SnapModel& m) { return (int64_t)m.seats; });
+        codeCol(2);
+        block('M', g);
+        stats.row_groups++;
+    }
+
+    for (size_t b = 0; b < links.size; b += snapshot_format::kZoneRows) {
+        size_t e = std::min(links.size, b + (size_t)snapshot_format::kZoneRows);
+        Writer g;
+        g.putVarint(e - b);
+        ints.clear();
+        for (size_t i = b; i < e; i++) ints.push_back(links[i].model_id);
+        putIntColumn(g, ints, tmp);
+        ints.clear();
+        for (size_t i = b; i < e; i++) ints.push_back(links[i].tech_id);
+        putIntColumn(g, ints, tmp);
+        block('L', g);
+    }
+
+    Writer end;
+    end.putVarint(stats.row_groups);
+    block('E', end);
+
+    stats.series = snap.series().size;
+    stats.techs = snap.techs().size;
+    stats.models = models.size;
+    stats.model_techs = links.size;
+    return out.commit(err);
+}
+
+// 判断文件是否为列式格式 (按文件头)
+inline bool isColumnarFile(const std::string& path) {
+    int fd = wal_detail::openRead(path.c_str());
+    if (fd < 0) return false;
+    char head[sizeof(columnar_detail::kMagic)];
+    long long n = wal_detail::readSome(fd, head, sizeof(head));
+    wal_detail::closeFd(fd);
+    return n == (long long)sizeof(head) && std::memcmp(head, columnar_detail::kMagic, sizeof(head)) == 0;
+}
+
+// 读取列式文件, 各表直接解码进 out; 任何块校验失败、统计不符或缺少结尾块时返回 false
+inline bool readColumnarFile(const std::string& path, SnapshotBuilder& out, ColumnarStats& stats, std::string& err) {
+    using namespace columnar_detail;
+    MappedFile file;
+    if (!file.open(path, err, true)) return false;
+    stats = ColumnarStats();
+    stats.bytes = file.size();
+    std::string_view data = file.view();
+    if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        err = "列式文件头无效: " + path;
+        return false;
+    }
+
+    uint64_t want_series = 0, want_techs = 0, want_models = 0, want_links = 0;
+    bool has_header = false, has_dict = false, has_end = false;
+    std::vector<snapshot_format::StrRef> dict_refs[3];
+    std::vector<int64_t> ids, series_ids, seats, codes[3], prefix, lens, fixed;
+    std::vector<uint64_t> tmp;
+    std::vector<double> prices, ranges;
+    std::vector<std::string_view> names, intros;
+    std::string name_arena, intro_arena;
+    size_t pos = sizeof(kMagic);
+    size_t block_no = 0;
+
+    auto fail = [&](const std::string& what) {
+        err = "列式文件已损坏 (第 " + std::to_string(block_no) + " 块" + what + "): " + path;
+        return false;
+    };
+
+    while (pos < data.size() && !has_end) {
+        block_no++;
+        if (data.size() - pos < kBlockHeaderSize) return fail(", 块头不完整");
+        char type = data[pos];
+        uint32_t len = wal_detail::getU32(data.data() + pos + 1);
+        uint32_t crc = wal_detail::getU32(data.data() + pos + 5);
+        pos += kBlockHeaderSize;
+        if (len > kMaxBlock || data.size() - pos < len) return fail(", 长度越界");
+        if (crc32c(data.data() + pos, len) != crc) return fail(", 校验和不符");
+        Reader r(data.data() + pos, len);
+        pos += len;
+        if (type != 'H' && !has_header) return fail(", 缺少文件信息");
+
+        switch (type) {
+            case 'H': {
+                uint32_t version = r.getU32();
+                uint32_t group_rows = r.getU32();
+                if (version != kVersion) {
+                    err = "列式文件版本 " + std::to_string(version) + " 与当前版本 " + std::to_string(kVersion) + " 不一致";
+                    return false;
+                }
+                (void)group_rows;   // 读取按每个行组自带的行数, 不依赖该值
+                stats.wal_lsn = r.getU64();
+                want_series = r.getVarint();
+                want_techs = r.getVarint();
+                want_models = r.getVarint();
+                want_links = r.getVarint();
+                if (!r.ok()) return fail(", 文件信息不完整");
+                out.reserveModels((size_t)std::min<uint64_t>(want_models, data.size()),
+                                  (size_t)std::min<uint64_t>(want_links, data.size()), 0);
+                has_header = true;
+                break;
+            }
+            case 'S':
+            case 'T': {
+                uint64_t n = r.getVarint();
+                if (!r.checkCount(n, 0) || !getIntColumn(r, (size_t)n, ids, tmp) ||
+                    !getStringColumn(r, (size_t)n, names, name_arena, prefix, lens, tmp) ||
+                    !getStringColumn(r, (size_t)n, intros, intro_arena, prefix, lens, tmp)) {
+                    return fail("");
+                }
+                for (size_t i = 0; i < n; i++) {
+                    if (type == 'S') out.addSeries((int32_t)ids[i], names[i], intros[i]);
+                    else out.addTech((int32_t)ids[i], names[i], intros[i]);
+                }
+                (type == 'S' ? stats.series : stats.techs) += (size_t)n;
+                break;
+            }
+            case 'D': {
+                for (auto& refs : dict_refs) {
+                    uint64_t n = r.getVarint();
+                    if (!r.checkCount(n, 0) || !getStringColumn(r, (size_t)n, names, name_arena, prefix, lens, tmp)) return fail("");
+                    refs.clear();
+                    for (std::string_view s : names) refs.push_back(out.internString(s));
+                }
+                has_dict = true;
+                break;
+            }
+            case 'M': {
+                if (!has_dict) return fail(", 车型行组出现在字典之前");
+                uint64_t n = r.getVarint();
+                GroupStats want;
+                want.read(r);
+                size_t rows = (size_t)n;
+                bool ok = r.checkCount(n, 0) && n > 0 &&
+                          getIntColumn(r, rows, ids, tmp) && getStringColumn(r, rows, names, name_arena, prefix, lens, tmp) &&
+                          getIntColumn(r, rows, series_ids, tmp) && getRealColumn(r, rows, prices, fixed, tmp) &&
+                          getRealColumn(r, rows, ranges, fixed, tmp) && getIntColumn(r, rows, codes[0], tmp) &&
+                          getIntColumn(r, rows, codes[1], tmp) && getIntColumn(r, rows, seats, tmp) &&
+                          getIntColumn(r, rows, codes[2], tmp);
+                if (!ok) return fail("");
+                struct Row { int64_t id, series_id; double price, range_km; int64_t seats; };
+                std::vector<Row> check(rows);
+                for (size_t i = 0; i < rows; i++) {
+                    SnapModel m;
+                    m.price = prices[i];
+                    m.range_km = ranges[i];
+                    m.id = (int32_t)ids[i];
+                    m.series_id = (int32_t)series_ids[i];
+                    m.seats = (int32_t)seats[i];
+                    m.pad = 0;
+                    m.name = out.addString(names[i]);
+                    snapshot_format::StrRef* refs[3] = { &m.energy_type, &m.body_type, &m.launch_year };
+                    for (int c = 0; c < 3; c++) {
+                        if (codes[c][i] < 0 || (uint64_t)codes[c][i] >= dict_refs[c].size()) return fail(", 字典编号越界");
+                        *refs[c] = dict_refs[c][(size_t)codes[c][i]];
+                    }
+                    out.addModel(m);
+                    check[i] = { ids[i], series_ids[i], prices[i], ranges[i], seats[i] };
+                }
+                if (!(GroupStats::of(check, 0, rows) == want)) return fail(", 行组统计与数据不符");
+                stats.models += rows;
+                stats.row_groups++;
+                break;
+            }
+            case 'L': {
+                uint64_t n = r.getVarint();
+                if (!r.checkCount(n, 0) || !getIntColumn(r, (size_t)n, ids, tmp) ||
+                    !getIntColumn(r, (size_t)n, series_ids, tmp)) {
+                    return fail("");
+                }
+                for (size_t i = 0; i < n; i++) out.addModelTech((int32_t)ids[i], (int32_t)series_ids[i]);
+                stats.model_techs += (size_t)n;
+                break;
+            }
+            case 'E':
+                if (r.getVarint() != stats.row_groups || !r.ok()) return fail(", 行组数不符");
+                has_end = true;
+                break;
+            default:
+                break;      // 未知块: 向前兼容, 跳过
+        }
+    }
+    if (!has_end) {
+        err = "列式文件不完整 (缺少结尾块): " + path;
+        return false;
+    }
+    if (stats.series != want_series || stats.techs != want_techs || stats.models != want_models ||
+        stats.model_techs != want_links) {
+        err = "列式文件已损坏 (行数与文件信息不符): " + path;
+        return false;
+    }
+    return true;
+}
+
+#endif // BYD_COLUMNAR_H
@@ -0,0 +1,151 @@
+/**
+ * CRC-32C (Castagnoli) 校验
+ *
+ * 用于 WAL 记录与快照文件的完整性校验。x86-64 上运行时检测 SSE4.2, 可用时用 crc32 指令
+ * (三路交错, 单核约 9 GB/s, 校验大快照时不低于磁盘带宽); AArch64 开启 CRC 扩展时用对应指令;
+ * 其他情况用软件 slicing-by-8。
+ */
+
+#ifndef BYD_CRC32C_H
+#define BYD_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define BYD_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define BYD_CRC32C_ARM 1
+#endif
+
+namespace crc32c_detail {
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : (c >> 1);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int s = 1; s < 8; s++) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+inline const Tables& tables() {
+    static const Tables tb;
+    return tb;
+}
+
+inline uint32_t software(const unsigned char* p, size_t n, uint32_t crc) {
+    const auto& t = tables().t;
+    while (n >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;   // 小端序假设 (x86 / ARM)
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+// GF(2) 上 a * b mod P (反射表示, 1 << 31 表示 x^0), 用于把一段 CRC 平移 n 个零字节后与后续段合并
+inline uint32_t multModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0x82F63B78u : (b >> 1);
+    }
+    return p;
+}
+
+// x^(8 * bytes) mod P
+inline uint32_t shiftOperator(size_t bytes) {
+    uint32_t result = 1u << 31, base = 1u << 30;
+    for (uint64_t e = (uint64_t)bytes * 8; e; e >>= 1) {
+        if (e & 1) result = multModP(base, result);
+        base = multModP(base, base);
+    }
+    return result;
+}
+
+#if defined(BYD_CRC32C_X86)
+// crc32 指令延迟 3 周期、吞吐 1 周期: 三段交错计算再合并, 接近吞吐上限
+__attribute__((target("sse4.2"))) inline uint32_t hardware(const unsigned char* p, size_t n, uint32_t crc) {
+    const size_t kBlock = 4096;
+    static const uint32_t shift_block = shiftOperator(kBlock);
+    uint64_t c0 = crc;
+    while (n >= 3 * kBlock) {
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < kBlock; i += 8) {
+            uint64_t v0, v1, v2;
+            std::memcpy(&v0, p + i, 8);
+            std::memcpy(&v1, p + kBlock + i, 8);
+            std::memcpy(&v2, p + 2 * kBlock + i, 8);
+            c0 = _mm_crc32_u64(c0, v0);
+            c1 = _mm_crc32_u64(c1, v1);
+            c2 = _mm_crc32_u64(c2, v2);
+        }
+        uint32_t c = multModP(shift_block, (uint32_t)c0) ^ (uint32_t)c1;
+        c0 = multModP(shift_block, c) ^ (uint32_t)c2;
+        p += 3 * kBlock;
+        n -= 3 * kBlock;
+    }
+    while (n >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c0 = _mm_crc32_u64(c0, v);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = (uint32_t)c0;
+    while (n--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+inline bool hasHardware() {
+    static const bool ok = __builtin_cpu_supports("sse4.2");
+    return ok;
+}
+#elif defined(BYD_CRC32C_ARM)
+inline uint32_t hardware(const unsigned char* p, size_t n, uint32_t crc) {
+    while (n >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+
+inline bool hasHardware() { return true; }
+#endif
+
+} // namespace crc32c_detail
+
+// 增量计算: crc = crc32c(data, n, crc) 可分段调用, 初值为 0
+inline uint32_t crc32c(const void* data, size_t n, uint32_t crc = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+#if defined(BYD_CRC32C_X86) || defined(BYD_CRC32C_ARM)
+    if (crc32c_detail::hasHardware()) return ~crc32c_detail::hardware(p, n, ~crc);
+#endif
+    return ~crc32c_detail::software(p, n, ~crc);
+}
+
+#endif // BYD_CRC32C_H
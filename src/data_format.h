@@ -0,0 +1,393 @@
+/**
+ * 数据文件格式 (Web 服务端与 CLI 共用)
+ *
+ * 两个程序的数据文件都由 [SERIES] / [TECH] / [MODEL] 段组成, 只有车型-技术关联的写法不同:
+ *   Web 布局  独立的 [MODEL_TECH] 段, 每行 "车型id,技术id"
+ *   CLI 布局  [MODEL] 行的第 10 列内联技术id列表, 如 "101|102|109"
+ * parseDataRecord 两种写法都接受 (同一文件中混用也可以), 把每行转换为相同的记录事件;
+ * 内联列表在对应车型之后逐个产生关联事件, 调用方不需要区分布局。
+ * 写出时由 append*Line 按指定布局格式化; convertDataFile 在两种布局之间转换。
+ */
+
+#ifndef BYD_DATA_FORMAT_H
+#define BYD_DATA_FORMAT_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_loader.h"
+#include "wal.h"
+
+enum class DataLayout { Web, Cli };
+
+// 记录事件: 字符串字段指向被解析的行, 只在回调期间有效
+struct SeriesRecord {
+    int id = 0;
+    std::string_view name;
+    std::string_view intro;
+};
+
+struct TechRecord {
+    int id = 0;
+    std::string_view name;
+    std::string_view intro;
+};
+
+struct ModelRecord {
+    int id = 0;
+    std::string_view name;
+    int series_id = 0;
+    double price = 0;
+    double range_km = 0;
+    std::string_view energy_type;
+    std::string_view body_type;
+    int seats = 0;
+    std::string_view launch_year;
+};
+
+struct ModelTechRecord {
+    int model_id = 0;
+    int tech_id = 0;
+};
+
+// 逐个处理 "101|102|109" 中的技术id (空项忽略); 遇到无效项时返回 false, 之前的项已回调
+template <typename F>
+inline bool forEachTechId(std::string_view list, F fn, std::string& err) {
+    while (!list.empty()) {
+        size_t bar = list.find('|');
+        std::string_view item = trimView(list.substr(0, bar));
+        list = bar == std::string_view::npos ? std::string_view() : list.substr(bar + 1);
+        if (item.empty()) continue;
+        int tech_id;
+        if (!parseNumber(item, tech_id)) {
+            err = "技术id不是有效的整数: '" + std::string(item) + "'";
+            return false;
+        }
+        fn(tech_id);
+    }
+    return true;
+}
+
+// 把一行转换为记录事件。sink 需提供
+//   onSeries(const SeriesRecord&, size_t line)      onTech(const TechRecord&, size_t line)
+//   onModel(const ModelRecord&, size_t line)        onModelTech(const ModelTechRecord&, size_t line)
+// 格式错误时返回 false 并设置 err, 该行不产生任何事件
+template <typename Sink>
+inline bool parseDataRecord(const TextRecord& r, Sink& sink, std::string& err) {
+    switch (r.section) {
+    case TextSection::Series: {
+        SeriesRecord s;
+        if (!r.requireFields(3, err) || !r.getInt(0, "series_id", s.id, err)) return false;
+        s.name = r[1];
+        s.intro = r[2];
+        sink.onSeries(s, r.line);
+        return true;
+    }
+    case TextSection::Tech: {
+        TechRecord t;
+        if (!r.requireFields(3, err) || !r.getInt(0, "tech_id", t.id, err)) return false;
+        t.name = r[1];
+        t.intro = r[2];
+        sink.onTech(t, r.line);
+        return true;
+    }
+    case TextSection::Model: {
+        ModelRecord m;
+        if (!r.requireFields(9, err) || !r.getInt(0, "model_id", m.id, err) ||
+            !r.getInt(2, "series_id", m.series_id, err) || !r.getDouble(3, "price", m.price, err) ||
+            !r.getDouble(4, "range_km", m.range_km, err) || !r.getInt(7, "seats", m.seats, err)) {
+            return false;
+        }
+        m.name = r[1];
+        m.energy_type = r[5];
+        m.body_type = r[6];
+        m.launch_year = r[8];
+        // 先整体校验内联列表, 出错时整行不产生事件
+        std::string_view techs = r[9];
+        if (!forEachTechId(techs, [](int) {}, err)) return false;
+        sink.onModel(m, r.line);
+        forEachTechId(techs, [&](int tech_id) { sink.onModelTech(ModelTechRecord{ m.id, tech_id }, r.line); }, err);
+        return true;
+    }
+    case TextSection::ModelTech: {
+        ModelTechRecord mt;
+        if (!r.requireFields(2, err) || !r.getInt(0, "model_id", mt.model_id, err) ||
+            !r.getInt(1, "tech_id", mt.tech_id, err)) {
+            return false;
+        }
+        sink.onModelTech(mt, r.line);
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+// -------------------------
+// 写出
+// -------------------------
+
+inline void appendInt(std::string& out, long long v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, (size_t)(r.ptr - buf));
+}
+
+// 两位小数 (与 "%.2f" 相同); 数值过大时退回最短表示
+inline void appendFixed2(std::string& out, double v) {
+    char buf[64];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, 2);
+    if (r.ec != std::errc()) r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, (size_t)(r.ptr - buf));
+}
+
+inline void appendFileHeader(std::string& out, DataLayout layout, uint64_t wal_lsn) {
+    if (layout == DataLayout::Web) {
+        out += "# BYD汽车信息系统 - Web版本数据文件\n"
+               "# 格式说明：\n"
+               "# [SERIES] 系列数据: id,名称,简介\n"
+               "# [TECH] 技术数据: id,名称,简介\n"
+               "# [MODEL] 车型数据: id,名称,系列id,价格,续航,能源类型,车身类型,座位数,年份\n"
+               "# [MODEL_TECH] 车型技术关联: 车型id,技术id\n";
+    } else {
+        out += "# BYD汽车信息系统 - CLI版本数据文件\n"
+               "# 格式说明：\n"
+               "# [SERIES] 系列数据: id,名称,简介\n"
+               "# [TECH] 技术数据: id,名称,简介\n"
+               "# [MODEL] 车型数据: id,名称,系列id,价格,续航,能源类型,车身类型,座位数,年份,技术id列表(用|分隔)\n";
+    }
+    out += "# WAL_LSN: ";
+    appendInt(out, (long long)wal_lsn);
+    out += "\n\n";
+}
+
+inline void appendSeriesLine(std::string& out, const SeriesRecord& s) {
+    appendInt(out, s.id);
+    out += ',';
+    out += s.name;
+    out += ',';
+    out += s.intro;
+    out += '\n';
+}
+
+inline void appendTechLine(std::string& out, const TechRecord& t) {
+    appendInt(out, t.id);
+    out += ',';
+    out += t.name;
+    out += ',';
+    out += t.intro;
+    out += '\n';
+}
+
+// 车型的前 9 列, 不含换行; 续航按整数写出
+inline void appendModelFields(std::string& out, const ModelRecord& m) {
+    appendInt(out, m.id);
+    out += ',';
+    out += m.name;
+    out += ',';
+    appendInt(out, m.series_id);
+    out += ',';
+    appendFixed2(out, m.price);
+    out += ',';
+    appendInt(out, (long long)m.range_km);
+    out += ',';
+    out += m.energy_type;
+    out += ',';
+    out += m.body_type;
+    out += ',';
+    appendInt(out, m.seats);
+    out += ',';
+    out += m.launch_year;
+}
+
+inline void appendTechList(std::string& out, const int* techs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) out += '|';
+        appendInt(out, techs[i]);
+    }
+}
+
+// CLI 布局在第 10 列写出 techs (可为空); Web 布局忽略 techs, 关联另行写入 [MODEL_TECH] 段
+inline void appendModelLine(std::string& out, const ModelRecord& m, DataLayout layout,
+                            const int* techs = nullptr, size_t tech_count = 0) {
+    appendModelFields(out, m);
+    if (layout == DataLayout::Cli) {
+        out += ',';
+        appendTechList(out, techs, tech_count);
+    }
+    out += '\n';
+}
+
+inline void appendModelTechLine(std::string& out, const ModelTechRecord& mt) {
+    appendInt(out, mt.model_id);
+    out += ',';
+    appendInt(out, mt.tech_id);
+    out += '\n';
+}
+
+// -------------------------
+// 布局转换
+// -------------------------
+
+struct ConvertResult {
+    size_t series = 0;
+    size_t techs = 0;
+    size_t models = 0;
+    size_t model_techs = 0;
+    size_t orphan_links = 0;    // 转为 CLI 布局时引用了文件中不存在车型的关联 (无处可写, 丢弃)
+    size_t bytes_out = 0;
+};
+
+// 把任一布局的数据文件转换为 to 布局, 经临时文件 + rename 写到 out_path。
+// 只转换格式, 不检查主键/外键 (由加载方负责); 格式错误的行跳过并记录在 loader 中。
+// 各块并行格式化, 再按文件顺序写出, 段的先后与输入一致; 布局不变时保留 WAL_LSN, 否则写 0
+// (另一个程序的 WAL 序号与之无关)。仅输入无法打开或输出写入失败时返回 false
+inline bool convertDataFile(const std::string& in_path, const std::string& out_path, DataLayout to,
+                            unsigned threads, TextDataLoader& loader, ConvertResult& result, std::string& err) {
+    struct Chunk {
+        std::string text;                   // 本块输出的行 (CLI 布局的车型行只有前 9 列, 写出时补技术列)
+        std::vector<size_t> model_ends;     // CLI 布局: 每个车型行在 text 中的结束位置
+        std::vector<int> model_ids;
+        std::vector<ModelTechRecord> links; // CLI 布局: 全部关联; Web 布局: 内联列表产生的关联
+        size_t series = 0, techs = 0, models = 0, model_techs = 0;
+        bool to_cli = false;
+        bool in_model_section = false;
+
+        void onSeries(const SeriesRecord& s, size_t) { appendSeriesLine(text, s); series++; }
+        void onTech(const TechRecord& t, size_t) { appendTechLine(text, t); techs++; }
+        void onModel(const ModelRecord& m, size_t) {
+            models++;
+            if (to_cli) {
+                appendModelFields(text, m);
+                model_ends.push_back(text.size());
+                model_ids.push_back(m.id);
+            } else {
+                appendModelLine(text, m, DataLayout::Web);
+            }
+        }
+        void onModelTech(const ModelTechRecord& mt, size_t) {
+            model_techs++;
+            if (to_cli || in_model_section) links.push_back(mt);
+            else appendModelTechLine(text, mt);
+        }
+    };
+
+    if (!loader.open(in_path, err)) return false;
+    std::vector<Chunk> chunks(loader.splitChunks());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunks[i].to_cli = to == DataLayout::Cli;
+        chunks[i].in_model_section = loader.chunk(i).section == TextSection::Model;
+    }
+    loader.parseChunks(threads, [&](size_t ci, const TextRecord& r, std::string& e) {
+        return parseDataRecord(r, chunks[ci], e);
+    });
+
+    // CLI 布局: 按 model_id 归并全部关联, 同一车型内保持文件顺序
+    std::vector<ModelTechRecord> links;
+    if (to == DataLayout::Cli) {
+        size_t total = 0;
+        for (const Chunk& c : chunks) total += c.links.size();
+        links.reserve(total);
+        for (Chunk& c : chunks) {
+            links.insert(links.end(), c.links.begin(), c.links.end());
+            std::vector<ModelTechRecord>().swap(c.links);
+        }
+        std::stable_sort(links.begin(), links.end(),
+                         [](const ModelTechRecord& a, const ModelTechRecord& b) { return a.model_id < b.model_id; });
+    }
+    auto linksOf = [&](int model_id) {
+        auto lo = std::lower_bound(links.begin(), links.end(), model_id,
+                                   [](const ModelTechRecord& l, int id) { return l.model_id < id; });
+        auto hi = lo;
+        while (hi != links.end() && hi->model_id == model_id) ++hi;
+        return std::make_pair(lo, hi);
+    };
+
+    // 输入的布局: 有 [MODEL_TECH] 段且没有内联列表时为 Web 布局
+    bool in_web = false, has_inline = false;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        const Chunk& c = chunks[i];
+        if (loader.chunk(i).section == TextSection::ModelTech) in_web = true;
+        if (c.in_model_section && c.model_techs > 0) has_inline = true;
+        result.series += c.series;
+        result.techs += c.techs;
+        result.models += c.models;
+        result.model_techs += c.model_techs;
+    }
+    in_web = in_web && !has_inline;
+
+    AtomicFileWriter file(out_path);
+    std::string buf;
+    appendFileHeader(buf, to, (to == DataLayout::Web) == in_web ? loader.walLsn() : 0);
+    result.bytes_out += buf.size();
+    file.write(buf);
+    buf.clear();
+
+    std::vector<int> tech_ids;
+    TextSection written = TextSection::None;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        Chunk& c = chunks[i];
+        TextSection section = loader.chunk(i).section;
+        if (section == TextSection::None || section == TextSection::Unknown) continue;
+        if (to == DataLayout::Cli && section == TextSection::ModelTech) continue;
+        if (section != written) {
+            if (written != TextSection::None) buf += '\n';
+            buf += section == TextSection::Series ? "[SERIES]\n" : section == TextSection::Tech ? "[TECH]\n"
+                 : section == TextSection::Model ? "[MODEL]\n" : "[MODEL_TECH]\n";
+            written = section;
+        }
+        if (to == DataLayout::Cli && section == TextSection::Model) {
+            size_t begin = 0;
+            for (size_t k = 0; k < c.model_ids.size(); k++) {
+                buf.append(c.text, begin, c.model_ends[k] - begin);
+                begin = c.model_ends[k];
+                auto range = linksOf(c.model_ids[k]);
+                tech_ids.clear();
+                for (auto it = range.first; it != range.second; ++it) tech_ids.push_back(it->tech_id);
+                buf += ',';
+                appendTechList(buf, tech_ids.data(), tech_ids.size());
+                buf += '\n';
+                if (buf.size() >= (1u << 20)) { result.bytes_out += buf.size(); file.write(buf); buf.clear(); }
+            }
+        } else {
+            buf += c.text;
+        }
+        std::string().swap(c.text);
+        result.bytes_out += buf.size();
+        file.write(buf);
+        buf.clear();
+    }
+
+    if (to == DataLayout::Web) {
+        // 内联列表产生的关联写到末尾的 [MODEL_TECH] 段
+        bool header = false;
+        for (const Chunk& c : chunks) {
+            for (const ModelTechRecord& mt : c.links) {
+                if (!header && written != TextSection::ModelTech) {
+                    if (written != TextSection::None) buf += '\n';
+                    buf += "[MODEL_TECH]\n";
+                }
+                header = true;
+                appendModelTechLine(buf, mt);
+            }
+            result.bytes_out += buf.size();
+            file.write(buf);
+            buf.clear();
+        }
+    } else {
+        // 统计没有对应车型行的关联
+        std::vector<int> ids;
+        for (const Chunk& c : chunks) ids.insert(ids.end(), c.model_ids.begin(), c.model_ids.end());
+        std::sort(ids.begin(), ids.end());
+        for (const ModelTechRecord& l : links) {
+            if (!std::binary_search(ids.begin(), ids.end(), l.model_id)) result.orphan_links++;
+        }
+    }
+    return file.commit(err);
+}
+
+#endif // BYD_DATA_FORMAT_H
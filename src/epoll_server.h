@@ -0,0 +1,522 @@
+/**
+ * 事件驱动的 HTTP 服务模式 (Linux epoll)
+ *
+ * httplib 一个连接占用一个工作线程: keep-alive 期间线程阻塞在 select 上等下一个请求,
+ * 几百个空闲的浏览器标签页就能占满线程池。EpollServer 继承 httplib::Server, 注册的路由与处理函数不变:
+ *   I/O 线程   少量线程各自一个 epoll 实例, 非阻塞地接受连接、读入请求头; 空闲连接只占一个 Conn 结构,
+ *              不占线程。空闲超过 keep-alive 超时、请求头在读超时内没有读完整的连接每秒扫描一次关闭。
+ *   计算线程   请求头完整后把连接交给 new_task_queue 创建的任务队列 (与默认模式是同一个队列, 过载拒绝照常生效),
+ *              工作线程调用 httplib 的 process_request 处理; 请求体没读完的部分直接从套接字读取。
+ *              响应先写入缓冲, 处理完 (或缓冲超过 64KB) 时一次写出, 之后连接交回 I/O 线程继续等待。
+ * 同一连接上流水线发来的后续请求在缓冲中已完整时直接接着处理。其他平台上 listenEpoll 返回 false。
+ */
+
+#ifndef BYD_EPOLL_SERVER_H
+#define BYD_EPOLL_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "httplib.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class EpollServer : public httplib::Server {
+public:
+    static bool supported() { return true; }
+
+    // 把打开文件数的软限制提高到硬限制, 返回新的软限制 (-1 表示无限制)
+    static long raiseFileLimit() {
+        rlimit rl;
+        if (::getrlimit(RLIMIT_NOFILE, &rl) != 0) return 0;
+        if (rl.rlim_cur < rl.rlim_max) {
+            rlimit want = rl;
+            want.rlim_cur = rl.rlim_max;
+            if (::setrlimit(RLIMIT_NOFILE, &want) == 0) rl = want;
+        }
+        return rl.rlim_cur == RLIM_INFINITY ? -1 : (long)rl.rlim_cur;
+    }
+
+    // 在 bind_to_port 之后调用, 阻塞到 stopEpoll
+    bool listenEpoll(size_t io_threads) {
+        listen_fd_ = svr_sock_.load();
+        if (listen_fd_ == INVALID_SOCKET) return false;
+        // bind_to_port 的 backlog 只有 CPPHTTPLIB_LISTEN_BACKLOG, 大量连接同时到达时会丢 SYN
+        ::listen(listen_fd_, SOMAXCONN);
+        ::fcntl(listen_fd_, F_SETFL, ::fcntl(listen_fd_, F_GETFL) | O_NONBLOCK);
+
+        std::unique_ptr<httplib::TaskQueue> tasks(
+            new_task_queue ? new_task_queue() : new httplib::ThreadPool(CPPHTTPLIB_THREAD_POOL_COUNT));
+        tasks_ = tasks.get();
+        bool ok = true;
+        for (size_t i = 0; i < std::max<size_t>(1, io_threads) && ok; i++) {
+            std::unique_ptr<IoLoop> loop(new IoLoop());
+            ok = loop->open(listen_fd_);
+            loops_.push_back(std::move(loop));
+        }
+        if (ok) {
+            ready_.store(true, std::memory_order_release);
+            std::vector<std::thread> threads;
+            for (auto& loop : loops_) threads.emplace_back([this, &loop]() { run(*loop); });
+            for (auto& t : threads) t.join();
+        }
+
+        // 处理中的连接由任务队列执行完 (之后交回 I/O 线程的消息不再处理), 再统一关闭
+        tasks->shutdown();
+        tasks_ = nullptr;
+        for (auto& loop : loops_) {
+            for (auto& kv : loop->conns) ::close(kv.first);
+            open_.fetch_sub((int64_t)loop->conns.size(), std::memory_order_relaxed);
+            loop->close();
+        }
+        loops_.clear();
+        svr_sock_.store(INVALID_SOCKET);
+        ::close(listen_fd_);
+        listen_fd_ = INVALID_SOCKET;
+        return ok;
+    }
+
+    // 可在信号处理函数中调用 (只有原子操作、shutdown 与 write)
+    void stopEpoll() {
+        if (stopping_.exchange(true)) return;
+        socket_t s = svr_sock_.exchange(INVALID_SOCKET);
+        if (s != INVALID_SOCKET && !shared_listener_) ::shutdown(s, SHUT_RDWR);
+        if (!ready_.load(std::memory_order_acquire)) return;     // I/O 线程启动前: 由 run 检查 stopping_
+        for (auto& loop : loops_) loop->wake();
+    }
+
+    int64_t openConnections() const { return open_.load(std::memory_order_relaxed); }
+    uint64_t acceptedConnections() const { return accepted_.load(std::memory_order_relaxed); }
+
+    // 多进程模式: 使用主进程创建的监听套接字代替 bind_to_port, 在将要调用 listen 的线程上调用。
+    // 该套接字与同槽位的新工作进程共享, 停止时不 shutdown, 排队中的连接留给接替的进程接受。
+    // 默认模式下接受的连接继承监听套接字的 TCP_NODELAY (bind_to_port 按 set_tcp_nodelay 设置, 这里由调用方给出)
+    void adoptListener(socket_t fd, bool tcp_nodelay) {
+        int on = tcp_nodelay ? 1 : 0;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        svr_sock_ = fd;
+        shared_listener_ = true;
+        accept_thread_ = ::pthread_self();
+    }
+
+    // 默认 (阻塞) 模式的停止, 可在信号处理函数中调用。共享监听套接字时关闭它不会让 accept 返回,
+    // 改为把信号 sig 转发给接受线程, 使 accept 以 EINTR 返回 (处理函数需不带 SA_RESTART 安装)
+    void stopListening(int sig) {
+        if (!shared_listener_) {
+            stop();
+            return;
+        }
+        svr_sock_.store(INVALID_SOCKET);
+        if (!::pthread_equal(::pthread_self(), accept_thread_)) ::pthread_kill(accept_thread_, sig);
+    }
+
+private:
+    static const size_t kReadChunk = 16384;
+    static const size_t kMaxHeaderBytes = 65536;    // 请求头超过该长度仍不完整时关闭连接
+    static const size_t kFlushBytes = 65536;
+    static const uint64_t kWakeTag = 1;             // epoll_event.data 中与 Conn* 区分的标记
+    static const uint64_t kListenTag = 2;
+
+    struct Conn {
+        int fd = -1;
+        std::string in;             // 读入但未处理的字节从 in_off 开始
+        size_t in_off = 0;
+        size_t scan = 0;            // 继续查找请求头结尾的位置
+        std::string remote_addr;
+        int remote_port = 0;
+        std::string local_addr;
+        int local_port = 0;
+        size_t served = 0;          // 已处理的请求数 (keep-alive 上限)
+        int64_t last_active_ms = 0;
+        bool busy = false;          // 正在计算线程中处理, I/O 线程不访问
+        bool peer_closed = false;
+
+        size_t buffered() const { return in.size() - in_off; }
+
+        // 请求头以空行结束 (兼容只用 \n 换行的客户端)
+        bool headerComplete() {
+            size_t i = std::max(in_off, scan);
+            for (; i < in.size(); i++) {
+                if (in[i] != '\n') continue;
+                size_t j = i + 1;
+                if (j < in.size() && in[j] == '\r') j++;
+                if (j < in.size() && in[j] == '\n') return true;
+            }
+            scan = std::max(in_off, in.size() >= 2 ? in.size() - 2 : 0);
+            return false;
+        }
+
+        // 丢掉已处理的字节; 全部处理完时释放缓冲, 空闲连接不占内存
+        void compact() {
+            if (in_off >= in.size()) std::string().swap(in);
+            else in.erase(0, in_off);
+            in_off = 0;
+            scan = 0;
+        }
+    };
+
+    struct Done {
+        Conn* conn;
+        bool keep;
+    };
+
+    struct IoLoop {
+        int epfd = -1;
+        int wakefd = -1;
+        int sparefd = -1;           // 文件描述符耗尽时先关掉它, 接受并立即关闭新连接, 避免 accept 空转
+        std::unordered_map<int, std::unique_ptr<Conn>> conns;
+        std::mutex mu;
+        std::vector<Done> done;     // mu: 计算线程处理完交回的连接
+        bool draining = false;      // 已停止接受新连接
+
+        bool open(int listen_fd) {
+            epfd = ::epoll_create1(EPOLL_CLOEXEC);
+            wakefd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            sparefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (epfd < 0 || wakefd < 0) return false;
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u64 = kWakeTag;
+            if (::epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) != 0) return false;
+            // 各 I/O 线程都监听同一个套接字, EPOLLEXCLUSIVE 让新连接只唤醒其中一个
+            ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+            ev.data.u64 = kListenTag;
+            return ::epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) == 0;
+        }
+
+        void wake() {
+            uint64_t one = 1;
+            ssize_t n = ::write(wakefd, &one, sizeof(one));
+            (void)n;
+        }
+
+        void close() {
+            if (epfd >= 0) ::close(epfd);
+            if (wakefd >= 0) ::close(wakefd);
+            if (sparefd >= 0) ::close(sparefd);
+            epfd = wakefd = sparefd = -1;
+        }
+    };
+
+    // 处理一个连接期间的 httplib::Stream: 读先取缓冲中的字节, 写先进缓冲
+    class ConnStream final : public httplib::Stream {
+    public:
+        ConnStream(Conn& c, time_t read_timeout_sec, time_t write_timeout_sec)
+            : c_(c), read_ms_((int)read_timeout_sec * 1000), write_ms_((int)write_timeout_sec * 1000),
+              start_(std::chrono::steady_clock::now()) {}
+
+        bool is_readable() const override { return c_.buffered() > 0; }
+        bool wait_readable() const override { return is_readable() || pollFd(POLLIN, read_ms_); }
+        bool wait_writable() const override {
+            return pollFd(POLLOUT, write_ms_) && httplib::detail::is_socket_alive(c_.fd);
+        }
+
+        ssize_t read(char* ptr, size_t size) override {
+            if (!is_readable()) {
+                // 请求体还没到齐: 先写出已缓冲的输出 (如 100 Continue), 再从套接字读
+                if (!flush()) return -1;
+                ssize_t n = fill();
+                if (n <= 0) return n;
+            }
+            size_t n = std::min(size, c_.buffered());
+            memcpy(ptr, c_.in.data() + c_.in_off, n);
+            c_.in_off += n;
+            return (ssize_t)n;
+        }
+
+        ssize_t write(const char* ptr, size_t size) override {
+            out_.append(ptr, size);
+            if (out_.size() >= kFlushBytes && !flush()) return -1;
+            return (ssize_t)size;
+        }
+
+        void get_remote_ip_and_port(std::string& ip, int& port) const override {
+            ip = c_.remote_addr;
+            port = c_.remote_port;
+        }
+        void get_local_ip_and_port(std::string& ip, int& port) const override {
+            ip = c_.local_addr;
+            port = c_.local_port;
+        }
+        socket_t socket() const override { return c_.fd; }
+        time_t duration() const override {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_)
+                .count();
+        }
+
+        bool flush() {
+            size_t off = 0;
+            while (off < out_.size()) {
+                ssize_t n = ::send(c_.fd, out_.data() + off, out_.size() - off, MSG_NOSIGNAL);
+                if (n > 0) { off += (size_t)n; continue; }
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && errno == EAGAIN && pollFd(POLLOUT, write_ms_)) continue;
+                error_ = httplib::Error::Write;
+                return false;
+            }
+            out_.clear();
+            return true;
+        }
+
+    private:
+        Conn& c_;
+        int read_ms_;
+        int write_ms_;
+        std::chrono::steady_clock::time_point start_;
+        std::string out_;
+
+        bool pollFd(short events, int timeout_ms) const {
+            pollfd p = { c_.fd, events, 0 };
+            int r;
+            do { r = ::poll(&p, 1, timeout_ms); } while (r < 0 && errno == EINTR);
+            return r > 0;
+        }
+
+        ssize_t fill() {
+            c_.compact();
+            char buf[kReadChunk];
+            for (;;) {
+                ssize_t n = ::recv(c_.fd, buf, sizeof(buf), 0);
+                if (n > 0) {
+                    c_.in.append(buf, (size_t)n);
+                    return n;
+                }
+                if (n == 0) {
+                    c_.peer_closed = true;
+                    error_ = httplib::Error::ConnectionClosed;
+                    return 0;
+                }
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN && pollFd(POLLIN, read_ms_)) continue;
+                error_ = errno == EAGAIN ? httplib::Error::Timeout : httplib::Error::Read;
+                return -1;
+            }
+        }
+    };
+
+    int listen_fd_ = INVALID_SOCKET;
+    httplib::TaskQueue* tasks_ = nullptr;
+    std::vector<std::unique_ptr<IoLoop>> loops_;
+    std::atomic<bool> ready_{ false };
+    std::atomic<bool> stopping_{ false };
+    std::atomic<int64_t> open_{ 0 };
+    std::atomic<uint64_t> accepted_{ 0 };
+    bool shared_listener_ = false;
+    pthread_t accept_thread_{};
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void run(IoLoop& loop) {
+        epoll_event events[256];
+        int64_t last_sweep = nowMs();
+        for (;;) {
+            bool stopping = stopping_.load(std::memory_order_acquire);
+            if (stopping && !(shared_listener_ && drain(loop, nowMs()))) break;
+            int n = ::epoll_wait(loop.epfd, events, 256, stopping ? 100 : 1000);
+            int64_t now = nowMs();
+            for (int i = 0; i < n; i++) {
+                uint64_t tag = events[i].data.u64;
+                if (tag == kWakeTag) finishDone(loop, now);
+                else if (tag == kListenTag) acceptAll(loop, now);
+                else onReadable(loop, static_cast<Conn*>(events[i].data.ptr), now);
+            }
+            if (now - last_sweep >= 1000) {
+                sweep(loop, now);
+                last_sweep = now;
+            }
+        }
+    }
+
+    // 共享监听套接字时的停止: 不再接受新连接 (排队的连接留给接替的进程), 关闭空闲的 keep-alive 连接;
+    // 刚接受还没处理过请求的连接等它的请求处理完再关闭 (最多等读超时)。还有连接未关闭时返回 true
+    bool drain(IoLoop& loop, int64_t now) {
+        if (!loop.draining) {
+            ::epoll_ctl(loop.epfd, EPOLL_CTL_DEL, listen_fd_, nullptr);
+            loop.draining = true;
+        }
+        int64_t read_ms = (int64_t)read_timeout_sec_ * 1000;
+        std::vector<Conn*> idle;
+        for (auto& kv : loop.conns) {
+            Conn* c = kv.second.get();
+            if (c->busy) continue;
+            if ((c->served > 0 && c->buffered() == 0) || now - c->last_active_ms > read_ms) idle.push_back(c);
+        }
+        for (Conn* c : idle) closeConn(loop, c);
+        return !loop.conns.empty();
+    }
+
+    void acceptAll(IoLoop& loop, int64_t now) {
+        for (int k = 0; k < 256; k++) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                if ((errno == EMFILE || errno == ENFILE) && loop.sparefd >= 0) {
+                    ::close(loop.sparefd);
+                    int victim = ::accept(listen_fd_, nullptr, nullptr);
+                    if (victim >= 0) ::close(victim);
+                    loop.sparefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                }
+                return;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::unique_ptr<Conn> c(new Conn());
+            c->fd = fd;
+            c->last_active_ms = now;
+            httplib::detail::get_remote_ip_and_port(fd, c->remote_addr, c->remote_port);
+            httplib::detail::get_local_ip_and_port(fd, c->local_addr, c->local_port);
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.ptr = c.get();
+            if (::epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            loop.conns.emplace(fd, std::move(c));
+            open_.fetch_add(1, std::memory_order_relaxed);
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void onReadable(IoLoop& loop, Conn* c, int64_t now) {
+        char buf[kReadChunk];
+        for (;;) {
+            ssize_t n = ::recv(c->fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c->in.append(buf, (size_t)n);
+                if ((size_t)n < sizeof(buf) || c->buffered() >= kMaxHeaderBytes) break;
+                continue;
+            }
+            if (n == 0) c->peer_closed = true;
+            else if (errno == EINTR) continue;
+            else if (errno != EAGAIN) c->peer_closed = true;
+            break;
+        }
+        c->last_active_ms = now;
+        if (c->headerComplete()) dispatch(loop, c);
+        else if (c->peer_closed || c->buffered() >= kMaxHeaderBytes) closeConn(loop, c);
+        else rearm(loop, c);
+    }
+
+    void dispatch(IoLoop& loop, Conn* c) {
+        c->busy = true;
+        IoLoop* lp = &loop;
+        if (!tasks_->enqueue([this, lp, c]() { serve(*lp, c); })) {
+            c->busy = false;
+            closeConn(loop, c);
+        }
+    }
+
+    // 计算线程: 处理缓冲中所有完整的请求, 然后把连接交回 I/O 线程
+    void serve(IoLoop& loop, Conn* c) {
+        ConnStream strm(*c, read_timeout_sec_, write_timeout_sec_);
+        bool keep = true;
+        for (;;) {
+            bool close_connection = c->served + 1 >= keep_alive_max_count_ || stopping_.load();
+            bool connection_closed = false;
+            bool ok = process_request(strm, c->remote_addr, c->remote_port, c->local_addr, c->local_port,
+                                      close_connection, connection_closed, nullptr);
+            c->served++;
+            if (!strm.flush() || !ok || close_connection || connection_closed || c->peer_closed) {
+                keep = false;
+                break;
+            }
+            if (!c->headerComplete()) break;
+        }
+        c->compact();
+        {
+            std::lock_guard<std::mutex> lk(loop.mu);
+            loop.done.push_back({ c, keep });
+        }
+        loop.wake();
+    }
+
+    void finishDone(IoLoop& loop, int64_t now) {
+        uint64_t v;
+        ssize_t r = ::read(loop.wakefd, &v, sizeof(v));
+        (void)r;
+        std::vector<Done> done;
+        {
+            std::lock_guard<std::mutex> lk(loop.mu);
+            done.swap(loop.done);
+        }
+        for (const Done& d : done) {
+            Conn* c = d.conn;
+            c->busy = false;
+            c->last_active_ms = now;
+            if (!d.keep) closeConn(loop, c);
+            else if (c->headerComplete()) dispatch(loop, c);
+            else rearm(loop, c);
+        }
+    }
+
+    void rearm(IoLoop& loop, Conn* c) {
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = c;
+        if (::epoll_ctl(loop.epfd, EPOLL_CTL_MOD, c->fd, &ev) != 0) closeConn(loop, c);
+    }
+
+    void closeConn(IoLoop& loop, Conn* c) {
+        int fd = c->fd;
+        ::close(fd);    // 关闭后自动移出 epoll
+        loop.conns.erase(fd);
+        open_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 空闲超过 keep-alive 超时, 或请求头读到一半超过读超时的连接
+    void sweep(IoLoop& loop, int64_t now) {
+        int64_t idle_ms = (int64_t)keep_alive_timeout_sec_ * 1000;
+        int64_t read_ms = (int64_t)read_timeout_sec_ * 1000;
+        std::vector<Conn*> expired;
+        for (auto& kv : loop.conns) {
+            Conn* c = kv.second.get();
+            if (c->busy) continue;
+            if (now - c->last_active_ms > (c->buffered() > 0 ? read_ms : idle_ms)) expired.push_back(c);
+        }
+        for (Conn* c : expired) closeConn(loop, c);
+    }
+};
+
+#else
+
+class EpollServer : public httplib::Server {
+public:
+    static bool supported() { return false; }
+    static long raiseFileLimit() { return 0; }
+    bool listenEpoll(size_t) { return false; }
+    void stopEpoll() {}
+    void adoptListener(socket_t, bool) {}
+    void stopListening(int) { stop(); }
+    int64_t openConnections() const { return 0; }
+    uint64_t acceptedConnections() const { return 0; }
+};
+
+#endif // __linux__
+
+#endif // BYD_EPOLL_SERVER_H
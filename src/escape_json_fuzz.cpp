@@ -0,0 +1,203 @@
+// escapeJson / appendJsonEscaped 与逐字节参考实现的对比测试
+//
+//   g++ -std=c++17 -O2 -mavx2 -o escape_json_fuzz_avx2 escape_json_fuzz.cpp                    # AVX2 (32 字节) + SSE2 + 标量收尾
+//   g++ -std=c++17 -O2 -o escape_json_fuzz_sse2 escape_json_fuzz.cpp                           # SSE2 (16 字节) + 标量收尾
+//   g++ -std=c++17 -O2 -DBYD_SCALAR_JSON_ESCAPE -o escape_json_fuzz_scalar escape_json_fuzz.cpp  # 只用标量循环
+//   ./escape_json_fuzz_avx2 [--iterations=300000] [--seed=1]
+//
+// 只包含服务端使用的 json_escape.h。扫描路径在编译时选择, 三种编译方式各覆盖一条。
+// 1. 分块边界: 长度取 16/32 的倍数附近 (含 0), 在每个位置放入 256 种字节中的每一种, 其余为 ASCII;
+//    输入从缓冲区的不同偏移开始 (非对齐加载), 紧随输入之后的字节是 '"', 越界读取会被发现
+// 2. 多字节 UTF-8: 2/3/4 字节序列跨 16/32 字节边界, 前后夹特殊字节
+// 3. 随机: 随机长度, 字节按 ASCII / 特殊字节 / UTF-8 序列 / 任意字节混合生成, 追加到非空的输出之后
+// 发现不一致时打印输入与两份输出并以 1 退出
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "json_escape.h"
+
+using namespace std;
+
+namespace {
+
+long g_cases = 0;
+long g_bad = 0;
+
+// 参考实现: 逐字节按 RFC 8259 转义, 控制字符除 \b \f \n \r \t 外写成 \u00XX
+string referenceEscape(const char* p, size_t n) {
+    string out;
+    char u[8];
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)p[i];
+        if (c == '"') out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else if (c == '\b') out += "\\b";
+        else if (c == '\f') out += "\\f";
+        else if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else if (c == '\t') out += "\\t";
+        else if (c < 0x20) {
+            snprintf(u, sizeof(u), "\\u%04x", c);
+            out += u;
+        } else {
+            out += (char)c;
+        }
+    }
+    return out;
+}
+
+string hexDump(const char* p, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    string out;
+    for (size_t i = 0; i < n && i < 96; i++) {
+        if (i) out += ' ';
+        out += hex[(unsigned char)p[i] >> 4];
+        out += hex[(unsigned char)p[i] & 0xF];
+    }
+    if (n > 96) out += " ...";
+    return out;
+}
+
+void check(const char* p, size_t n, const string& what) {
+    g_cases++;
+    string expected = referenceEscape(p, n);
+    string out = "prefix:";
+    appendJsonEscaped(out, p, n);
+    string got = escapeJson(string(p, n));
+    if (out.compare(0, 7, "prefix:") != 0 || out.compare(7, string::npos, expected) != 0 || got != expected) {
+        if (++g_bad <= 10) {
+            cerr << "FAIL: " << what << ", length " << n << "\n  input:    " << hexDump(p, n)
+                 << "\n  expected: " << hexDump(expected.data(), expected.size())
+                 << "\n  append:   " << hexDump(out.data() + 7, out.size() - 7)
+                 << "\n  escape:   " << hexDump(got.data(), got.size()) << endl;
+        }
+    }
+}
+
+// 16/32 的倍数附近的长度 (两种向量宽度的整块、整块 + 收尾、只有收尾)
+vector<size_t> boundaryLengths() {
+    vector<size_t> lens;
+    for (size_t n = 0; n <= 3; n++) lens.push_back(n);
+    for (size_t k = 16; k <= 160; k += 16) {
+        lens.push_back(k - 1);
+        lens.push_back(k);
+        lens.push_back(k + 1);
+    }
+    lens.push_back(255);
+    lens.push_back(256);
+    lens.push_back(257);
+    return lens;
+}
+
+// 阶段 1: 每个长度、每个位置放入每种字节, 输入起点取 0..31 的偏移
+void chunkBoundaries() {
+    vector<char> buf(512 + 64);
+    long before = g_cases;
+    for (size_t n : boundaryLengths()) {
+        for (size_t pos = 0; pos < n; pos++) {
+            for (int b = 0; b < 256; b++) {
+                size_t off = (pos + b) % 32;
+                char* p = buf.data() + off;
+                std::fill(buf.begin(), buf.end(), 'a');
+                p[pos] = (char)b;
+                p[n] = '"';     // 紧随输入之后: 不能被读入
+                check(p, n, "byte 0x" + hexDump(p + pos, 1) + " at " + to_string(pos) + ", offset " + to_string(off));
+            }
+        }
+        // 全部为特殊字节 / 全部为 UTF-8 高位字节
+        string all_ctrl, all_high;
+        for (size_t i = 0; i < n; i++) {
+            all_ctrl += (char)(i % 0x20);
+            all_high += (char)(0x80 + i % 0x80);
+        }
+        check(all_ctrl.data(), n, "control bytes only");
+        check(all_high.data(), n, "high bytes only");
+    }
+    cout << "chunk boundaries: " << g_cases - before << " cases" << endl;
+}
+
+// 阶段 2: UTF-8 序列跨越向量边界, 前后夹 '"' / '\\' / 控制字节
+void utf8Boundaries() {
+    const char* seqs[] = { "\xC3\xA9", "\xE6\xB1\x89", "\xF0\x9F\x98\x80", "\xE6\xB1\x89\xE5\xAD\x97" "DM-i" };
+    const char specials[] = { '"', '\\', '\n', '\x01', '\x1F', '\x7F', ' ' };
+    long before = g_cases;
+    for (const char* seq : seqs) {
+        for (size_t start = 0; start < 70; start++) {
+            for (char sp : specials) {
+                string s(start, 'x');
+                s += seq;
+                s += sp;
+                s += seq;
+                s += string(start % 19, 'y');
+                check(s.data(), s.size(), "utf-8 at " + to_string(start));
+                string t = string(1, sp) + string(start, 'z') + seq + seq + seq;
+                check(t.data(), t.size(), "utf-8 run at " + to_string(start));
+            }
+        }
+    }
+    // 全中文文本 (无需转义, 应整段拷贝)
+    string han;
+    for (int i = 0; i < 200; i++) han += "比亚迪汉";
+    for (size_t n = 0; n <= han.size(); n += 3) check(han.data(), n, "han text");
+    cout << "utf-8 boundaries: " << g_cases - before << " cases" << endl;
+}
+
+// 阶段 3: 随机输入
+void randomInputs(long iterations, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const char* utf8[] = { "\xC3\xA9", "\xE6\xB1\x89", "\xE8\xBF\xAA", "\xF0\x9F\x98\x80" };
+    const char specials[] = { '"', '\\', '\b', '\f', '\n', '\r', '\t', '\0', '\x01', '\x1B', '\x1F' };
+    long before = g_cases;
+    string s;
+    for (long it = 0; it < iterations; it++) {
+        size_t n = rng() % 4 == 0 ? rng() % 1024 : rng() % 100;
+        int special_pct = (int)(rng() % 30);    // 每个输入的特殊字节比例不同: 从几乎没有到很密集
+        s.clear();
+        while (s.size() < n) {
+            int r = (int)(rng() % 100);
+            if (r < special_pct) s += specials[rng() % sizeof(specials)];
+            else if (r < special_pct + 25) s += utf8[rng() % 4];
+            else if (r < special_pct + 30) s += (char)(rng() % 256);
+            else s += (char)(0x20 + rng() % 0x5F);
+        }
+        check(s.data(), s.size(), "random #" + to_string(it) + " (seed " + to_string(seed) + ")");
+    }
+    cout << "random: " << g_cases - before << " cases" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long iterations = 300000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 13, "--iterations=") == 0) iterations = atol(arg.c_str() + 13);
+        else if (arg.compare(0, 7, "--seed=") == 0) seed = (uint32_t)strtoul(arg.c_str() + 7, nullptr, 10);
+        else {
+            cerr << "Usage: " << argv[0] << " [--iterations=N] [--seed=N]" << endl;
+            return 1;
+        }
+    }
+#if defined(BYD_SCALAR_JSON_ESCAPE)
+    cout << "scan path: scalar" << endl;
+#elif defined(__AVX2__)
+    cout << "scan path: avx2 + sse2 + scalar tail" << endl;
+#elif defined(__SSE2__) || defined(_M_X64)
+    cout << "scan path: sse2 + scalar tail" << endl;
+#else
+    cout << "scan path: scalar" << endl;
+#endif
+    chunkBoundaries();
+    utf8Boundaries();
+    randomInputs(iterations, seed);
+    cout << (g_bad ? "FAILED: " + to_string(g_bad) + " of " + to_string(g_cases) + " cases" : "OK: " + to_string(g_cases) + " cases")
+         << endl;
+    return g_bad ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * 数据文件变更监视
+ *
+ * Linux 下用 inotify 监视文件所在目录 (编辑器常以 "写临时文件 + rename" 的方式保存, 直接监视文件本身
+ * 会在替换后失效), 其他平台每秒比较一次文件的 FileStamp。事件静默 debounce_ms 之后才回调一次,
+ * 避免一次保存产生的多个事件触发多次重新加载。回调在监视线程中执行。
+ * startDir 监视整个目录 (只含直接位于其中的文件): 其中任何文件被写入、创建、删除或改名都触发回调。
+ */
+
+#ifndef BYD_FILE_WATCHER_H
+#define BYD_FILE_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+#ifndef __linux__
+#include <filesystem>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// 文件身份: 用于判断文件是否被外部改写 (自己写出的文件记录下 stamp 后即可忽略对应事件)
+struct FileStamp {
+    bool exists = false;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    static FileStamp of(const std::string& path) {
+        FileStamp s;
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0) return s;
+        s.exists = true;
+        s.inode = (uint64_t)st.st_ino;
+        s.size = (uint64_t)st.st_size;
+#ifdef __linux__
+        s.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+        s.mtime_ns = (int64_t)st.st_mtime * 1000000000;
+#endif
+        return s;
+    }
+
+    bool operator==(const FileStamp& o) const {
+        return exists == o.exists && inode == o.inode && size == o.size && mtime_ns == o.mtime_ns;
+    }
+    bool operator!=(const FileStamp& o) const { return !(*this == o); }
+};
+
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher() { stop(); }
+
+    bool start(const std::string& path, int debounce_ms, std::function<void()> on_change, std::string& err) {
+        size_t slash = path.find_last_of("/\\");
+        return startWatch(slash == std::string::npos ? "." : path.substr(0, slash),
+                          slash == std::string::npos ? path : path.substr(slash + 1),
+                          debounce_ms, std::move(on_change), err);
+    }
+
+    bool startDir(const std::string& dir, int debounce_ms, std::function<void()> on_change, std::string& err) {
+        return startWatch(dir, "", debounce_ms, std::move(on_change), err);
+    }
+
+    void stop() {
+        stopping_ = true;
+        if (thread_.joinable()) thread_.join();
+#ifdef __linux__
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+    }
+
+private:
+    static const int kPollMs = 200;    // 检查 stopping_ 的间隔
+
+    std::string dir_, name_, path_;     // name_ 为空时监视整个目录
+    int debounce_ms_ = 300;
+    std::function<void()> on_change_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{ false };
+
+    bool startWatch(const std::string& dir, const std::string& name, int debounce_ms,
+                    std::function<void()> on_change, std::string& err) {
+        stop();
+        dir_ = dir;
+        name_ = name;
+        path_ = name.empty() ? dir : dir + "/" + name;
+        debounce_ms_ = debounce_ms;
+        on_change_ = std::move(on_change);
+#ifdef __linux__
+        uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+        if (name_.empty()) mask |= IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+        fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) { err = "inotify_init1 失败"; return false; }
+        if (::inotify_add_watch(fd_, dir_.c_str(), mask) < 0) {
+            ::close(fd_);
+            fd_ = -1;
+            err = "无法监视目录 " + dir_;
+            return false;
+        }
+#else
+        (void)err;
+#endif
+        stopping_ = false;
+        thread_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+#ifdef __linux__
+    int fd_ = -1;
+
+    // 读出所有就绪事件, 返回其中是否有目标文件
+    bool drainEvents() {
+        alignas(struct inotify_event) char buf[4096];
+        bool hit = false;
+        for (;;) {
+            ssize_t n = ::read(fd_, buf, sizeof(buf));
+            if (n <= 0) break;
+            for (char* p = buf; p < buf + n;) {
+                const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                if (ev->len > 0 && (name_.empty() || name_ == ev->name)) hit = true;
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+        return hit;
+    }
+#else
+    // 目录中各文件 FileStamp 的组合, 任何文件变化都会改变它
+    uint64_t dirStamp() const {
+        uint64_t h = 1469598103934665603ull;
+        std::error_code ec;
+        for (const auto& e : std::filesystem::directory_iterator(dir_, ec)) {
+            FileStamp s = FileStamp::of(e.path().string());
+            std::string name = e.path().filename().string();
+            for (char c : name) h = (h ^ (unsigned char)c) * 1099511628211ull;
+            h = (h ^ s.size) * 1099511628211ull;
+            h = (h ^ (uint64_t)s.mtime_ns) * 1099511628211ull;
+        }
+        return h;
+    }
+#endif
+
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        bool pending = false;
+        Clock::time_point deadline;
+#ifndef __linux__
+        FileStamp last = FileStamp::of(path_);
+        uint64_t last_dir = name_.empty() ? dirStamp() : 0;
+#endif
+        while (!stopping_) {
+            bool hit = false;
+#ifdef __linux__
+            struct pollfd pfd = { fd_, POLLIN, 0 };
+            if (::poll(&pfd, 1, kPollMs) > 0) hit = drainEvents();
+#else
+            for (int waited = 0; waited < 1000 && !stopping_; waited += kPollMs) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+            }
+            if (name_.empty()) {
+                uint64_t now = dirStamp();
+                hit = now != last_dir;
+                last_dir = now;
+            } else {
+                FileStamp now = FileStamp::of(path_);
+                hit = now != last;
+                last = now;
+            }
+#endif
+            if (hit) {
+                pending = true;
+                deadline = Clock::now() + std::chrono::milliseconds(debounce_ms_);
+            } else if (pending && Clock::now() >= deadline) {
+                pending = false;
+                on_change_();
+            }
+        }
+    }
+};
+
+#endif // BYD_FILE_WATCHER_H
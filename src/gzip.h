@@ -0,0 +1,333 @@
+/**
+ * gzip 压缩 (RFC 1951 deflate + RFC 1952 容器), 不依赖 zlib
+ *
+ * 用于启动时预压缩静态资源, 重压缩率不重速度: LZ77 用 3 字节哈希链在 32KB 窗口内找最长匹配
+ * (每个位置最多比较 kMaxChain 个候选, 一步惰性匹配), 每 kBlockSymbols 个符号输出一个动态 Huffman 块,
+ * 码长按频率构造, 超过长度上限时把频率减半重建。
+ */
+
+#ifndef BYD_GZIP_H
+#define BYD_GZIP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gzip_detail {
+
+inline uint32_t crc32(const unsigned char* p, size_t n) {
+    static const std::vector<uint32_t> table = []() {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++) c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+// deflate 的位流从每个字节的低位开始填
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        acc_ |= (uint64_t)value << count_;
+        count_ += bits;
+        while (count_ >= 8) {
+            out_.push_back((char)(acc_ & 0xFF));
+            acc_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    void flush() {
+        if (count_ > 0) out_.push_back((char)(acc_ & 0xFF));
+        acc_ = 0;
+        count_ = 0;
+    }
+
+private:
+    std::string& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+// 按频率构造 Huffman 码长, 不超过 limit 位; 频率为 0 的符号码长为 0
+inline std::vector<uint8_t> huffmanLengths(std::vector<uint32_t> freq, int limit) {
+    std::vector<uint8_t> lengths(freq.size(), 0);
+    for (;;) {
+        struct Node {
+            uint64_t weight;
+            int left, right;    // 叶子为 -1, 符号号存在 left 的补码中
+        };
+        std::vector<Node> nodes;
+        using Item = std::pair<uint64_t, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+        for (size_t s = 0; s < freq.size(); s++) {
+            if (freq[s] == 0) continue;
+            heap.push({ freq[s], (int)nodes.size() });
+            nodes.push_back({ freq[s], ~(int)s, -1 });
+        }
+        if (nodes.empty()) return lengths;
+        if (nodes.size() == 1) {
+            lengths[~nodes[0].left] = 1;
+            return lengths;
+        }
+        while (heap.size() > 1) {
+            Item a = heap.top();
+            heap.pop();
+            Item b = heap.top();
+            heap.pop();
+            heap.push({ a.first + b.first, (int)nodes.size() });
+            nodes.push_back({ a.first + b.first, a.second, b.second });
+        }
+        int max_depth = 0;
+        std::vector<std::pair<int, int>> stack = { { heap.top().second, 0 } };
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back();
+            stack.pop_back();
+            const Node& n = nodes[idx];
+            if (n.right < 0) {
+                lengths[~n.left] = (uint8_t)depth;
+                max_depth = std::max(max_depth, depth);
+            } else {
+                stack.push_back({ n.left, depth + 1 });
+                stack.push_back({ n.right, depth + 1 });
+            }
+        }
+        if (max_depth <= limit) return lengths;
+        for (auto& f : freq) if (f > 0) f = (f >> 1) | 1;
+    }
+}
+
+// 规范 Huffman 码 (RFC 1951 3.2.2), 已按位翻转以便低位先写
+inline std::vector<uint16_t> canonicalCodes(const std::vector<uint8_t>& lengths) {
+    int bl_count[16] = { 0 };
+    for (uint8_t l : lengths) bl_count[l]++;
+    bl_count[0] = 0;
+    int next[16] = { 0 };
+    int code = 0;
+    for (int bits = 1; bits < 16; bits++) {
+        code = (code + bl_count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    std::vector<uint16_t> codes(lengths.size(), 0);
+    for (size_t s = 0; s < lengths.size(); s++) {
+        int len = lengths[s];
+        if (len == 0) continue;
+        int c = next[len]++;
+        int rev = 0;
+        for (int i = 0; i < len; i++) rev |= ((c >> i) & 1) << (len - 1 - i);
+        codes[s] = (uint16_t)rev;
+    }
+    return codes;
+}
+
+static const int kLengthBase[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int kDistBase[30] = { 1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,    65,    97,    129,
+                                   193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+inline int lengthCode(int len) {
+    int i = 28;
+    while (kLengthBase[i] > len) i--;
+    return i;
+}
+
+inline int distCode(int dist) {
+    int i = 29;
+    while (kDistBase[i] > dist) i--;
+    return i;
+}
+
+// LZ77 输出: dist 为 0 时 value 是字面字节, 否则是匹配长度
+struct Symbol {
+    uint16_t value;
+    uint16_t dist;
+};
+
+inline void writeBlock(BitWriter& bw, const std::vector<Symbol>& syms, bool final) {
+    std::vector<uint32_t> lit_freq(286, 0), dist_freq(30, 0);
+    for (const Symbol& s : syms) {
+        if (s.dist == 0) {
+            lit_freq[s.value]++;
+        } else {
+            lit_freq[257 + lengthCode(s.value)]++;
+            dist_freq[distCode(s.dist)]++;
+        }
+    }
+    lit_freq[256] = 1;
+    // 只有一个码字的树是不完整的, 补一个符号让每棵树至少两个码字
+    if (std::count_if(lit_freq.begin(), lit_freq.end(), [](uint32_t f) { return f > 0; }) < 2) lit_freq[0]++;
+    while (std::count_if(dist_freq.begin(), dist_freq.end(), [](uint32_t f) { return f > 0; }) < 2) {
+        dist_freq[dist_freq[0] == 0 ? 0 : 1]++;
+    }
+    std::vector<uint8_t> lit_len = huffmanLengths(lit_freq, 15);
+    std::vector<uint8_t> dist_len = huffmanLengths(dist_freq, 15);
+    int hlit = 286, hdist = 30;
+    while (hlit > 257 && lit_len[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && dist_len[hdist - 1] == 0) hdist--;
+
+    // 码长序列的游程编码: 16 重复前一个 3-6 次, 17 / 18 连续 3-10 / 11-138 个 0
+    std::vector<uint8_t> all(lit_len.begin(), lit_len.begin() + hlit);
+    all.insert(all.end(), dist_len.begin(), dist_len.begin() + hdist);
+    std::vector<std::pair<uint8_t, uint8_t>> rle;     // (码长符号, 附加值)
+    for (size_t i = 0; i < all.size();) {
+        size_t run = 1;
+        while (i + run < all.size() && all[i + run] == all[i]) run++;
+        if (all[i] == 0 && run >= 3) {
+            size_t n = std::min<size_t>(run, 138);
+            if (n >= 11) rle.push_back({ 18, (uint8_t)(n - 11) });
+            else rle.push_back({ 17, (uint8_t)(n - 3) });
+            i += n;
+        } else if (all[i] != 0 && run >= 4) {
+            rle.push_back({ all[i], 0 });
+            size_t n = std::min<size_t>(run - 1, 6);
+            rle.push_back({ 16, (uint8_t)(n - 3) });
+            i += 1 + n;
+        } else {
+            rle.push_back({ all[i], 0 });
+            i++;
+        }
+    }
+    std::vector<uint32_t> cl_freq(19, 0);
+    for (auto& r : rle) cl_freq[r.first]++;
+    if (std::count_if(cl_freq.begin(), cl_freq.end(), [](uint32_t f) { return f > 0; }) < 2) {
+        cl_freq[cl_freq[0] == 0 ? 0 : 1]++;
+    }
+    std::vector<uint8_t> cl_len = huffmanLengths(cl_freq, 7);
+    std::vector<uint16_t> cl_code = canonicalCodes(cl_len);
+    static const int kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    int hclen = 19;
+    while (hclen > 4 && cl_len[kOrder[hclen - 1]] == 0) hclen--;
+
+    bw.put(final ? 1 : 0, 1);
+    bw.put(2, 2);
+    bw.put((uint32_t)(hlit - 257), 5);
+    bw.put((uint32_t)(hdist - 1), 5);
+    bw.put((uint32_t)(hclen - 4), 4);
+    for (int i = 0; i < hclen; i++) bw.put(cl_len[kOrder[i]], 3);
+    for (auto& r : rle) {
+        bw.put(cl_code[r.first], cl_len[r.first]);
+        if (r.first == 16) bw.put(r.second, 2);
+        else if (r.first == 17) bw.put(r.second, 3);
+        else if (r.first == 18) bw.put(r.second, 7);
+    }
+
+    std::vector<uint16_t> lit_code = canonicalCodes(lit_len);
+    std::vector<uint16_t> dist_code = canonicalCodes(dist_len);
+    for (const Symbol& s : syms) {
+        if (s.dist == 0) {
+            bw.put(lit_code[s.value], lit_len[s.value]);
+            continue;
+        }
+        int lc = lengthCode(s.value);
+        bw.put(lit_code[257 + lc], lit_len[257 + lc]);
+        bw.put((uint32_t)(s.value - kLengthBase[lc]), kLengthExtra[lc]);
+        int dc = distCode(s.dist);
+        bw.put(dist_code[dc], dist_len[dc]);
+        bw.put((uint32_t)(s.dist - kDistBase[dc]), kDistExtra[dc]);
+    }
+    bw.put(lit_code[256], lit_len[256]);
+}
+
+} // namespace gzip_detail
+
+inline std::string gzipCompress(const std::string& input) {
+    using namespace gzip_detail;
+    static const int kWindow = 32768;
+    static const int kMinMatch = 3;
+    static const int kMaxMatch = 258;
+    static const int kMaxChain = 256;
+    static const size_t kBlockSymbols = 32768;
+    static const int kHashBits = 15;
+
+    // 文件头: 魔数, deflate, 无标志, 无时间戳, 最大压缩, 操作系统未知
+    std::string out = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 2, '\xff' };
+    BitWriter bw(out);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(input.data());
+    const int n = (int)input.size();
+    std::vector<int> head(1 << kHashBits, -1);
+    std::vector<int> prev(n > 0 ? n : 1, -1);
+    auto hashAt = [&](int i) {
+        return (int)(((uint32_t)p[i] << 16 | (uint32_t)p[i + 1] << 8 | p[i + 2]) * 2654435761u >> (32 - kHashBits));
+    };
+    auto insert = [&](int i) {
+        if (i + kMinMatch > n) return;
+        int h = hashAt(i);
+        prev[i] = head[h];
+        head[h] = i;
+    };
+    // 返回 (长度, 距离); 调用前 i 尚未插入哈希链
+    auto longest = [&](int i) {
+        std::pair<int, int> best = { 0, 0 };
+        if (i + kMinMatch > n) return best;
+        int limit = std::min(kMaxMatch, n - i);
+        int cand = head[hashAt(i)];
+        for (int chain = 0; cand >= 0 && i - cand <= kWindow && chain < kMaxChain; chain++, cand = prev[cand]) {
+            if (p[cand + best.first] != p[i + best.first]) continue;
+            int len = 0;
+            while (len < limit && p[cand + len] == p[i + len]) len++;
+            if (len > best.first) {
+                best = { len, i - cand };
+                if (len == limit) break;
+            }
+        }
+        if (best.first < kMinMatch) best = { 0, 0 };
+        return best;
+    };
+
+    std::vector<Symbol> syms;
+    syms.reserve(kBlockSymbols);
+    int i = 0;
+    std::pair<int, int> cur = longest(0);
+    while (i < n) {
+        if (cur.first == 0) {
+            syms.push_back({ p[i], 0 });
+            insert(i);
+            i++;
+            cur = longest(i);
+        } else {
+            insert(i);
+            std::pair<int, int> next = longest(i + 1);
+            if (next.first > cur.first) {
+                // 惰性匹配: 下一个位置的匹配更长, 当前字节作为字面量输出
+                syms.push_back({ p[i], 0 });
+                i++;
+                cur = next;
+            } else {
+                syms.push_back({ (uint16_t)cur.first, (uint16_t)cur.second });
+                for (int k = 1; k < cur.first; k++) insert(i + k);
+                i += cur.first;
+                cur = longest(i);
+            }
+        }
+        if (syms.size() >= kBlockSymbols && i < n) {
+            writeBlock(bw, syms, false);
+            syms.clear();
+        }
+    }
+    writeBlock(bw, syms, true);
+    bw.flush();
+
+    uint32_t crc = crc32(p, input.size());
+    uint32_t isize = (uint32_t)input.size();
+    for (int k = 0; k < 4; k++) out.push_back((char)((crc >> (8 * k)) & 0xFF));
+    for (int k = 0; k < 4; k++) out.push_back((char)((isize >> (8 * k)) & 0xFF));
+    return out;
+}
+
+#endif // BYD_GZIP_H
@@ -0,0 +1,114 @@
+/**
+ * JSON 字符串转义 (RFC 8259)
+ *
+ * 每次比较 32 字节 (AVX2) 或 16 字节 (SSE2), 找出 '"'、'\\' 与 0x20 以下的控制字节,
+ * 其间的干净区间 (包括全部多字节 UTF-8) 整段追加到输出缓冲, 只对特殊字节逐个处理。
+ * 扫描路径在编译时选择; 定义 BYD_SCALAR_JSON_ESCAPE 时只用逐字节循环 (escape_json_fuzz.cpp 借此单独检查标量路径)。
+ */
+
+#ifndef BYD_JSON_ESCAPE_H
+#define BYD_JSON_ESCAPE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline unsigned countTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned)idx;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// 返回 p[0..n) 中第一个需要转义的字节 ('"', '\\', 控制字符 < 0x20) 的下标, 不存在时返回 n。
+// UTF-8 多字节序列 (>= 0x80) 均视为干净字节
+inline size_t findJsonEscape(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__) && !defined(BYD_SCALAR_JSON_ESCAPE)
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i bslash32 = _mm256_set1_epi8('\\');
+    const __m256i ctrl32 = _mm256_set1_epi8(0x1F);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, bslash32)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl32), ctrl32));   // v <= 0x1F (无符号)
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) return i + countTrailingZeros(mask);
+    }
+#endif
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(BYD_SCALAR_JSON_ESCAPE)
+    const __m128i quote16 = _mm_set1_epi8('"');
+    const __m128i bslash16 = _mm_set1_epi8('\\');
+    const __m128i ctrl16 = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote16), _mm_cmpeq_epi8(v, bslash16)),
+            _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl16), ctrl16));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return i + countTrailingZeros(mask);
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned char c = (unsigned char)p[i];
+        if (c < 0x20 || c == '"' || c == '\\') return i;
+    }
+    return n;
+}
+
+// 转义并追加到 out: 干净区间整段拷贝, 仅对特殊字节逐个处理
+inline void appendJsonEscaped(std::string& out, const char* p, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    out.reserve(out.size() + n);
+    while (n > 0) {
+        size_t k = findJsonEscape(p, n);
+        out.append(p, k);
+        if (k == n) break;
+        unsigned char c = (unsigned char)p[k];
+        switch (c) {
+            case '"':  out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2);  break;
+            case '\f': out.append("\\f", 2);  break;
+            case '\n': out.append("\\n", 2);  break;
+            case '\r': out.append("\\r", 2);  break;
+            case '\t': out.append("\\t", 2);  break;
+            default: {
+                const char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                out.append(u, 6);
+                break;
+            }
+        }
+        p += k + 1;
+        n -= k + 1;
+    }
+}
+
+// 带引号的 JSON 字符串
+inline void appendJsonString(std::string& out, std::string_view s) {
+    out += '"';
+    appendJsonEscaped(out, s.data(), s.size());
+    out += '"';
+}
+
+// 返回转义后的副本; 响应序列化直接用 appendJsonEscaped / appendJsonString 写入输出缓冲
+inline std::string escapeJson(std::string_view s) {
+    std::string out;
+    appendJsonEscaped(out, s.data(), s.size());
+    return out;
+}
+
+#endif // BYD_JSON_ESCAPE_H
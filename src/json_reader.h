@@ -0,0 +1,276 @@
+/**
+ * 单遍 JSON 拉取式解析器 (pull / SAX 风格)
+ *
+ * 逐个产出事件 (BeginObject, Key, String, Number ...), 字符串与数字以
+ * string_view 的形式直接指向请求体; 只有字符串包含转义序列时才解码到内部缓冲。
+ * 数字使用 std::from_chars 转换, 格式错误返回 false 而不是抛异常。
+ */
+
+#ifndef BYD_JSON_READER_H
+#define BYD_JSON_READER_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class JsonReader {
+public:
+    enum class Token {
+        BeginObject, EndObject, BeginArray, EndArray,
+        Key, String, Number, True, False, Null,
+        End, Error
+    };
+
+    explicit JsonReader(std::string_view text) : p_(text.data()), begin_(text.data()), end_(text.data() + text.size()) {}
+
+    // 读取下一个事件; 出错后一直返回 Token::Error
+    Token next() {
+        if (state_ == St::Failed) return Token::Error;
+        for (;;) {
+            skipWs();
+            switch (state_) {
+            case St::Value:
+                return readValue();
+            case St::ArrayFirst:
+                if (p_ < end_ && *p_ == ']') { ++p_; return closeContainer(Token::EndArray); }
+                return readValue();
+            case St::ObjectFirst:
+                if (p_ < end_ && *p_ == '}') { ++p_; return closeContainer(Token::EndObject); }
+                return readKey();
+            case St::ObjectKey:
+                return readKey();
+            case St::AfterValue:
+                if (stack_.empty()) {
+                    if (p_ == end_) { state_ = St::Done; return Token::End; }
+                    return fail("多余的字符");
+                }
+                if (p_ == end_) return fail("意外的输入结束");
+                if (stack_.back() == '{') {
+                    if (*p_ == ',') { ++p_; state_ = St::ObjectKey; continue; }
+                    if (*p_ == '}') { ++p_; return closeContainer(Token::EndObject); }
+                    return fail("对象中缺少 ',' 或 '}'");
+                }
+                if (*p_ == ',') { ++p_; state_ = St::Value; continue; }
+                if (*p_ == ']') { ++p_; return closeContainer(Token::EndArray); }
+                return fail("数组中缺少 ',' 或 ']'");
+            case St::Done:
+                return Token::End;
+            case St::Failed:
+                return Token::Error;
+            }
+        }
+    }
+
+    // 跳过刚读到的值: 若为 BeginObject/BeginArray 则消费到对应的结束符
+    bool skipValue(Token t) {
+        if (t != Token::BeginObject && t != Token::BeginArray) return t != Token::Error;
+        size_t depth = 1;
+        while (depth > 0) {
+            Token n = next();
+            if (n == Token::BeginObject || n == Token::BeginArray) depth++;
+            else if (n == Token::EndObject || n == Token::EndArray) depth--;
+            else if (n == Token::Error || n == Token::End) return false;
+        }
+        return true;
+    }
+
+    // Key/String 的内容 (已反转义); Number 的原始文本
+    std::string_view value() const { return value_; }
+
+    bool toInt(int& out) const { return parseInt(value_, out); }
+    bool toDouble(double& out) const { return parseDouble(value_, out); }
+
+    const std::string& error() const { return error_; }
+    size_t offset() const { return (size_t)(p_ - begin_); }
+
+    static bool parseInt(std::string_view s, int& out) {
+        if (s.empty()) return false;
+        auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+    static bool parseDouble(std::string_view s, double& out) {
+        if (s.empty()) return false;
+        auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+private:
+    enum class St { Value, ArrayFirst, ObjectFirst, ObjectKey, AfterValue, Done, Failed };
+    static constexpr size_t kMaxDepth = 64;
+
+    const char* p_;
+    const char* begin_;
+    const char* end_;
+    St state_ = St::Value;
+    std::vector<char> stack_;
+    std::string_view value_;
+    std::string scratch_;   // 仅在字符串含转义时使用
+    std::string error_;
+
+    void skipWs() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    Token fail(const char* msg) {
+        state_ = St::Failed;
+        error_ = std::string(msg) + " (偏移 " + std::to_string(offset()) + ")";
+        return Token::Error;
+    }
+
+    Token closeContainer(Token t) {
+        stack_.pop_back();
+        state_ = St::AfterValue;
+        return t;
+    }
+
+    Token openContainer(char c, St st, Token t) {
+        if (stack_.size() >= kMaxDepth) return fail("嵌套层数过深");
+        ++p_;
+        stack_.push_back(c);
+        state_ = st;
+        return t;
+    }
+
+    Token readKey() {
+        if (p_ == end_ || *p_ != '"') return fail("缺少对象键");
+        if (!readString()) return Token::Error;
+        skipWs();
+        if (p_ == end_ || *p_ != ':') return fail("对象键后缺少 ':'");
+        ++p_;
+        state_ = St::Value;
+        return Token::Key;
+    }
+
+    Token readValue() {
+        if (p_ == end_) return fail("意外的输入结束");
+        switch (*p_) {
+        case '{': return openContainer('{', St::ObjectFirst, Token::BeginObject);
+        case '[': return openContainer('[', St::ArrayFirst, Token::BeginArray);
+        case '"':
+            if (!readString()) return Token::Error;
+            state_ = St::AfterValue;
+            return Token::String;
+        case 't': return readLiteral("true", Token::True);
+        case 'f': return readLiteral("false", Token::False);
+        case 'n': return readLiteral("null", Token::Null);
+        default:  return readNumber();
+        }
+    }
+
+    Token readLiteral(const char* lit, Token t) {
+        size_t n = std::strlen(lit);
+        if ((size_t)(end_ - p_) < n || std::memcmp(p_, lit, n) != 0) return fail("无效的字面量");
+        p_ += n;
+        value_ = std::string_view(p_ - n, n);
+        state_ = St::AfterValue;
+        return t;
+    }
+
+    // JSON 数字语法: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    Token readNumber() {
+        const char* s = p_;
+        auto digits = [&]() { const char* d = p_; while (p_ < end_ && *p_ >= '0' && *p_ <= '9') ++p_; return p_ > d; };
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (p_ < end_ && *p_ == '0') ++p_;
+        else if (!digits()) return fail("无效的数值");
+        if (p_ < end_ && *p_ == '.') { ++p_; if (!digits()) return fail("无效的数值"); }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (!digits()) return fail("无效的数值");
+        }
+        value_ = std::string_view(s, (size_t)(p_ - s));
+        state_ = St::AfterValue;
+        return Token::Number;
+    }
+
+    // 读取字符串: 无转义时 value_ 指向原文, 否则解码到 scratch_
+    bool readString() {
+        const char* s = ++p_;
+        while (p_ < end_ && *p_ != '"' && *p_ != '\\') {
+            if ((unsigned char)*p_ < 0x20) { fail("字符串中包含未转义的控制字符"); return false; }
+            ++p_;
+        }
+        if (p_ == end_) { fail("字符串未闭合"); return false; }
+        if (*p_ == '"') {
+            value_ = std::string_view(s, (size_t)(p_ - s));
+            ++p_;
+            return true;
+        }
+        scratch_.assign(s, (size_t)(p_ - s));
+        while (p_ < end_ && *p_ != '"') {
+            unsigned char c = (unsigned char)*p_;
+            if (c < 0x20) { fail("字符串中包含未转义的控制字符"); return false; }
+            if (c != '\\') { scratch_ += (char)c; ++p_; continue; }
+            if (++p_ == end_) break;
+            switch (*p_++) {
+            case '"':  scratch_ += '"';  break;
+            case '\\': scratch_ += '\\'; break;
+            case '/':  scratch_ += '/';  break;
+            case 'b':  scratch_ += '\b'; break;
+            case 'f':  scratch_ += '\f'; break;
+            case 'n':  scratch_ += '\n'; break;
+            case 'r':  scratch_ += '\r'; break;
+            case 't':  scratch_ += '\t'; break;
+            case 'u':  if (!readUnicodeEscape()) return false; break;
+            default:   fail("无效的转义序列"); return false;
+            }
+        }
+        if (p_ == end_) { fail("字符串未闭合"); return false; }
+        ++p_;
+        value_ = scratch_;
+        return true;
+    }
+
+    bool readHex4(uint32_t& cp) {
+        if (end_ - p_ < 4) return false;
+        cp = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *p_++;
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= (uint32_t)(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    // \uXXXX (含 UTF-16 代理对) -> UTF-8
+    bool readUnicodeEscape() {
+        uint32_t cp;
+        if (!readHex4(cp)) { fail("无效的 \\u 转义"); return false; }
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            uint32_t lo;
+            if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') { fail("缺少低位代理项"); return false; }
+            p_ += 2;
+            if (!readHex4(lo) || lo < 0xDC00 || lo > 0xDFFF) { fail("无效的低位代理项"); return false; }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            fail("孤立的低位代理项");
+            return false;
+        }
+        if (cp < 0x80) {
+            scratch_ += (char)cp;
+        } else if (cp < 0x800) {
+            scratch_ += (char)(0xC0 | (cp >> 6));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            scratch_ += (char)(0xE0 | (cp >> 12));
+            scratch_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        } else {
+            scratch_ += (char)(0xF0 | (cp >> 18));
+            scratch_ += (char)(0x80 | ((cp >> 12) & 0x3F));
+            scratch_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            scratch_ += (char)(0x80 | (cp & 0x3F));
+        }
+        return true;
+    }
+};
+
+#endif // BYD_JSON_READER_H
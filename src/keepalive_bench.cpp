@@ -0,0 +1,300 @@
+// keep-alive 连接数基准: 对运行中的服务端保持大量空闲连接, 同时测量活跃请求的延迟 (Linux)
+//
+//   g++ -std=c++17 -O2 -pthread -o keepalive_bench keepalive_bench.cpp
+//   ./keepalive_bench [--port=8080] [--idle=10000] [--clients=4] [--seconds=10] [--path=/api/stats]
+//
+// idle:    每个连接发一个请求并读完响应后保持打开、不再发送 (浏览器标签页的典型行为),
+//          统计建立的连接数、得到响应的连接数, 以及测量期间被服务端关闭的连接数
+// clients: 空闲连接建立后, 各自在一个 keep-alive 连接上循环请求 path (被关闭时重连),
+//          统计吞吐与延迟分位; 超过 --timeout-ms 没有响应记为失败
+// 服务端的 --keep-alive-sec 应大于建立连接与测量的总时间, 否则空闲连接会按超时被正常关闭
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct BenchOptions {
+    int port = 8080;
+    size_t idle = 10000;
+    unsigned clients = 4;
+    double seconds = 10;
+    string path = "/api/stats";
+    int timeout_ms = 5000;
+    double setup_seconds = 20;      // 建立空闲连接并等待响应的最长时间
+};
+
+double secondsSince(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+int connectTo(int port, bool nonblocking) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | (nonblocking ? SOCK_NONBLOCK : 0), 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+string requestFor(const BenchOptions& opt) {
+    return "GET " + opt.path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+}
+
+// 缓冲中是否已有一个完整的响应 (只支持 Content-Length), 完整时返回响应长度
+size_t completeResponse(const string& buf) {
+    size_t end = buf.find("\r\n\r\n");
+    if (end == string::npos) return 0;
+    size_t length = 0;
+    size_t p = buf.find("Content-Length: ");
+    if (p != string::npos && p < end) length = strtoul(buf.c_str() + p + 16, nullptr, 10);
+    return buf.size() >= end + 4 + length ? end + 4 + length : 0;
+}
+
+// 空闲连接: 一个线程用 epoll 建立连接、发送请求、读完响应, 之后只检测是否被关闭
+struct IdleConnections {
+    enum State { kConnecting, kWaiting, kIdle, kClosed };
+    struct Conn {
+        int fd;
+        State state;
+        string buf;
+    };
+
+    const BenchOptions& opt;
+    vector<Conn> conns;
+    int epfd = -1;
+    size_t connected = 0;
+    size_t answered = 0;
+    size_t closed_by_server = 0;    // 进入空闲后被关闭的连接
+
+    explicit IdleConnections(const BenchOptions& o) : opt(o) { epfd = ::epoll_create1(0); }
+    ~IdleConnections() {
+        for (auto& c : conns) if (c.state != kClosed) ::close(c.fd);
+        ::close(epfd);
+    }
+
+    void open() {
+        conns.reserve(opt.idle);
+        string req = requestFor(opt);
+        auto t0 = chrono::steady_clock::now();
+        size_t next = 0;
+        size_t in_flight = 0;
+        size_t settled = 0;         // 已得到响应或失败的连接
+        // 正在握手或等待响应的连接不超过 1000 个, 避免超出服务端的 listen backlog 而丢 SYN
+        while (secondsSince(t0) < opt.setup_seconds && settled < opt.idle) {
+            while (next < opt.idle && in_flight < 1000) {
+                int fd = connectTo(opt.port, true);
+                next++;
+                if (fd < 0) {
+                    conns.push_back({ -1, kClosed, "" });
+                    settled++;
+                    continue;
+                }
+                epoll_event ev;
+                ev.events = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+                ev.data.u64 = conns.size();
+                ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+                conns.push_back({ fd, kConnecting, "" });
+                in_flight++;
+            }
+            epoll_event events[512];
+            int n = ::epoll_wait(epfd, events, 512, 100);
+            for (int i = 0; i < n; i++) {
+                Conn& c = conns[events[i].data.u64];
+                bool pending = c.state == kConnecting || c.state == kWaiting;
+                handle(c, events[i].events, req);
+                if (pending && (c.state == kIdle || c.state == kClosed)) {
+                    in_flight--;
+                    settled++;
+                }
+            }
+        }
+    }
+
+    void handle(Conn& c, uint32_t events, const string& req) {
+        if (c.state == kConnecting && (events & EPOLLOUT)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            ::getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0 || ::send(c.fd, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) {
+                closeConn(c);
+                return;
+            }
+            connected++;
+            c.state = kWaiting;
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.u64 = (uint64_t)(&c - conns.data());
+            ::epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+        }
+        if (!(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) return;
+        char buf[4096];
+        for (;;) {
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                if (c.state == kWaiting) {
+                    c.buf.append(buf, (size_t)n);
+                    if (completeResponse(c.buf)) {
+                        answered++;
+                        c.state = kIdle;
+                        string().swap(c.buf);
+                    }
+                }
+                continue;
+            }
+            if (n < 0 && errno == EAGAIN) return;
+            if (c.state == kIdle) closed_by_server++;
+            closeConn(c);
+            return;
+        }
+    }
+
+    void closeConn(Conn& c) {
+        ::close(c.fd);
+        c.state = kClosed;
+    }
+
+    // 测量期间: 只处理关闭事件
+    void watch(atomic<bool>& stop) {
+        string req = requestFor(opt);
+        while (!stop.load()) {
+            epoll_event events[512];
+            int n = ::epoll_wait(epfd, events, 512, 100);
+            for (int i = 0; i < n; i++) handle(conns[events[i].data.u64], events[i].events, req);
+        }
+    }
+
+    size_t stillOpen() const {
+        size_t n = 0;
+        for (auto& c : conns) n += c.state == kIdle;
+        return n;
+    }
+};
+
+// 活跃客户端的一次请求, 连接被关闭或出错时重连; 返回是否在超时内收到完整响应
+bool requestOnce(int& fd, const BenchOptions& opt, const string& req) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (fd < 0) fd = connectTo(opt.port, false);
+        if (fd < 0) return false;
+        if (::send(fd, req.data(), req.size(), MSG_NOSIGNAL) == (ssize_t)req.size()) {
+            string buf;
+            char chunk[4096];
+            auto t0 = chrono::steady_clock::now();
+            for (;;) {
+                int left = opt.timeout_ms - (int)(secondsSince(t0) * 1000);
+                pollfd p = { fd, POLLIN, 0 };
+                if (left <= 0 || ::poll(&p, 1, left) <= 0) break;
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) break;
+                buf.append(chunk, (size_t)n);
+                if (size_t len = completeResponse(buf)) {
+                    bool ok = buf.compare(0, 12, "HTTP/1.1 200") == 0;
+                    if (buf.find("Connection: close") < len) {
+                        ::close(fd);
+                        fd = -1;
+                    }
+                    return ok;
+                }
+            }
+            // 超时不重试: 重连只会排到更后面
+            if (secondsSince(t0) * 1000 >= opt.timeout_ms) {
+                ::close(fd);
+                fd = -1;
+                return false;
+            }
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string val = eq == string::npos ? "" : arg.substr(eq + 1);
+        double v = atof(val.c_str());
+        if (key == "--port" && v > 0) opt.port = (int)v;
+        else if (key == "--idle" && v >= 0 && !val.empty()) opt.idle = (size_t)v;
+        else if (key == "--clients" && v > 0) opt.clients = (unsigned)v;
+        else if (key == "--seconds" && v > 0) opt.seconds = v;
+        else if (key == "--path" && !val.empty()) opt.path = val;
+        else if (key == "--timeout-ms" && v > 0) opt.timeout_ms = (int)v;
+        else if (key == "--setup-seconds" && v > 0) opt.setup_seconds = v;
+        else {
+            cerr << "Usage: " << argv[0] << " [--port=N] [--idle=N] [--clients=N] [--seconds=S] [--path=P]"
+                 << " [--timeout-ms=N] [--setup-seconds=S]" << endl;
+            return 1;
+        }
+    }
+    rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    IdleConnections idle(opt);
+    auto t0 = chrono::steady_clock::now();
+    idle.open();
+    cout << "idle    " << idle.connected << "/" << opt.idle << " connected, " << idle.answered << " answered in "
+         << secondsSince(t0) << " s" << endl;
+
+    atomic<bool> stop{ false };
+    thread watcher([&]() { idle.watch(stop); });
+    vector<vector<double>> latencies(opt.clients);
+    atomic<size_t> failed{ 0 };
+    string req = requestFor(opt);
+    t0 = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (unsigned c = 0; c < opt.clients; c++) {
+        clients.emplace_back([&, c]() {
+            int fd = -1;
+            while (secondsSince(t0) < opt.seconds) {
+                auto r0 = chrono::steady_clock::now();
+                if (requestOnce(fd, opt, req)) latencies[c].push_back(secondsSince(r0) * 1e3);
+                else failed++;
+            }
+            if (fd >= 0) ::close(fd);
+        });
+    }
+    for (auto& t : clients) t.join();
+    double s = secondsSince(t0);
+    stop = true;
+    watcher.join();
+
+    vector<double> all;
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+    sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all.empty() ? 0.0 : all[min(all.size() - 1, (size_t)(p * all.size()))]; };
+    cout << "active  " << all.size() / s << " req/s, p50 " << pct(0.5) << " ms, p99 " << pct(0.99) << " ms, max "
+         << (all.empty() ? 0.0 : all.back()) << " ms, failed " << failed << endl;
+    cout << "idle    " << idle.stillOpen() << " still open, " << idle.closed_by_server << " closed by server" << endl;
+    return 0;
+}
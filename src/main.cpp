@@ -4,11 +4,40 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <csignal>
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <memory>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <charconv>
+#include <cstring>
+#include <cmath>
 
 #include "httplib.h"
+#include "json_reader.h"
+#include "json_escape.h"
+#include "wal.h"
+#include "snapshot.h"
+#include "columnar.h"
+#include "text_loader.h"
+#include "data_format.h"
+#include "file_watcher.h"
+#include "mvcc.h"
+#include "task_queue.h"
+#include "admission.h"
+#include "epoll_server.h"
+#include "static_assets.h"
+#include "single_flight.h"
+#include "metrics.h"
+#include "trace.h"
+#include "access_log.h"
+#include "supervisor.h"
 
 using namespace std;
 
@@ -51,11 +80,54 @@ struct ModelTech {
     // model_id + tech_id 唯一约束
 };
 
+// 写数据文件用的车型记录 (字符串字段引用 m)
+inline ModelRecord toRecord(const Model& m) {
+    ModelRecord r;
+    r.id = m.model_id;
+    r.name = m.model_name;
+    r.series_id = m.series_id;
+    r.price = m.price;
+    r.range_km = m.range_km;
+    r.energy_type = m.energy_type;
+    r.body_type = m.body_type;
+    r.seats = m.seats;
+    r.launch_year = m.launch_year;
+    return r;
+}
+
 // =============================
 // 数据管理器 (带完整性校验)
 // =============================
 
 const string DATA_FILE = "../data/byd_web_data.txt";
+const string WAL_FILE = "../data/byd_web_data.wal";
+// 二进制快照的 A/B 两个槽位: 轮流写入, 加载序号最大且校验通过的一个; 不旧于文本文件时优先于文本加载
+const string SNAPSHOT_FILES[2] = { "../data/byd_web_data.a.snap", "../data/byd_web_data.b.snap" };
+const string LEGACY_SNAPSHOT_FILE = "../data/byd_web_data.snap";   // 旧版单文件快照 (无校验和)
+// 分发给只读副本的压缩列式文件 (--convert --to=columnar 生成); 比快照与文本文件都新时优先加载
+const string COLUMNAR_FILE = "../data/byd_web_data.bydc";
+
+// 前向声明: WAL 记录复用导出的 NDJSON 行编码
+void appendNdjsonRow(string& out, const Series& s);
+void appendNdjsonRow(string& out, const Tech& t);
+void appendNdjsonRow(string& out, const Model& m);
+void appendNdjsonRow(string& out, const ModelTech& mt);
+bool bindRow(JsonReader& r, Series& s, string& err);
+bool bindRow(JsonReader& r, Tech& t, string& err);
+bool bindRow(JsonReader& r, Model& m, string& err);
+bool bindRow(JsonReader& r, ModelTech& mt, string& err);
+
+// WAL 记录类型 (payload 首字节), 其后为该行的 NDJSON 编码
+const char WAL_SERIES = 'S';
+const char WAL_TECH = 'T';
+const char WAL_MODEL = 'M';
+const char WAL_MODEL_TECH = 'L';
+const char WAL_BATCH = 'B';     // 一次批量写入: 其后为以换行分隔的多条上述记录, 崩溃后整批生效或整批丢失
+
+inline char walTag(const Series*)    { return WAL_SERIES; }
+inline char walTag(const Tech*)      { return WAL_TECH; }
+inline char walTag(const Model*)     { return WAL_MODEL; }
+inline char walTag(const ModelTech*) { return WAL_MODEL_TECH; }
 
 // 辅助函数：去除首尾空白
 string trim(const string& s) {
@@ -76,7 +148,55 @@ vector<string> splitStr(const string& s, char delimiter) {
     return tokens;
 }
 
-class CarDataManager {
+// =============================
+// 字段投影 (?fields=model_id,model_name,price)
+// =============================
+
+// 车型可输出字段位掩码; techs 仅在显式请求时才做 车型->技术 关联
+enum ModelField : unsigned {
+    MF_MODEL_ID    = 1u << 0,
+    MF_MODEL_NAME  = 1u << 1,
+    MF_SERIES_ID   = 1u << 2,
+    MF_SERIES_NAME = 1u << 3,
+    MF_PRICE       = 1u << 4,
+    MF_RANGE_KM    = 1u << 5,
+    MF_ENERGY_TYPE = 1u << 6,
+    MF_BODY_TYPE   = 1u << 7,
+    MF_SEATS       = 1u << 8,
+    MF_LAUNCH_YEAR = 1u << 9,
+    MF_TECHS       = 1u << 10,
+    MF_ALL         = (1u << 11) - 1
+};
+
+const pair<const char*, unsigned> MODEL_FIELD_NAMES[] = {
+    { "model_id", MF_MODEL_ID },       { "model_name", MF_MODEL_NAME },
+    { "series_id", MF_SERIES_ID },     { "series_name", MF_SERIES_NAME },
+    { "price", MF_PRICE },             { "range_km", MF_RANGE_KM },
+    { "energy_type", MF_ENERGY_TYPE }, { "body_type", MF_BODY_TYPE },
+    { "seats", MF_SEATS },             { "launch_year", MF_LAUNCH_YEAR },
+    { "techs", MF_TECHS }
+};
+
+// 解析 fields 参数; 未知字段名写入 err 并返回 false
+bool parseFieldMask(const string& spec, unsigned& mask, string& err) {
+    mask = 0;
+    for (const auto& name : splitStr(spec, ',')) {
+        if (name.empty()) continue;
+        bool found = false;
+        for (const auto& f : MODEL_FIELD_NAMES) {
+            if (name == f.first) { mask |= f.second; found = true; break; }
+        }
+        if (!found) { err = "未知字段: " + name; return false; }
+    }
+    if (mask == 0) { err = "fields 参数不能为空"; return false; }
+    return true;
+}
+
+// =============================
+// 数据集: 一份完整的数据 (只读基础快照 + 增量表 + 唯一性索引)
+// 管理器持有当前数据集; 重新加载时在旁边构建新数据集, 校验通过后整体替换
+// =============================
+class CarDataSet {
 public:
     // 数据存储 (模拟数据库表)
     unordered_map<int, Series> series_table;
@@ -84,537 +204,3316 @@ public:
     unordered_map<int, Tech> techs_table;
     vector<ModelTech> model_tech_table;
 
+    // 只读基础数据: 从二进制快照启动时直接在 mmap 上查询, 上面的各表只保存快照之后新增的行;
+    // 从文本文件加载时为空, 全部数据都在各表中
+    shared_ptr<const MappedSnapshot> base_;
+
     // 辅助索引 (用于唯一性校验)
     unordered_set<string> series_names;
     unordered_set<string> model_names;
     unordered_set<string> tech_names;
-    unordered_set<string> model_tech_pairs; // "model_id_tech_id"
+    unordered_set<uint64_t> model_tech_pairs; // pairKey(model_id, tech_id)
 
-    mutable std::mutex mtx_;
     int next_mt_id = 1;
 
+    static uint64_t pairKey(int model_id, int tech_id) {
+        return ((uint64_t)(uint32_t)model_id << 32) | (uint32_t)tech_id;
+    }
+    // 车型的只读视图: 字符串指向增量表或快照映射, 遍历时不复制
+    struct ModelView {
+        int model_id;
+        string_view model_name;
+        int series_id;
+        double price;
+        double range_km;
+        string_view energy_type;
+        string_view body_type;
+        int seats;
+        string_view launch_year;
+
+        Model toModel() const {
+            return { model_id, string(model_name), series_id, price, range_km, string(energy_type),
+                     string(body_type), seats, string(launch_year) };
+        }
+    };
+
+    static ModelView viewOf(const Model& m) {
+        return { m.model_id, m.model_name, m.series_id, m.price, m.range_km,
+                 m.energy_type, m.body_type, m.seats, m.launch_year };
+    }
+
+    ModelView viewOf(const SnapModel& r) const {
+        return { r.id, base_->str(r.name), r.series_id, r.price, r.range_km,
+                 base_->str(r.energy_type), base_->str(r.body_type), r.seats, base_->str(r.launch_year) };
+    }
+
     // -------------------------
-    // 约束校验与数据操作
+    // 基础快照 + 增量表的联合查找 (调用方持有 mtx_)
     // -------------------------
+    bool hasSeries(int id) const { return series_table.count(id) || (base_ && base_->findSeries(id)); }
+    bool hasTech(int id) const { return techs_table.count(id) || (base_ && base_->findTech(id)); }
+    bool hasModel(int id) const { return models_table.count(id) || (base_ && base_->findModel(id)); }
+
+    bool hasSeriesName(const string& name) const { return series_names.count(name) || (base_ && base_->hasSeriesName(name)); }
+    bool hasTechName(const string& name) const { return tech_names.count(name) || (base_ && base_->hasTechName(name)); }
+    bool hasModelName(const string& name) const { return model_names.count(name) || (base_ && base_->hasModelName(name)); }
+
+    bool findSeriesName(int id, string_view& out) const {
+        auto it = series_table.find(id);
+        if (it != series_table.end()) { out = it->second.series_name; return true; }
+        const SnapSeries* s = base_ ? base_->findSeries(id) : nullptr;
+        if (s) out = base_->str(s->name);
+        return s != nullptr;
+    }
 
-    // 新增系列 (非空约束 + 唯一约束)
-    bool addSeries(int id, const string& name, const string& intro, string& err) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (name.empty()) { err = "NOT NULL 约束失败: series_name 不能为空"; return false; }
-        if (series_table.count(id)) { err = "主键约束失败: series_id 已存在"; return false; }
-        if (series_names.count(name)) { err = "唯一约束失败: series_name 已存在"; return false; }
+    bool findTechName(int id, string_view& out) const {
+        auto it = techs_table.find(id);
+        if (it != techs_table.end()) { out = it->second.tech_name; return true; }
+        const SnapTech* t = base_ ? base_->findTech(id) : nullptr;
+        if (t) out = base_->str(t->name);
+        return t != nullptr;
+    }
 
-        series_table[id] = { id, name, intro };
-        series_names.insert(name);
-        return true;
+    // 返回遍历的行数
+    template <typename F>
+    size_t forEachModel(F f) const {
+        size_t scanned = models_table.size();
+        if (base_) {
+            for (const SnapModel& r : base_->models()) f(viewOf(r));
+            scanned += base_->models().size;
+        }
+        for (const auto& p : models_table) f(viewOf(p.second));
+        return scanned;
     }
 
-    // 新增技术 (非空约束 + 唯一约束)
-    bool addTech(int id, const string& name, const string& intro, string& err) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (name.empty()) { err = "NOT NULL 约束失败: tech_name 不能为空"; return false; }
-        if (techs_table.count(id)) { err = "主键约束失败: tech_id 已存在"; return false; }
-        if (tech_names.count(name)) { err = "唯一约束失败: tech_name 已存在"; return false; }
+    // 车型筛选条件; 范围条件未设置时为 (-inf, +inf)
+    struct ModelFilter {
+        int series_id = -1;         // <= 0 表示不限
+        string energy_type;         // 空表示不限
+        double min_price = -HUGE_VAL, max_price = HUGE_VAL;
+        double min_range = -HUGE_VAL, max_range = HUGE_VAL;
 
-        techs_table[id] = { id, name, intro };
-        tech_names.insert(name);
-        return true;
+        static bool inRange(double v, double lo, double hi) {
+            return (lo == -HUGE_VAL && hi == HUGE_VAL) || (v >= lo && v <= hi);
+        }
+
+        bool matches(const ModelView& m) const {
+            return (series_id <= 0 || m.series_id == series_id) &&
+                   (energy_type.empty() || m.energy_type == energy_type) &&
+                   inRange(m.price, min_price, max_price) && inRange(m.range_km, min_range, max_range);
+        }
+
+        // 行组内是否可能有满足条件的车型
+        bool mayMatch(const SnapZone& z) const {
+            return (series_id <= 0 || (series_id >= z.min_series_id && series_id <= z.max_series_id)) &&
+                   !(z.max_price < min_price || z.min_price > max_price) &&
+                   !(z.max_range < min_range || z.min_range > max_range);
+        }
+    };
+
+    // 只遍历满足条件的车型: 快照部分按行组统计跳过不可能命中的整组; 返回检查过的行数
+    template <typename F>
+    size_t forEachModel(const ModelFilter& filter, F f) const {
+        size_t scanned = models_table.size();
+        if (base_) {
+            auto models = base_->models();
+            auto zones = base_->modelZones();
+            auto scan = [&](size_t begin, size_t end) {
+                scanned += end - begin;
+                for (size_t i = begin; i < end; i++) {
+                    ModelView m = viewOf(models[i]);
+                    if (filter.matches(m)) f(m);
+                }
+            };
+            if (zones.size == 0) scan(0, models.size);
+            for (const SnapZone& z : zones) {
+                if (filter.mayMatch(z)) scan(z.begin, z.end);
+            }
+        }
+        for (const auto& p : models_table) {
+            ModelView m = viewOf(p.second);
+            if (filter.matches(m)) f(m);
+        }
+        return scanned;
     }
 
-    // 新增车型 (完整约束校验)
-    bool addModel(int id, const string& name, int series_id, double price, 
-                  double range_km, const string& energy_type, 
-                  const string& body_type, int seats, const string& launch_year,
-                  const vector<int>& tech_ids, string& err) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        
-        // 1. 非空约束
-        if (name.empty()) { err = "NOT NULL 约束失败: model_name 不能为空"; return false; }
-        if (energy_type.empty()) { err = "NOT NULL 约束失败: energy_type 不能为空"; return false; }
+    // 车型绑定的技术名称: 快照中的关联 + 增量关联
+    template <typename F>
+    void forEachTechName(int model_id, F f) const {
+        string_view name;
+        if (base_) {
+            if (const SnapModel* m = base_->findModel(model_id)) {
+                for (const SnapModelTech& mt : base_->techsOf(m)) {
+                    if (findTechName(mt.tech_id, name)) f(name);
+                }
+            }
+        }
+        for (const auto& mt : model_tech_table) {
+            if (mt.model_id == model_id && findTechName(mt.tech_id, name)) f(name);
+        }
+    }
+
+    // -------------------------
+    // 约束校验与数据操作
+    // 数据集发布后, insert* 要求调用方持有管理器的 mtx_
+    // -------------------------
+
+    // 插入系列 (非空约束 + 主键约束 + 唯一约束)
+    bool insertSeries(const Series& s, string& err) {
+        if (s.series_name.empty()) { err = "NOT NULL 约束失败: series_name 不能为空"; return false; }
+        if (hasSeries(s.series_id)) { err = "主键约束失败: series_id 已存在"; return false; }
+        if (hasSeriesName(s.series_name)) { err = "唯一约束失败: series_name 已存在"; return false; }
+
+        series_table[s.series_id] = s;
+        series_names.insert(s.series_name);
+        return true;
+    }
 
-        // 2. 主键约束
-        if (models_table.count(id)) { err = "主键约束失败: model_id 已存在"; return false; }
+    // 插入技术 (非空约束 + 主键约束 + 唯一约束)
+    bool insertTech(const Tech& t, string& err) {
+        if (t.tech_name.empty()) { err = "NOT NULL 约束失败: tech_name 不能为空"; return false; }
+        if (hasTech(t.tech_id)) { err = "主键约束失败: tech_id 已存在"; return false; }
+        if (hasTechName(t.tech_name)) { err = "唯一约束失败: tech_name 已存在"; return false; }
 
-        // 3. 唯一约束
-        if (model_names.count(name)) { err = "唯一约束失败: model_name 已存在"; return false; }
+        techs_table[t.tech_id] = t;
+        tech_names.insert(t.tech_name);
+        return true;
+    }
 
-        // 4. 外键约束: series_id 必须在系列表存在
-        if (series_table.find(series_id) == series_table.end()) {
-            err = "外键约束失败: series_id " + to_string(series_id) + " 在系列表中不存在";
+    // 车型的非空/主键/唯一/外键/CHECK 约束 (不含技术绑定)
+    bool checkModel(const Model& m, string& err) const {
+        if (m.model_name.empty()) { err = "NOT NULL 约束失败: model_name 不能为空"; return false; }
+        if (m.energy_type.empty()) { err = "NOT NULL 约束失败: energy_type 不能为空"; return false; }
+        if (hasModel(m.model_id)) { err = "主键约束失败: model_id 已存在"; return false; }
+        if (hasModelName(m.model_name)) { err = "唯一约束失败: model_name 已存在"; return false; }
+        if (!hasSeries(m.series_id)) {
+            err = "外键约束失败: series_id " + to_string(m.series_id) + " 在系列表中不存在";
             return false;
         }
+        // 写成取反的比较, NaN 不满足任何比较而被拒绝
+        if (!(m.price > 0)) { err = "CHECK 约束失败: price 必须大于 0"; return false; }
+        if (!(m.range_km >= 0)) { err = "CHECK 约束失败: range_km 不能为负"; return false; }
+        return true;
+    }
+
+    bool insertModel(const Model& m, string& err) {
+        if (!checkModel(m, err)) return false;
+        models_table[m.model_id] = m;
+        model_names.insert(m.model_name);
+        return true;
+    }
 
-        // 5. CHECK约束: price > 0
-        if (price <= 0) {
-            err = "CHECK 约束失败: price 必须大于 0";
+    // 插入车型-技术关联 (外键约束; 重复关联视为成功)
+    bool insertModelTech(int model_id, int tech_id, string& err) {
+        if (!hasModel(model_id)) {
+            err = "外键约束失败: model_id " + to_string(model_id) + " 在车型表中不存在";
             return false;
         }
-
-        // 6. 业务校验: 必须绑定至少1个技术
-        if (tech_ids.empty()) {
-            err = "业务约束失败: 车型必须绑定至少1个技术";
+        if (!hasTech(tech_id)) {
+            err = "外键约束失败: tech_id " + to_string(tech_id) + " 在技术表中不存在";
             return false;
         }
+        uint64_t pair_key = pairKey(model_id, tech_id);
+        if (model_tech_pairs.count(pair_key) || (base_ && base_->hasModelTech(model_id, tech_id))) return true; // 已存在
 
-        // 7. 外键约束: 所有tech_id必须在技术表存在
-        for (int tid : tech_ids) {
-            if (techs_table.find(tid) == techs_table.end()) {
-                err = "外键约束失败: tech_id " + to_string(tid) + " 在技术表中不存在";
-                return false;
+        model_tech_table.push_back({ next_mt_id++, model_id, tech_id });
+        model_tech_pairs.insert(pair_key);
+        return true;
+    }
+
+    // 回放一条 WAL 记录; 违反约束的记录跳过 (与首次写入时的判定一致)
+    void applyWalRecord(string_view payload) {
+        if (payload.empty()) return;
+        if (payload[0] == WAL_BATCH) {
+            payload.remove_prefix(1);
+            while (!payload.empty()) {
+                size_t nl = payload.find('\n');
+                applyWalRecord(payload.substr(0, nl));
+                payload = nl == string_view::npos ? string_view() : payload.substr(nl + 1);
             }
+            return;
+        }
+        JsonReader r(payload.substr(1));
+        string err;
+        switch (payload[0]) {
+            case WAL_SERIES:     { Series s{};    if (bindRow(r, s, err)) insertSeries(s, err); break; }
+            case WAL_TECH:       { Tech t{};      if (bindRow(r, t, err)) insertTech(t, err); break; }
+            case WAL_MODEL:      { Model m{};     if (bindRow(r, m, err)) insertModel(m, err); break; }
+            case WAL_MODEL_TECH: { ModelTech mt{}; if (bindRow(r, mt, err)) insertModelTech(mt.model_id, mt.tech_id, err); break; }
+            default: break;
+        }
+    }
+
+    void getCounts(int& series_count, int& model_count, int& tech_count) const {
+        series_count = series_table.size();
+        model_count = models_table.size();
+        tech_count = techs_table.size();
+        if (base_) {
+            series_count += base_->series().size;
+            model_count += base_->models().size;
+            tech_count += base_->techs().size;
         }
+    }
 
-        // 入库
-        models_table[id] = { id, name, series_id, price, range_km, energy_type, body_type, seats, launch_year };
-        model_names.insert(name);
+    // 文本加载时每个块的解析结果, 行号随行保存; 按块下标顺序遍历即为文件顺序
+    struct LoadChunk {
+        vector<pair<size_t, Series>> series;
+        vector<pair<size_t, Tech>> techs;
+        vector<pair<size_t, Model>> models;
+        vector<pair<int, int>> model_techs;
 
-        // 插入关联表
-        for (int tid : tech_ids) {
-            string pair_key = to_string(id) + "_" + to_string(tid);
-            if (!model_tech_pairs.count(pair_key)) {
-                model_tech_table.push_back({ next_mt_id++, id, tid });
-                model_tech_pairs.insert(pair_key);
+        // parseDataRecord 的记录事件
+        void onSeries(const SeriesRecord& r, size_t line) {
+            series.emplace_back(line, Series{ r.id, string(r.name), string(r.intro) });
+        }
+        void onTech(const TechRecord& r, size_t line) {
+            techs.emplace_back(line, Tech{ r.id, string(r.name), string(r.intro) });
+        }
+        void onModel(const ModelRecord& r, size_t line) {
+            Model m;
+            m.model_id = r.id;
+            m.model_name = string(r.name);
+            m.series_id = r.series_id;
+            m.price = r.price;
+            m.range_km = r.range_km;
+            m.energy_type = string(r.energy_type);
+            m.body_type = string(r.body_type);
+            m.seats = r.seats;
+            m.launch_year = string(r.launch_year);
+            models.emplace_back(line, std::move(m));
+        }
+        void onModelTech(const ModelTechRecord& r, size_t) { model_techs.emplace_back(r.model_id, r.tech_id); }
+    };
+
+    // 按文件顺序插入一张表: 主键或名称与之前已接受的行重复时跳过该行并记录错误。
+    // 每张表只由一个任务按固定顺序构建, 因此判定结果与线程调度无关
+    template <typename Row, typename Key, typename Name>
+    static void insertUnique(vector<LoadChunk>& chunks, vector<pair<size_t, Row>> LoadChunk::*rows,
+                             unordered_map<int, Row>& table, unordered_set<string>& names,
+                             const char* key_field, const char* name_field, Key key_of, Name name_of,
+                             vector<TextLoadError>& errors) {
+        size_t total = 0;
+        for (const auto& c : chunks) total += (c.*rows).size();
+        table.reserve(total);
+        names.reserve(total);
+        for (auto& c : chunks) {
+            for (auto& r : c.*rows) {
+                int key = key_of(r.second);
+                if (table.count(key)) {
+                    errors.push_back({ r.first, string("主键重复: ") + key_field + " " + to_string(key) + " 已存在, 保留先出现的行" });
+                    continue;
+                }
+                if (!names.insert(name_of(r.second)).second) {
+                    errors.push_back({ r.first, string("唯一约束失败: ") + name_field + " '" + name_of(r.second) + "' 已存在" });
+                    continue;
+                }
+                table.emplace(key, std::move(r.second));
             }
+            (c.*rows).clear();
+            (c.*rows).shrink_to_fit();
         }
+    }
+
+
+    // 文本加载: 按段切成行对齐的块并行解析, 再由各表独立的任务并行建表与索引。
+    // 格式错误与重复行记录在 loader 中 (调用方决定输出或拒绝); 仅文件无法打开时返回 false
+    bool loadText(const string& path, unsigned threads, TextDataLoader& loader, string& err) {
+        if (!loader.open(path, err)) return false;
 
+        vector<LoadChunk> chunks(loader.splitChunks());
+        // 两种布局 (独立的 [MODEL_TECH] 段 / 车型行内联技术列表) 都可以加载
+        loader.parseChunks(threads, [&](size_t ci, const TextRecord& r, string& err) {
+            return parseDataRecord(r, chunks[ci], err);
+        });
+
+        vector<TextLoadError> dup_errors[3];
+        parallelFor(4, threads, [&](size_t task) {
+            switch (task) {
+            case 0:
+                insertUnique(chunks, &LoadChunk::series, series_table, series_names, "series_id", "series_name",
+                             [](const Series& s) { return s.series_id; },
+                             [](const Series& s) -> const string& { return s.series_name; }, dup_errors[0]);
+                break;
+            case 1:
+                insertUnique(chunks, &LoadChunk::techs, techs_table, tech_names, "tech_id", "tech_name",
+                             [](const Tech& t) { return t.tech_id; },
+                             [](const Tech& t) -> const string& { return t.tech_name; }, dup_errors[1]);
+                break;
+            case 2:
+                insertUnique(chunks, &LoadChunk::models, models_table, model_names, "model_id", "model_name",
+                             [](const Model& m) { return m.model_id; },
+                             [](const Model& m) -> const string& { return m.model_name; }, dup_errors[2]);
+                break;
+            case 3: {
+                // 关联表: 重复关联直接合并, 与原行为一致
+                size_t total = 0;
+                for (const auto& c : chunks) total += c.model_techs.size();
+                model_tech_pairs.reserve(total);
+                model_tech_table.reserve(total);
+                for (auto& c : chunks) {
+                    for (const auto& mt : c.model_techs) {
+                        if (model_tech_pairs.insert(pairKey(mt.first, mt.second)).second) {
+                            model_tech_table.push_back({ next_mt_id++, mt.first, mt.second });
+                        }
+                    }
+                    c.model_techs.clear();
+                    c.model_techs.shrink_to_fit();
+                }
+                break;
+            }
+            }
+        });
+        for (const auto& errs : dup_errors) {
+            for (const auto& e : errs) loader.addError(e.line, e.message);
+        }
         return true;
     }
 
-    // 新增车型（无技术绑定版本，用于API添加后再单独绑定技术）
-    bool addModel(int id, const string& name, int series_id, double price, 
-                  double range_km, const string& energy_type, 
-                  const string& body_type, int seats, const string& launch_year,
-                  string& err) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        
-        if (name.empty()) { err = "NOT NULL 约束失败: model_name 不能为空"; return false; }
-        if (energy_type.empty()) { err = "NOT NULL 约束失败: energy_type 不能为空"; return false; }
-        if (models_table.count(id)) { err = "主键约束失败: model_id 已存在"; return false; }
-        if (model_names.count(name)) { err = "唯一约束失败: model_name 已存在"; return false; }
-        if (series_table.find(series_id) == series_table.end()) {
-            err = "外键约束失败: series_id " + to_string(series_id) + " 在系列表中不存在";
+    // 重新加载前的整体校验: 文本加载不检查外键, 这里补上车型 -> 系列的外键
+    // (关联表中引用不存在车型的行沿用原行为, 查询时自然被忽略)
+    bool validate(string& err) const {
+        if (series_table.empty() && techs_table.empty() && models_table.empty()) {
+            err = "数据文件中没有任何数据";
             return false;
         }
-        if (price <= 0) { err = "CHECK 约束失败: price 必须大于 0"; return false; }
-
-        models_table[id] = { id, name, series_id, price, range_km, energy_type, body_type, seats, launch_year };
-        model_names.insert(name);
+        for (const auto& p : models_table) {
+            if (!hasSeries(p.second.series_id)) {
+                err = "外键约束失败: 车型 " + to_string(p.first) + " 的 series_id " +
+                      to_string(p.second.series_id) + " 在系列表中不存在";
+                return false;
+            }
+        }
         return true;
     }
+};
 
-    // 添加车型-技术关联
-    bool addModelTech(int model_id, int tech_id) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (models_table.find(model_id) == models_table.end()) return false;
-        if (techs_table.find(tech_id) == techs_table.end()) return false;
-        
-        string pair_key = to_string(model_id) + "_" + to_string(tech_id);
-        if (model_tech_pairs.count(pair_key)) return true; // 已存在
-        
-        model_tech_table.push_back({ next_mt_id++, model_id, tech_id });
-        model_tech_pairs.insert(pair_key);
-        return true;
+// =============================
+// 多版本存储: 每次提交 (一次写请求) 产生一个新版本。
+// 数据代 = 不可变的基础数据集 + 之后各次提交追加的版本化增量行; 读者按 (数据代, 版本) 无锁读取,
+// 版本大于所读版本的增量行不可见。超出保留窗口的增量由后台并入新的基础数据集
+// =============================
+
+template <typename Row>
+struct Versioned {
+    uint64_t version;
+    Row row;
+};
+
+// 增量关联; prev 为同一车型上一条增量关联的下标
+struct VersionedLink {
+    uint64_t version;
+    int model_id;
+    int tech_id;
+    uint32_t prev;
+};
+
+const uint32_t NO_LINK = UINT32_MAX;
+
+struct CommitMark {
+    uint64_t version;
+    int64_t time_ms;    // 提交时间 (Unix 毫秒)
+};
+
+inline int64_t unixMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct Generation {
+    shared_ptr<const CarDataSet> base;
+    uint64_t floor = 0;             // 可查询的最早版本, base 即该版本时的全部数据
+    int64_t floor_time_ms = 0;
+    // 被重新加载取代时由写者设置: 本数据代只回答 [floor, end_version) 内的版本与 end_time_ms 之前的时间。
+    // 之后的数据代被并入新基础数据集后, 两者之间的版本不再可查 (版本缺口), 不能落回本数据代
+    std::atomic<uint64_t> end_version{ UINT64_MAX };
+    std::atomic<int64_t> end_time_ms{ 0 };          // 0 表示仍是当前数据代
+
+    // floor 之后的提交, 按版本递增追加; 索引值为数组下标
+    AppendVector<Versioned<Series>> series;
+    AppendVector<Versioned<Tech>> techs;
+    AppendVector<Versioned<Model>> models;
+    AppendVector<VersionedLink> links;
+    AppendVector<CommitMark> commits;
+    AtomicIntMap series_index, tech_index, model_index;
+    AtomicIntMap link_heads;        // model_id -> 该车型最新一条增量关联
+
+    // 唯一性校验只由写者使用 (持有 mtx_)
+    unordered_set<string> series_names, tech_names, model_names;
+    unordered_set<uint64_t> link_pairs;
+
+    std::atomic<Generation*> prev{ nullptr };   // 重新加载之前的数据代, 保留窗口内仍可按版本查询
+
+    // 写者: 追加增量行并更新索引 (先发布行, 再发布索引)
+    void appendSeries(uint64_t v, const Series& s) {
+        series.push_back({ v, s });
+        series_index.put(s.series_id, (uint32_t)series.size() - 1);
+        series_names.insert(s.series_name);
     }
+    void appendTech(uint64_t v, const Tech& t) {
+        techs.push_back({ v, t });
+        tech_index.put(t.tech_id, (uint32_t)techs.size() - 1);
+        tech_names.insert(t.tech_name);
+    }
+    void appendModel(uint64_t v, const Model& m) {
+        models.push_back({ v, m });
+        model_index.put(m.model_id, (uint32_t)models.size() - 1);
+        model_names.insert(m.model_name);
+    }
+    void appendLink(uint64_t v, int model_id, int tech_id) {
+        uint32_t head = NO_LINK;
+        link_heads.find(model_id, head);
+        links.push_back({ v, model_id, tech_id, head });
+        link_heads.put(model_id, (uint32_t)links.size() - 1);
+        link_pairs.insert(CarDataSet::pairKey(model_id, tech_id));
+    }
+};
+
+// 版本 <= v 的增量行数 (增量按版本递增追加)
+template <typename T>
+size_t visibleCount(const AppendVector<T>& rows, uint64_t v) {
+    return rows.upperBound(rows.size(), v, [](const T& r) { return r.version; });
+}
+
+// 运行指标 (GET /metrics); 写锁等待时间也记在这里, 所以定义在数据管理器之前
+MetricsRegistry g_metrics;
+Tracer g_tracer;            // 请求分阶段追踪 (--trace-sample, GET /debug/trace)
+
+// 当前请求中只读视图遍历过的车型行数, 写入访问日志; 每个请求开始时清零
+thread_local uint64_t t_rows_scanned = 0;
+
+class CarDataManager {
+    friend struct MvccStressAccess;     // mvcc_stress.cpp: 单独触发 foldLocked, 构造重新加载之后的版本缺口
+public:
+    using ModelView = CarDataSet::ModelView;
+    using ModelFilter = CarDataSet::ModelFilter;
+
+    // 获取所有车型 (带关联信息)
+    struct ModelDetail {
+        Model model;
+        string series_name;
+        vector<string> tech_names;
+    };
+
+    // -------------------------
+    // 只读快照: 供压缩、重新加载写出数据文件与二进制快照时使用的完整拷贝
+    // -------------------------
+    struct DataSnapshot {
+        uint64_t version = 0;
+        vector<Series> series;      // 均按主键排序
+        vector<Tech> techs;
+        vector<Model> models;
+        vector<ModelTech> model_techs;
+    };
+
+    // 批量写入 (POST /api/bulk) 的一批数据; model_tech_ids 与 models 一一对应, 是车型自带的技术列表
+    struct BulkBatch {
+        vector<Series> series;
+        vector<Tech> techs;
+        vector<Model> models;
+        vector<vector<int>> model_tech_ids;
+        vector<ModelTech> model_techs;
+    };
+
+    struct BulkError {
+        const char* entity;     // series / techs / models / model_techs
+        size_t index;           // 在对应数组中的下标
+        string message;
+    };
 
     // -------------------------
-    // 查询接口
+    // 查询接口: 固定 (数据代, 版本) 的只读视图, 整个生命周期内不加锁。
+    // 持有视图期间数据代不会被回收, 视图应在单个请求内使用
     // -------------------------
+    class ReadView {
+    public:
+        ReadView() = default;
+        ReadView(EpochDomain::Guard guard, const Generation* gen, uint64_t version)
+            : guard_(std::move(guard)), gen_(gen), version_(version) {}
+
+        uint64_t version() const { return version_; }
+        bool valid() const { return gen_ != nullptr; }
+
+        bool findSeriesName(int id, string_view& out) const {
+            uint32_t i;
+            if (gen_->series_index.find(id, i) && gen_->series[i].version <= version_) {
+                out = gen_->series[i].row.series_name;
+                return true;
+            }
+            return gen_->base->findSeriesName(id, out);
+        }
 
-    // 获取所有系列
-    vector<Series> getAllSeries() {
-        std::lock_guard<std::mutex> lk(mtx_);
-        vector<Series> result;
-        for (const auto& p : series_table) {
-            result.push_back(p.second);
+        bool findTechName(int id, string_view& out) const {
+            uint32_t i;
+            if (gen_->tech_index.find(id, i) && gen_->techs[i].version <= version_) {
+                out = gen_->techs[i].row.tech_name;
+                return true;
+            }
+            return gen_->base->findTechName(id, out);
         }
-        return result;
+
+        // 遍历的行数计入 t_rows_scanned (访问日志)
+        template <typename F>
+        void forEachModel(F f) const {
+            size_t scanned = gen_->base->forEachModel(f);
+            size_t n = visibleCount(gen_->models, version_);
+            for (size_t i = 0; i < n; i++) f(CarDataSet::viewOf(gen_->models[i].row));
+            t_rows_scanned += scanned + n;
+        }
+
+        template <typename F>
+        void forEachModel(const ModelFilter& filter, F f) const {
+            size_t scanned = gen_->base->forEachModel(filter, f);
+            size_t n = visibleCount(gen_->models, version_);
+            for (size_t i = 0; i < n; i++) {
+                ModelView m = CarDataSet::viewOf(gen_->models[i].row);
+                if (filter.matches(m)) f(m);
+            }
+            t_rows_scanned += scanned + n;
+        }
+
+        // 车型绑定的技术名称: 基础数据中的关联 + 增量关联 (按绑定顺序)
+        template <typename F>
+        void forEachTechName(int model_id, F f) const {
+            gen_->base->forEachTechName(model_id, f);
+            uint32_t i;
+            if (!gen_->link_heads.find(model_id, i)) return;
+            vector<uint32_t> chain;
+            for (; i != NO_LINK; i = gen_->links[i].prev) {
+                if (gen_->links[i].version <= version_) chain.push_back(i);
+            }
+            string_view name;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                if (findTechName(gen_->links[*it].tech_id, name)) f(name);
+            }
+        }
+
+        // 获取所有系列
+        vector<Series> getAllSeries() const {
+            TraceSpan span(g_tracer, "getAllSeries");
+            const CarDataSet& d = *gen_->base;
+            vector<Series> result;
+            if (d.base_) {
+                for (const SnapSeries& r : d.base_->series()) result.push_back({ r.id, string(d.base_->str(r.name)), string(d.base_->str(r.intro)) });
+            }
+            for (const auto& p : d.series_table) {
+                result.push_back(p.second);
+            }
+            size_t n = visibleCount(gen_->series, version_);
+            for (size_t i = 0; i < n; i++) result.push_back(gen_->series[i].row);
+            return result;
+        }
+
+        // 获取所有技术
+        vector<Tech> getAllTechs() const {
+            TraceSpan span(g_tracer, "getAllTechs");
+            const CarDataSet& d = *gen_->base;
+            vector<Tech> result;
+            if (d.base_) {
+                for (const SnapTech& r : d.base_->techs()) result.push_back({ r.id, string(d.base_->str(r.name)), string(d.base_->str(r.intro)) });
+            }
+            for (const auto& p : d.techs_table) {
+                result.push_back(p.second);
+            }
+            size_t n = visibleCount(gen_->techs, version_);
+            for (size_t i = 0; i < n; i++) result.push_back(gen_->techs[i].row);
+            return result;
+        }
+
+        // 按字段掩码填充关联信息: 未请求的系列名/技术不做查找与关联
+        void fillDetail(ModelDetail& detail, const ModelView& m, unsigned fields) const {
+            detail.model = m.toModel();
+            if (fields & MF_SERIES_NAME) {
+                string_view name;
+                if (findSeriesName(m.series_id, name)) detail.series_name = string(name);
+            }
+            if (fields & MF_TECHS) {
+                forEachTechName(m.model_id, [&](string_view name) { detail.tech_names.emplace_back(name); });
+            }
+        }
+
+        vector<ModelDetail> getAllModels(const ModelFilter& filter = ModelFilter(), unsigned fields = MF_ALL) const {
+            TraceSpan span(g_tracer, "getAllModels");
+            vector<ModelDetail> result;
+
+            forEachModel(filter, [&](const ModelView& m) {
+                result.emplace_back();
+                fillDetail(result.back(), m, fields);
+            });
+
+            // 按价格排序
+            TraceSpan sort_span(g_tracer, "getAllModels: sort");
+            sort(result.begin(), result.end(), [](const ModelDetail& a, const ModelDetail& b) {
+                return a.model.price < b.model.price;
+            });
+
+            return result;
+        }
+
+        // 获取单个车型详情
+        ModelDetail getModelDetail(int model_id, unsigned fields = MF_ALL) const {
+            const CarDataSet& d = *gen_->base;
+            ModelDetail detail{};
+            uint32_t i;
+
+            auto it = d.models_table.find(model_id);
+            if (it != d.models_table.end()) {
+                fillDetail(detail, d.viewOf(it->second), fields);
+            } else if (const SnapModel* r = d.base_ ? d.base_->findModel(model_id) : nullptr) {
+                fillDetail(detail, d.viewOf(*r), fields);
+            } else if (gen_->model_index.find(model_id, i) && gen_->models[i].version <= version_) {
+                fillDetail(detail, CarDataSet::viewOf(gen_->models[i].row), fields);
+            }
+            return detail;
+        }
+
+        // 搜索车型 (匹配仍覆盖技术名, fields 只影响结果中的关联字段)
+        vector<ModelDetail> searchModels(const string& keyword, unsigned fields = MF_ALL) const {
+            TraceSpan span(g_tracer, "searchModels");
+            vector<ModelDetail> result;
+
+            forEachModel([&](const ModelView& m) {
+                // 名称匹配
+                bool match = m.model_name.find(keyword) != string_view::npos;
+
+                // 系列名匹配
+                string_view series_name;
+                if (!match && findSeriesName(m.series_id, series_name)) {
+                    match = series_name.find(keyword) != string_view::npos;
+                }
+
+                // 技术名匹配
+                if (!match) {
+                    forEachTechName(m.model_id, [&](string_view name) {
+                        if (!match && name.find(keyword) != string_view::npos) match = true;
+                    });
+                }
+
+                if (match) {
+                    result.emplace_back();
+                    fillDetail(result.back(), m, fields);
+                }
+            });
+            return result;
+        }
+
+        // 获取统计信息
+        void getStats(int& series_count, int& model_count, int& tech_count) const {
+            gen_->base->getCounts(series_count, model_count, tech_count);
+            series_count += (int)visibleCount(gen_->series, version_);
+            model_count += (int)visibleCount(gen_->models, version_);
+            tech_count += (int)visibleCount(gen_->techs, version_);
+        }
+
+        shared_ptr<DataSnapshot> buildSnapshot() const {
+            TraceSpan span(g_tracer, "buildSnapshot");
+            auto snap = make_shared<DataSnapshot>();
+            snap->version = version_;
+            appendBase(*gen_->base, *snap);
+            size_t n = visibleCount(gen_->series, version_);
+            for (size_t i = 0; i < n; i++) snap->series.push_back(gen_->series[i].row);
+            n = visibleCount(gen_->techs, version_);
+            for (size_t i = 0; i < n; i++) snap->techs.push_back(gen_->techs[i].row);
+            n = visibleCount(gen_->models, version_);
+            for (size_t i = 0; i < n; i++) snap->models.push_back(gen_->models[i].row);
+            n = visibleCount(gen_->links, version_);
+            int mt_id = gen_->base->next_mt_id;
+            for (size_t i = 0; i < n; i++) snap->model_techs.push_back({ mt_id++, gen_->links[i].model_id, gen_->links[i].tech_id });
+            sortSnapshot(*snap);
+            return snap;
+        }
+
+    private:
+        // 导出游标按实体取三段数据: 映射快照中的定长记录、基础表、增量 (以 (const Row*)nullptr 选择实体)
+        static auto mappedRows(const MappedSnapshot& s, const Series*) { return s.series(); }
+        static auto mappedRows(const MappedSnapshot& s, const Tech*) { return s.techs(); }
+        static auto mappedRows(const MappedSnapshot& s, const Model*) { return s.models(); }
+        static auto mappedRows(const MappedSnapshot& s, const ModelTech*) { return s.modelTechs(); }
+        static const unordered_map<int, Series>& baseTable(const CarDataSet& d, const Series*) { return d.series_table; }
+        static const unordered_map<int, Tech>& baseTable(const CarDataSet& d, const Tech*) { return d.techs_table; }
+        static const unordered_map<int, Model>& baseTable(const CarDataSet& d, const Model*) { return d.models_table; }
+        static const vector<ModelTech>& baseTable(const CarDataSet& d, const ModelTech*) { return d.model_tech_table; }
+        static const AppendVector<Versioned<Series>>& deltaRows(const Generation& g, const Series*) { return g.series; }
+        static const AppendVector<Versioned<Tech>>& deltaRows(const Generation& g, const Tech*) { return g.techs; }
+        static const AppendVector<Versioned<Model>>& deltaRows(const Generation& g, const Model*) { return g.models; }
+        static const AppendVector<VersionedLink>& deltaRows(const Generation& g, const ModelTech*) { return g.links; }
+
+        static void readMapped(const CarDataSet& d, const SnapSeries& r, Series& out) {
+            out.series_id = r.id;
+            out.series_name.assign(d.base_->str(r.name));
+            out.intro.assign(d.base_->str(r.intro));
+        }
+        static void readMapped(const CarDataSet& d, const SnapTech& r, Tech& out) {
+            out.tech_id = r.id;
+            out.tech_name.assign(d.base_->str(r.name));
+            out.intro.assign(d.base_->str(r.intro));
+        }
+        static void readMapped(const CarDataSet& d, const SnapModel& r, Model& out) { out = d.viewOf(r).toModel(); }
+        static void readMapped(const CarDataSet&, const SnapModelTech& r, ModelTech& out) { out = { 0, r.model_id, r.tech_id }; }
+
+        template <typename Row>
+        static const Row* tableRow(const pair<const int, Row>& p, Row&) { return &p.second; }
+        static const ModelTech* tableRow(const ModelTech& mt, ModelTech&) { return &mt; }
+        template <typename Row>
+        static const Row* deltaRow(const Versioned<Row>& r, Row&) { return &r.row; }
+        static const ModelTech* deltaRow(const VersionedLink& l, ModelTech& scratch) {
+            scratch = { 0, l.model_id, l.tech_id };
+            return &scratch;
+        }
+
+    public:
+        // 导出游标 (定义在 ReadView 之后)
+        template <typename Row>
+        class Cursor;
+
+    private:
+        EpochDomain::Guard guard_;
+        const Generation* gen_ = nullptr;
+        uint64_t version_ = 0;
+    };
+
+    // 导出游标: 逐行读取一个实体, 依次经过 映射快照、基础表、该版本可见的增量三段 (存储顺序, 不排序)。
+    // 只记录所在段与位置, 不复制整表; 游标持有视图, 导出期间数据代不会被回收
+    template <typename Row>
+    class ReadView::Cursor {
+    public:
+        explicit Cursor(ReadView view) : view_(std::move(view)) {
+            const Generation& g = *view_.gen_;
+            table_it_ = baseTable(*g.base, (const Row*)nullptr).begin();
+            delta_end_ = visibleCount(deltaRows(g, (const Row*)nullptr), view_.version_);
+        }
+
+        // 下一行; 指针在下次调用前有效, 全部读完时返回 nullptr
+        const Row* next() {
+            const Generation& g = *view_.gen_;
+            const CarDataSet& d = *g.base;
+            if (segment_ == 0) {
+                if (d.base_) {
+                    auto rows = mappedRows(*d.base_, (const Row*)nullptr);
+                    if (pos_ < rows.size) {
+                        readMapped(d, rows[pos_++], scratch_);
+                        return &scratch_;
+                    }
+                }
+                segment_ = 1;
+            }
+            if (segment_ == 1) {
+                if (table_it_ != baseTable(d, (const Row*)nullptr).end()) return tableRow(*table_it_++, scratch_);
+                segment_ = 2;
+                pos_ = 0;
+            }
+            if (pos_ < delta_end_) return deltaRow(deltaRows(g, (const Row*)nullptr)[pos_++], scratch_);
+            return nullptr;
+        }
+
+    private:
+        ReadView view_;
+        int segment_ = 0;       // 0 映射快照, 1 基础表, 2 增量
+        size_t pos_ = 0;
+        typename std::remove_reference<decltype(baseTable(std::declval<const CarDataSet&>(),
+                                                          (const Row*)nullptr))>::type::const_iterator table_it_;
+        size_t delta_end_ = 0;  // 该版本可见的增量行数, 打开游标时确定
+        Row scratch_{};
+    };
+
+    static void appendBase(const CarDataSet& d, DataSnapshot& snap) {
+        if (const MappedSnapshot* base = d.base_.get()) {
+            for (const SnapSeries& r : base->series()) snap.series.push_back({ r.id, string(base->str(r.name)), string(base->str(r.intro)) });
+            for (const SnapTech& r : base->techs()) snap.techs.push_back({ r.id, string(base->str(r.name)), string(base->str(r.intro)) });
+            for (const SnapModel& r : base->models()) snap.models.push_back(d.viewOf(r).toModel());
+            int mt_id = 1;
+            for (const SnapModelTech& r : base->modelTechs()) snap.model_techs.push_back({ mt_id++, r.model_id, r.tech_id });
+        }
+        for (const auto& p : d.series_table) snap.series.push_back(p.second);
+        for (const auto& p : d.techs_table) snap.techs.push_back(p.second);
+        for (const auto& p : d.models_table) snap.models.push_back(p.second);
+        snap.model_techs.insert(snap.model_techs.end(), d.model_tech_table.begin(), d.model_tech_table.end());
+    }
+
+    static void sortSnapshot(DataSnapshot& snap) {
+        sort(snap.series.begin(), snap.series.end(),
+             [](const Series& a, const Series& b) { return a.series_id < b.series_id; });
+        sort(snap.techs.begin(), snap.techs.end(),
+             [](const Tech& a, const Tech& b) { return a.tech_id < b.tech_id; });
+        sort(snap.models.begin(), snap.models.end(),
+             [](const Model& a, const Model& b) { return a.model_id < b.model_id; });
+    }
+
+    static shared_ptr<DataSnapshot> buildSnapshot(const CarDataSet& d) {
+        auto snap = make_shared<DataSnapshot>();
+        appendBase(d, *snap);
+        sortSnapshot(*snap);
+        return snap;
+    }
+
+    // 最新已提交版本的视图
+    ReadView latestView() {
+        EpochDomain::Guard guard = epoch_.pin();
+        uint64_t v = visible_.load(std::memory_order_acquire);
+        const Generation* g = current_.load(std::memory_order_seq_cst);
+        // 重新加载刚发布新数据代而 visible_ 尚未更新时, 直接读新数据代的起始版本
+        return ReadView(std::move(guard), g, std::max(v, g->floor));
     }
 
-    // 获取所有技术
-    vector<Tech> getAllTechs() {
-        std::lock_guard<std::mutex> lk(mtx_);
-        vector<Tech> result;
-        for (const auto& p : techs_table) {
-            result.push_back(p.second);
+    // ?as_of_version=N: 在保留窗口内的任意版本
+    bool viewAtVersion(uint64_t version, ReadView& view, string& err) {
+        EpochDomain::Guard guard = epoch_.pin();
+        uint64_t v = visible_.load(std::memory_order_acquire);
+        if (version > v) {
+            err = "版本 " + to_string(version) + " 不存在, 当前版本为 " + to_string(v);
+            return false;
         }
-        return result;
+        const Generation* g = current_.load(std::memory_order_seq_cst);
+        while (g && version < g->floor) g = g->prev.load(std::memory_order_seq_cst);
+        if (!g || version >= g->end_version.load(std::memory_order_relaxed)) {
+            err = "版本 " + to_string(version) + " 已超出保留窗口";
+            return false;
+        }
+        view = ReadView(std::move(guard), g, version);
+        return true;
+    }
+
+    // ?as_of_time=T: 时间 T (Unix 毫秒) 时最后一次提交之后的数据
+    bool viewAtTime(int64_t time_ms, ReadView& view, string& err) {
+        EpochDomain::Guard guard = epoch_.pin();
+        uint64_t v = visible_.load(std::memory_order_acquire);
+        const Generation* g = current_.load(std::memory_order_seq_cst);
+        while (g && time_ms < g->floor_time_ms) g = g->prev.load(std::memory_order_seq_cst);
+        int64_t end_ms = g ? g->end_time_ms.load(std::memory_order_relaxed) : 0;
+        if (!g || (end_ms != 0 && time_ms >= end_ms)) {
+            err = "该时间点已超出保留窗口";
+            return false;
+        }
+        size_t n = g->commits.upperBound(g->commits.size(), (uint64_t)time_ms,
+                                         [](const CommitMark& c) { return (uint64_t)c.time_ms; });
+        uint64_t version = n > 0 ? g->commits[n - 1].version : g->floor;
+        view = ReadView(std::move(guard), g, std::min(version, std::max(v, g->floor)));
+        return true;
+    }
+
+    // 加载错误按行号排序 (重复行的错误在解析之后才加入)
+    static vector<TextLoadError> sortedErrors(const TextDataLoader& loader) {
+        vector<TextLoadError> errors = loader.errors();
+        stable_sort(errors.begin(), errors.end(),
+                    [](const TextLoadError& a, const TextLoadError& b) { return a.line < b.line; });
+        return errors;
     }
 
-    // 获取所有车型 (带关联信息)
-    struct ModelDetail {
-        Model model;
-        string series_name;
-        vector<string> tech_names;
-    };
+    // -------------------------
+    // 约束校验与数据操作
+    // insert* 系列函数要求调用方已持有 mtx_, 供单条写入与批量导入共用;
+    // 写入的行属于下一个版本, publish() 之后才对读者可见
+    // -------------------------
+    bool hasSeries(int id) const { return gen().base->hasSeries(id) || gen().series_index.contains(id); }
+    bool hasTech(int id) const { return gen().base->hasTech(id) || gen().tech_index.contains(id); }
+    bool hasModel(int id) const { return gen().base->hasModel(id) || gen().model_index.contains(id); }
+
+    // 批量写入中已通过校验、尚未写入的行; 校验后续行时与已有数据一起参与主键/唯一/外键判断
+    struct PendingRows {
+        unordered_set<int> series, techs, models;
+        unordered_set<string> series_names, tech_names, model_names;
+    };
+
+    // 系列的非空/主键/唯一约束
+    bool checkSeries(const Series& s, string& err, const PendingRows* batch = nullptr) const {
+        if (s.series_name.empty()) { err = "NOT NULL 约束失败: series_name 不能为空"; return false; }
+        if (hasSeries(s.series_id) || (batch && batch->series.count(s.series_id))) {
+            err = "主键约束失败: series_id 已存在";
+            return false;
+        }
+        if (gen().base->hasSeriesName(s.series_name) || gen().series_names.count(s.series_name) ||
+            (batch && batch->series_names.count(s.series_name))) {
+            err = "唯一约束失败: series_name 已存在";
+            return false;
+        }
+        return true;
+    }
+
+    bool insertSeries(const Series& s, string& err) {
+        if (!checkSeries(s, err)) return false;
+        gen().appendSeries(version_ + 1, s);
+        pending_ = true;
+        return true;
+    }
+
+    // 技术的非空/主键/唯一约束
+    bool checkTech(const Tech& t, string& err, const PendingRows* batch = nullptr) const {
+        if (t.tech_name.empty()) { err = "NOT NULL 约束失败: tech_name 不能为空"; return false; }
+        if (hasTech(t.tech_id) || (batch && batch->techs.count(t.tech_id))) {
+            err = "主键约束失败: tech_id 已存在";
+            return false;
+        }
+        if (gen().base->hasTechName(t.tech_name) || gen().tech_names.count(t.tech_name) ||
+            (batch && batch->tech_names.count(t.tech_name))) {
+            err = "唯一约束失败: tech_name 已存在";
+            return false;
+        }
+        return true;
+    }
+
+    bool insertTech(const Tech& t, string& err) {
+        if (!checkTech(t, err)) return false;
+        gen().appendTech(version_ + 1, t);
+        pending_ = true;
+        return true;
+    }
+
+    // 车型的非空/主键/唯一/外键/CHECK 约束 (不含技术绑定)
+    bool checkModel(const Model& m, string& err, const PendingRows* batch = nullptr) const {
+        if (m.model_name.empty()) { err = "NOT NULL 约束失败: model_name 不能为空"; return false; }
+        if (m.energy_type.empty()) { err = "NOT NULL 约束失败: energy_type 不能为空"; return false; }
+        if (hasModel(m.model_id) || (batch && batch->models.count(m.model_id))) {
+            err = "主键约束失败: model_id 已存在";
+            return false;
+        }
+        if (gen().base->hasModelName(m.model_name) || gen().model_names.count(m.model_name) ||
+            (batch && batch->model_names.count(m.model_name))) {
+            err = "唯一约束失败: model_name 已存在";
+            return false;
+        }
+        if (!hasSeries(m.series_id) && !(batch && batch->series.count(m.series_id))) {
+            err = "外键约束失败: series_id " + to_string(m.series_id) + " 在系列表中不存在";
+            return false;
+        }
+        // 写成取反的比较, NaN 不满足任何比较而被拒绝
+        if (!(m.price > 0)) { err = "CHECK 约束失败: price 必须大于 0"; return false; }
+        if (!(m.range_km >= 0)) { err = "CHECK 约束失败: range_km 不能为负"; return false; }
+        return true;
+    }
+
+    // 关联的外键约束 (重复关联视为成功)
+    bool checkModelTech(int model_id, int tech_id, string& err, const PendingRows* batch = nullptr) const {
+        if (!hasModel(model_id) && !(batch && batch->models.count(model_id))) {
+            err = "外键约束失败: model_id " + to_string(model_id) + " 在车型表中不存在";
+            return false;
+        }
+        if (!hasTech(tech_id) && !(batch && batch->techs.count(tech_id))) {
+            err = "外键约束失败: tech_id " + to_string(tech_id) + " 在技术表中不存在";
+            return false;
+        }
+        return true;
+    }
+
+    bool insertModel(const Model& m, string& err) {
+        if (!checkModel(m, err)) return false;
+        gen().appendModel(version_ + 1, m);
+        pending_ = true;
+        return true;
+    }
+
+    // 插入车型-技术关联 (外键约束; 重复关联视为成功, inserted 为 false)
+    bool insertModelTech(int model_id, int tech_id, string& err, bool* inserted = nullptr) {
+        if (inserted) *inserted = false;
+        if (!checkModelTech(model_id, tech_id, err)) return false;
+        const CarDataSet& base = *gen().base;
+        uint64_t pair_key = CarDataSet::pairKey(model_id, tech_id);
+        if (gen().link_pairs.count(pair_key) || base.model_tech_pairs.count(pair_key) ||
+            (base.base_ && base.base_->hasModelTech(model_id, tech_id))) {
+            return true; // 已存在
+        }
+        gen().appendLink(version_ + 1, model_id, tech_id);
+        pending_ = true;
+        if (inserted) *inserted = true;
+        return true;
+    }
+
+    // 提交: 本次写入的行整体对之后开始的读取可见 (调用方持有 mtx_)
+    void publish() {
+        if (!pending_) return;
+        pending_ = false;
+        version_++;
+        gen().commits.push_back({ version_, unixMillis() });
+        visible_.store(version_, std::memory_order_release);
+    }
+
+    // -------------------------
+    // WAL 持久化: 每次变更追加一条记录, 不再整体重写数据文件
+    // -------------------------
+
+    // 把一行变更写入 WAL 缓冲 (调用方持有 mtx_), 返回其 lsn; WAL 未打开时返回 0。
+    // 重新加载期间同时把记录留在内存中, 替换数据集前补到新数据集上
+    template <typename Row>
+    uint64_t logRow(const Row& row) {
+        if (!wal_.isOpen() && !reload_capture_) return 0;
+        string payload;
+        appendWalRow(payload, row);
+        return logPayload(payload);
+    }
+
+    template <typename Row>
+    static void appendWalRow(string& out, const Row& row) {
+        out += walTag(&row);
+        appendNdjsonRow(out, row);
+        out.pop_back();   // 去掉行尾换行
+    }
+
+    uint64_t logPayload(const string& payload) {
+        if (reload_capture_) reload_tail_.push_back(payload);
+        return wal_.isOpen() ? wal_.append(payload) : 0;
+    }
+
+    // 释放 mtx_ 后调用: 等待组提交线程把 lsn 之前的记录落盘。
+    // async 确认模式下立即返回, 由写线程在后台完成
+    bool awaitDurable(uint64_t lsn, string& err) {
+        TraceSpan span(g_tracer, "WAL commit wait");
+        if (lsn == 0 || !wal_ack_durable_ || wal_.waitDurable(lsn)) return true;
+        err = "WAL 写入失败: 数据已更新但未能持久化";
+        cerr << "Error: " << err << endl;
+        return false;
+    }
+
+    // 新增系列
+    bool addSeries(int id, const string& name, const string& intro, string& err) {
+        uint64_t lsn;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            Series s = { id, name, intro };
+            if (!insertSeries(s, err)) return false;
+            lsn = logRow(s);
+            publish();
+        }
+        return awaitDurable(lsn, err);
+    }
+
+    // 新增技术
+    bool addTech(int id, const string& name, const string& intro, string& err) {
+        uint64_t lsn;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            Tech t = { id, name, intro };
+            if (!insertTech(t, err)) return false;
+            lsn = logRow(t);
+            publish();
+        }
+        return awaitDurable(lsn, err);
+    }
+
+    // 新增车型 (完整约束校验)
+    bool addModel(int id, const string& name, int series_id, double price, 
+                  double range_km, const string& energy_type, 
+                  const string& body_type, int seats, const string& launch_year,
+                  const vector<int>& tech_ids, string& err) {
+        std::unique_lock<InstrumentedMutex> lk(mtx_);
+        Model m = { id, name, series_id, price, range_km, energy_type, body_type, seats, launch_year };
+        if (!checkModel(m, err)) return false;
+
+        // 业务校验: 必须绑定至少1个技术
+        if (tech_ids.empty()) {
+            err = "业务约束失败: 车型必须绑定至少1个技术";
+            return false;
+        }
+
+        // 外键约束: 所有tech_id必须在技术表存在
+        for (int tid : tech_ids) {
+            if (!hasTech(tid)) {
+                err = "外键约束失败: tech_id " + to_string(tid) + " 在技术表中不存在";
+                return false;
+            }
+        }
+
+        // 入库 + 插入关联表, 车型与其技术在同一版本中可见
+        insertModel(m, err);
+        uint64_t lsn = logRow(m);
+        for (int tid : tech_ids) {
+            insertModelTech(id, tid, err);
+            lsn = logRow(ModelTech{ 0, id, tid });
+        }
+        publish();
+        lk.unlock();
+        return awaitDurable(lsn, err);
+    }
+
+    // 批量导入: 一次加锁应用整批记录并作为一个版本提交, 违反约束的行跳过并记录 (行号, 错误)
+    template <typename Row, typename Insert>
+    size_t importBatch(const vector<pair<size_t, Row>>& rows, Insert insert,
+                       vector<pair<size_t, string>>& errors) {
+        TraceSpan span(g_tracer, "importBatch");
+        size_t applied = 0;
+        uint64_t lsn = 0;
+        string err;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            for (const auto& r : rows) {
+                if ((this->*insert)(r.second, err)) {
+                    lsn = logRow(r.second);
+                    applied++;
+                } else {
+                    errors.emplace_back(r.first, err);
+                }
+            }
+            publish();
+        }
+        // 整批只等待一次 WAL 提交
+        if (applied > 0 && !awaitDurable(lsn, err)) errors.emplace_back(0, err);
+        return applied;
+    }
+
+    bool insertModelTechRow(const ModelTech& mt, string& err) {
+        return insertModelTech(mt.model_id, mt.tech_id, err);
+    }
+
+    // 批量写入: 一次加锁, 按 系列 -> 技术 -> 车型 -> 关联 的顺序校验整批, 批内的行彼此可见。
+    // 通过校验的行作为一个版本发布, 并编码为一条 WAL 记录一次写入; atomic 时任一行失败则整批不写入。
+    // 返回写入的行数 (车型自带的技术计入车型); WAL 写入失败或整批过大时设置 err
+    size_t applyBulk(const BulkBatch& b, bool atomic, vector<BulkError>& errors, uint64_t& version, string& err) {
+        TraceSpan span(g_tracer, "applyBulk");
+        PendingRows batch;
+        vector<char> ok_series(b.series.size()), ok_techs(b.techs.size());
+        vector<char> ok_models(b.models.size()), ok_links(b.model_techs.size());
+        size_t rejected = 0;
+        string row_err;
+        auto reject = [&](const char* entity, size_t i) {
+            errors.push_back({ entity, i, row_err });
+            rejected++;
+        };
+
+        std::unique_lock<InstrumentedMutex> lk(mtx_);
+        for (size_t i = 0; i < b.series.size(); i++) {
+            const Series& s = b.series[i];
+            if (!checkSeries(s, row_err, &batch)) { reject("series", i); continue; }
+            batch.series.insert(s.series_id);
+            batch.series_names.insert(s.series_name);
+            ok_series[i] = 1;
+        }
+        for (size_t i = 0; i < b.techs.size(); i++) {
+            const Tech& t = b.techs[i];
+            if (!checkTech(t, row_err, &batch)) { reject("techs", i); continue; }
+            batch.techs.insert(t.tech_id);
+            batch.tech_names.insert(t.tech_name);
+            ok_techs[i] = 1;
+        }
+        for (size_t i = 0; i < b.models.size(); i++) {
+            const Model& m = b.models[i];
+            // 与 addModel 相同: 车型与自带的技术一起通过或一起拒绝
+            bool ok = checkModel(m, row_err, &batch);
+            for (int tid : b.model_tech_ids[i]) {
+                if (ok && !hasTech(tid) && !batch.techs.count(tid)) {
+                    row_err = "外键约束失败: tech_id " + to_string(tid) + " 在技术表中不存在";
+                    ok = false;
+                }
+            }
+            if (!ok) { reject("models", i); continue; }
+            batch.models.insert(m.model_id);
+            batch.model_names.insert(m.model_name);
+            ok_models[i] = 1;
+        }
+        for (size_t i = 0; i < b.model_techs.size(); i++) {
+            const ModelTech& mt = b.model_techs[i];
+            if (!checkModelTech(mt.model_id, mt.tech_id, row_err, &batch)) { reject("model_techs", i); continue; }
+            ok_links[i] = 1;
+        }
+        // 与 addModel 相同: 新车型必须绑定至少1个技术 (自带 tech_ids, 或同批 model_techs 中通过校验的关联)。
+        // 被拒绝的车型没有通过校验的关联, 不影响已校验的其他行
+        unordered_set<int> linked;
+        for (size_t i = 0; i < b.model_techs.size(); i++) if (ok_links[i]) linked.insert(b.model_techs[i].model_id);
+        for (size_t i = 0; i < b.models.size(); i++) {
+            if (!ok_models[i] || !b.model_tech_ids[i].empty() || linked.count(b.models[i].model_id)) continue;
+            row_err = "业务约束失败: 车型必须绑定至少1个技术";
+            reject("models", i);
+            ok_models[i] = 0;
+        }
+        version = version_;
+        if (atomic && rejected > 0) return 0;
+
+        // 先编码, 超过 WAL 单条记录上限时不写入任何行
+        string payload(1, WAL_BATCH);
+        auto encode = [&](const auto& row) {
+            if (payload.size() > 1) payload += '\n';
+            appendWalRow(payload, row);
+        };
+        for (size_t i = 0; i < b.series.size(); i++) if (ok_series[i]) encode(b.series[i]);
+        for (size_t i = 0; i < b.techs.size(); i++) if (ok_techs[i]) encode(b.techs[i]);
+        for (size_t i = 0; i < b.models.size(); i++) {
+            if (!ok_models[i]) continue;
+            encode(b.models[i]);
+            for (int tid : b.model_tech_ids[i]) encode(ModelTech{ 0, b.models[i].model_id, tid });
+        }
+        for (size_t i = 0; i < b.model_techs.size(); i++) if (ok_links[i]) encode(b.model_techs[i]);
+        if (payload.size() > wal_detail::kMaxPayload) {
+            err = "批量写入超过 WAL 单条记录上限 (" + to_string(wal_detail::kMaxPayload >> 20) + "MB), 请拆分后提交";
+            return 0;
+        }
+
+        // 校验已在同一把锁内完成, 以下插入不会失败; 已存在的关联不计入写入行数
+        size_t applied = 0;
+        bool inserted;
+        for (size_t i = 0; i < b.series.size(); i++) if (ok_series[i]) applied += insertSeries(b.series[i], row_err);
+        for (size_t i = 0; i < b.techs.size(); i++) if (ok_techs[i]) applied += insertTech(b.techs[i], row_err);
+        for (size_t i = 0; i < b.models.size(); i++) {
+            if (!ok_models[i]) continue;
+            applied += insertModel(b.models[i], row_err);
+            for (int tid : b.model_tech_ids[i]) insertModelTech(b.models[i].model_id, tid, row_err);
+        }
+        for (size_t i = 0; i < b.model_techs.size(); i++) {
+            if (!ok_links[i]) continue;
+            insertModelTech(b.model_techs[i].model_id, b.model_techs[i].tech_id, row_err, &inserted);
+            applied += inserted;
+        }
+        uint64_t lsn = applied > 0 ? logPayload(payload) : 0;
+        publish();
+        version = version_;
+        lk.unlock();
+        awaitDurable(lsn, err);
+        return applied;
+    }
+
+private:
+    mutable InstrumentedMutex mtx_{ g_metrics, &g_tracer };    // 写者互斥; 读者不使用
+    uint64_t version_ = 0;                  // 最后一次提交的版本 (mtx_)
+    bool pending_ = false;                  // 当前写入是否已追加增量行 (mtx_)
+    std::atomic<uint64_t> visible_{ 0 };    // 读者可见的最新版本
+    std::atomic<Generation*> current_{ nullptr };   // 只在 mtx_ 下替换
+    EpochDomain epoch_;
+    int64_t window_ms_ = 600000;            // 历史版本的保留窗口
+    WriteAheadLog wal_;
+    bool wal_ack_durable_ = true;   // 写请求是否等待 WAL 提交后再返回
+    unsigned load_threads_ = 1;     // 文本加载的并行线程数
+    uint64_t snapshot_lsn_ = 0;     // 数据文件 (快照) 中已包含的最大 lsn
+    bool verify_snapshot_ = true;   // 加载快照时校验全部段数据的校验和
+    int snapshot_slot_ = -1;        // 最近加载或写入的快照槽位, 下次写另一个 (compact_mtx_)
+    uint64_t snapshot_seq_ = 0;     // 已有快照的最大写入序号 (compact_mtx_)
+    string data_source_;            // 最近一次 loadData 采用的文件
+    std::mutex compact_mtx_;        // 同一时刻只允许一个压缩、重新加载或版本回收任务
+    FileStamp data_stamp_;          // 最近一次加载或写出的数据文件, 用于忽略自己产生的变更事件 (compact_mtx_)
+    bool reload_capture_ = false;   // 重新加载期间为 true, logRow 同时把记录存入 reload_tail_ (mtx_)
+    vector<string> reload_tail_;
+    FileWatcher watcher_;
+    std::thread maintenance_;
+    std::mutex maintenance_mtx_;
+    std::condition_variable maintenance_cv_;
+    bool stopping_ = false;
+
+    static const size_t FOLD_MIN_ROWS = 4096;   // 可并入的增量行少于此数时不重建基础数据集
+
+    // 写者使用的当前数据代 (调用方持有 mtx_ 或 compact_mtx_)
+    Generation& gen() const { return *current_.load(std::memory_order_relaxed); }
+
+    void retireChain(Generation* g) {
+        while (g) {
+            Generation* prev = g->prev.load(std::memory_order_relaxed);
+            epoch_.retire([g]() { delete g; });
+            g = prev;
+        }
+    }
+
+    // 以新的基础数据集发布一个数据代 (调用方持有 mtx_)。keep_previous 时旧数据代挂在其后,
+    // 保留窗口内仍可按版本查询; 否则直接回收 (启动时替换空数据集)
+    void installGeneration(shared_ptr<const CarDataSet> base, bool keep_previous) {
+        Generation* g = new Generation;
+        g->base = std::move(base);
+        g->floor = ++version_;
+        g->floor_time_ms = unixMillis();
+        Generation* old = current_.load(std::memory_order_relaxed);
+        if (old && keep_previous) {
+            old->end_version.store(g->floor, std::memory_order_relaxed);
+            old->end_time_ms.store(g->floor_time_ms, std::memory_order_relaxed);
+            g->prev.store(old, std::memory_order_relaxed);
+        }
+        current_.store(g, std::memory_order_seq_cst);
+        visible_.store(version_, std::memory_order_release);
+        if (old && !keep_previous) retireChain(old);
+    }
+
+    // 把保留窗口之外的增量并入新的基础数据集, 窗口内的增量原样搬到新数据代 (调用方持有 compact_mtx_)。
+    // 基础数据集的复制在锁外进行, 持锁只搬运窗口内的增量
+    void foldLocked(int64_t limit_ms) {
+        Generation* g = &gen();
+        size_t k = g->commits.upperBound(g->commits.size(), (uint64_t)limit_ms,
+                                         [](const CommitMark& c) { return (uint64_t)c.time_ms; });
+        if (k == 0) return;
+        uint64_t cutoff = g->commits[k - 1].version;
+        size_t ns = visibleCount(g->series, cutoff), nt = visibleCount(g->techs, cutoff);
+        size_t nm = visibleCount(g->models, cutoff), nl = visibleCount(g->links, cutoff);
+        int sc, mc, tc;
+        g->base->getCounts(sc, mc, tc);
+        if (ns + nt + nm + nl < std::max(FOLD_MIN_ROWS, (size_t)(sc + mc + tc) / 4)) return;
+
+        auto base = make_shared<CarDataSet>(*g->base);  // 映射的快照共享, 只复制增量表
+        string err;
+        for (size_t i = 0; i < ns; i++) base->insertSeries(g->series[i].row, err);
+        for (size_t i = 0; i < nt; i++) base->insertTech(g->techs[i].row, err);
+        for (size_t i = 0; i < nm; i++) base->insertModel(g->models[i].row, err);
+        for (size_t i = 0; i < nl; i++) base->insertModelTech(g->links[i].model_id, g->links[i].tech_id, err);
+
+        Generation* ng = new Generation;
+        ng->base = base;
+        ng->floor = cutoff;
+        ng->floor_time_ms = g->commits[k - 1].time_ms;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            for (size_t i = ns; i < g->series.size(); i++) ng->appendSeries(g->series[i].version, g->series[i].row);
+            for (size_t i = nt; i < g->techs.size(); i++) ng->appendTech(g->techs[i].version, g->techs[i].row);
+            for (size_t i = nm; i < g->models.size(); i++) ng->appendModel(g->models[i].version, g->models[i].row);
+            for (size_t i = nl; i < g->links.size(); i++) {
+                ng->appendLink(g->links[i].version, g->links[i].model_id, g->links[i].tech_id);
+            }
+            for (size_t i = k; i < g->commits.size(); i++) ng->commits.push_back(g->commits[i]);
+            ng->prev.store(g->prev.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            current_.store(ng, std::memory_order_seq_cst);
+        }
+        epoch_.retire([g]() { delete g; });
+    }
+
+public:
+    CarDataManager() {
+        std::lock_guard<InstrumentedMutex> lk(mtx_);
+        installGeneration(make_shared<CarDataSet>(), false);
+    }
+
+    ~CarDataManager() {
+        stopMaintenance();
+        Generation* g = current_.load();
+        while (g) {
+            Generation* prev = g->prev.load();
+            delete g;
+            g = prev;
+        }
+    }
+
+    void setLoadThreads(unsigned n) { load_threads_ = n > 0 ? n : 1; }
+
+    void setVersionWindow(int seconds) { window_ms_ = (int64_t)seconds * 1000; }
+
+    void setSnapshotVerify(bool full) { verify_snapshot_ = full; }
+
+    void setWalOptions(const WriteAheadLog::Options& opt, bool ack_durable) {
+        wal_.setOptions(opt);
+        wal_ack_durable_ = ack_durable;
+    }
+
+    // 在数据文件快照之上回放 WAL, 然后打开 WAL 继续追加 (启动阶段, 数据集尚未发布)
+    bool openWal(CarDataSet& set, string& err) {
+        WriteAheadLog::ReplayStats stats;
+        if (!WriteAheadLog::replay(WAL_FILE, snapshot_lsn_,
+                                   [&](uint64_t, string_view payload) { set.applyWalRecord(payload); },
+                                   stats, err)) {
+            return false;
+        }
+        if (stats.records > 0) cout << "WAL replayed: " << stats.records << " records" << endl;
+        if (stats.truncated_tail) cerr << "Warning: WAL tail was incomplete and has been truncated" << endl;
+        if (stats.records > 0 && stats.first_lsn > snapshot_lsn_ + 1) {
+            cerr << "Warning: WAL records " << snapshot_lsn_ + 1 << ".." << stats.first_lsn - 1
+                 << " are missing, changes in between are lost" << endl;
+        }
+        if (!wal_.open(WAL_FILE, stats.last_lsn, err)) return false;
+        wal_.startWriter();
+        return true;
+    }
+
+    // 压缩: 轮转 WAL -> 把当前数据写成新快照 (临时文件 + rename) -> 删除旧日志
+    bool compact(string& err) {
+        std::lock_guard<std::mutex> ck(compact_mtx_);
+        uint64_t lsn, version;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            if (!wal_.isOpen()) { err = "WAL 未打开"; return false; }
+            lsn = wal_.lastLsn();
+            version = version_;
+            string rotate_err;
+            // 轮转失败 (如上次压缩遗留 .old) 不影响正确性: 新快照同样覆盖 .old 中的全部记录
+            wal_.rotate(rotate_err);
+        }
+        // 持有 compact_mtx_ 时数据代不会被替换, 该版本一定可读
+        ReadView view;
+        if (!viewAtVersion(version, view, err)) return false;
+        shared_ptr<const DataSnapshot> snap = view.buildSnapshot();
+        // 先写文本再写二进制快照, 使二进制快照不旧于文本文件
+        if (!saveData(*snap, lsn, err)) return false;
+        data_stamp_ = FileStamp::of(DATA_FILE);   // 监视线程据此忽略这次写出
+        if (!saveBinarySnapshot(*snap, lsn, err)) return false;
+        snapshot_lsn_ = lsn;
+        wal_.removeRotated();
+        return true;
+    }
+
+    // 版本回收: 并入窗口外的增量, 摘下窗口外的旧数据代, 释放已无读者的对象
+    void collectVersions() {
+        {
+            std::lock_guard<std::mutex> ck(compact_mtx_);
+            int64_t limit = unixMillis() - window_ms_;
+            foldLocked(limit);
+
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            Generation* g = &gen();
+            Generation* p;
+            while ((p = g->prev.load(std::memory_order_relaxed)) != nullptr && p->end_time_ms.load(std::memory_order_relaxed) >= limit) g = p;
+            if (p) {
+                g->prev.store(nullptr, std::memory_order_seq_cst);
+                retireChain(p);
+            }
+        }
+        epoch_.collect();
+    }
+
+    // 后台维护线程: 按间隔刷盘 (Interval 策略), WAL 超过阈值时压缩, 回收历史版本
+    void startMaintenance(uint64_t compact_bytes, int sync_interval_ms) {
+        maintenance_ = std::thread([this, compact_bytes, sync_interval_ms]() {
+            std::unique_lock<std::mutex> lk(maintenance_mtx_);
+            while (!stopping_) {
+                maintenance_cv_.wait_for(lk, std::chrono::milliseconds(sync_interval_ms));
+                if (stopping_) break;
+                lk.unlock();
+                wal_.sync();
+                if (wal_.bytes() > compact_bytes) {
+                    string err;
+                    if (!compact(err)) cerr << "Warning: WAL compaction failed: " << err << endl;
+                }
+                collectVersions();
+                lk.lock();
+            }
+        });
+    }
+    // 监视数据文件, 被外部修改后自动重新加载
+    void startWatcher() {
+        string err;
+        if (!watcher_.start(DATA_FILE, 300, [this]() { reloadIfChanged(); }, err)) {
+            cerr << "Warning: " << err << ", data file changes will not be reloaded automatically" << endl;
+        }
+    }
+
+    void stopMaintenance() {
+        watcher_.stop();
+        {
+            std::lock_guard<std::mutex> lk(maintenance_mtx_);
+            stopping_ = true;
+        }
+        maintenance_cv_.notify_all();
+        if (maintenance_.joinable()) maintenance_.join();
+        wal_.close();
+    }
+
+    // -------------------------
+    // 热重载: 在锁外解析数据文件并构建新数据集, 校验通过后作为新数据代发布。
+    // 解析期间读写照常进行; 发布前把这段时间的写入补到新数据集上, 不丢失写入;
+    // 旧数据代在保留窗口内仍可按版本查询
+    // -------------------------
+    struct ReloadResult {
+        bool ok = false;
+        string message;
+        size_t error_count = 0;
+        vector<TextLoadError> errors;   // 数据文件中的错误行 (前若干条, 按行号排序)
+        size_t replayed = 0;            // 补到新数据集上的 WAL 记录数
+        int series_count = 0, model_count = 0, tech_count = 0;
+        double ms = 0;
+    };
+
+    ReloadResult reload() {
+        TraceSpan span(g_tracer, "reload");
+        std::lock_guard<std::mutex> ck(compact_mtx_);
+        return reloadLocked();
+    }
+
+    // 监视线程回调: 文件与最近一次加载/写出的相同时 (如压缩写出的文件) 不做任何事
+    void reloadIfChanged() {
+        ReloadResult r;
+        {
+            std::lock_guard<std::mutex> ck(compact_mtx_);
+            if (FileStamp::of(DATA_FILE) == data_stamp_) return;
+            r = reloadLocked();
+        }
+        if (r.ok) {
+            cout << "Data reloaded from " << DATA_FILE << ": " << r.series_count << " series, " << r.model_count
+                 << " models, " << r.tech_count << " techs (" << r.ms << " ms, " << r.replayed << " WAL records replayed)" << endl;
+        } else {
+            cerr << "Warning: data reload rejected: " << r.message << endl;
+            for (const auto& e : r.errors) cerr << "  line " << e.line << ": " << e.message << endl;
+        }
+    }
+
+private:
+    // 调用方持有 compact_mtx_ (与压缩互斥, 压缩期间 WAL 不会轮转)
+    ReloadResult reloadLocked() {
+        ReloadResult result;
+        auto t0 = std::chrono::steady_clock::now();
+        FileStamp stamp = FileStamp::of(DATA_FILE);
+
+        // 从此刻起的写入由 logRow 截获; 之前的写入等它们落盘后从 WAL 文件补放
+        uint64_t start_lsn;
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            reload_capture_ = true;
+            reload_tail_.clear();
+            start_lsn = wal_.isOpen() ? wal_.lastLsn() : 0;
+        }
+
+        auto next = make_shared<CarDataSet>();
+        TextDataLoader loader;
+        string err;
+        bool built = next->loadText(DATA_FILE, load_threads_, loader, err);
+        if (built && loader.errorCount() > 0) {
+            result.error_count = loader.errorCount();
+            result.errors = sortedErrors(loader);
+            err = "数据文件中有 " + to_string(loader.errorCount()) + " 行错误";
+            built = false;
+        }
+        if (built) built = next->validate(err);
+        if (built && start_lsn > loader.walLsn()) {
+            WriteAheadLog::ReplayStats stats;
+            built = wal_.waitDurable(start_lsn) &&
+                    WriteAheadLog::replay(WAL_FILE, loader.walLsn(), [&](uint64_t lsn, string_view payload) {
+                        if (lsn <= start_lsn) { next->applyWalRecord(payload); result.replayed++; }
+                    }, stats, err, false);
+            if (!built && err.empty()) err = "WAL 写入失败";
+        }
+        // 新数据集 (不含截获的写入) 对应 start_lsn, 用于刷新二进制快照
+        shared_ptr<DataSnapshot> snap;
+        if (built) snap = buildSnapshot(*next);
+
+        {
+            std::lock_guard<InstrumentedMutex> lk(mtx_);
+            if (built) {
+                for (const string& payload : reload_tail_) next->applyWalRecord(payload);
+                result.replayed += reload_tail_.size();
+                next->getCounts(result.series_count, result.model_count, result.tech_count);
+                installGeneration(next, true);
+            }
+            reload_capture_ = false;
+            reload_tail_.clear();
+            reload_tail_.shrink_to_fit();
+        }
+
+        if (!built) {
+            result.message = err + ", 未替换当前数据";
+            return result;
+        }
+        data_stamp_ = stamp;
+        snapshot_lsn_ = loader.walLsn();
+        // 刷新二进制快照, 下次启动直接映射重新加载后的数据; 失败不影响本次重新加载
+        if (saveBinarySnapshot(*snap, start_lsn, err)) snapshot_lsn_ = start_lsn;
+        else cerr << "Warning: " << err << endl;
+
+        result.ok = true;
+        result.message = "重新加载完成";
+        result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return result;
+    }
+
+
+public:
+    // -------------------------
+    // 从文件加载数据: 收到比其余文件都新的列式文件时解码它, 否则优先 mmap 最新的有效快照槽位,
+    // 都不可用或比文本文件旧时解析文本文件。成功时 out 为尚未发布的数据集
+    // -------------------------
+    struct SnapshotSlotState;
+
+    bool loadData(shared_ptr<CarDataSet>& out) {
+        SnapshotSlotState slots[2];
+        return loadData(out, slots);
+    }
+
+    // slots 返回两个槽位的检查结果
+    bool loadData(shared_ptr<CarDataSet>& out, SnapshotSlotState (&slots)[2]) {
+        snapshot_lsn_ = 0;
+        data_stamp_ = FileStamp::of(DATA_FILE);
+        int best = scanSnapshotSlots(verify_snapshot_, slots);
+        for (const SnapshotSlotState& s : slots) {
+            if (s.exists && !s.snap) cerr << "Warning: " << s.error << endl;
+            if (s.snap) snapshot_seq_ = std::max(snapshot_seq_, s.snap->sequence());
+        }
+        snapshot_slot_ = best;
+        DataSource source = chooseSource(slots, best, data_stamp_, FileStamp::of(COLUMNAR_FILE));
+        if (source == DataSource::Columnar) {
+            string err;
+            if (loadColumnarData(out, err)) return true;
+            cerr << "Warning: " << err << ", ignoring " << COLUMNAR_FILE << endl;
+            source = chooseSource(slots, best, data_stamp_, FileStamp());
+        }
+        if (source == DataSource::Snapshot) {
+            useSnapshot(out, slots[best].snap);
+            data_source_ = SNAPSHOT_FILES[best];
+            return true;
+        }
+        data_source_ = DATA_FILE;
+        return loadTextData(out);
+    }
+
+    enum class DataSource { Columnar, Snapshot, Text };
+
+    // 启动数据源: 列式文件比文本文件与最新快照都新时用列式文件; 其次是不旧于文本文件的最新有效快照; 否则文本文件
+    static DataSource chooseSource(const SnapshotSlotState (&slots)[2], int best, const FileStamp& text,
+                                   const FileStamp& columnar) {
+        int64_t text_mtime = text.exists ? text.mtime_ns : INT64_MIN;
+        if (columnar.exists && columnar.mtime_ns > text_mtime &&
+            (best < 0 || columnar.mtime_ns > slots[best].stamp.mtime_ns)) {
+            return DataSource::Columnar;
+        }
+        return best >= 0 && slots[best].stamp.mtime_ns >= text_mtime ? DataSource::Snapshot : DataSource::Text;
+    }
+
+    void useSnapshot(shared_ptr<CarDataSet>& out, shared_ptr<const MappedSnapshot> snap) {
+        out = make_shared<CarDataSet>();
+        out->next_mt_id = (int)snap->modelTechs().size + 1;
+        snapshot_lsn_ = snap->walLsn();
+        out->base_ = std::move(snap);
+    }
+
+    // 列式文件直接解码为内存中的快照映像作为基础数据, 同时写入另一个快照槽位,
+    // 之后的启动直接映射该槽位 (写入失败不影响本次加载)
+    bool loadColumnarData(shared_ptr<CarDataSet>& out, string& err) {
+        SnapshotBuilder builder;
+        ColumnarStats stats;
+        if (!readColumnarFile(COLUMNAR_FILE, builder, stats, err)) return false;
+        int slot = snapshot_slot_ == 0 ? 1 : 0;
+        string image;
+        if (!builder.build(image, stats.wal_lsn, snapshot_seq_ + 1, err)) return false;
+        AtomicFileWriter file(SNAPSHOT_FILES[slot]);
+        string write_err;
+        if (file.isOpen() && file.write(image) && file.commit(write_err)) {
+            snapshot_slot_ = slot;
+            snapshot_seq_++;
+        } else {
+            cerr << "Warning: cannot write " << SNAPSHOT_FILES[slot] << (write_err.empty() ? "" : ": " + write_err) << endl;
+        }
+        auto snap = make_shared<MappedSnapshot>();
+        if (!snap->openImage(std::move(image), COLUMNAR_FILE, err)) return false;
+        useSnapshot(out, snap);
+        data_source_ = COLUMNAR_FILE;
+        return true;
+    }
+
+    // 快照槽位的检查结果
+    struct SnapshotSlotState {
+        bool exists = false;
+        FileStamp stamp;
+        shared_ptr<MappedSnapshot> snap;    // 校验通过时非空
+        string error;
+        double ms = 0;
+    };
+
+    // 打开并校验两个槽位, 返回序号最大的有效槽位, 都无效时返回 -1
+    static int scanSnapshotSlots(bool verify_data, SnapshotSlotState (&slots)[2]) {
+        int best = -1;
+        for (int i = 0; i < 2; i++) {
+            SnapshotSlotState& s = slots[i];
+            s.stamp = FileStamp::of(SNAPSHOT_FILES[i]);
+            s.exists = s.stamp.exists;
+            if (!s.exists) continue;
+            auto t0 = std::chrono::steady_clock::now();
+            auto snap = make_shared<MappedSnapshot>();
+            if (snap->open(SNAPSHOT_FILES[i], s.error, verify_data)) s.snap = snap;
+            s.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (s.snap && (best < 0 || s.snap->sequence() > slots[best].snap->sequence())) best = i;
+        }
+        return best;
+    }
+
+    // 启动时的文本加载: 错误行跳过并输出, 其余数据照常加载
+    bool loadTextData(shared_ptr<CarDataSet>& out) {
+        auto next = make_shared<CarDataSet>();
+        TextDataLoader loader;
+        string err;
+        if (!next->loadText(DATA_FILE, load_threads_, loader, err)) {
+            cerr << "Warning: " << err << endl;
+            return false;
+        }
+        snapshot_lsn_ = loader.walLsn();
+        if (loader.errorCount() > 0) {
+            cerr << "Warning: " << loader.errorCount() << " malformed line(s) skipped in " << DATA_FILE << endl;
+            for (const auto& e : sortedErrors(loader)) cerr << "  line " << e.line << ": " << e.message << endl;
+        }
+        out = next;
+        return true;
+    }
+    
+    // -------------------------
+    // 保存快照到数据文件 (临时文件 + rename, 中途失败不破坏原文件)
+    // -------------------------
+    bool saveData(const DataSnapshot& snap, uint64_t lsn, string& err) {
+        AtomicFileWriter file(DATA_FILE);
+        if (!file.isOpen()) {
+            err = "Cannot write to data file " + DATA_FILE;
+            return false;
+        }
+        
+        string buf;
+        appendFileHeader(buf, DataLayout::Web, lsn);
+        auto flush = [&](bool force) {
+            if (force || buf.size() >= (1u << 20)) { file.write(buf); buf.clear(); }
+        };
+        buf += "[SERIES]\n";
+        for (const Series& s : snap.series) appendSeriesLine(buf, { s.series_id, s.series_name, s.intro });
+        buf += "\n[TECH]\n";
+        for (const Tech& t : snap.techs) appendTechLine(buf, { t.tech_id, t.tech_name, t.intro });
+        buf += "\n[MODEL]\n";
+        for (const Model& m : snap.models) {
+            appendModelLine(buf, toRecord(m), DataLayout::Web);
+            flush(false);
+        }
+        buf += "\n[MODEL_TECH]\n";
+        for (const ModelTech& mt : snap.model_techs) {
+            appendModelTechLine(buf, { mt.model_id, mt.tech_id });
+            flush(false);
+        }
+        flush(true);
+        return file.commit(err);
+    }
+
+    // 写二进制快照 (供下次启动 mmap) 到当前槽位之外的另一个槽位, 写坏时仍可回退到当前槽位
+    bool saveBinarySnapshot(const DataSnapshot& snap, uint64_t lsn, string& err) {
+        int slot = snapshot_slot_ == 0 ? 1 : 0;
+        if (!writeBinarySnapshot(snap, SNAPSHOT_FILES[slot], lsn, snapshot_seq_ + 1, err)) return false;
+        snapshot_slot_ = slot;
+        snapshot_seq_++;
+        std::remove(LEGACY_SNAPSHOT_FILE.c_str());
+        return true;
+    }
+
+    static bool writeBinarySnapshot(const DataSnapshot& snap, const string& path, uint64_t lsn, uint64_t sequence,
+                                    string& err) {
+        SnapshotBuilder b;
+        fillSnapshotBuilder(snap, b);
+        return b.write(path, lsn, sequence, err);
+    }
+
+    static void fillSnapshotBuilder(const DataSnapshot& snap, SnapshotBuilder& b) {
+        for (const Series& s : snap.series) b.addSeries(s.series_id, s.series_name, s.intro);
+        for (const Tech& t : snap.techs) b.addTech(t.tech_id, t.tech_name, t.intro);
+        for (const Model& m : snap.models) {
+            b.addModel(m.model_id, m.model_name, m.series_id, m.price, m.range_km,
+                       m.energy_type, m.body_type, m.seats, m.launch_year);
+        }
+        for (const ModelTech& mt : snap.model_techs) b.addModelTech(mt.model_id, mt.tech_id);
+    }
+
+    // -------------------------
+    // 初始化数据 - 加载快照并回放 WAL, 然后作为第一个数据代发布
+    // -------------------------
+    void initData() {
+        auto t0 = std::chrono::steady_clock::now();
+        shared_ptr<CarDataSet> set;
+        if (!loadData(set)) {
+            cerr << "Data loading failed, please ensure data file exists: " << DATA_FILE << endl;
+            set = make_shared<CarDataSet>();
+        } else {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            cout << "Data loaded from file: " << data_source_ << " (" << ms << " ms)" << endl;
+            // 首次从文本启动: 生成二进制快照并改为映射加载, 之后的启动无需解析
+            string err;
+            if (!set->base_) {
+                if (saveBinarySnapshot(*buildSnapshot(*set), snapshot_lsn_, err)) loadData(set);
+                else cerr << "Warning: " << err << endl;
+            }
+        }
+        string err;
+        if (!openWal(*set, err)) {
+            cerr << "Warning: " << err << ", changes will not be persisted" << endl;
+        }
+        std::lock_guard<InstrumentedMutex> lk(mtx_);
+        installGeneration(set, false);
+    }
+
+    // -------------------------
+    // --verify: 检查文本数据文件、两个快照槽位 (全部校验和) 与 WAL, 输出启动时会采用的数据源。
+    // 全部完好时返回 true
+    // -------------------------
+    bool verifyFiles() {
+        bool clean = true;
+        data_stamp_ = FileStamp::of(DATA_FILE);
+        uint64_t text_lsn = 0;
+        if (!data_stamp_.exists) {
+            cout << DATA_FILE << ": missing" << endl;
+        } else {
+            auto t0 = std::chrono::steady_clock::now();
+            CarDataSet set;
+            TextDataLoader loader;
+            string err;
+            if (!set.loadText(DATA_FILE, load_threads_, loader, err)) {
+                cout << DATA_FILE << ": " << err << endl;
+                clean = false;
+            } else {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                int series_count, model_count, tech_count;
+                set.getCounts(series_count, model_count, tech_count);
+                text_lsn = loader.walLsn();
+                cout << DATA_FILE << ": " << (loader.errorCount() > 0 ? "DAMAGED" : "ok") << ", wal_lsn " << text_lsn
+                     << ", " << series_count << " series, " << model_count << " models, " << tech_count << " techs ("
+                     << ms << " ms)" << endl;
+                if (loader.errorCount() > 0) {
+                    clean = false;
+                    cout << "  " << loader.errorCount() << " bad line(s)" << endl;
+                    for (const auto& e : sortedErrors(loader)) cout << "  line " << e.line << ": " << e.message << endl;
+                }
+            }
+        }
+
+        SnapshotSlotState slots[2];
+        int best = scanSnapshotSlots(true, slots);
+        for (int i = 0; i < 2; i++) {
+            const SnapshotSlotState& st = slots[i];
+            cout << SNAPSHOT_FILES[i] << ": ";
+            if (!st.exists) { cout << "missing" << endl; continue; }
+            if (!st.snap) { cout << "INVALID, " << st.error << endl; clean = false; continue; }
+            const MappedSnapshot& m = *st.snap;
+            cout << "ok, sequence " << m.sequence() << ", wal_lsn " << m.walLsn() << ", " << m.series().size
+                 << " series, " << m.models().size << " models, " << m.techs().size << " techs, " << m.fileSize()
+                 << " bytes verified in " << st.ms << " ms (" << (st.ms > 0 ? m.fileSize() / st.ms / 1e6 : 0.0)
+                 << " GB/s)" << endl;
+        }
+
+        FileStamp columnar_stamp = FileStamp::of(COLUMNAR_FILE);
+        uint64_t columnar_lsn = 0;
+        if (columnar_stamp.exists) {
+            auto t0 = std::chrono::steady_clock::now();
+            SnapshotBuilder builder;
+            ColumnarStats cs;
+            string err;
+            cout << COLUMNAR_FILE << ": ";
+            if (!readColumnarFile(COLUMNAR_FILE, builder, cs, err)) {
+                cout << "INVALID, " << err << endl;
+                columnar_stamp = FileStamp();
+                clean = false;
+            } else {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                columnar_lsn = cs.wal_lsn;
+                cout << "ok, wal_lsn " << cs.wal_lsn << ", " << cs.series << " series, " << cs.models << " models, "
+                     << cs.techs << " techs, " << cs.row_groups << " row groups, " << cs.bytes << " bytes decoded in "
+                     << ms << " ms" << endl;
+            }
+        }
+
+        // 与 loadData 相同的选择规则
+        DataSource source = chooseSource(slots, best, data_stamp_, columnar_stamp);
+        uint64_t source_lsn = source == DataSource::Columnar ? columnar_lsn
+                            : source == DataSource::Snapshot ? slots[best].snap->walLsn() : text_lsn;
+        WriteAheadLog::ReplayStats stats;
+        string err;
+        if (!WriteAheadLog::replay(WAL_FILE, source_lsn, [](uint64_t, string_view) {}, stats, err, false)) {
+            cout << WAL_FILE << ": " << err << endl;
+            return false;
+        }
+        cout << WAL_FILE << ": " << (stats.truncated_tail ? "DAMAGED TAIL" : "ok") << ", "
+             << stats.records + stats.skipped << " records, last lsn " << stats.last_lsn << endl;
+        if (stats.truncated_tail) clean = false;
+
+        if (source == DataSource::Text && !data_stamp_.exists) {
+            cout << "No usable data source" << endl;
+            return false;
+        }
+        const string& source_file = source == DataSource::Columnar ? COLUMNAR_FILE
+                                  : source == DataSource::Snapshot ? SNAPSHOT_FILES[best] : DATA_FILE;
+        cout << "Startup source: " << source_file << " (wal_lsn " << source_lsn
+             << ") + " << stats.records << " WAL record(s)" << endl;
+        if (stats.records > 0 && stats.first_lsn > source_lsn + 1) {
+            cout << "WAL records " << source_lsn + 1 << ".." << stats.first_lsn - 1 << " are missing" << endl;
+            clean = false;
+        }
+        return clean;
+    }
+
+    // -------------------------
+    // --recover: 从最新的有效数据源加载并回放 WAL (截掉残缺的尾部记录),
+    // 重写文本数据文件与一个快照槽位; 校验失败的槽位改名为 .corrupt 保留
+    // -------------------------
+    bool recoverFiles(string& err) {
+        verify_snapshot_ = true;
+        SnapshotSlotState slots[2];
+        shared_ptr<CarDataSet> set;
+        if (!loadData(set, slots)) {
+            err = "没有可用的数据源";
+            return false;
+        }
+        cout << "Recovering from " << data_source_ << " (wal_lsn " << snapshot_lsn_ << ")" << endl;
+
+        WriteAheadLog::ReplayStats stats;
+        if (!WriteAheadLog::replay(WAL_FILE, snapshot_lsn_, [&](uint64_t, string_view payload) { set->applyWalRecord(payload); },
+                                   stats, err)) {
+            return false;
+        }
+        cout << "WAL replayed: " << stats.records << " records" << endl;
+        if (stats.truncated_tail) cout << "WAL tail was incomplete and has been truncated" << endl;
+        if (stats.records > 0 && stats.first_lsn > snapshot_lsn_ + 1) {
+            cout << "Warning: WAL records " << snapshot_lsn_ + 1 << ".." << stats.first_lsn - 1 << " are missing" << endl;
+        }
+
+        shared_ptr<DataSnapshot> snap = buildSnapshot(*set);
+        if (!saveData(*snap, stats.last_lsn, err)) return false;
+        if (!saveBinarySnapshot(*snap, stats.last_lsn, err)) return false;
+        std::remove((WAL_FILE + ".old").c_str());   // 其中的记录已写入新快照
+        for (int i = 0; i < 2; i++) {
+            if (i == snapshot_slot_ || !slots[i].exists || slots[i].snap) continue;
+            string bad = SNAPSHOT_FILES[i] + ".corrupt";
+            if (std::rename(SNAPSHOT_FILES[i].c_str(), bad.c_str()) == 0) cout << "Moved invalid snapshot to " << bad << endl;
+        }
+        cout << "Recovered: " << snap->series.size() << " series, " << snap->models.size() << " models, "
+             << snap->techs.size() << " techs, wal_lsn " << stats.last_lsn << " -> " << DATA_FILE << ", "
+             << SNAPSHOT_FILES[snapshot_slot_] << endl;
+        return true;
+    }
+
+    // -------------------------
+    // --workers 的主进程: 启动 (及每次滚动重启) 前把最新数据整理为一个快照槽位。
+    // 回放 WAL 并截掉残缺的尾部; 数据来自文本文件或有新的 WAL 记录时写出新快照。
+    // 工作进程各自 mmap 同一个快照文件, 物理内存由页缓存共享, 启动时无需解析与回放
+    // -------------------------
+    bool prepareSharedSnapshot(string& err) {
+        shared_ptr<CarDataSet> set;
+        if (!loadData(set)) {
+            err = "没有可用的数据源";
+            return false;
+        }
+        WriteAheadLog::ReplayStats stats;
+        if (!WriteAheadLog::replay(WAL_FILE, snapshot_lsn_, [&](uint64_t, string_view payload) { set->applyWalRecord(payload); },
+                                   stats, err)) {
+            return false;
+        }
+        if (stats.truncated_tail) cerr << "Warning: WAL tail was incomplete and has been truncated" << endl;
+        if (set->base_ && stats.records == 0) {
+            cout << "Shared snapshot: " << data_source_ << " (wal_lsn " << snapshot_lsn_ << ")" << endl;
+            return true;
+        }
+        if (!saveBinarySnapshot(*buildSnapshot(*set), stats.last_lsn, err)) return false;
+        cout << "Shared snapshot: " << SNAPSHOT_FILES[snapshot_slot_] << " (from " << data_source_ << " + "
+             << stats.records << " WAL records, wal_lsn " << stats.last_lsn << ")" << endl;
+        return true;
+    }
+
+    // --workers 的工作进程: 映射主进程整理好的快照, 只读回放其后的 WAL 记录 (不截断, 不打开追加)。
+    // 不写任何文件, 也不启动压缩与文件监视; 写请求在路由前拒绝
+    void initReplica() {
+        auto t0 = std::chrono::steady_clock::now();
+        shared_ptr<CarDataSet> set;
+        if (!loadData(set)) {
+            cerr << "Data loading failed, please ensure data file exists: " << DATA_FILE << endl;
+            set = make_shared<CarDataSet>();
+        } else {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            cout << "Data loaded from file: " << data_source_ << " (" << ms << " ms)" << endl;
+        }
+        WriteAheadLog::ReplayStats stats;
+        string err;
+        if (!WriteAheadLog::replay(WAL_FILE, snapshot_lsn_, [&](uint64_t, string_view payload) { set->applyWalRecord(payload); },
+                                   stats, err, false)) {
+            cerr << "Warning: " << err << endl;
+        } else if (stats.records > 0) {
+            cout << "WAL replayed: " << stats.records << " records" << endl;
+        }
+        std::lock_guard<InstrumentedMutex> lk(mtx_);
+        installGeneration(set, false);
+    }
+};
+
+CarDataManager g_manager;
+
+// =============================
+// JSON 工具函数
+// =============================
+
+template <typename T>
+void appendNumber(string& out, T v) {
+    char buf[32];
+    auto r = to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
+
+// 按字段掩码序列化单个车型对象 (未请求的字段不输出), 直接追加到 out
+void writeModelJson(string& out, const CarDataManager::ModelDetail& md, unsigned fields) {
+    const char* sep = "";
+    out += '{';
+    if (fields & MF_MODEL_ID)    { out += sep; out += "\"model_id\":"; appendNumber(out, md.model.model_id); sep = ","; }
+    if (fields & MF_MODEL_NAME)  { out += sep; out += "\"model_name\":"; appendJsonString(out, md.model.model_name); sep = ","; }
+    if (fields & MF_SERIES_ID)   { out += sep; out += "\"series_id\":"; appendNumber(out, md.model.series_id); sep = ","; }
+    if (fields & MF_SERIES_NAME) { out += sep; out += "\"series_name\":"; appendJsonString(out, md.series_name); sep = ","; }
+    if (fields & MF_PRICE)       { out += sep; out += "\"price\":"; appendNumber(out, md.model.price); sep = ","; }
+    if (fields & MF_RANGE_KM)    { out += sep; out += "\"range_km\":"; appendNumber(out, md.model.range_km); sep = ","; }
+    if (fields & MF_ENERGY_TYPE) { out += sep; out += "\"energy_type\":"; appendJsonString(out, md.model.energy_type); sep = ","; }
+    if (fields & MF_BODY_TYPE)   { out += sep; out += "\"body_type\":"; appendJsonString(out, md.model.body_type); sep = ","; }
+    if (fields & MF_SEATS)       { out += sep; out += "\"seats\":"; appendNumber(out, md.model.seats); sep = ","; }
+    if (fields & MF_LAUNCH_YEAR) { out += sep; out += "\"launch_year\":"; appendJsonString(out, md.model.launch_year); sep = ","; }
+    if (fields & MF_TECHS) {
+        out += sep;
+        out += "\"techs\":[";
+        bool first_tech = true;
+        for (const auto& tn : md.tech_names) {
+            if (!first_tech) out += ',';
+            appendJsonString(out, tn);
+            first_tech = false;
+        }
+        out += ']';
+    }
+    out += '}';
+}
+
+// 读取请求中的 fields 参数; 缺省时输出全部字段
+bool getRequestFields(const httplib::Request& req, httplib::Response& res, unsigned& fields) {
+    fields = MF_ALL;
+    if (!req.has_param("fields")) return true;
+    string err;
+    if (!parseFieldMask(req.get_param_value("fields"), fields, err)) {
+        res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+        return false;
+    }
+    return true;
+}
+
+// 准入检查为判断能否合并而打开的视图; 同一请求的 getReadView 直接取走, 版本参数只解析一次。
+// 没有被取走时 (如处理函数提前返回错误) 由 finishRequest 释放
+thread_local CarDataManager::ReadView t_request_view;
+
+// 按请求中的版本参数打开只读视图: ?as_of_version=N 或 ?as_of_time=<Unix 秒>, 缺省时读最新版本
+bool openReadView(const httplib::Request& req, CarDataManager::ReadView& view, string& err) {
+    bool ok = true;
+    if (req.has_param("as_of_version")) {
+        uint64_t version;
+        if (!parseNumber(string_view(req.get_param_value("as_of_version")), version)) {
+            err = "as_of_version 不是有效的版本号";
+            ok = false;
+        } else {
+            ok = g_manager.viewAtVersion(version, view, err);
+        }
+    } else if (req.has_param("as_of_time")) {
+        double seconds;
+        if (!parseNumber(string_view(req.get_param_value("as_of_time")), seconds)) {
+            err = "as_of_time 应为 Unix 时间戳 (秒)";
+            ok = false;
+        } else {
+            ok = g_manager.viewAtTime((int64_t)(seconds * 1000), view, err);
+        }
+    } else {
+        view = g_manager.latestView();
+    }
+    return ok;
+}
+
+bool getReadView(const httplib::Request& req, httplib::Response& res, CarDataManager::ReadView& view) {
+    TraceSpan span(g_tracer, "read view");
+    if (t_request_view.valid()) {
+        view = std::move(t_request_view);
+        t_request_view = CarDataManager::ReadView();
+        return true;
+    }
+    string err;
+    if (openReadView(req, view, err)) return true;
+    res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+    return false;
+}
+
+// =============================
+// 请求体解析 (JSON -> 请求结构体)
+// =============================
+
+struct ModelAddRequest {
+    string model_name;
+    int series_id = 0;
+    double price = 0;
+    double range_km = 0;
+    string energy_type;
+    string body_type;
+    int seats = 0;
+    string launch_year;
+    vector<int> tech_ids;
+};
+
+struct TechAddRequest {
+    string tech_name;
+    string intro;
+};
+
+// 读取字符串字段 (null 视为缺省)
+bool readJsonString(JsonReader& r, const char* key, string& out, string& err) {
+    JsonReader::Token t = r.next();
+    if (t == JsonReader::Token::String) { out.assign(r.value().data(), r.value().size()); return true; }
+    if (t == JsonReader::Token::Null) return true;
+    if (t != JsonReader::Token::Error) err = string("字段 ") + key + " 必须是字符串";
+    return false;
+}
+
+// 读取数值字段: 接受 JSON 数字或数字字符串 (表单常见), null 视为缺省。
+// from_chars 接受 "nan" / "inf", 非有限值写不成合法 JSON, 也无法从 WAL 读回, 一律拒绝
+template <typename T>
+bool readJsonNumber(JsonReader& r, const char* key, T& out, string& err) {
+    JsonReader::Token t = r.next();
+    if (t == JsonReader::Token::Null) return true;
+    if (t == JsonReader::Token::Number || t == JsonReader::Token::String) {
+        bool ok;
+        if constexpr (std::is_same<T, int>::value) ok = JsonReader::parseInt(r.value(), out);
+        else ok = JsonReader::parseDouble(r.value(), out) && std::isfinite(out);
+        if (ok) return true;
+    }
+    if (t != JsonReader::Token::Error) err = string("字段 ") + key + " 不是有效数值";
+    return false;
+}
+
+// 读取整数数组字段, 例如 tech_ids: [101, 102]
+bool readJsonIntArray(JsonReader& r, const char* key, vector<int>& out, string& err) {
+    JsonReader::Token t = r.next();
+    if (t == JsonReader::Token::Null) return true;
+    if (t != JsonReader::Token::BeginArray) {
+        if (t != JsonReader::Token::Error) err = string("字段 ") + key + " 必须是数组";
+        return false;
+    }
+    out.clear();
+    while ((t = r.next()) != JsonReader::Token::EndArray) {
+        int v;
+        if ((t != JsonReader::Token::Number && t != JsonReader::Token::String) || !r.toInt(v)) {
+            if (t != JsonReader::Token::Error) err = string("字段 ") + key + " 只能包含整数";
+            return false;
+        }
+        out.push_back(v);
+    }
+    return true;
+}
+
+// 遍历一个 JSON 对象, 对每个键调用 on_field(key); on_field 必须消费对应的值。
+// t 为已读出的第一个事件 (数组元素需先读出事件才能判断数组是否结束)
+template <typename F>
+bool readJsonObject(JsonReader& r, JsonReader::Token t, string& err, F on_field) {
+    if (t != JsonReader::Token::BeginObject) {
+        if (t != JsonReader::Token::Error) err = "请求体必须是 JSON 对象";
+        return false;
+    }
+    while ((t = r.next()) == JsonReader::Token::Key) {
+        if (!on_field(r.value())) {
+            if (err.empty()) err = "JSON 解析错误: " + r.error();
+            return false;
+        }
+    }
+    if (t != JsonReader::Token::EndObject) {
+        err = "JSON 解析错误: " + r.error();
+        return false;
+    }
+    return true;
+}
+
+template <typename F>
+bool readJsonObject(JsonReader& r, string& err, F on_field) {
+    return readJsonObject(r, r.next(), err, on_field);
+}
+
+// 读取对象数组字段, 例如 models: [{...}, {...}]; bind_field(key, row) 绑定元素的一个字段, 出错信息带上下标
+template <typename Row, typename BindField>
+bool readJsonRows(JsonReader& r, const char* key, vector<Row>& out, string& err, BindField bind_field) {
+    JsonReader::Token t = r.next();
+    if (t == JsonReader::Token::Null) return true;
+    if (t != JsonReader::Token::BeginArray) {
+        if (t != JsonReader::Token::Error) err = string("字段 ") + key + " 必须是数组";
+        return false;
+    }
+    while ((t = r.next()) != JsonReader::Token::EndArray) {
+        out.emplace_back();
+        Row& row = out.back();
+        if (!readJsonObject(r, t, err, [&](string_view k) { return bind_field(k, row); })) {
+            if (err.empty()) err = "JSON 解析错误: " + r.error();
+            err = string(key) + "[" + to_string(out.size() - 1) + "]: " + err;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 跳过不认识的字段值
+bool skipJsonValue(JsonReader& r) {
+    return r.skipValue(r.next());
+}
+
+bool bindModel(JsonReader& r, ModelAddRequest& m, string& err) {
+    return readJsonObject(r, err, [&](string_view key) {
+        if (key == "model_name")  return readJsonString(r, "model_name", m.model_name, err);
+        if (key == "series_id")   return readJsonNumber(r, "series_id", m.series_id, err);
+        if (key == "price")       return readJsonNumber(r, "price", m.price, err);
+        if (key == "range_km")    return readJsonNumber(r, "range_km", m.range_km, err);
+        if (key == "energy_type") return readJsonString(r, "energy_type", m.energy_type, err);
+        if (key == "body_type")   return readJsonString(r, "body_type", m.body_type, err);
+        if (key == "seats")       return readJsonNumber(r, "seats", m.seats, err);
+        if (key == "launch_year") return readJsonString(r, "launch_year", m.launch_year, err);
+        if (key == "tech_ids")    return readJsonIntArray(r, "tech_ids", m.tech_ids, err);
+        return skipJsonValue(r);
+    });
+}
+
+bool bindTech(JsonReader& r, TechAddRequest& t, string& err) {
+    return readJsonObject(r, err, [&](string_view key) {
+        if (key == "tech_name") return readJsonString(r, "tech_name", t.tech_name, err);
+        if (key == "intro")     return readJsonString(r, "intro", t.intro, err);
+        return skipJsonValue(r);
+    });
+}
+
+// 解析完整请求体: 绑定后必须到达输入末尾
+template <typename T, typename Bind>
+bool parseRequestBody(const string& body, T& out, string& err, Bind bind) {
+    JsonReader r(body);
+    if (!bind(r, out, err)) return false;
+    if (r.next() != JsonReader::Token::End) {
+        err = "JSON 解析错误: " + r.error();
+        return false;
+    }
+    return true;
+}
+
+// =============================
+// 数据导出 / 导入 (NDJSON, CSV)
+// =============================
+
+// 导出/导入实体: models | series | techs | model_tech
+enum class Entity { Series, Techs, Models, ModelTech };
+
+bool parseEntity(const string& name, Entity& out) {
+    if (name == "series")     { out = Entity::Series;    return true; }
+    if (name == "techs")      { out = Entity::Techs;     return true; }
+    if (name == "models")     { out = Entity::Models;    return true; }
+    if (name == "model_tech") { out = Entity::ModelTech; return true; }
+    return false;
+}
+
+// CSV 字段: 含逗号/引号/换行时加引号, 内部引号加倍 (RFC 4180)
+void appendCsvField(string& out, const string& s) {
+    if (s.find_first_of(",\"\r\n") == string::npos) { out += s; return; }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// 各实体的 CSV 表头 (导入时必须与之一致) 与单行序列化
+const char* csvHeader(const Series*)    { return "series_id,series_name,intro"; }
+const char* csvHeader(const Tech*)      { return "tech_id,tech_name,intro"; }
+const char* csvHeader(const Model*)     { return "model_id,model_name,series_id,price,range_km,energy_type,body_type,seats,launch_year"; }
+const char* csvHeader(const ModelTech*) { return "model_id,tech_id"; }
+
+void appendNdjsonRow(string& out, const Series& s) {
+    out += "{\"series_id\":"; appendNumber(out, s.series_id);
+    out += ",\"series_name\":"; appendJsonString(out, s.series_name);
+    out += ",\"intro\":"; appendJsonString(out, s.intro);
+    out += "}\n";
+}
+
+void appendNdjsonRow(string& out, const Tech& t) {
+    out += "{\"tech_id\":"; appendNumber(out, t.tech_id);
+    out += ",\"tech_name\":"; appendJsonString(out, t.tech_name);
+    out += ",\"intro\":"; appendJsonString(out, t.intro);
+    out += "}\n";
+}
+
+void appendNdjsonRow(string& out, const Model& m) {
+    out += "{\"model_id\":"; appendNumber(out, m.model_id);
+    out += ",\"model_name\":"; appendJsonString(out, m.model_name);
+    out += ",\"series_id\":"; appendNumber(out, m.series_id);
+    out += ",\"price\":"; appendNumber(out, m.price);
+    out += ",\"range_km\":"; appendNumber(out, m.range_km);
+    out += ",\"energy_type\":"; appendJsonString(out, m.energy_type);
+    out += ",\"body_type\":"; appendJsonString(out, m.body_type);
+    out += ",\"seats\":"; appendNumber(out, m.seats);
+    out += ",\"launch_year\":"; appendJsonString(out, m.launch_year);
+    out += "}\n";
+}
+
+void appendNdjsonRow(string& out, const ModelTech& mt) {
+    out += "{\"model_id\":"; appendNumber(out, mt.model_id);
+    out += ",\"tech_id\":"; appendNumber(out, mt.tech_id);
+    out += "}\n";
+}
+
+void appendCsvRow(string& out, const Series& s) {
+    appendNumber(out, s.series_id); out += ',';
+    appendCsvField(out, s.series_name); out += ',';
+    appendCsvField(out, s.intro); out += '\n';
+}
+
+void appendCsvRow(string& out, const Tech& t) {
+    appendNumber(out, t.tech_id); out += ',';
+    appendCsvField(out, t.tech_name); out += ',';
+    appendCsvField(out, t.intro); out += '\n';
+}
+
+void appendCsvRow(string& out, const Model& m) {
+    appendNumber(out, m.model_id); out += ',';
+    appendCsvField(out, m.model_name); out += ',';
+    appendNumber(out, m.series_id); out += ',';
+    appendNumber(out, m.price); out += ',';
+    appendNumber(out, m.range_km); out += ',';
+    appendCsvField(out, m.energy_type); out += ',';
+    appendCsvField(out, m.body_type); out += ',';
+    appendNumber(out, m.seats); out += ',';
+    appendCsvField(out, m.launch_year); out += '\n';
+}
+
+void appendCsvRow(string& out, const ModelTech& mt) {
+    appendNumber(out, mt.model_id); out += ',';
+    appendNumber(out, mt.tech_id); out += '\n';
+}
+
+// 以分块方式从固定视图流式输出一个实体, 每块约 64KB; 游标逐行读取, 内存占用与数据量无关。
+// 视图随响应对象在同一工作线程中释放, 导出期间被取代的数据代要等导出结束才回收
+template <typename Row>
+void streamExport(httplib::Response& res, CarDataManager::ReadView view, bool csv) {
+    const size_t kChunkBytes = 64 * 1024;
+    auto cursor = make_shared<CarDataManager::ReadView::Cursor<Row>>(std::move(view));
+    bool header_done = !csv;
+    string buf;
+    res.set_chunked_content_provider(csv ? "text/csv; charset=utf-8" : "application/x-ndjson",
+        [=](size_t, httplib::DataSink& sink) mutable {
+            buf.clear();
+            if (!header_done) {
+                buf += csvHeader((const Row*)nullptr);
+                buf += '\n';
+                header_done = true;
+            }
+            const Row* row = nullptr;
+            while (buf.size() < kChunkBytes && (row = cursor->next())) {
+                if (csv) appendCsvRow(buf, *row);
+                else appendNdjsonRow(buf, *row);
+            }
+            TraceSpan span(g_tracer, "write");
+            if (!buf.empty() && !sink.write(buf.data(), buf.size())) return false;
+            if (!row) sink.done();
+            return true;
+        });
+}
+
+// NDJSON 行绑定: bindField 绑定对象的一个字段 (不认识的字段跳过), bindRow 绑定整个对象
+bool bindField(JsonReader& r, string_view key, Series& s, string& err) {
+    if (key == "series_id")   return readJsonNumber(r, "series_id", s.series_id, err);
+    if (key == "series_name") return readJsonString(r, "series_name", s.series_name, err);
+    if (key == "intro")       return readJsonString(r, "intro", s.intro, err);
+    return skipJsonValue(r);
+}
+
+bool bindField(JsonReader& r, string_view key, Tech& t, string& err) {
+    if (key == "tech_id")   return readJsonNumber(r, "tech_id", t.tech_id, err);
+    if (key == "tech_name") return readJsonString(r, "tech_name", t.tech_name, err);
+    if (key == "intro")     return readJsonString(r, "intro", t.intro, err);
+    return skipJsonValue(r);
+}
+
+bool bindField(JsonReader& r, string_view key, Model& m, string& err) {
+    if (key == "model_id")    return readJsonNumber(r, "model_id", m.model_id, err);
+    if (key == "model_name")  return readJsonString(r, "model_name", m.model_name, err);
+    if (key == "series_id")   return readJsonNumber(r, "series_id", m.series_id, err);
+    if (key == "price")       return readJsonNumber(r, "price", m.price, err);
+    if (key == "range_km")    return readJsonNumber(r, "range_km", m.range_km, err);
+    if (key == "energy_type") return readJsonString(r, "energy_type", m.energy_type, err);
+    if (key == "body_type")   return readJsonString(r, "body_type", m.body_type, err);
+    if (key == "seats")       return readJsonNumber(r, "seats", m.seats, err);
+    if (key == "launch_year") return readJsonString(r, "launch_year", m.launch_year, err);
+    return skipJsonValue(r);
+}
+
+bool bindField(JsonReader& r, string_view key, ModelTech& mt, string& err) {
+    if (key == "model_id") return readJsonNumber(r, "model_id", mt.model_id, err);
+    if (key == "tech_id")  return readJsonNumber(r, "tech_id", mt.tech_id, err);
+    return skipJsonValue(r);
+}
+
+template <typename Row>
+bool bindObject(JsonReader& r, Row& row, string& err) {
+    return readJsonObject(r, err, [&](string_view key) { return bindField(r, key, row, err); });
+}
+
+bool bindRow(JsonReader& r, Series& s, string& err)     { return bindObject(r, s, err); }
+bool bindRow(JsonReader& r, Tech& t, string& err)       { return bindObject(r, t, err); }
+bool bindRow(JsonReader& r, Model& m, string& err)      { return bindObject(r, m, err); }
+bool bindRow(JsonReader& r, ModelTech& mt, string& err) { return bindObject(r, mt, err); }
+
+// POST /api/bulk 请求体: {"series":[...], "techs":[...], "models":[...], "model_techs":[...]},
+// 各数组均可缺省; 车型对象可带 tech_ids, 与 addModel 一样随车型一起写入
+bool bindBulk(JsonReader& r, CarDataManager::BulkBatch& b, string& err) {
+    auto rows = [&](const char* key, auto& out) {
+        using Row = typename std::decay_t<decltype(out)>::value_type;
+        return readJsonRows(r, key, out, err, [&](string_view k, Row& row) { return bindField(r, k, row, err); });
+    };
+    bool ok = readJsonObject(r, err, [&](string_view key) {
+        if (key == "series")      return rows("series", b.series);
+        if (key == "techs")       return rows("techs", b.techs);
+        if (key == "model_techs") return rows("model_techs", b.model_techs);
+        if (key == "models") {
+            return readJsonRows(r, "models", b.models, err, [&](string_view k, Model& m) {
+                if (k != "tech_ids") return bindField(r, k, m, err);
+                b.model_tech_ids.resize(b.models.size());
+                return readJsonIntArray(r, "tech_ids", b.model_tech_ids.back(), err);
+            });
+        }
+        return skipJsonValue(r);
+    });
+    b.model_tech_ids.resize(b.models.size());
+    return ok;
+}
+
+// CSV 行绑定 (列顺序与 csvHeader 一致)
+bool csvInt(const string& v, const char* key, int& out, string& err) {
+    if (JsonReader::parseInt(v, out)) return true;
+    err = string("字段 ") + key + " 不是有效整数";
+    return false;
+}
+
+bool csvDouble(const string& v, const char* key, double& out, string& err) {
+    if (JsonReader::parseDouble(v, out) && std::isfinite(out)) return true;   // 同 readJsonNumber, 拒绝 nan / inf
+    err = string("字段 ") + key + " 不是有效数值";
+    return false;
+}
+
+bool bindCsvRow(const vector<string>& c, Series& s, string& err) {
+    if (c.size() != 3) { err = "列数应为 3"; return false; }
+    s.series_name = c[1];
+    s.intro = c[2];
+    return csvInt(c[0], "series_id", s.series_id, err);
+}
+
+bool bindCsvRow(const vector<string>& c, Tech& t, string& err) {
+    if (c.size() != 3) { err = "列数应为 3"; return false; }
+    t.tech_name = c[1];
+    t.intro = c[2];
+    return csvInt(c[0], "tech_id", t.tech_id, err);
+}
+
+bool bindCsvRow(const vector<string>& c, Model& m, string& err) {
+    if (c.size() != 9) { err = "列数应为 9"; return false; }
+    m.model_name = c[1];
+    m.energy_type = c[5];
+    m.body_type = c[6];
+    m.launch_year = c[8];
+    return csvInt(c[0], "model_id", m.model_id, err) &&
+           csvInt(c[2], "series_id", m.series_id, err) &&
+           csvDouble(c[3], "price", m.price, err) &&
+           csvDouble(c[4], "range_km", m.range_km, err) &&
+           csvInt(c[7], "seats", m.seats, err);
+}
+
+bool bindCsvRow(const vector<string>& c, ModelTech& mt, string& err) {
+    if (c.size() != 2) { err = "列数应为 2"; return false; }
+    return csvInt(c[0], "model_id", mt.model_id, err) &&
+           csvInt(c[1], "tech_id", mt.tech_id, err);
+}
+
+// 拆分一条 CSV 记录 (已去掉行尾换行); 引号内允许逗号与换行
+bool splitCsvRecord(string_view rec, vector<string>& cols, string& err) {
+    cols.clear();
+    size_t i = 0;
+    for (;;) {
+        cols.emplace_back();
+        string& col = cols.back();
+        if (i < rec.size() && rec[i] == '"') {
+            i++;
+            for (;;) {
+                if (i >= rec.size()) { err = "引号未闭合"; return false; }
+                if (rec[i] == '"') {
+                    if (i + 1 < rec.size() && rec[i + 1] == '"') { col += '"'; i += 2; continue; }
+                    i++;
+                    break;
+                }
+                col += rec[i++];
+            }
+            if (i < rec.size() && rec[i] != ',') { err = "引号后应为逗号"; return false; }
+        } else {
+            size_t comma = rec.find(',', i);
+            size_t end = comma == string_view::npos ? rec.size() : comma;
+            col.assign(rec.data() + i, end - i);
+            i = end;
+        }
+        if (i >= rec.size()) return true;
+        i++; // 跳过逗号
+    }
+}
+
+// 流式导入: 按行切分请求体, 每 kBatchRows 行一次加锁批量写入
+template <typename Row>
+class StreamImporter {
+public:
+    using Insert = bool (CarDataManager::*)(const Row&, string&);
+
+    StreamImporter(bool csv, Insert insert) : csv_(csv), insert_(insert) {
+        batch_.reserve(kBatchRows);
+    }
+
+    // 喂入请求体的一段数据; 完整的记录立即解析, 不完整的部分保留到下一段
+    bool feed(const char* data, size_t len) {
+        const char* p = data;
+        const char* end = data + len;
+        while (p < end) {
+            if (carry_.empty()) record_line_ = line_no_ + 1;
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+            if (!nl) { carry_.append(p, (size_t)(end - p)); break; }
+            line_no_++;
+
+            string_view rec;
+            if (carry_.empty()) {
+                rec = string_view(p, (size_t)(nl - p));
+            } else {
+                carry_.append(p, (size_t)(nl - p));
+                rec = carry_;
+            }
+            p = nl + 1;
+
+            // CSV 引号内的换行属于同一条记录
+            if (csv_ && quoteOpen(rec)) {
+                if (carry_.empty()) carry_.assign(rec.data(), rec.size());
+                carry_ += '\n';
+                continue;
+            }
+            onRecord(rec);
+            carry_.clear();
+        }
+        return true;
+    }
+
+    void finish() {
+        if (!carry_.empty()) { onRecord(carry_); carry_.clear(); }
+        flush();
+        sort(errors_.begin(), errors_.end());
+    }
+
+    size_t applied() const { return applied_; }
+    size_t rows() const { return rows_; }
+    const vector<pair<size_t, string>>& errors() const { return errors_; }
+    size_t errorCount() const { return error_count_; }
+
+private:
+    static const size_t kBatchRows = 8192;
+    static const size_t kMaxErrors = 100;   // 只保留前 100 条错误明细
+
+    bool csv_;
+    Insert insert_;
+    string carry_;
+    size_t line_no_ = 0;        // 已消费的物理行数
+    size_t record_line_ = 0;    // 当前记录起始行号 (错误信息用)
+    size_t rows_ = 0;
+    size_t applied_ = 0;
+    size_t error_count_ = 0;
+    bool header_seen_ = false;
+    vector<string> cols_;
+    vector<pair<size_t, Row>> batch_;
+    vector<pair<size_t, string>> errors_;
+
+    static bool quoteOpen(string_view s) {
+        return count(s.begin(), s.end(), '"') % 2 == 1;
+    }
+
+    void addError(size_t line, const string& err) {
+        error_count_++;
+        if (errors_.size() < kMaxErrors) errors_.emplace_back(line, err);
+    }
+
+    void onRecord(string_view rec) {
+        if (!rec.empty() && rec.back() == '\r') rec.remove_suffix(1);
+        if (rec.empty()) return;
+
+        string err;
+        if (csv_ && !header_seen_) {
+            header_seen_ = true;
+            if (rec != csvHeader((const Row*)nullptr)) {
+                addError(record_line_, string("CSV 表头应为: ") + csvHeader((const Row*)nullptr));
+            }
+            return;
+        }
+
+        Row row{};
+        bool ok;
+        if (csv_) {
+            ok = splitCsvRecord(rec, cols_, err) && bindCsvRow(cols_, row, err);
+        } else {
+            JsonReader r(rec);
+            ok = bindRow(r, row, err);
+            if (ok && r.next() != JsonReader::Token::End) { err = "JSON 解析错误: " + r.error(); ok = false; }
+        }
+        rows_++;
+        if (!ok) { addError(record_line_, err); return; }
+
+        batch_.emplace_back(record_line_, std::move(row));
+        if (batch_.size() >= kBatchRows) flush();
+    }
+
+    void flush() {
+        if (batch_.empty()) return;
+        vector<pair<size_t, string>> errs;
+        applied_ += g_manager.importBatch(batch_, insert_, errs);
+        for (auto& e : errs) addError(e.first, e.second);
+        batch_.clear();
+    }
+};
+
+template <typename Row>
+void runImport(const httplib::ContentReader& reader, httplib::Response& res, bool csv,
+               typename StreamImporter<Row>::Insert insert) {
+    StreamImporter<Row> importer(csv, insert);
+    reader([&](const char* data, size_t len) { return importer.feed(data, len); });
+    importer.finish();
+
+    string out = "{\"ok\":true,\"rows\":";
+    appendNumber(out, importer.rows());
+    out += ",\"applied\":";
+    appendNumber(out, importer.applied());
+    out += ",\"error_count\":";
+    appendNumber(out, importer.errorCount());
+    out += ",\"errors\":[";
+    bool first = true;
+    for (const auto& e : importer.errors()) {
+        if (!first) out += ',';
+        out += "{\"line\":";
+        appendNumber(out, e.first);
+        out += ",\"message\":";
+        appendJsonString(out, e.second);
+        out += '}';
+        first = false;
+    }
+    out += "]}";
+    res.set_content(out, "application/json");
+}
+
+// =============================
+// 启动参数
+// =============================
+struct ServerOptions {
+    WalSyncPolicy wal_sync = WalSyncPolicy::Always;
+    int wal_sync_interval_ms = 100;
+    bool wal_ack_durable = true;                // false: 写入内存即返回, 由后台组提交落盘
+    unsigned load_threads = std::thread::hardware_concurrency();
+    uint64_t wal_compact_bytes = 8ull << 20;    // WAL 超过该大小时后台压缩
+    bool watch_data = true;                     // 数据文件被修改后自动重新加载
+    bool watch_web = true;                      // web/ 目录中的文件变化后重新读入静态资源缓存
+    int version_window_sec = 600;               // 历史版本的保留窗口
+    string convert_input;                       // 非空时只做数据文件格式转换, 完成后退出
+    string convert_to;                          // web / cli / snapshot / columnar
+    string convert_output;
+    bool snapshot_verify_full = true;           // 加载快照时校验全部段数据
+    bool verify = false;                        // 只检查数据文件, 完成后退出
+    bool recover = false;                       // 从最新的有效数据源恢复, 完成后退出
+    unsigned threads = CPPHTTPLIB_THREAD_POOL_COUNT;    // HTTP 工作线程数
+    bool stock_pool = false;                    // 使用 httplib 自带的 ThreadPool (对比用)
+    size_t max_queued = 4096;                   // 等待工作线程的连接数上限
+    int queue_wait_ms = 1000;                   // 连接排队超过该时间后直接返回 503
+    bool admission = true;                      // 高开销接口单独限流
+    int expensive_limit = 0;                    // 高开销接口的最大并发, 0 表示按线程数自动取值
+    int expensive_queue = 0;                    // 高开销接口超过并发上限时的排队数, 0 表示上限的 2 倍
+    int expensive_wait_ms = 50;                 // 高开销接口的最长排队时间
+    bool epoll = false;                         // 事件驱动模式: I/O 线程复用空闲连接, 工作线程只处理请求
+    unsigned io_threads = std::max(1u, std::thread::hardware_concurrency() / 4);
+    int keep_alive_sec = CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND;  // 空闲 keep-alive 连接的保持时间
+    string access_log;                          // 访问日志文件, 空表示不记录
+    int access_log_mb = 64;                     // 访问日志超过该大小时轮转
+    int access_log_keep = 5;                    // 保留的历史访问日志文件数
+    int workers = 0;                            // 多进程模式的工作进程数, 0 表示单进程
+    int worker_drain_sec = 30;                  // 旧工作进程排空的最长时间
+    int worker_slot = -1;                       // 以下由主进程传给工作进程 (--worker=<槽位>,<监听描述符>,<就绪描述符>)
+    int worker_listen_fd = -1;
+    int worker_ready_fd = -1;
+    int trace_sample = 0;                       // 每 N 个请求追踪 1 个, 0 表示关闭
+};
+
+void printUsage(const char* prog) {
+    cout << "Usage: " << prog << " [options]\n"
+         << "  --wal-sync=always|interval|none   WAL 刷盘策略 (默认 always)\n"
+         << "  --wal-sync-interval-ms=N          interval 策略的刷盘间隔 (默认 100)\n"
+         << "  --wal-ack=durable|async           写请求在 WAL 提交后 / 入队后即返回 (默认 durable)\n"
+         << "  --load-threads=N                  文本数据文件的并行加载线程数 (默认 CPU 核数)\n"
+         << "  --wal-compact-mb=N                WAL 超过 N MB 时压缩为新快照 (默认 8)\n"
+         << "  --watch-data=on|off               数据文件被修改后自动重新加载 (默认 on)\n"
+         << "  --watch-web=on|off                web/ 目录中的文件变化后重新读入静态资源 (默认 on)\n"
+         << "  --version-window-sec=N            历史版本保留 N 秒, 可用 as_of_version/as_of_time 查询 (默认 600)\n"
+         << "  --convert=FILE --to=web|cli|snapshot|columnar --output=FILE\n"
+         << "                                    把任一布局的文本数据文件转换为 Web / CLI 布局、二进制快照或压缩列式文件后退出;\n"
+         << "                                    列式文件可转换为二进制快照\n"
+         << "  --snapshot-verify=full|quick      启动时校验快照全部数据 / 只校验文件头、段表与文件尾 (默认 full)\n"
+         << "  --verify                          检查数据文件、快照槽位与 WAL 后退出, 有损坏时返回 1\n"
+         << "  --recover                         从最新的有效快照或数据文件回放 WAL, 重写数据文件与快照后退出\n"
+         << "  --threads=N                       HTTP 工作线程数 (默认 " << CPPHTTPLIB_THREAD_POOL_COUNT << ")\n"
+         << "  --task-queue=steal|pool           无锁环形队列 + 工作窃取 / httplib 自带线程池 (默认 steal)\n"
+         << "  --max-queued=N                    等待处理的连接数上限 (默认 4096)\n"
+         << "  --queue-wait-ms=N                 连接排队超过 N ms 时直接返回 503 (默认 1000, 0 不限)\n"
+         << "  --admission=on|off                图数据/搜索/批量写入/导入接口按耗时自适应限流 (默认 on)\n"
+         << "  --expensive-limit=N               上述接口的最大并发 (默认工作线程数的 1/4, 至少 1)\n"
+         << "  --expensive-queue=N               超过并发上限时的排队数 (默认并发上限的 2 倍)\n"
+         << "  --expensive-wait-ms=N             排队的最长等待时间, 超时返回 503 (默认 50)\n"
+         << "  --io-mode=blocking|epoll          每个连接占用一个工作线程 / epoll 复用连接, 工作线程只处理请求 (默认 blocking, epoll 仅 Linux)\n"
+         << "  --io-threads=N                    epoll 模式的 I/O 线程数 (默认 CPU 核数的 1/4, 至少 1)\n"
+         << "  --keep-alive-sec=N                空闲 keep-alive 连接的保持时间 (默认 " << CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND << ")\n"
+         << "  --access-log=FILE                 异步写入 JSON Lines 访问日志 (默认不记录)\n"
+         << "  --access-log-mb=N                 访问日志超过 N MB 时轮转为 FILE.1 ... (默认 64)\n"
+         << "  --access-log-keep=N               保留的历史访问日志数 (默认 5)\n"
+         << "  --workers=N                       多进程模式: N 个只读工作进程以 SO_REUSEPORT 共享端口, SIGHUP 滚动重启 (仅 Linux)\n"
+         << "  --worker-drain-sec=N              滚动重启与停止时旧工作进程的最长排空时间 (默认 30)\n"
+         << "  --trace-sample=N                  每 N 个请求记录 1 个的分阶段耗时, 从 /debug/trace 导出 (默认 0 不记录)\n";
+}
+
+// --worker=<槽位>,<监听描述符>,<就绪描述符>: 只由主进程在启动工作进程时传入
+bool parseWorkerArg(const string& val, ServerOptions& opt) {
+    size_t a = val.find(',');
+    size_t b = a == string::npos ? a : val.find(',', a + 1);
+    if (b == string::npos) return false;
+    return JsonReader::parseInt(string_view(val).substr(0, a), opt.worker_slot) && opt.worker_slot >= 0 &&
+           JsonReader::parseInt(string_view(val).substr(a + 1, b - a - 1), opt.worker_listen_fd) && opt.worker_listen_fd >= 0 &&
+           JsonReader::parseInt(string_view(val).substr(b + 1), opt.worker_ready_fd) && opt.worker_ready_fd >= 0;
+}
+
+bool parseOptions(int argc, char** argv, ServerOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string val = eq == string::npos ? "" : arg.substr(eq + 1);
+        int n = 0;
+        if (key == "--wal-sync" && val == "always") opt.wal_sync = WalSyncPolicy::Always;
+        else if (key == "--wal-sync" && val == "interval") opt.wal_sync = WalSyncPolicy::Interval;
+        else if (key == "--wal-sync" && val == "none") opt.wal_sync = WalSyncPolicy::None;
+        else if (key == "--wal-ack" && val == "durable") opt.wal_ack_durable = true;
+        else if (key == "--wal-ack" && val == "async") opt.wal_ack_durable = false;
+        else if (key == "--wal-sync-interval-ms" && JsonReader::parseInt(val, n) && n > 0) opt.wal_sync_interval_ms = n;
+        else if (key == "--load-threads" && JsonReader::parseInt(val, n) && n > 0) opt.load_threads = (unsigned)n;
+        else if (key == "--wal-compact-mb" && JsonReader::parseInt(val, n) && n > 0) opt.wal_compact_bytes = (uint64_t)n << 20;
+        else if (key == "--watch-data" && val == "on") opt.watch_data = true;
+        else if (key == "--watch-data" && val == "off") opt.watch_data = false;
+        else if (key == "--watch-web" && val == "on") opt.watch_web = true;
+        else if (key == "--watch-web" && val == "off") opt.watch_web = false;
+        else if (key == "--version-window-sec" && JsonReader::parseInt(val, n) && n >= 0) opt.version_window_sec = n;
+        else if (key == "--convert" && !val.empty()) opt.convert_input = val;
+        else if (key == "--to" && (val == "web" || val == "cli" || val == "snapshot" || val == "columnar")) opt.convert_to = val;
+        else if (key == "--output" && !val.empty()) opt.convert_output = val;
+        else if (key == "--snapshot-verify" && val == "full") opt.snapshot_verify_full = true;
+        else if (key == "--snapshot-verify" && val == "quick") opt.snapshot_verify_full = false;
+        else if (arg == "--verify") opt.verify = true;
+        else if (arg == "--recover") opt.recover = true;
+        else if (key == "--threads" && JsonReader::parseInt(val, n) && n > 0) opt.threads = (unsigned)n;
+        else if (key == "--task-queue" && val == "steal") opt.stock_pool = false;
+        else if (key == "--task-queue" && val == "pool") opt.stock_pool = true;
+        else if (key == "--max-queued" && JsonReader::parseInt(val, n) && n > 0) opt.max_queued = (size_t)n;
+        else if (key == "--queue-wait-ms" && JsonReader::parseInt(val, n) && n >= 0) opt.queue_wait_ms = n;
+        else if (key == "--admission" && val == "on") opt.admission = true;
+        else if (key == "--admission" && val == "off") opt.admission = false;
+        else if (key == "--expensive-limit" && JsonReader::parseInt(val, n) && n > 0) opt.expensive_limit = n;
+        else if (key == "--expensive-queue" && JsonReader::parseInt(val, n) && n >= 0) opt.expensive_queue = n;
+        else if (key == "--expensive-wait-ms" && JsonReader::parseInt(val, n) && n >= 0) opt.expensive_wait_ms = n;
+        else if (key == "--io-mode" && val == "blocking") opt.epoll = false;
+        else if (key == "--io-mode" && val == "epoll" && EpollServer::supported()) opt.epoll = true;
+        else if (key == "--io-threads" && JsonReader::parseInt(val, n) && n > 0) opt.io_threads = (unsigned)n;
+        else if (key == "--keep-alive-sec" && JsonReader::parseInt(val, n) && n > 0) opt.keep_alive_sec = n;
+        else if (key == "--access-log" && !val.empty()) opt.access_log = val;
+        else if (key == "--access-log-mb" && JsonReader::parseInt(val, n) && n > 0) opt.access_log_mb = n;
+        else if (key == "--access-log-keep" && JsonReader::parseInt(val, n) && n > 0) opt.access_log_keep = n;
+        else if (key == "--workers" && JsonReader::parseInt(val, n) && n > 0 && n <= 256 && Supervisor::supported()) opt.workers = n;
+        else if (key == "--worker-drain-sec" && JsonReader::parseInt(val, n) && n > 0) opt.worker_drain_sec = n;
+        else if (key == "--worker" && parseWorkerArg(val, opt)) {}
+        else if (key == "--trace-sample" && JsonReader::parseInt(val, n) && n >= 0) opt.trace_sample = n;
+        else {
+            if (key != "--help") cerr << "Invalid option: " << arg << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!opt.convert_input.empty() && (opt.convert_to.empty() || opt.convert_output.empty())) {
+        cerr << "--convert requires --to and --output" << endl;
+        printUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+// --convert: 文本数据文件在 Web / CLI 布局之间转换, 或生成二进制快照 / 压缩列式文件;
+// 列式文件可以转换为二进制快照
+int runConvert(const ServerOptions& opt) {
+    auto t0 = std::chrono::steady_clock::now();
+    TextDataLoader loader;
+    ConvertResult result;
+    ColumnarStats columnar;
+    uint64_t bytes_read = 0;
+    string err;
+    bool ok;
+    if (isColumnarFile(opt.convert_input)) {
+        SnapshotBuilder b;
+        if (opt.convert_to != "snapshot") {
+            err = "列式文件只能转换为 snapshot";
+            ok = false;
+        } else {
+            ok = readColumnarFile(opt.convert_input, b, columnar, err) &&
+                 b.write(opt.convert_output, columnar.wal_lsn, 1, err);
+        }
+        result.series = columnar.series;
+        result.techs = columnar.techs;
+        result.models = columnar.models;
+        result.model_techs = columnar.model_techs;
+        bytes_read = columnar.bytes;
+    } else if (opt.convert_to == "snapshot" || opt.convert_to == "columnar") {
+        // 按服务端的加载规则建表 (主键/名称重复的行跳过), 与启动时生成的快照相同
+        CarDataSet set;
+        ok = set.loadText(opt.convert_input, opt.load_threads, loader, err);
+        if (ok) {
+            auto snap = CarDataManager::buildSnapshot(set);
+            result.series = snap->series.size();
+            result.techs = snap->techs.size();
+            result.models = snap->models.size();
+            result.model_techs = snap->model_techs.size();
+            if (opt.convert_to == "snapshot") {
+                ok = CarDataManager::writeBinarySnapshot(*snap, opt.convert_output, loader.walLsn(), 1, err);
+            } else {
+                // 先在内存中生成快照映像 (排序、索引与服务端一致), 再按列编码
+                SnapshotBuilder b;
+                CarDataManager::fillSnapshotBuilder(*snap, b);
+                snap.reset();
+                string image;
+                MappedSnapshot image_view;
+                ok = b.build(image, loader.walLsn(), 1, err) &&
+                     image_view.openImage(std::move(image), opt.convert_input, err) &&
+                     writeColumnarFile(image_view, opt.convert_output, columnar, err);
+                result.bytes_out = columnar.bytes;
+            }
+        }
+        bytes_read = loader.bytes();
+    } else {
+        DataLayout to = opt.convert_to == "cli" ? DataLayout::Cli : DataLayout::Web;
+        ok = convertDataFile(opt.convert_input, opt.convert_output, to, opt.load_threads, loader, result, err);
+        bytes_read = loader.bytes();
+    }
+    if (loader.errorCount() > 0) {
+        cerr << "Warning: " << loader.errorCount() << " line(s) skipped in " << opt.convert_input << endl;
+        for (const auto& e : CarDataManager::sortedErrors(loader)) cerr << "  line " << e.line << ": " << e.message << endl;
+    }
+    if (!ok) {
+        cerr << "Convert failed: " << err << endl;
+        return 1;
+    }
+    if (result.orphan_links > 0) {
+        cerr << "Warning: " << result.orphan_links << " model-tech link(s) reference models not in the file, dropped" << endl;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    cout << "Converted " << opt.convert_input << " -> " << opt.convert_output << " (" << opt.convert_to << "): "
+         << result.series << " series, " << result.techs << " techs, " << result.models << " models, "
+         << result.model_techs << " model-tech links, " << bytes_read << " bytes read in " << ms << " ms" << endl;
+    if (opt.convert_to == "columnar") {
+        cout << "Columnar file: " << columnar.bytes << " bytes, " << columnar.row_groups << " model row groups" << endl;
+    }
+    return 0;
+}
+
+// --workers: 主进程整理数据并持有监听套接字, 请求由只读的工作进程处理 (见 supervisor.h)。
+// SIGHUP 时重新整理数据 (拾取修改过的数据文件) 并滚动重启工作进程
+int runSupervisor(const ServerOptions& opt, int argc, char** argv) {
+    string err;
+    if (!g_manager.prepareSharedSnapshot(err)) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+    Supervisor::Options sup_opt;
+    sup_opt.workers = opt.workers;
+    sup_opt.drain_timeout_ms = opt.worker_drain_sec * 1000;
+    Supervisor supervisor;
+    if (!supervisor.listen(sup_opt, 8080, err)) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--workers=", 10) != 0) args.push_back(argv[i]);
+    }
+    cout << "Supervisor listening on http://localhost:8080 with " << opt.workers
+         << " workers. Send SIGHUP for a rolling restart, SIGTERM to stop." << endl;
+    return supervisor.run(args, []() {
+        string e;
+        if (g_manager.prepareSharedSnapshot(e)) return true;
+        cerr << "Error: " << e << endl;
+        return false;
+    });
+}
+
+EpollServer* g_server = nullptr;
+bool g_epoll_mode = false;
+bool g_replica = false;     // --workers 的工作进程: 只读, 拒绝写请求
+WorkStealingQueue* g_task_queue = nullptr;      // --task-queue=pool 时为空
 
-    vector<ModelDetail> getAllModels(int filter_series_id = -1, const string& filter_energy = "") {
-        std::lock_guard<std::mutex> lk(mtx_);
-        vector<ModelDetail> result;
+// =============================
+// 相同请求合并: 同一数据版本上的相同查询同时到达时只计算一次, 共享响应体
+// =============================
 
-        for (const auto& p : models_table) {
-            const Model& m = p.second;
+SingleFlight g_coalescer;
+
+// 路径 + 参数 (httplib 按参数名排序, 与参数顺序无关) + 数据版本; 参数带长度前缀, 不会拼接出相同的键
+string coalesceKey(const httplib::Request& req, uint64_t version) {
+    string key = req.path;
+    for (const auto& p : req.params) {
+        key += '|';
+        key += to_string(p.first.size());
+        key += ':';
+        key += p.first;
+        key += to_string(p.second.size());
+        key += ':';
+        key += p.second;
+    }
+    key += '@';
+    key += to_string(version);
+    return key;
+}
 
-            // 系列筛选
-            if (filter_series_id > 0 && m.series_id != filter_series_id) continue;
-            // 能源类型筛选
-            if (!filter_energy.empty() && m.energy_type != filter_energy) continue;
+// 共享的响应体直接写出, 不复制到 res.body
+void setSharedContent(httplib::Response& res, const SingleFlight::Result& body) {
+    res.set_content_provider(body->size(), "application/json",
+                             [body](size_t offset, size_t length, httplib::DataSink& sink) {
+                                 TraceSpan span(g_tracer, "write");
+                                 return sink.write(body->data() + offset, length);
+                             });
+}
 
-            ModelDetail detail;
-            detail.model = m;
-            detail.series_name = series_table.count(m.series_id) ? series_table.at(m.series_id).series_name : "";
+// =============================
+// 准入控制: 路由前申请, 写出响应前释放
+// =============================
 
-            // 获取关联技术
-            for (const auto& mt : model_tech_table) {
-                if (mt.model_id == m.model_id && techs_table.count(mt.tech_id)) {
-                    detail.tech_names.push_back(techs_table.at(mt.tech_id).tech_name);
-                }
-            }
-            result.push_back(detail);
-        }
+AdmissionControl g_admission;
 
-        // 按价格排序
-        sort(result.begin(), result.end(), [](const ModelDetail& a, const ModelDetail& b) {
-            return a.model.price < b.model.price;
-        });
+// 工作线程同一时刻只处理一个请求, 准入票据放在线程局部变量中
+struct AdmissionTicket {
+    AdaptiveLimiter* limiter = nullptr;
+    bool joined = false;            // 合并到正在进行的相同计算, 未占用 limiter
+    std::chrono::steady_clock::time_point start;
+};
+thread_local AdmissionTicket t_ticket;
 
-        return result;
+void finishRequest() {
+    t_request_view = CarDataManager::ReadView();
+    if (t_ticket.joined) {
+        g_admission.leave();
+        t_ticket.joined = false;
     }
+    if (!t_ticket.limiter) return;
+    auto elapsed = std::chrono::steady_clock::now() - t_ticket.start;
+    t_ticket.limiter->release(std::chrono::duration<double, std::milli>(elapsed).count());
+    t_ticket.limiter = nullptr;
+}
 
-    // 获取单个车型详情
-    ModelDetail getModelDetail(int model_id) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        ModelDetail detail;
-        
-        if (!models_table.count(model_id)) return detail;
-        
-        const Model& m = models_table.at(model_id);
-        detail.model = m;
-        detail.series_name = series_table.count(m.series_id) ? series_table.at(m.series_id).series_name : "";
+void rejectOverloaded(httplib::Response& res) {
+    res.status = 503;
+    res.set_header("Retry-After", "1");
+    res.set_content("{\"ok\":false,\"message\":\"服务繁忙, 请稍后重试\"}", "application/json");
+}
 
-        for (const auto& mt : model_tech_table) {
-            if (mt.model_id == m.model_id && techs_table.count(mt.tech_id)) {
-                detail.tech_names.push_back(techs_table.at(mt.tech_id).tech_name);
-            }
-        }
-        return detail;
+// 返回 false 时已写好 503 响应
+bool admitRequest(const httplib::Request& req, httplib::Response& res) {
+    finishRequest();    // 上一个请求没有经过 post-routing 时补上释放
+    if (WorkStealingQueue::shedding()) {
+        g_admission.countShed();
+        rejectOverloaded(res);
+        return false;
+    }
+    AdaptiveLimiter* limiter = g_admission.limiterFor(AdmissionControl::classify(req.path));
+    if (!limiter) return true;
+    // 相同的查询正在计算时只需等待它的结果, 不占用高开销请求的并发名额。
+    // 键中的版本与处理函数一致: 视图在这里按 as_of 参数打开一次, 交给处理函数使用
+    string err;
+    if (req.method == "GET" && openReadView(req, t_request_view, err) &&
+        g_coalescer.inflight(coalesceKey(req, t_request_view.version())) && g_admission.tryJoin()) {
+        t_ticket.joined = true;
+        return true;
+    }
+    if (!limiter->acquire()) {
+        rejectOverloaded(res);
+        return false;
     }
+    t_ticket.limiter = limiter;
+    t_ticket.start = std::chrono::steady_clock::now();
+    return true;
+}
+
+// =============================
+// 运行指标与访问日志: 路由前记下开始时间, 写出响应头前按 (路由, 状态码) 记录耗时并写入访问日志
+// =============================
 
-    // 搜索车型
-    vector<ModelDetail> searchModels(const string& keyword) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        vector<ModelDetail> result;
+thread_local std::chrono::steady_clock::time_point t_request_start;
+AccessLog g_access_log;
 
-        for (const auto& p : models_table) {
-            const Model& m = p.second;
-            
-            // 名称匹配
-            bool match = m.model_name.find(keyword) != string::npos;
-            
-            // 系列名匹配
-            if (!match && series_table.count(m.series_id)) {
-                match = series_table.at(m.series_id).series_name.find(keyword) != string::npos;
-            }
-            
-            // 技术名匹配
-            if (!match) {
-                for (const auto& mt : model_tech_table) {
-                    if (mt.model_id == m.model_id && techs_table.count(mt.tech_id)) {
-                        if (techs_table.at(mt.tech_id).tech_name.find(keyword) != string::npos) {
-                            match = true;
-                            break;
-                        }
-                    }
-                }
-            }
+void beginRequest() {
+    t_request_start = std::chrono::steady_clock::now();
+    t_rows_scanned = 0;
+    g_tracer.beginRequest();
+}
 
-            if (match) {
-                ModelDetail detail;
-                detail.model = m;
-                detail.series_name = series_table.count(m.series_id) ? series_table.at(m.series_id).series_name : "";
-                for (const auto& mt : model_tech_table) {
-                    if (mt.model_id == m.model_id && techs_table.count(mt.tech_id)) {
-                        detail.tech_names.push_back(techs_table.at(mt.tech_id).tech_name);
-                    }
-                }
-                result.push_back(detail);
-            }
-        }
-        return result;
-    }
+// 放入本线程的日志缓冲, 格式化与写文件由后台线程完成
+void logAccess(const httplib::Request& req, const httplib::Response& res, const string& route, uint64_t latency_ns) {
+    AccessRecord* r = g_access_log.reserve();
+    if (!r) return;
+    r->time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    r->latency_ns = latency_ns;
+    r->bytes = res.body.empty() ? res.content_length_ : res.body.size();
+    r->rows = t_rows_scanned;
+    r->status = (uint16_t)res.status;
+    AccessRecord::copy(r->method, sizeof(r->method), req.method);
+    AccessRecord::copy(r->remote, sizeof(r->remote), req.remote_addr);
+    AccessRecord::copy(r->route, sizeof(r->route), route);
+    AccessRecord::copy(r->path, sizeof(r->path), req.path);
+    size_t q = req.target.find('?');
+    if (q == string::npos) r->params[0] = '\0';
+    else AccessRecord::copy(r->params, sizeof(r->params), req.target.data() + q + 1, req.target.size() - q - 1);
+    g_access_log.commit();
+}
 
-    // 获取统计信息
-    void getStats(int& series_count, int& model_count, int& tech_count) {
-        std::lock_guard<std::mutex> lk(mtx_);
-        series_count = series_table.size();
-        model_count = models_table.size();
-        tech_count = techs_table.size();
+void recordRequest(const httplib::Request& req, const httplib::Response& res) {
+    // 请求行解析失败等没有经过 pre-routing 的响应不计耗时
+    if (t_request_start == std::chrono::steady_clock::time_point()) return;
+    auto elapsed = std::chrono::steady_clock::now() - t_request_start;
+    t_request_start = std::chrono::steady_clock::time_point();
+    // 标签用路由模式: 路由前就已返回的请求 (静态文件、503) 没有路由模式, 用固定的几个名字, 避免原始路径撑大标签数
+    static const string kStatic = "static", kUnrouted = "unrouted";
+    const string* route = &req.matched_route;
+    if (route->empty()) {
+        if (req.path.compare(0, 5, "/api/") != 0) route = &kStatic;
+        else if (AdmissionControl::classify(req.path) == AdmissionControl::kExpensive) route = &req.path;
+        else route = &kUnrouted;
     }
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    g_metrics.recordRequest(g_metrics.route(*route), res.status, ns);
+    if (g_access_log.enabled()) logAccess(req, res, *route, ns);
+}
 
-    // -------------------------
-    // 从文件加载数据
-    // -------------------------
-    bool loadData() {
-        ifstream file(DATA_FILE);
-        if (!file.is_open()) {
-            cerr << "Warning: Cannot open data file " << DATA_FILE << endl;
-            return false;
-        }
-        
-        // 清空现有数据
-        series_table.clear();
-        models_table.clear();
-        techs_table.clear();
-        model_tech_table.clear();
-        series_names.clear();
-        model_names.clear();
-        tech_names.clear();
-        model_tech_pairs.clear();
-        next_mt_id = 1;
-        
-        string line;
-        string currentSection;
-        
-        while (getline(file, line)) {
-            line = trim(line);
-            if (line.empty() || line[0] == '#') continue;
-            
-            if (line == "[SERIES]") {
-                currentSection = "SERIES";
-                continue;
-            } else if (line == "[TECH]") {
-                currentSection = "TECH";
-                continue;
-            } else if (line == "[MODEL]") {
-                currentSection = "MODEL";
-                continue;
-            } else if (line == "[MODEL_TECH]") {
-                currentSection = "MODEL_TECH";
-                continue;
-            }
-            
-            vector<string> parts = splitStr(line, ',');
-            
-            if (currentSection == "SERIES" && parts.size() >= 3) {
-                int id = stoi(parts[0]);
-                series_table[id] = { id, parts[1], parts[2] };
-                series_names.insert(parts[1]);
-            }
-            else if (currentSection == "TECH" && parts.size() >= 3) {
-                int id = stoi(parts[0]);
-                techs_table[id] = { id, parts[1], parts[2] };
-                tech_names.insert(parts[1]);
-            }
-            else if (currentSection == "MODEL" && parts.size() >= 9) {
-                int id = stoi(parts[0]);
-                Model m;
-                m.model_id = id;
-                m.model_name = parts[1];
-                m.series_id = stoi(parts[2]);
-                m.price = stod(parts[3]);
-                m.range_km = stod(parts[4]);
-                m.energy_type = parts[5];
-                m.body_type = parts[6];
-                m.seats = stoi(parts[7]);
-                m.launch_year = parts[8];
-                models_table[id] = m;
-                model_names.insert(parts[1]);
-            }
-            else if (currentSection == "MODEL_TECH" && parts.size() >= 2) {
-                int model_id = stoi(parts[0]);
-                int tech_id = stoi(parts[1]);
-                string pair_key = to_string(model_id) + "_" + to_string(tech_id);
-                if (!model_tech_pairs.count(pair_key)) {
-                    model_tech_table.push_back({ next_mt_id++, model_id, tech_id });
-                    model_tech_pairs.insert(pair_key);
-                }
-            }
-        }
-        
-        file.close();
-        return true;
+string renderMetrics() {
+    string out;
+    g_metrics.render(out);
+    using M = MetricsRegistry;
+
+    CarDataManager::ReadView view = g_manager.latestView();
+    int s_cnt, m_cnt, t_cnt;
+    view.getStats(s_cnt, m_cnt, t_cnt);
+    M::writeMetric(out, "byd_dataset_rows", "gauge", "Rows visible in the latest dataset version.", s_cnt,
+                   "entity=\"series\"");
+    M::writeMetric(out, "byd_dataset_rows", "gauge", nullptr, m_cnt, "entity=\"models\"");
+    M::writeMetric(out, "byd_dataset_rows", "gauge", nullptr, t_cnt, "entity=\"techs\"");
+    M::writeMetric(out, "byd_dataset_version", "gauge", "Latest committed dataset version.", (double)view.version());
+
+    SingleFlight::Stats sf = g_coalescer.stats();
+    M::writeMetric(out, "byd_cache_requests_total", "counter",
+                   "Lookups by cache and result (coalesce: hit = shared an in-flight result).", (double)sf.coalesced,
+                   "cache=\"coalesce\",result=\"hit\"");
+    M::writeMetric(out, "byd_cache_requests_total", "counter", nullptr, (double)sf.computed,
+                   "cache=\"coalesce\",result=\"miss\"");
+
+    if (g_task_queue) {
+        M::writeMetric(out, "byd_task_queue_depth", "gauge", "Connections queued for a worker thread.",
+                       (double)g_task_queue->queued());
+        M::writeMetric(out, "byd_task_queue_stolen_total", "counter", "Tasks taken from another worker's queue.",
+                       (double)g_task_queue->stolen());
     }
-    
-    // -------------------------
-    // 保存数据到文件
-    // -------------------------
-    bool saveData() {
-        ofstream file(DATA_FILE);
-        if (!file.is_open()) {
-            cerr << "Error: Cannot write to data file " << DATA_FILE << endl;
-            return false;
-        }
-        
-        file << "# BYD汽车信息系统 - Web版本数据文件\n";
-        file << "# 格式说明：\n";
-        file << "# [SERIES] 系列数据: id,名称,简介\n";
-        file << "# [TECH] 技术数据: id,名称,简介\n";
-        file << "# [MODEL] 车型数据: id,名称,系列id,价格,续航,能源类型,车身类型,座位数,年份\n";
-        file << "# [MODEL_TECH] 车型技术关联: 车型id,技术id\n\n";
-        
-        // 写入系列数据
-        file << "[SERIES]\n";
-        for (const auto& p : series_table) {
-            const Series& s = p.second;
-            file << s.series_id << "," << s.series_name << "," << s.intro << "\n";
-        }
-        file << "\n";
-        
-        // 写入技术数据
-        file << "[TECH]\n";
-        for (const auto& p : techs_table) {
-            const Tech& t = p.second;
-            file << t.tech_id << "," << t.tech_name << "," << t.intro << "\n";
-        }
-        file << "\n";
-        
-        // 写入车型数据
-        file << "[MODEL]\n";
-        for (const auto& p : models_table) {
-            const Model& m = p.second;
-            file << m.model_id << "," << m.model_name << "," << m.series_id << ","
-                 << fixed << setprecision(2) << m.price << ","
-                 << (int)m.range_km << "," << m.energy_type << ","
-                 << m.body_type << "," << m.seats << "," << m.launch_year << "\n";
-        }
-        file << "\n";
-        
-        // 写入车型技术关联
-        file << "[MODEL_TECH]\n";
-        for (const auto& mt : model_tech_table) {
-            file << mt.model_id << "," << mt.tech_id << "\n";
-        }
-        
-        file.close();
-        return true;
+    if (g_server && g_epoll_mode) {
+        M::writeMetric(out, "byd_open_connections", "gauge", "Connections held by the epoll loops.",
+                       (double)g_server->openConnections());
     }
 
-    // -------------------------
-    // 初始化数据 - 从文件加载
-    // -------------------------
-    void initData() {
-        if (!loadData()) {
-            cerr << "Data loading failed, please ensure data file exists: " << DATA_FILE << endl;
-        } else {
-            cout << "Data loaded from file: " << DATA_FILE << endl;
-        }
+    if (g_access_log.enabled()) {
+        M::writeMetric(out, "byd_access_log_records_total", "counter", "Access log records written or dropped.",
+                       (double)g_access_log.written(), "result=\"written\"");
+        M::writeMetric(out, "byd_access_log_records_total", "counter", nullptr, (double)g_access_log.dropped(),
+                       "result=\"dropped\"");
     }
-};
 
-CarDataManager g_manager;
+    AdaptiveLimiter::Stats st = g_admission.expensive().stats();
+    M::writeMetric(out, "byd_admission_expensive_limit", "gauge", "Current concurrency limit for expensive routes.",
+                   st.limit);
+    M::writeMetric(out, "byd_admission_expensive_inflight", "gauge", "Expensive requests being processed.",
+                   st.inflight);
+    M::writeMetric(out, "byd_admission_rejected_total", "counter", "Requests answered with 503 by reason.",
+                   (double)g_admission.shed(), "reason=\"queue\"");
+    M::writeMetric(out, "byd_admission_rejected_total", "counter", nullptr, (double)st.rejected,
+                   "reason=\"expensive\"");
+    return out;
+}
 
 // =============================
-// JSON 工具函数
+// 静态资源: 启动时整体读入内存, web/ 目录变化时重新读入
 // =============================
-string escapeJson(const string& s) {
-    stringstream ss;
-    for (char c : s) {
-        switch (c) {
-            case '"':  ss << "\\\""; break;
-            case '\\': ss << "\\\\"; break;
-            case '\n': ss << "\\n";  break;
-            case '\r': ss << "\\r";  break;
-            case '\t': ss << "\\t";  break;
-            default:   ss << c;      break;
-        }
+
+const string WEB_DIR = "../web";
+StaticAssets g_assets;
+FileWatcher g_web_watcher;
+
+void loadStaticAssets(const char* what) {
+    string err;
+    if (!g_assets.load(WEB_DIR, err)) {
+        cerr << "Static assets not loaded: " << err << endl;
+        return;
     }
-    return ss.str();
+    StaticAssets::Stats st = g_assets.stats();
+    cout << "Static assets " << what << ": " << st.files << " files, " << st.bytes / 1024 << " KB ("
+         << st.gzip_bytes / 1024 << " KB compressed)" << endl;
+}
+
+// Ctrl+C / SIGTERM: 停止监听, 让 main 正常返回并刷写 WAL。
+// 工作进程停止接受连接 (监听套接字留给接替的进程), 处理完已接受的请求后退出
+void handleStopSignal(int sig) {
+    if (!g_server) return;
+    if (g_epoll_mode) g_server->stopEpoll();
+    else g_server->stopListening(sig);
 }
 
 // =============================
 // HTTP服务器
 // =============================
-int main() {
-    g_manager.initData();
+int main(int argc, char** argv) {
+    ServerOptions opts;
+    if (!parseOptions(argc, argv, opts)) return 1;
+    if (!opts.convert_input.empty()) return runConvert(opts);
+
+    WriteAheadLog::Options wal_opts;
+    wal_opts.sync = opts.wal_sync;
+    wal_opts.sync_interval_ms = opts.wal_sync_interval_ms;
+    g_manager.setWalOptions(wal_opts, opts.wal_ack_durable);
+    g_manager.setLoadThreads(opts.load_threads);
+    g_manager.setVersionWindow(opts.version_window_sec);
+    g_manager.setSnapshotVerify(opts.snapshot_verify_full);
+    if (opts.verify) return g_manager.verifyFiles() ? 0 : 1;
+    if (opts.recover) {
+        string err;
+        if (g_manager.recoverFiles(err)) return 0;
+        cerr << "Recover failed: " << err << endl;
+        return 1;
+    }
+    if (opts.workers > 0) return runSupervisor(opts, argc, argv);
+    g_replica = opts.worker_slot >= 0;
+    if (g_replica) {
+        g_manager.initReplica();
+    } else {
+        g_manager.initData();
+        g_manager.startMaintenance(opts.wal_compact_bytes, opts.wal_sync_interval_ms);
+        if (opts.watch_data) g_manager.startWatcher();
+    }
     
     int s_cnt, m_cnt, t_cnt;
-    g_manager.getStats(s_cnt, m_cnt, t_cnt);
+    g_manager.latestView().getStats(s_cnt, m_cnt, t_cnt);
     cout << "Server started: " << s_cnt << " series, " << m_cnt << " models, " << t_cnt << " techs." << endl;
 
-    httplib::Server svr;
+    EpollServer svr;
+    svr.new_task_queue = [&opts]() -> httplib::TaskQueue* {
+        if (opts.stock_pool) return new httplib::ThreadPool(opts.threads, opts.max_queued);
+        g_task_queue = new WorkStealingQueue(opts.threads, opts.max_queued, opts.queue_wait_ms);
+        return g_task_queue;
+    };
+    // 响应头与响应体分两次写出, 开着 Nagle 时 keep-alive 连接上的响应体要等对端的延迟 ACK (约 40ms)
+    svr.set_tcp_nodelay(true);
+    svr.set_keep_alive_timeout(opts.keep_alive_sec);
+    LimiterOptions expensive;
+    expensive.max_limit = opts.expensive_limit > 0 ? opts.expensive_limit : std::max(1, (int)opts.threads / 4);
+    expensive.max_waiting = opts.expensive_queue > 0 ? opts.expensive_queue : expensive.max_limit * 2;
+    expensive.max_wait_ms = opts.expensive_wait_ms;
+    g_admission.configure(opts.admission, expensive, std::max(1, (int)opts.threads / 2));
+    g_tracer.setSampleEvery((uint32_t)opts.trace_sample);
+
+    if (!opts.access_log.empty()) {
+        AccessLog::Options log_opts;
+        log_opts.max_bytes = (uint64_t)opts.access_log_mb << 20;
+        log_opts.keep = opts.access_log_keep;
+        // 各工作进程写自己的文件, 轮转互不干扰
+        string path = g_replica ? opts.access_log + ".w" + to_string(opts.worker_slot) : opts.access_log;
+        string err;
+        if (g_access_log.start(path, log_opts, err)) cout << "Access log: " << path << endl;
+        else cerr << "Access log not started: " << err << endl;
+    }
 
-    // 静态文件服务
-    svr.set_mount_point("/", "../web");
+    // 静态文件服务: 从内存缓存返回, /api/ 请求不查找
+    loadStaticAssets("loaded");
+    if (opts.watch_web) {
+        string err;
+        if (!g_web_watcher.startDir(WEB_DIR, 300, []() { loadStaticAssets("reloaded"); }, err)) {
+            cerr << "Web directory watcher not started: " << err << endl;
+        }
+    }
 
     // 跨域设置
-    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response& res) {
+    svr.set_pre_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        beginRequest();
         res.set_header("Access-Control-Allow-Origin", "*");
+        if (g_replica && req.method == "POST") {
+            res.status = 403;
+            res.set_content("{\"ok\":false,\"message\":\"多进程模式下工作进程只读: 请修改数据文件后向主进程发送 SIGHUP\"}",
+                            "application/json");
+            return httplib::Server::HandlerResponse::Handled;
+        }
+        bool admitted;
+        {
+            TraceSpan span(g_tracer, "admission");
+            admitted = admitRequest(req, res);
+        }
+        if (!admitted) return httplib::Server::HandlerResponse::Handled;
+        if (req.path.compare(0, 5, "/api/") != 0 && g_assets.serve(req, res)) {
+            return httplib::Server::HandlerResponse::Handled;
+        }
         return httplib::Server::HandlerResponse::Unhandled;
     });
+    svr.set_post_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        finishRequest();
+        recordRequest(req, res);
+        g_tracer.endRequest(req.method, req.path);
+    });
+
+    // 运行指标 (Prometheus 文本格式)
+    svr.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(renderMetrics(), "text/plain; version=0.0.4");
+    });
 
     // API: 获取所有系列
-    svr.Get("/api/series", [](const httplib::Request&, httplib::Response& res) {
-        auto series = g_manager.getAllSeries();
-        stringstream ss;
-        ss << "{\"ok\":true,\"data\":[";
+    svr.Get("/api/series", [](const httplib::Request& req, httplib::Response& res) {
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+        auto series = view.getAllSeries();
+        TraceSpan span(g_tracer, "serialize");
+        string out = "{\"ok\":true,\"data\":[";
         bool first = true;
         for (const auto& s : series) {
-            if (!first) ss << ",";
-            ss << "{\"series_id\":" << s.series_id 
-               << ",\"series_name\":\"" << escapeJson(s.series_name) << "\""
-               << ",\"intro\":\"" << escapeJson(s.intro) << "\"}";
+            if (!first) out += ',';
+            out += "{\"series_id\":"; appendNumber(out, s.series_id);
+            out += ",\"series_name\":"; appendJsonString(out, s.series_name);
+            out += ",\"intro\":"; appendJsonString(out, s.intro);
+            out += '}';
             first = false;
         }
-        ss << "]}";
-        res.set_content(ss.str(), "application/json");
+        out += "]}";
+        res.set_content(std::move(out), "application/json");
     });
 
     // API: 获取所有技术
-    svr.Get("/api/techs", [](const httplib::Request&, httplib::Response& res) {
-        auto techs = g_manager.getAllTechs();
-        stringstream ss;
-        ss << "{\"ok\":true,\"data\":[";
+    svr.Get("/api/techs", [](const httplib::Request& req, httplib::Response& res) {
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+        auto techs = view.getAllTechs();
+        TraceSpan span(g_tracer, "serialize");
+        string out = "{\"ok\":true,\"data\":[";
         bool first = true;
         for (const auto& t : techs) {
-            if (!first) ss << ",";
-            ss << "{\"tech_id\":" << t.tech_id 
-               << ",\"tech_name\":\"" << escapeJson(t.tech_name) << "\""
-               << ",\"intro\":\"" << escapeJson(t.intro) << "\"}";
+            if (!first) out += ',';
+            out += "{\"tech_id\":"; appendNumber(out, t.tech_id);
+            out += ",\"tech_name\":"; appendJsonString(out, t.tech_name);
+            out += ",\"intro\":"; appendJsonString(out, t.intro);
+            out += '}';
             first = false;
         }
-        ss << "]}";
-        res.set_content(ss.str(), "application/json");
+        out += "]}";
+        res.set_content(std::move(out), "application/json");
     });
 
     // API: 获取车型列表 (支持筛选)
     svr.Get("/api/models", [](const httplib::Request& req, httplib::Response& res) {
-        int series_id = -1;
-        string energy = "";
+        CarDataManager::ModelFilter filter;
         
         if (req.has_param("series_id")) {
-            try { series_id = stoi(req.get_param_value("series_id")); } catch(...) {}
+            try { filter.series_id = stoi(req.get_param_value("series_id")); } catch(...) {}
         }
         if (req.has_param("energy_type")) {
-            energy = req.get_param_value("energy_type");
+            filter.energy_type = req.get_param_value("energy_type");
         }
-
-        auto models = g_manager.getAllModels(series_id, energy);
-        stringstream ss;
-        ss << "{\"ok\":true,\"data\":[";
-        bool first = true;
-        for (const auto& md : models) {
-            if (!first) ss << ",";
-            ss << "{\"model_id\":" << md.model.model_id 
-               << ",\"model_name\":\"" << escapeJson(md.model.model_name) << "\""
-               << ",\"series_id\":" << md.model.series_id
-               << ",\"series_name\":\"" << escapeJson(md.series_name) << "\""
-               << ",\"price\":" << md.model.price
-               << ",\"range_km\":" << md.model.range_km
-               << ",\"energy_type\":\"" << escapeJson(md.model.energy_type) << "\""
-               << ",\"body_type\":\"" << escapeJson(md.model.body_type) << "\""
-               << ",\"seats\":" << md.model.seats
-               << ",\"launch_year\":\"" << escapeJson(md.model.launch_year) << "\""
-               << ",\"techs\":[";
-            bool first_tech = true;
-            for (const auto& tn : md.tech_names) {
-                if (!first_tech) ss << ",";
-                ss << "\"" << escapeJson(tn) << "\"";
-                first_tech = false;
-            }
-            ss << "]}";
-            first = false;
+        // 价格 / 续航范围 (闭区间)
+        const pair<const char*, double*> bounds[] = {
+            { "min_price", &filter.min_price }, { "max_price", &filter.max_price },
+            { "min_range", &filter.min_range }, { "max_range", &filter.max_range },
+        };
+        for (const auto& b : bounds) {
+            if (!req.has_param(b.first)) continue;
+            if (!parseNumber(string_view(req.get_param_value(b.first)), *b.second) || std::isnan(*b.second)) {
+                res.set_content("{\"ok\":false,\"message\":\"" + string(b.first) + " 不是有效的数值\"}", "application/json");
+                return;
+            }
         }
-        ss << "]}";
-        res.set_content(ss.str(), "application/json");
+
+        unsigned fields;
+        if (!getRequestFields(req, res, fields)) return;
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+
+        TraceSpan flight(g_tracer, "single-flight");
+        SingleFlight::Result body = g_coalescer.run(coalesceKey(req, view.version()), [&]() {
+            auto models = view.getAllModels(filter, fields);
+            TraceSpan span(g_tracer, "serialize");
+            string out = "{\"ok\":true,\"data\":[";
+            bool first = true;
+            for (const auto& md : models) {
+                if (!first) out += ',';
+                writeModelJson(out, md, fields);
+                first = false;
+            }
+            out += "]}";
+            return out;
+        });
+        setSharedContent(res, body);
     });
 
     // API: 获取单个车型详情
@@ -626,33 +3525,21 @@ int main() {
         int model_id = 0;
         try { model_id = stoi(req.get_param_value("id")); } catch(...) {}
 
-        auto detail = g_manager.getModelDetail(model_id);
+        unsigned fields;
+        if (!getRequestFields(req, res, fields)) return;
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+
+        auto detail = view.getModelDetail(model_id, fields);
         if (detail.model.model_id == 0) {
             res.set_content("{\"ok\":false,\"message\":\"车型不存在\"}", "application/json");
             return;
         }
 
-        stringstream ss;
-        ss << "{\"ok\":true,\"data\":{";
-        ss << "\"model_id\":" << detail.model.model_id 
-           << ",\"model_name\":\"" << escapeJson(detail.model.model_name) << "\""
-           << ",\"series_id\":" << detail.model.series_id
-           << ",\"series_name\":\"" << escapeJson(detail.series_name) << "\""
-           << ",\"price\":" << detail.model.price
-           << ",\"range_km\":" << detail.model.range_km
-           << ",\"energy_type\":\"" << escapeJson(detail.model.energy_type) << "\""
-           << ",\"body_type\":\"" << escapeJson(detail.model.body_type) << "\""
-           << ",\"seats\":" << detail.model.seats
-           << ",\"launch_year\":\"" << escapeJson(detail.model.launch_year) << "\""
-           << ",\"techs\":[";
-        bool first_tech = true;
-        for (const auto& tn : detail.tech_names) {
-            if (!first_tech) ss << ",";
-            ss << "\"" << escapeJson(tn) << "\"";
-            first_tech = false;
-        }
-        ss << "]}}";
-        res.set_content(ss.str(), "application/json");
+        string out = "{\"ok\":true,\"data\":";
+        writeModelJson(out, detail, fields);
+        out += '}';
+        res.set_content(std::move(out), "application/json");
     });
 
     // API: 搜索车型
@@ -663,115 +3550,142 @@ int main() {
             return;
         }
 
-        auto models = g_manager.searchModels(keyword);
-        stringstream ss;
-        ss << "{\"ok\":true,\"data\":[";
-        bool first = true;
-        for (const auto& md : models) {
-            if (!first) ss << ",";
-            ss << "{\"model_id\":" << md.model.model_id 
-               << ",\"model_name\":\"" << escapeJson(md.model.model_name) << "\""
-               << ",\"series_id\":" << md.model.series_id
-               << ",\"series_name\":\"" << escapeJson(md.series_name) << "\""
-               << ",\"price\":" << md.model.price
-               << ",\"range_km\":" << md.model.range_km
-               << ",\"energy_type\":\"" << escapeJson(md.model.energy_type) << "\""
-               << ",\"body_type\":\"" << escapeJson(md.model.body_type) << "\""
-               << ",\"seats\":" << md.model.seats
-               << ",\"launch_year\":\"" << escapeJson(md.model.launch_year) << "\""
-               << ",\"techs\":[";
-            bool first_tech = true;
-            for (const auto& tn : md.tech_names) {
-                if (!first_tech) ss << ",";
-                ss << "\"" << escapeJson(tn) << "\"";
-                first_tech = false;
-            }
-            ss << "]}";
-            first = false;
-        }
-        ss << "]}";
-        res.set_content(ss.str(), "application/json");
+        unsigned fields;
+        if (!getRequestFields(req, res, fields)) return;
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+
+        TraceSpan flight(g_tracer, "single-flight");
+        SingleFlight::Result body = g_coalescer.run(coalesceKey(req, view.version()), [&]() {
+            auto models = view.searchModels(keyword, fields);
+            TraceSpan span(g_tracer, "serialize");
+            string out = "{\"ok\":true,\"data\":[";
+            bool first = true;
+            for (const auto& md : models) {
+                if (!first) out += ',';
+                writeModelJson(out, md, fields);
+                first = false;
+            }
+            out += "]}";
+            return out;
+        });
+        setSharedContent(res, body);
     });
 
     // API: 获取统计信息
-    svr.Get("/api/stats", [](const httplib::Request&, httplib::Response& res) {
+    svr.Get("/api/stats", [](const httplib::Request& req, httplib::Response& res) {
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
         int s_cnt, m_cnt, t_cnt;
-        g_manager.getStats(s_cnt, m_cnt, t_cnt);
+        view.getStats(s_cnt, m_cnt, t_cnt);
         stringstream ss;
         ss << "{\"ok\":true,\"series_count\":" << s_cnt 
            << ",\"model_count\":" << m_cnt 
-           << ",\"tech_count\":" << t_cnt << "}";
+           << ",\"tech_count\":" << t_cnt
+           << ",\"version\":" << view.version() << "}";
         res.set_content(ss.str(), "application/json");
     });
 
     // API: 获取图结构数据 (三层架构: Series -> Model -> Tech)
-    svr.Get("/api/graph", [](const httplib::Request&, httplib::Response& res) {
-        auto series = g_manager.getAllSeries();
-        auto techs = g_manager.getAllTechs();
-        auto models = g_manager.getAllModels();
-
-        stringstream ss;
-        ss << "{\"ok\":true,";
+    svr.Get("/api/graph", [](const httplib::Request& req, httplib::Response& res) {
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+        // 仪表盘刷新时大量客户端同时请求整张图, 同一版本只序列化一次
+        TraceSpan flight(g_tracer, "single-flight");
+        SingleFlight::Result body = g_coalescer.run(coalesceKey(req, view.version()), [&]() {
+            auto series = view.getAllSeries();
+            auto techs = view.getAllTechs();
+            auto models = view.getAllModels();
+
+            TraceSpan nodes_span(g_tracer, "serialize nodes");
+            string out = "{\"ok\":true,";
         
-        // 节点数据
-        ss << "\"nodes\":[";
-        bool first = true;
+            // 节点数据
+            out += "\"nodes\":[";
+            bool first = true;
         
-        // 顶层: 系列节点
-        for (const auto& s : series) {
-            if (!first) ss << ",";
-            ss << "{\"id\":\"s_" << s.series_id << "\""
-               << ",\"name\":\"" << escapeJson(s.series_name) << "\""
-               << ",\"category\":0,\"layer\":0}";
-            first = false;
-        }
+            // 顶层: 系列节点
+            for (const auto& s : series) {
+                if (!first) out += ',';
+                out += "{\"id\":\"s_"; appendNumber(out, s.series_id);
+                out += "\",\"name\":"; appendJsonString(out, s.series_name);
+                out += ",\"category\":0,\"layer\":0}";
+                first = false;
+            }
         
-        // 中层: 车型节点
-        for (const auto& md : models) {
-            ss << ",{\"id\":\"m_" << md.model.model_id << "\""
-               << ",\"name\":\"" << escapeJson(md.model.model_name) << "\""
-               << ",\"series_id\":" << md.model.series_id
-               << ",\"category\":1,\"layer\":1}";
-        }
+            // 中层: 车型节点
+            for (const auto& md : models) {
+                out += ",{\"id\":\"m_"; appendNumber(out, md.model.model_id);
+                out += "\",\"name\":"; appendJsonString(out, md.model.model_name);
+                out += ",\"series_id\":"; appendNumber(out, md.model.series_id);
+                out += ",\"category\":1,\"layer\":1}";
+            }
         
-        // 底层: 技术节点
-        for (const auto& t : techs) {
-            ss << ",{\"id\":\"t_" << t.tech_id << "\""
-               << ",\"name\":\"" << escapeJson(t.tech_name) << "\""
-               << ",\"category\":2,\"layer\":2}";
-        }
-        ss << "],";
+            // 底层: 技术节点
+            for (const auto& t : techs) {
+                out += ",{\"id\":\"t_"; appendNumber(out, t.tech_id);
+                out += "\",\"name\":"; appendJsonString(out, t.tech_name);
+                out += ",\"category\":2,\"layer\":2}";
+            }
+            out += "],";
         
-        // 边数据 (只允许相邻层: Series->Model, Model->Tech)
-        ss << "\"links\":[";
-        first = true;
+            // 边数据 (只允许相邻层: Series->Model, Model->Tech)
+            out += "\"links\":[";
+            first = true;
         
-        // Series -> Model 边
-        for (const auto& md : models) {
-            if (!first) ss << ",";
-            ss << "{\"source\":\"s_" << md.model.series_id << "\""
-               << ",\"target\":\"m_" << md.model.model_id << "\""
-               << ",\"relation\":\"belongs_to\"}";
-            first = false;
-        }
+            // Series -> Model 边
+            for (const auto& md : models) {
+                if (!first) out += ',';
+                out += "{\"source\":\"s_"; appendNumber(out, md.model.series_id);
+                out += "\",\"target\":\"m_"; appendNumber(out, md.model.model_id);
+                out += "\",\"relation\":\"belongs_to\"}";
+                first = false;
+            }
         
-        // Model -> Tech 边
-        for (const auto& md : models) {
-            for (const auto& tn : md.tech_names) {
-                // 需要找到tech_id
-                for (const auto& t : techs) {
-                    if (t.tech_name == tn) {
-                        ss << ",{\"source\":\"m_" << md.model.model_id << "\""
-                           << ",\"target\":\"t_" << t.tech_id << "\""
-                           << ",\"relation\":\"equipped_with\"}";
-                        break;
+            // Model -> Tech 边
+            TraceSpan tech_span(g_tracer, "tech lookup + links");
+            for (const auto& md : models) {
+                for (const auto& tn : md.tech_names) {
+                    // 需要找到tech_id
+                    for (const auto& t : techs) {
+                        if (t.tech_name == tn) {
+                            out += ",{\"source\":\"m_"; appendNumber(out, md.model.model_id);
+                            out += "\",\"target\":\"t_"; appendNumber(out, t.tech_id);
+                            out += "\",\"relation\":\"equipped_with\"}";
+                            break;
+                        }
                     }
                 }
             }
+            out += "]}";
+            return out;
+        });
+        setSharedContent(res, body);
+    });
+
+    // API: 流式导出 (?format=ndjson|csv&entity=models|series|techs|model_tech)
+    svr.Get("/api/export", [](const httplib::Request& req, httplib::Response& res) {
+        string format = req.has_param("format") ? req.get_param_value("format") : "ndjson";
+        Entity entity;
+        if (format != "ndjson" && format != "csv") {
+            res.set_content("{\"ok\":false,\"message\":\"format 只能是 ndjson 或 csv\"}", "application/json");
+            return;
+        }
+        if (!parseEntity(req.get_param_value("entity"), entity)) {
+            res.set_content("{\"ok\":false,\"message\":\"entity 只能是 models, series, techs 或 model_tech\"}", "application/json");
+            return;
+        }
+
+        // 固定一个版本的视图, 导出过程中的新写入不影响本次输出
+        CarDataManager::ReadView view;
+        if (!getReadView(req, res, view)) return;
+        bool csv = format == "csv";
+        switch (entity) {
+            case Entity::Series:    streamExport<Series>(res, std::move(view), csv); break;
+            case Entity::Techs:     streamExport<Tech>(res, std::move(view), csv); break;
+            case Entity::Models:    streamExport<Model>(res, std::move(view), csv); break;
+            case Entity::ModelTech: streamExport<ModelTech>(res, std::move(view), csv); break;
         }
-        ss << "]}";
-        
-        res.set_content(ss.str(), "application/json");
     });
 
     // =============================
@@ -783,100 +3697,40 @@ int main() {
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Content-Type", "application/json");
         
-        try {
-            // 简单解析JSON（不依赖外部库）
-            string body = req.body;
-            
-            // 提取字段
-            auto extractStr = [&](const string& key) -> string {
-                string pattern = "\"" + key + "\":\"";
-                size_t pos = body.find(pattern);
-                if (pos == string::npos) return "";
-                pos += pattern.length();
-                size_t end = body.find("\"", pos);
-                if (end == string::npos) return "";
-                return body.substr(pos, end - pos);
-            };
-            
-            auto extractNum = [&](const string& key) -> double {
-                string pattern = "\"" + key + "\":";
-                size_t pos = body.find(pattern);
-                if (pos == string::npos) return 0;
-                pos += pattern.length();
-                size_t end = pos;
-                while (end < body.length() && (isdigit(body[end]) || body[end] == '.' || body[end] == '-')) end++;
-                return stod(body.substr(pos, end - pos));
-            };
-            
-            auto extractIntArray = [&](const string& key) -> vector<int> {
-                vector<int> result;
-                string pattern = "\"" + key + "\":[";
-                size_t pos = body.find(pattern);
-                if (pos == string::npos) return result;
-                pos += pattern.length();
-                size_t end = body.find("]", pos);
-                if (end == string::npos) return result;
-                string arr = body.substr(pos, end - pos);
-                stringstream ss(arr);
-                string item;
-                while (getline(ss, item, ',')) {
-                    if (!item.empty()) {
-                        try { result.push_back(stoi(item)); } catch (...) {}
-                    }
-                }
-                return result;
-            };
-            
-            string model_name = extractStr("model_name");
-            int series_id = (int)extractNum("series_id");
-            double price = extractNum("price");
-            double range_km = extractNum("range_km");
-            string energy_type = extractStr("energy_type");
-            string body_type = extractStr("body_type");
-            int seats = (int)extractNum("seats");
-            string launch_year = extractStr("launch_year");
-            vector<int> tech_ids = extractIntArray("tech_ids");
-            
-            // 验证
-            if (model_name.empty()) {
-                res.set_content("{\"ok\":false,\"message\":\"车型名称不能为空\"}", "application/json");
-                return;
-            }
-            if (price <= 0) {
-                res.set_content("{\"ok\":false,\"message\":\"价格必须大于0\"}", "application/json");
-                return;
-            }
-            if (energy_type.empty()) {
-                res.set_content("{\"ok\":false,\"message\":\"能源类型不能为空\"}", "application/json");
-                return;
-            }
-            
-            // 生成新ID
-            int new_model_id = 9000 + rand() % 1000;
-            
-            // 添加车型
-            string err;
-            bool ok = g_manager.addModel(new_model_id, model_name, series_id, price, range_km,
-                                          energy_type, body_type, seats, launch_year, err);
-            
-            if (!ok) {
-                res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
-                return;
-            }
-            
-            // 添加技术关联
-            for (int tech_id : tech_ids) {
-                g_manager.addModelTech(new_model_id, tech_id);
-            }
-            
-            // 保存到文件
-            g_manager.saveData();
-            
-            res.set_content("{\"ok\":true,\"message\":\"添加成功\",\"model_id\":" + to_string(new_model_id) + "}", "application/json");
-            
-        } catch (const exception& e) {
-            res.set_content("{\"ok\":false,\"message\":\"解析错误\"}", "application/json");
+        ModelAddRequest m;
+        string err;
+        if (!parseRequestBody(req.body, m, err, bindModel)) {
+            res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+            return;
+        }
+        
+        // 验证
+        if (m.model_name.empty()) {
+            res.set_content("{\"ok\":false,\"message\":\"车型名称不能为空\"}", "application/json");
+            return;
+        }
+        if (!(m.price > 0)) {
+            res.set_content("{\"ok\":false,\"message\":\"价格必须大于0\"}", "application/json");
+            return;
+        }
+        if (m.energy_type.empty()) {
+            res.set_content("{\"ok\":false,\"message\":\"能源类型不能为空\"}", "application/json");
+            return;
+        }
+        
+        // 生成新ID
+        int new_model_id = 9000 + rand() % 1000;
+        
+        // 添加车型: 车型与技术关联在同一把锁内一起校验, 作为一个版本提交; 关联错误同样返回
+        bool ok = g_manager.addModel(new_model_id, m.model_name, m.series_id, m.price, m.range_km,
+                                     m.energy_type, m.body_type, m.seats, m.launch_year, m.tech_ids, err);
+        
+        if (!ok) {
+            res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+            return;
         }
+        
+        res.set_content("{\"ok\":true,\"message\":\"添加成功\",\"model_id\":" + to_string(new_model_id) + "}", "application/json");
     });
     
     // API: 添加新技术
@@ -884,49 +3738,175 @@ int main() {
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Content-Type", "application/json");
         
-        try {
-            string body = req.body;
-            
-            auto extractStr = [&](const string& key) -> string {
-                string pattern = "\"" + key + "\":\"";
-                size_t pos = body.find(pattern);
-                if (pos == string::npos) return "";
-                pos += pattern.length();
-                size_t end = body.find("\"", pos);
-                if (end == string::npos) return "";
-                return body.substr(pos, end - pos);
-            };
-            
-            string tech_name = extractStr("tech_name");
-            string intro = extractStr("intro");
-            
-            if (tech_name.empty()) {
-                res.set_content("{\"ok\":false,\"message\":\"技术名称不能为空\"}", "application/json");
+        TechAddRequest t;
+        string err;
+        if (!parseRequestBody(req.body, t, err, bindTech)) {
+            res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+            return;
+        }
+        
+        if (t.tech_name.empty()) {
+            res.set_content("{\"ok\":false,\"message\":\"技术名称不能为空\"}", "application/json");
+            return;
+        }
+        
+        // 生成新ID
+        int new_tech_id = 200 + rand() % 100;
+        
+        // 添加技术
+        bool ok = g_manager.addTech(new_tech_id, t.tech_name, t.intro, err);
+        
+        if (!ok) {
+            res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+            return;
+        }
+        
+        res.set_content("{\"ok\":true,\"message\":\"添加成功\",\"tech_id\":" + to_string(new_tech_id) + "}", "application/json");
+    });
+    
+    // API: 流式导入 (?format=ndjson|csv&entity=...), 请求体按行解析并分批写入
+    svr.Post("/api/import", [](const httplib::Request& req, httplib::Response& res,
+                               const httplib::ContentReader& content_reader) {
+        string format = req.has_param("format") ? req.get_param_value("format") : "ndjson";
+        Entity entity;
+        if ((format != "ndjson" && format != "csv") || !parseEntity(req.get_param_value("entity"), entity)) {
+            res.set_content("{\"ok\":false,\"message\":\"format 或 entity 参数无效\"}", "application/json");
+            return;
+        }
+
+        bool csv = format == "csv";
+        switch (entity) {
+            case Entity::Series:    runImport<Series>(content_reader, res, csv, &CarDataManager::insertSeries); break;
+            case Entity::Techs:     runImport<Tech>(content_reader, res, csv, &CarDataManager::insertTech); break;
+            case Entity::Models:    runImport<Model>(content_reader, res, csv, &CarDataManager::insertModel); break;
+            case Entity::ModelTech: runImport<ModelTech>(content_reader, res, csv, &CarDataManager::insertModelTechRow); break;
+        }
+    });
+    
+    // API: 批量写入 {"series":[...],"techs":[...],"models":[...],"model_techs":[...]}, 整批校验后一次发布;
+    // 默认跳过未通过校验的行并逐行报告, ?atomic=true 时任一行失败整批不写入
+    svr.Post("/api/bulk", [](const httplib::Request& req, httplib::Response& res) {
+        CarDataManager::BulkBatch batch;
+        string err;
+        if (!parseRequestBody(req.body, batch, err, bindBulk)) {
+            res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
+            return;
+        }
+        string atomic_param = req.get_param_value("atomic");
+        bool atomic = atomic_param == "true" || atomic_param == "1";
+
+        vector<CarDataManager::BulkError> errors;
+        uint64_t version = 0;
+        size_t applied = g_manager.applyBulk(batch, atomic, errors, version, err);
+        size_t rows = batch.series.size() + batch.techs.size() + batch.models.size() + batch.model_techs.size();
+        if (err.empty() && atomic && !errors.empty()) err = "有 " + to_string(errors.size()) + " 行未通过校验, 整批未写入";
+
+        string out = "{\"ok\":";
+        out += err.empty() ? "true" : "false";
+        if (!err.empty()) {
+            out += ",\"message\":";
+            appendJsonString(out, err);
+        }
+        out += ",\"rows\":"; appendNumber(out, rows);
+        out += ",\"applied\":"; appendNumber(out, applied);
+        out += ",\"version\":"; appendNumber(out, version);
+        out += ",\"error_count\":"; appendNumber(out, errors.size());
+        out += ",\"errors\":[";
+        const size_t kMaxReported = 100;    // 只返回前若干条错误详情
+        for (size_t i = 0; i < errors.size() && i < kMaxReported; i++) {
+            if (i) out += ',';
+            out += "{\"entity\":";
+            appendJsonString(out, errors[i].entity);
+            out += ",\"index\":";
+            appendNumber(out, errors[i].index);
+            out += ",\"message\":";
+            appendJsonString(out, errors[i].message);
+            out += '}';
+        }
+        out += "]}";
+        res.set_content(out, "application/json");
+    });
+
+    // API: 准入控制与请求合并状态 (仅限本机)
+    svr.Get("/api/admin/admission", [](const httplib::Request& req, httplib::Response& res) {
+        if (req.remote_addr != "127.0.0.1" && req.remote_addr != "::1") {
+            res.status = 403;
+            res.set_content("{\"ok\":false,\"message\":\"管理接口只允许本机访问\"}", "application/json");
+            return;
+        }
+        AdaptiveLimiter::Stats st = g_admission.expensive().stats();
+        SingleFlight::Stats sf = g_coalescer.stats();
+        stringstream ss;
+        ss << "{\"ok\":true,\"enabled\":" << (g_admission.enabled() ? "true" : "false")
+           << ",\"queue_shed\":" << g_admission.shed()
+           << ",\"expensive\":{\"limit\":" << st.limit << ",\"inflight\":" << st.inflight
+           << ",\"waiting\":" << st.waiting << ",\"admitted\":" << st.admitted << ",\"rejected\":" << st.rejected
+           << ",\"base_ms\":" << st.base_ms << ",\"avg_ms\":" << st.avg_ms << "}"
+           << ",\"coalesce\":{\"computed\":" << sf.computed << ",\"coalesced\":" << sf.coalesced
+           << ",\"inflight\":" << sf.inflight << "}}";
+        res.set_content(ss.str(), "application/json");
+    });
+
+    // 分阶段追踪 (仅限本机): 返回 Chrome trace-event JSON; ?sample=N 修改采样率并清空已记录的事件
+    svr.Get("/debug/trace", [](const httplib::Request& req, httplib::Response& res) {
+        if (req.remote_addr != "127.0.0.1" && req.remote_addr != "::1") {
+            res.status = 403;
+            res.set_content("{\"ok\":false,\"message\":\"管理接口只允许本机访问\"}", "application/json");
+            return;
+        }
+        if (req.has_param("sample")) {
+            int n;
+            if (!JsonReader::parseInt(req.get_param_value("sample"), n) || n < 0) {
+                res.set_content("{\"ok\":false,\"message\":\"sample 应为非负整数\"}", "application/json");
                 return;
             }
-            
-            // 生成新ID
-            int new_tech_id = 200 + rand() % 100;
-            
-            // 添加技术
-            string err;
-            bool ok = g_manager.addTech(new_tech_id, tech_name, intro, err);
-            
-            if (!ok) {
-                res.set_content("{\"ok\":false,\"message\":\"" + escapeJson(err) + "\"}", "application/json");
-                return;
+            g_tracer.setSampleEvery((uint32_t)n);
+            g_tracer.clear();
+            res.set_content("{\"ok\":true,\"sample_every\":" + to_string(n) + "}", "application/json");
+            return;
+        }
+        string out;
+        g_tracer.exportJson(out);
+        res.set_content(out, "application/json");
+    });
+
+    // API: 重新加载数据文件 (仅限本机), 校验失败时保留当前数据并返回错误行
+    svr.Post("/api/admin/reload", [](const httplib::Request& req, httplib::Response& res) {
+        if (req.remote_addr != "127.0.0.1" && req.remote_addr != "::1") {
+            res.status = 403;
+            res.set_content("{\"ok\":false,\"message\":\"管理接口只允许本机访问\"}", "application/json");
+            return;
+        }
+        auto r = g_manager.reload();
+        string out = "{\"ok\":";
+        out += r.ok ? "true" : "false";
+        out += ",\"message\":";
+        appendJsonString(out, r.message);
+        if (r.ok) {
+            out += ",\"series_count\":"; appendNumber(out, r.series_count);
+            out += ",\"model_count\":"; appendNumber(out, r.model_count);
+            out += ",\"tech_count\":"; appendNumber(out, r.tech_count);
+            out += ",\"replayed\":"; appendNumber(out, r.replayed);
+            out += ",\"ms\":"; appendNumber(out, (long long)r.ms);
+        } else {
+            out += ",\"error_count\":"; appendNumber(out, r.error_count);
+            out += ",\"errors\":[";
+            bool first = true;
+            for (const auto& e : r.errors) {
+                if (!first) out += ',';
+                out += "{\"line\":";
+                appendNumber(out, e.line);
+                out += ",\"message\":";
+                appendJsonString(out, e.message);
+                out += '}';
+                first = false;
             }
-            
-            // 保存到文件
-            g_manager.saveData();
-            
-            res.set_content("{\"ok\":true,\"message\":\"添加成功\",\"tech_id\":" + to_string(new_tech_id) + "}", "application/json");
-            
-        } catch (const exception& e) {
-            res.set_content("{\"ok\":false,\"message\":\"解析错误\"}", "application/json");
+            out += ']';
         }
+        out += '}';
+        res.set_content(out, "application/json");
     });
-    
+
     // OPTIONS 预检请求处理
     svr.Options(".*", [](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
@@ -936,18 +3916,45 @@ int main() {
     });
 
     // 启动服务器
-    cout << "Starting server on http://localhost:8080 ..." << endl;
-    cout.flush();
-    
-    if (!svr.bind_to_port("0.0.0.0", 8080)) {
-        cerr << "Error: Cannot bind to port 8080" << endl;
-        return 1;
+    g_server = &svr;
+    g_epoll_mode = opts.epoll;
+    if (g_replica) {
+        svr.adoptListener(opts.worker_listen_fd, true);
+        Supervisor::installStopHandler(handleStopSignal);
+        cout << "Worker " << opts.worker_slot << " serving on http://localhost:8080" << endl;
+        Supervisor::notifyReady(opts.worker_ready_fd);
+    } else {
+        cout << "Starting server on http://localhost:8080 ..." << endl;
+        cout.flush();
+
+        if (!svr.bind_to_port("0.0.0.0", 8080)) {
+            cerr << "Error: Cannot bind to port 8080" << endl;
+            return 1;
+        }
+
+        cout << "Server is running. Press Ctrl+C to stop." << endl;
+        cout.flush();
+        signal(SIGINT, handleStopSignal);
+        signal(SIGTERM, handleStopSignal);
     }
-    
-    cout << "Server is running. Press Ctrl+C to stop." << endl;
-    cout.flush();
-    
-    svr.listen_after_bind();
+
+    if (opts.epoll) {
+        long files = EpollServer::raiseFileLimit();
+        cout << "I/O mode: epoll, " << opts.io_threads << " I/O threads, " << opts.threads
+             << " workers, open file limit " << files << endl;
+        if (!svr.listenEpoll(opts.io_threads)) {
+            cerr << "Error: Cannot start epoll I/O threads" << endl;
+            g_manager.stopMaintenance();
+            return 1;
+        }
+    } else {
+        svr.listen_after_bind();
+    }
+
+    g_web_watcher.stop();
+    g_access_log.stop();
+    g_manager.stopMaintenance();
+    cout << "Server stopped." << endl;
     
     return 0;
 }
@@ -0,0 +1,101 @@
+/**
+ * 只读文件映射
+ *
+ * POSIX 下 mmap 整个文件; Windows 下被映射的文件无法被 rename 替换 (压缩时会覆盖数据文件),
+ * 因此直接整体读入内存。两种方式对调用方都表现为一段连续的只读字节。
+ */
+
+#ifndef BYD_MAPPED_FILE_H
+#define BYD_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "wal.h"
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // 空文件也视为成功 (size() == 0); sequential 表示将顺序扫描, 提示内核预读
+    bool open(const std::string& path, std::string& err, bool sequential = false) {
+        close();
+        int fd = wal_detail::openRead(path.c_str());
+        if (fd < 0) { err = "无法打开文件 " + path; return false; }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            wal_detail::closeFd(fd);
+            err = "无法读取文件信息 " + path;
+            return false;
+        }
+        size_ = (size_t)st.st_size;
+        if (size_ == 0) { wal_detail::closeFd(fd); return true; }
+#ifndef _WIN32
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        wal_detail::closeFd(fd);
+        if (p == MAP_FAILED) { size_ = 0; err = "无法映射文件 " + path; return false; }
+        map_ = static_cast<char*>(p);
+        data_ = map_;
+        if (sequential) ::madvise(map_, size_, MADV_SEQUENTIAL);
+#else
+        (void)sequential;
+        buffer_.resize(size_);
+        size_t got = 0;
+        while (got < size_) {
+            long long n = wal_detail::readSome(fd, &buffer_[got], size_ - got);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        wal_detail::closeFd(fd);
+        if (got != size_) { size_ = 0; err = "读取文件失败 " + path; return false; }
+        data_ = buffer_.data();
+#endif
+        return true;
+    }
+
+    // 改为持有内存中的一段数据 (与 Windows 下整体读入的方式相同)
+    void adopt(std::string data) {
+        close();
+        buffer_ = std::move(data);
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (map_) ::munmap(map_, size_);
+        map_ = nullptr;
+#endif
+        buffer_.clear();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    // 顺序扫描结束后恢复默认的预读策略 (之后按随机访问使用)
+    void adviseNormal() {
+#ifndef _WIN32
+        if (map_) ::madvise(map_, size_, MADV_NORMAL);
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    char* map_ = nullptr;
+    std::string buffer_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // BYD_MAPPED_FILE_H
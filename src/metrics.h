@@ -0,0 +1,303 @@
+/**
+ * 运行指标 (Prometheus 文本格式, GET /metrics)
+ *
+ *   LatencyHistogram  HDR 风格的对数-线性直方图: 每个 2 的幂区间再等分 8 格, 相对误差不超过 12.5%,
+ *                     覆盖 1ns ~ 2^64ns; 只由一个线程写入, 写入是几次不带锁前缀的原子读写。
+ *   MetricsRegistry   每个线程一个分片 (首次记录时分配并登记, 线程退出后保留), 分片内按 路由 x 状态码
+ *                     懒分配直方图。记录时只访问本线程的分片, 不加锁、不与其他线程共享缓存行;
+ *                     导出时加锁遍历分片并求和, 只与新线程的登记互斥。
+ *   InstrumentedMutex 带等待计时的互斥量: 先 try_lock, 失败时才计时阻塞等待, 等待时间计入直方图;
+ *                     当前请求被追踪采样时, 等待同时记为 "lock wait" 区间 (trace.h)。
+ * 路由与状态码在首次出现时登记 (加锁), 之后的查找只读; 路由标签来自路由模式而不是原始路径, 数量有限。
+ */
+
+#ifndef BYD_METRICS_H
+#define BYD_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+class LatencyHistogram {
+public:
+    static const int kSubBits = 3;
+    static const int kSub = 1 << kSubBits;
+    static const int kBuckets = (64 - kSubBits + 1) * kSub;
+
+    LatencyHistogram() {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    }
+
+    // 单写者: 读-改-写不需要原子 RMW, 导出线程读到的是某一时刻的值
+    void record(uint64_t ns) {
+        bump(buckets_[bucketOf(ns)], 1);
+        bump(count_, 1);
+        bump(sum_ns_, ns);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sumNs() const { return sum_ns_.load(std::memory_order_relaxed); }
+    uint64_t bucket(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    static int bucketOf(uint64_t v) {
+        if (v < (uint64_t)kSub) return (int)v;
+        int e = 63 - __builtin_clzll(v);
+        return (e - kSubBits + 1) * kSub + (int)((v >> (e - kSubBits)) & (kSub - 1));
+    }
+
+    // 第 i 格的上界 (不含)
+    static uint64_t upperBound(int i) {
+        if (i < kSub) return (uint64_t)i + 1;
+        int e = i / kSub + kSubBits - 1;
+        uint64_t width = 1ull << (e - kSubBits);
+        uint64_t lower = (uint64_t)(kSub + i % kSub) << (e - kSubBits);
+        return lower + width < lower ? UINT64_MAX : lower + width;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& c, uint64_t d) {
+        c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[kBuckets];
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_ns_{ 0 };
+};
+
+class MetricsRegistry {
+public:
+    static const int kMaxRoutes = 64;       // 超出的路由计入最后一个 ("other")
+    static const int kMaxCodes = 16;        // 超出的状态码计入最后一个 ("other")
+
+    MetricsRegistry() {
+        for (auto& s : code_slot_) s.store(-1, std::memory_order_relaxed);
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // 路由标签 -> 编号; 已登记的路由只读查找, 不加锁
+    int route(const std::string& name) {
+        int n = route_count_.load(std::memory_order_acquire);
+        for (int i = 0; i < n; i++) {
+            if (routes_[i] == name) return i;
+        }
+        std::lock_guard<std::mutex> lk(mu_);
+        n = route_count_.load(std::memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            if (routes_[i] == name) return i;
+        }
+        if (n == kMaxRoutes - 1) {
+            routes_[n] = "other";
+            route_count_.store(n + 1, std::memory_order_release);
+        }
+        if (n >= kMaxRoutes - 1) return kMaxRoutes - 1;
+        routes_[n] = name;
+        route_count_.store(n + 1, std::memory_order_release);
+        return n;
+    }
+
+    void recordRequest(int route, int status, uint64_t ns) {
+        int code = codeSlot(status);
+        Shard& s = shard();
+        LatencyHistogram* h = s.requests[route][code].load(std::memory_order_relaxed);
+        if (!h) {
+            h = new LatencyHistogram();
+            s.requests[route][code].store(h, std::memory_order_release);
+        }
+        h->record(ns);
+    }
+
+    void recordLockWait(uint64_t ns) { shard().lock_wait.record(ns); }
+
+    // 请求延迟与写锁等待两组直方图; le 边界上的 HDR 格按上界归入 (误差同格宽)
+    void render(std::string& out) const {
+        static const double kBounds[] = { 0.00001, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                          0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+        std::lock_guard<std::mutex> lk(mu_);
+        int routes = route_count_.load(std::memory_order_acquire);
+        std::vector<uint64_t> merged(LatencyHistogram::kBuckets);
+
+        out += "# HELP byd_http_request_duration_seconds Time from routing to response headers, by route and status.\n";
+        out += "# TYPE byd_http_request_duration_seconds histogram\n";
+        for (int r = 0; r < routes; r++) {
+            for (int c = 0; c < kMaxCodes; c++) {
+                if (codes_[c].empty()) continue;
+                uint64_t count = 0, sum_ns = 0;
+                std::fill(merged.begin(), merged.end(), 0);
+                bool any = false;
+                for (const auto& s : shards_) {
+                    const LatencyHistogram* h = s->requests[r][c].load(std::memory_order_acquire);
+                    if (!h) continue;
+                    any = true;
+                    mergeInto(*h, merged, count, sum_ns);
+                }
+                if (!any) continue;
+                std::string labels = "route=\"" + routes_[r] + "\",code=\"" + codes_[c] + "\"";
+                writeHistogram(out, "byd_http_request_duration_seconds", labels, merged, count, sum_ns,
+                               kBounds, sizeof(kBounds) / sizeof(kBounds[0]));
+            }
+        }
+
+        uint64_t count = 0, sum_ns = 0;
+        std::fill(merged.begin(), merged.end(), 0);
+        for (const auto& s : shards_) mergeInto(s->lock_wait, merged, count, sum_ns);
+        out += "# HELP byd_writer_lock_wait_seconds Time writers waited for the data manager lock.\n";
+        out += "# TYPE byd_writer_lock_wait_seconds histogram\n";
+        writeHistogram(out, "byd_writer_lock_wait_seconds", "", merged, count, sum_ns,
+                       kBounds, sizeof(kBounds) / sizeof(kBounds[0]));
+    }
+
+    // 其他模块的计数器与瞬时值, 导出时由调用方读取后写入
+    static void writeMetric(std::string& out, const char* name, const char* type, const char* help,
+                            double value, const std::string& labels = "") {
+        if (help) {
+            out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+            out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+        }
+        out += name;
+        if (!labels.empty()) { out += '{'; out += labels; out += '}'; }
+        out += ' ';
+        appendValue(out, value);
+        out += '\n';
+    }
+
+private:
+    struct Shard {
+        std::atomic<LatencyHistogram*> requests[kMaxRoutes][kMaxCodes];
+        LatencyHistogram lock_wait;
+
+        Shard() {
+            for (auto& r : requests)
+                for (auto& h : r) h.store(nullptr, std::memory_order_relaxed);
+        }
+        ~Shard() {
+            for (auto& r : requests)
+                for (auto& h : r) delete h.load(std::memory_order_relaxed);
+        }
+    };
+
+    mutable std::mutex mu_;         // 登记路由、状态码与分片; 导出
+    std::string routes_[kMaxRoutes];
+    std::atomic<int> route_count_{ 0 };
+    std::string codes_[kMaxCodes];
+    int code_count_ = 0;                // mu_
+    std::atomic<int> code_slot_[600];   // 状态码 -> 编号, -1 表示未登记
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard& shard() {
+        struct Local {
+            const MetricsRegistry* owner = nullptr;
+            Shard* shard = nullptr;
+        };
+        static thread_local Local t;
+        if (t.owner != this) {
+            std::unique_ptr<Shard> s(new Shard());
+            std::lock_guard<std::mutex> lk(mu_);
+            t.shard = s.get();
+            t.owner = this;
+            shards_.push_back(std::move(s));
+        }
+        return *t.shard;
+    }
+
+    int codeSlot(int status) {
+        int idx = status >= 100 && status < 600 ? status : 0;
+        int slot = code_slot_[idx].load(std::memory_order_acquire);
+        if (slot >= 0) return slot;
+        std::lock_guard<std::mutex> lk(mu_);
+        slot = code_slot_[idx].load(std::memory_order_relaxed);
+        if (slot >= 0) return slot;
+        int n = code_count_;
+        if (idx == 0 || n >= kMaxCodes - 1) {
+            // 非法状态码与超出上限的状态码共用最后一格
+            codes_[kMaxCodes - 1] = "other";
+            slot = kMaxCodes - 1;
+        } else {
+            codes_[n] = std::to_string(status);
+            slot = n;
+            code_count_ = n + 1;
+        }
+        code_slot_[idx].store(slot, std::memory_order_release);
+        return slot;
+    }
+
+    static void mergeInto(const LatencyHistogram& h, std::vector<uint64_t>& merged, uint64_t& count,
+                          uint64_t& sum_ns) {
+        for (int i = 0; i < LatencyHistogram::kBuckets; i++) merged[i] += h.bucket(i);
+        count += h.count();
+        sum_ns += h.sumNs();
+    }
+
+    static void writeHistogram(std::string& out, const char* name, const std::string& labels,
+                               const std::vector<uint64_t>& merged, uint64_t count, uint64_t sum_ns,
+                               const double* bounds, size_t n_bounds) {
+        std::string prefix = labels.empty() ? "" : labels + ",";
+        uint64_t cumulative = 0;
+        int i = 0;
+        for (size_t b = 0; b < n_bounds; b++) {
+            uint64_t limit_ns = (uint64_t)(bounds[b] * 1e9);
+            while (i < LatencyHistogram::kBuckets && LatencyHistogram::upperBound(i) <= limit_ns + 1) {
+                cumulative += merged[i++];
+            }
+            char le[32];
+            std::snprintf(le, sizeof(le), "%g", bounds[b]);
+            out += name; out += "_bucket{"; out += prefix; out += "le=\""; out += le; out += "\"} ";
+            out += std::to_string(cumulative); out += '\n';
+        }
+        // 各格与 _count 不是同一时刻读取的, +Inf 取 _count 保证两者一致
+        out += name; out += "_bucket{"; out += prefix; out += "le=\"+Inf\"} "; out += std::to_string(count);
+        out += '\n';
+        out += name; out += "_sum";
+        if (!labels.empty()) { out += '{'; out += labels; out += '}'; }
+        out += ' ';
+        appendValue(out, sum_ns / 1e9);
+        out += '\n';
+        out += name; out += "_count";
+        if (!labels.empty()) { out += '{'; out += labels; out += '}'; }
+        out += ' '; out += std::to_string(count); out += '\n';
+    }
+
+    static void appendValue(std::string& out, double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", v);
+        out += buf;
+    }
+};
+
+// 用法同 std::mutex; 没有竞争时只多一次 try_lock 与一次直方图写入
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(MetricsRegistry& registry, Tracer* tracer = nullptr)
+        : registry_(registry), tracer_(tracer) {}
+
+    void lock() {
+        if (mu_.try_lock()) {
+            registry_.recordLockWait(0);
+            return;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t trace_start = tracer_ && tracer_->sampling() ? tracer_->nowNs() : 0;
+        mu_.lock();
+        registry_.recordLockWait((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+        if (trace_start) tracer_->record("lock wait", trace_start, tracer_->nowNs());
+    }
+    bool try_lock() { return mu_.try_lock(); }
+    void unlock() { mu_.unlock(); }
+
+private:
+    std::mutex mu_;
+    MetricsRegistry& registry_;
+    Tracer* tracer_;
+};
+
+#endif // BYD_METRICS_H
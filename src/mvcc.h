@@ -0,0 +1,308 @@
+/**
+ * 多版本读取的并发基础组件
+ *
+ * 写者由调用方串行化 (持有同一把锁), 读者不加锁:
+ *   AppendVector  只追加数组, 分段分配, 元素地址不变, 以 release/acquire 发布长度
+ *   AtomicIntMap  只插入/覆盖的 int -> uint32 哈希表, 开放寻址, 每个槽一次原子读写
+ *   EpochDomain   基于纪元的内存回收: 读者登记纪元后读取共享对象, 写者摘下的对象在所有
+ *                 可能持有它的读者退出后才释放
+ */
+
+#ifndef BYD_MVCC_H
+#define BYD_MVCC_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 第 k 段容量为 kFirst << k, 48 段足以覆盖任何实际长度; 下标到 (段, 段内偏移) 只需一次求最高位
+template <typename T>
+class AppendVector {
+public:
+    AppendVector() {
+        for (auto& s : segs_) s.store(nullptr, std::memory_order_relaxed);
+    }
+    AppendVector(const AppendVector&) = delete;
+    AppendVector& operator=(const AppendVector&) = delete;
+    ~AppendVector() {
+        for (auto& s : segs_) delete[] s.load(std::memory_order_relaxed);
+    }
+
+    // 读者: 先取长度, 之后 [0, size) 内的元素均已完整写入
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    const T& operator[](size_t i) const {
+        size_t seg, off;
+        locate(i, seg, off);
+        return segs_[seg].load(std::memory_order_relaxed)[off];
+    }
+
+    // 写者 (调用方串行化)
+    void push_back(T v) {
+        size_t i = size_.load(std::memory_order_relaxed);
+        size_t seg, off;
+        locate(i, seg, off);
+        T* s = segs_[seg].load(std::memory_order_relaxed);
+        if (!s) {
+            s = new T[kFirst << seg];
+            segs_[seg].store(s, std::memory_order_relaxed);
+        }
+        s[off] = std::move(v);
+        size_.store(i + 1, std::memory_order_release);
+    }
+
+    // 按 key 单调不减排列时, 返回第一个 key(x) > k 的下标
+    template <typename Key>
+    size_t upperBound(size_t n, uint64_t k, Key key) const {
+        size_t lo = 0, hi = n;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (key((*this)[mid]) <= k) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+private:
+    static const unsigned kFirstBits = 4;
+    static const size_t kFirst = (size_t)1 << kFirstBits;
+    static const size_t kSegments = 48;
+
+    std::atomic<T*> segs_[kSegments];
+    std::atomic<size_t> size_{ 0 };
+
+    static unsigned bitWidth(uint64_t v) {
+#if defined(_MSC_VER)
+        unsigned n = 0;
+        while (v) { v >>= 1; n++; }
+        return n;
+#else
+        return 64 - (unsigned)__builtin_clzll(v);
+#endif
+    }
+
+    static void locate(size_t i, size_t& seg, size_t& off) {
+        uint64_t j = (uint64_t)i + kFirst;
+        unsigned w = bitWidth(j);
+        seg = w - 1 - kFirstBits;
+        off = (size_t)(j - ((uint64_t)1 << (w - 1)));
+    }
+};
+
+// 槽内打包 (key << 32) | (value + 1), 0 表示空槽; 负载超过 1/2 时写者建两倍大的新表后发布,
+// 旧表可能仍有读者在探测, 保留到整个对象析构 (总量不超过当前表的大小)
+class AtomicIntMap {
+public:
+    AtomicIntMap() : table_(nullptr) {}
+    AtomicIntMap(const AtomicIntMap&) = delete;
+    AtomicIntMap& operator=(const AtomicIntMap&) = delete;
+
+    bool find(int key, uint32_t& value) const {
+        const Table* t = table_.load(std::memory_order_acquire);
+        if (!t) return false;
+        for (size_t i = hash(key) & t->mask;; i = (i + 1) & t->mask) {
+            uint64_t s = t->slots[i].load(std::memory_order_acquire);
+            if (s == 0) return false;
+            if ((uint32_t)(s >> 32) == (uint32_t)key) {
+                value = (uint32_t)s - 1;
+                return true;
+            }
+        }
+    }
+
+    bool contains(int key) const {
+        uint32_t v;
+        return find(key, v);
+    }
+
+    // 写者 (调用方串行化): 插入或覆盖
+    void put(int key, uint32_t value) {
+        Table* t = table_.load(std::memory_order_relaxed);
+        if (!t || (count_ + 1) * 2 > t->mask + 1) t = grow(t);
+        if (store(*t, key, value)) count_++;
+    }
+
+    size_t size() const { return count_; }
+
+private:
+    struct Table {
+        size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+
+        explicit Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<uint64_t>[capacity]) {
+            for (size_t i = 0; i < capacity; i++) slots[i].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<Table*> table_;
+    std::vector<std::unique_ptr<Table>> tables_;    // 当前表在末尾
+    size_t count_ = 0;
+
+    static size_t hash(int key) {
+        uint64_t h = (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h >> 32);
+    }
+
+    static uint64_t pack(int key, uint32_t value) {
+        return ((uint64_t)(uint32_t)key << 32) | ((uint64_t)value + 1);
+    }
+
+    // 返回是否为新键
+    static bool store(Table& t, int key, uint32_t value) {
+        for (size_t i = hash(key) & t.mask;; i = (i + 1) & t.mask) {
+            uint64_t s = t.slots[i].load(std::memory_order_relaxed);
+            if (s == 0 || (uint32_t)(s >> 32) == (uint32_t)key) {
+                t.slots[i].store(pack(key, value), std::memory_order_release);
+                return s == 0;
+            }
+        }
+    }
+
+    Table* grow(Table* old) {
+        size_t capacity = old ? (old->mask + 1) * 2 : 16;
+        tables_.emplace_back(new Table(capacity));
+        Table* t = tables_.back().get();
+        if (old) {
+            for (size_t i = 0; i <= old->mask; i++) {
+                uint64_t s = old->slots[i].load(std::memory_order_relaxed);
+                if (s) store(*t, (int)(uint32_t)(s >> 32), (uint32_t)s - 1);
+            }
+        }
+        table_.store(t, std::memory_order_release);
+        return t;
+    }
+};
+
+class EpochDomain {
+public:
+    // 读者临界区: 构造时登记当前纪元, 析构时退出; 同一线程可嵌套
+    class Guard {
+    public:
+        Guard() = default;
+        explicit Guard(EpochDomain* d) : domain_(d) { domain_->enter(); }
+        Guard(Guard&& o) noexcept : domain_(o.domain_) { o.domain_ = nullptr; }
+        Guard& operator=(Guard&& o) noexcept {
+            if (this != &o) {
+                release();
+                domain_ = o.domain_;
+                o.domain_ = nullptr;
+            }
+            return *this;
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { release(); }
+
+    private:
+        EpochDomain* domain_ = nullptr;
+        void release() {
+            if (domain_) domain_->leave();
+            domain_ = nullptr;
+        }
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+    ~EpochDomain() {
+        for (auto& r : retired_) r.second();
+    }
+
+    Guard pin() { return Guard(this); }
+
+    // 对象已从共享结构中摘下后调用; deleter 在没有读者可能持有它时执行
+    void retire(std::function<void()> deleter) {
+        uint64_t e = epoch_.fetch_add(1, std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lk(retire_mu_);
+        retired_.emplace_back(e, std::move(deleter));
+    }
+
+    // 释放所有已安全的对象, 返回仍在等待的数量
+    size_t collect() {
+        uint64_t min_active = UINT64_MAX;
+        for (const Slot& s : slots_) {
+            uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e < min_active) min_active = e;
+        }
+        std::vector<std::function<void()>> ready;
+        size_t waiting;
+        {
+            std::lock_guard<std::mutex> lk(retire_mu_);
+            auto keep = retired_.begin();
+            for (auto it = retired_.begin(); it != retired_.end(); ++it) {
+                if (it->first < min_active) ready.push_back(std::move(it->second));
+                else *keep++ = std::move(*it);
+            }
+            retired_.erase(keep, retired_.end());
+            waiting = retired_.size();
+        }
+        for (auto& f : ready) f();
+        return waiting;
+    }
+
+private:
+    static const size_t kMaxSlots = 256;
+    static const uint64_t kIdle = UINT64_MAX;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ kIdle };
+        std::atomic<bool> used{ false };
+    };
+
+    // 线程首次进入某个域时以 CAS 占用一个槽位, 线程退出时归还
+    struct ThreadSlots {
+        struct Entry { EpochDomain* domain; Slot* slot; unsigned depth; };
+        Entry entries[4] = {};
+        ~ThreadSlots() {
+            for (Entry& e : entries) {
+                if (e.slot) e.slot->used.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    Slot slots_[kMaxSlots];
+    std::atomic<uint64_t> epoch_{ 1 };
+    std::mutex retire_mu_;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+
+    ThreadSlots::Entry& entry() {
+        static thread_local ThreadSlots tls;
+        ThreadSlots::Entry* free_entry = nullptr;
+        for (auto& e : tls.entries) {
+            if (e.domain == this) return e;
+            if (!e.domain && !free_entry) free_entry = &e;
+        }
+        // 每个线程最多同时使用 4 个域; 本程序只有一个
+        ThreadSlots::Entry& e = free_entry ? *free_entry : tls.entries[0];
+        e = { this, nullptr, 0 };
+        for (;;) {
+            for (Slot& s : slots_) {
+                bool expected = false;
+                if (!s.used.load(std::memory_order_relaxed) &&
+                    s.used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    e.slot = &s;
+                    return e;
+                }
+            }
+            std::this_thread::yield();   // 槽位用尽: 等待其他线程退出
+        }
+    }
+
+    void enter() {
+        ThreadSlots::Entry& e = entry();
+        if (e.depth++ == 0) e.slot->epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    void leave() {
+        ThreadSlots::Entry& e = entry();
+        if (--e.depth == 0) e.slot->epoch.store(kIdle, std::memory_order_release);
+    }
+};
+
+#endif // BYD_MVCC_H
@@ -0,0 +1,262 @@
+// 多版本读取的压力测试: 写者 / 读者 / 版本回收并发运行, 检查每个可读版本的数据都与该版本提交时一致
+//
+//   g++ -std=c++17 -O2 -pthread -o mvcc_stress mvcc_stress.cpp
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -pthread -o mvcc_stress_tsan mvcc_stress.cpp
+//   ./mvcc_stress [--commits=60000] [--cycles=5]
+//
+// 直接包含服务端源码, 使用同一个 CarDataManager (不启动 HTTP 服务, 不打开 WAL);
+// 数据文件与重新加载写出的快照放在临时目录中, 不触碰 ../data。保留窗口为 0, 回收线程不停地并入与摘除旧版本。
+// 1. 单条提交: 写者逐条添加车型, 3 个读者检查最新版本与稍旧版本的车型数 = 版本号 - 起始偏移
+// 2. 重新加载 -> 并入 -> as_of: 重新加载之后的提交被并入新基础数据集时, 重新加载与并入点之间的版本
+//    和时间必须返回 "已超出保留窗口", 不能落回重新加载之前的数据代
+// 3. 反复重新加载与批量提交, 读者按随机的 as_of_version / as_of_time 读取, 检查车型数与所读版本一致
+// 发现不一致时打印并以 1 退出
+
+#define main byd_main
+#include "main.cpp"
+#undef main
+
+#include <random>
+
+// 只供本测试使用: 不摘除旧数据代, 单独并入当前数据代的增量
+struct MvccStressAccess {
+    static void fold(CarDataManager& m, int64_t limit_ms) {
+        std::lock_guard<std::mutex> ck(m.compact_mtx_);
+        m.foldLocked(limit_ms);
+    }
+};
+
+namespace {
+
+std::atomic<long> g_bad{ 0 };
+
+void fail(const string& what) {
+    g_bad++;
+    cerr << "FAIL: " << what << endl;
+}
+
+int modelCount(const CarDataManager::ReadView& view) {
+    int s, m, t;
+    view.getStats(s, m, t);
+    return m;
+}
+
+bool addModels(int first_id, int n, const string& prefix) {
+    string err;
+    for (int i = 0; i < n; i++) {
+        if (!g_manager.addModel(first_id + i, prefix + to_string(i), 1, 10 + i % 90, 0, "EV", "", 5, "2024", { 101 }, err)) {
+            fail("addModel: " + err);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 数据文件: 1 个系列、1 个技术、1 个车型
+void writeDataFile() {
+    ofstream out(DATA_FILE);
+    out << "[SERIES]\n1,s1,\n\n[TECH]\n101,t101,\n\n[MODEL]\n1,m0,1,10,0,EV,,5,2024\n\n[MODEL_TECH]\n1,101\n";
+}
+
+// 阶段 1: 空数据集上逐条提交, 版本 v 时车型数为 v - 3 (v1 空数据代, v2 系列, v3 技术)
+void singleCommits(int commits) {
+    std::atomic<bool> stop{ false };
+    std::atomic<long> reads{ 0 };
+    string err;
+    g_manager.addSeries(1, "s1", "", err);
+    g_manager.addTech(101, "t101", "", err);
+    std::thread writer([&]() {
+        addModels(1000, commits, "m");
+        stop = true;
+    });
+    std::thread gc([&]() {
+        while (!stop) {
+            g_manager.collectVersions();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 rng(r);
+            while (!stop) {
+                auto v = g_manager.latestView();
+                if ((uint64_t)modelCount(v) != v.version() - 3) fail("latest version " + to_string(v.version()));
+                auto d = v.getModelDetail(1000 + (int)(rng() % commits));
+                if (d.model.model_id && d.tech_names.size() != 1) fail("model techs at " + to_string(v.version()));
+                CarDataManager::ReadView old;
+                string e;
+                if (v.version() > 10 && g_manager.viewAtVersion(v.version() - 5, old, e) &&
+                    (uint64_t)modelCount(old) != old.version() - 3) {
+                    fail("as_of_version " + to_string(old.version()));
+                }
+                reads++;
+            }
+        });
+    }
+    writer.join();
+    gc.join();
+    for (auto& t : readers) t.join();
+    cout << "single commits: " << commits << " commits, " << reads << " reads" << endl;
+}
+
+// 阶段 2: 重新加载 (版本 F) -> 提交 F+1..F+n -> 并入到最后一次提交, 之前的数据代仍挂在链上
+void reloadFoldAsOf() {
+    uint64_t before = g_manager.latestView().version();
+    int before_models = modelCount(g_manager.latestView());
+    auto r = g_manager.reload();
+    if (!r.ok) {
+        fail("reload: " + r.message);
+        return;
+    }
+    uint64_t floor = g_manager.latestView().version();
+    int64_t reload_ms = unixMillis();
+    const int n = 5000;
+    addModels(100000, n / 2, "r");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    int64_t mid_ms = unixMillis();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    addModels(100000 + n / 2, n - n / 2, "r2_");
+    MvccStressAccess::fold(g_manager, unixMillis());
+
+    CarDataManager::ReadView view;
+    string err;
+    // 重新加载之前的版本仍在旧数据代中
+    if (g_manager.viewAtVersion(before, view, err) && modelCount(view) != before_models) {
+        fail("pre-reload version " + to_string(before) + " has " + to_string(modelCount(view)) + " models");
+    }
+    // 被并入的版本: 重新加载本身与之后的提交
+    for (uint64_t v : { floor, floor + 1, floor + n / 2, floor + n - 1 }) {
+        if (g_manager.viewAtVersion(v, view, err)) {
+            fail("folded version " + to_string(v) + " readable with " + to_string(modelCount(view)) + " models");
+        } else if (err.find("已超出保留窗口") == string::npos) {
+            fail("folded version " + to_string(v) + ": " + err);
+        }
+    }
+    for (int64_t t : { reload_ms, mid_ms }) {
+        if (g_manager.viewAtTime(t, view, err)) {
+            fail("folded time readable at version " + to_string(view.version()) + " with " +
+                 to_string(modelCount(view)) + " models");
+        }
+    }
+    if (!g_manager.viewAtVersion(floor + n, view, err) || modelCount(view) != 1 + n) {
+        fail("latest version after fold");
+    }
+    cout << "reload -> fold -> as_of: reload at version " << floor << ", folded through " << floor + n << endl;
+}
+
+// 阶段 3: 写者反复重新加载并提交, 读者检查任意可读版本的车型数
+// 第 i 轮从版本 F_i 开始, 版本 x (F_i <= x < F_{i+1}) 时车型数为 1 + (x - F_i)
+struct Cycles {
+    std::mutex mu;
+    vector<uint64_t> floors;
+    uint64_t known_upto = UINT64_MAX;   // 正在重新加载时为之前的最新版本, 更新的版本尚不知属于哪一轮
+};
+
+void reloadCycles(int cycles) {
+    Cycles c;
+    std::atomic<bool> stop{ false };
+    std::atomic<long> reads{ 0 }, gaps{ 0 };
+    std::thread writer([&]() {
+        for (int i = 0; i < cycles; i++) {
+            {
+                std::lock_guard<std::mutex> lk(c.mu);
+                c.known_upto = g_manager.latestView().version();
+            }
+            auto r = g_manager.reload();
+            if (!r.ok) fail("reload: " + r.message);
+            {
+                std::lock_guard<std::mutex> lk(c.mu);
+                c.floors.push_back(g_manager.latestView().version());
+                c.known_upto = UINT64_MAX;
+            }
+            addModels(200000, 4500, "c" + to_string(i) + "_");
+        }
+        stop = true;
+    });
+    std::thread gc([&]() {
+        while (!stop) {
+            g_manager.collectVersions();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+    vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&, r]() {
+            std::mt19937_64 rng(100 + r);
+            while (!stop) {
+                vector<uint64_t> floors;
+                uint64_t upto;
+                {
+                    std::lock_guard<std::mutex> lk(c.mu);
+                    floors = c.floors;
+                    upto = std::min(c.known_upto, g_manager.latestView().version());
+                }
+                if (floors.empty() || upto < floors.front()) continue;
+                CarDataManager::ReadView view;
+                string err;
+                bool ok;
+                if (rng() % 4 == 0) {
+                    // 最近 50 ms 内的随机时间
+                    ok = g_manager.viewAtTime(unixMillis() - (int64_t)(rng() % 50), view, err);
+                } else {
+                    uint64_t x = upto - rng() % std::min<uint64_t>(upto - floors.front() + 1, 6000);
+                    ok = g_manager.viewAtVersion(x, view, err);
+                }
+                reads++;
+                if (!ok) {
+                    gaps++;
+                    continue;
+                }
+                uint64_t x = view.version();
+                if (x < floors.front() || x > upto) continue;
+                uint64_t floor = *(std::upper_bound(floors.begin(), floors.end(), x) - 1);
+                if ((uint64_t)modelCount(view) != 1 + (x - floor)) {
+                    fail("version " + to_string(x) + " (reload at " + to_string(floor) + ") has " +
+                         to_string(modelCount(view)) + " models");
+                }
+            }
+        });
+    }
+    writer.join();
+    gc.join();
+    for (auto& t : readers) t.join();
+    cout << "reload cycles: " << cycles << " cycles, " << reads << " reads, " << gaps << " outside the window" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int commits = 60000, cycles = 5;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 10, "--commits=") == 0) commits = atoi(arg.c_str() + 10);
+        else if (arg.compare(0, 9, "--cycles=") == 0) cycles = atoi(arg.c_str() + 9);
+        else {
+            cerr << "Usage: " << argv[0] << " [--commits=N] [--cycles=N]" << endl;
+            return 1;
+        }
+    }
+    // DATA_FILE 等路径相对于 ../data: 在临时目录下建 data/ 与 run/ 并切换到 run/
+    char tmpl[] = "/tmp/mvcc_stress.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "mkdtemp failed" << endl;
+        return 1;
+    }
+    std::filesystem::path dir = tmpl;
+    std::filesystem::create_directories(dir / "data");
+    std::filesystem::create_directories(dir / "run");
+    std::filesystem::current_path(dir / "run");
+    writeDataFile();
+
+    g_manager.setVersionWindow(0);
+    singleCommits(commits);
+    reloadFoldAsOf();
+    reloadCycles(cycles);
+
+    std::filesystem::current_path("/");
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    cout << (g_bad ? "FAILED: " + to_string(g_bad.load()) + " violations" : string("OK")) << endl;
+    return g_bad ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+// 非有限数值的写入测试: "nan" / "inf" / "-inf" 作为价格或续航提交时, 各写入接口都必须拒绝
+//
+//   g++ -std=c++17 -O2 -pthread -o number_input_test number_input_test.cpp
+//   ./number_input_test
+//
+// 直接包含服务端源码, 在临时目录中以 --watch-data=off --watch-web=off 启动服务端 (占用 8080 端口, 不触碰 ../data),
+// 依次向 /api/model/add、/api/bulk、/api/import (NDJSON 与 CSV) 提交非有限数值, 检查:
+// 1. 请求返回 ok:false 或逐行错误, 车型数不变
+// 2. /api/models 与 /api/export 的输出中没有 nan / inf
+// 同时提交一个价格为字符串 "12.5" 的车型作为对照, 它必须被接受。发现问题时打印并以 1 退出
+
+#define main byd_main
+#include "main.cpp"
+#undef main
+
+namespace {
+
+int g_bad = 0;
+
+void fail(const string& what) {
+    g_bad++;
+    cerr << "FAIL: " << what << endl;
+}
+
+int modelCount(httplib::Client& cli) {
+    auto r = cli.Get("/api/stats");
+    if (!r) return -1;
+    size_t p = r->body.find("\"model_count\":");
+    return p == string::npos ? -1 : atoi(r->body.c_str() + p + 14);
+}
+
+bool hasNonFinite(const string& body) {
+    return body.find("nan") != string::npos || body.find("inf") != string::npos;
+}
+
+void writeDataFile() {
+    ofstream out(DATA_FILE);
+    out << "[SERIES]\n1,s1,\n\n[TECH]\n101,t101,\n\n[MODEL]\n1,m0,1,10,0,EV,,5,2024\n\n[MODEL_TECH]\n1,101\n";
+}
+
+void postNonFinite(httplib::Client& cli) {
+    const char* values[] = { "nan", "inf", "-inf", "NaN", "infinity" };
+    const char* fields[] = { "price", "range_km" };
+    int before = modelCount(cli);
+    int n = 0;
+    for (const char* field : fields) {
+        for (const char* v : values) {
+            string name = string("nf_") + field + "_" + v + "_";
+            string price = strcmp(field, "price") == 0 ? string("\"") + v + "\"" : "12.5";
+            string range = strcmp(field, "range_km") == 0 ? string("\"") + v + "\"" : "500";
+            string model = "{\"model_name\":\"" + name + to_string(n++) + "\",\"series_id\":1,\"price\":" + price +
+                           ",\"range_km\":" + range + ",\"energy_type\":\"EV\",\"tech_ids\":[101]}";
+
+            auto r = cli.Post("/api/model/add", model, "application/json");
+            if (!r || r->body.find("\"ok\":false") == string::npos) {
+                fail(string("/api/model/add accepted ") + field + "=" + v + ": " + (r ? r->body : "no response"));
+            }
+
+            string bulk_model = "{\"model_id\":" + to_string(5000 + n) + model.substr(1);
+            r = cli.Post("/api/bulk", "{\"models\":[" + bulk_model + "]}", "application/json");
+            if (!r || (r->body.find("\"applied\":0") == string::npos && r->body.find("\"ok\":false") == string::npos)) {
+                fail(string("/api/bulk accepted ") + field + "=" + v + ": " + (r ? r->body : "no response"));
+            }
+
+            r = cli.Post("/api/import?format=ndjson&entity=models", bulk_model + "\n", "application/x-ndjson");
+            if (!r || (r->body.find("\"ok\":true") != string::npos && r->body.find("\"error_count\":0") != string::npos)) {
+                fail(string("/api/import (ndjson) accepted ") + field + "=" + v + ": " + (r ? r->body : "no response"));
+            }
+
+            string csv_row = to_string(6000 + n) + "," + name + "csv,1," +
+                             (strcmp(field, "price") == 0 ? string(v) : "12.5") + "," +
+                             (strcmp(field, "range_km") == 0 ? string(v) : "500") + ",EV,,5,2024\n";
+            r = cli.Post("/api/import?format=csv&entity=models",
+                         "model_id,model_name,series_id,price,range_km,energy_type,body_type,seats,launch_year\n" + csv_row,
+                         "text/csv");
+            if (!r || (r->body.find("\"ok\":true") != string::npos && r->body.find("\"error_count\":0") != string::npos)) {
+                fail(string("/api/import (csv) accepted ") + field + "=" + v + ": " + (r ? r->body : "no response"));
+            }
+        }
+    }
+    int after = modelCount(cli);
+    if (after != before) fail("model count changed from " + to_string(before) + " to " + to_string(after));
+    cout << "non-finite values: " << n * 4 << " requests, model count " << before << " -> " << after << endl;
+
+    // 对照: 数字字符串仍然接受
+    auto r = cli.Post("/api/model/add",
+                      "{\"model_name\":\"对照车型\",\"series_id\":1,\"price\":\"12.5\",\"energy_type\":\"EV\",\"tech_ids\":[101]}",
+                      "application/json");
+    if (!r || r->body.find("\"ok\":true") == string::npos) fail("finite price rejected: " + (r ? r->body : string("no response")));
+    if (modelCount(cli) != after + 1) fail("finite model not added");
+
+    for (const char* path : { "/api/models", "/api/export?entity=models", "/api/export?entity=models&format=csv" }) {
+        r = cli.Get(path);
+        if (!r || hasNonFinite(r->body)) fail(string(path) + " contains a non-finite number");
+    }
+}
+
+}  // namespace
+
+int main() {
+    // DATA_FILE 等路径相对于 ../data: 在临时目录下建 data/ 与 run/ 并切换到 run/
+    char tmpl[] = "/tmp/number_input_test.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        cerr << "mkdtemp failed" << endl;
+        return 1;
+    }
+    std::filesystem::path dir = tmpl;
+    std::filesystem::create_directories(dir / "data");
+    std::filesystem::create_directories(dir / "run");
+    std::filesystem::current_path(dir / "run");
+    writeDataFile();
+
+    httplib::Client cli("127.0.0.1", 8080);
+    if (cli.Get("/api/stats")) {
+        cerr << "Port 8080 is already in use, stop the running server first" << endl;
+        return 1;
+    }
+    std::thread server([]() {
+        char arg0[] = "byd_server", arg1[] = "--watch-data=off", arg2[] = "--watch-web=off", arg3[] = "--threads=4";
+        char* argv[] = { arg0, arg1, arg2, arg3, nullptr };
+        byd_main(4, argv);
+    });
+    bool up = false;
+    for (int i = 0; i < 100 && !up; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        up = (bool)cli.Get("/api/stats");
+    }
+    if (up) postNonFinite(cli);
+    else fail("server did not start");
+
+    handleStopSignal(SIGTERM);
+    server.join();
+    std::filesystem::current_path("/");
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    cout << (g_bad ? "FAILED: " + to_string(g_bad) + " checks" : string("OK")) << endl;
+    return g_bad ? 1 : 0;
+}
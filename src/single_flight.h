@@ -0,0 +1,92 @@
+/**
+ * 相同请求的合并计算 (single-flight)
+ *
+ * 同一个键同一时刻只计算一次: 第一个到达的请求负责计算, 计算期间到达的相同请求等待它完成,
+ * 共享同一份结果 (shared_ptr, 不复制)。计算结束后键随即删除, 之后到达的请求重新计算, 这里不做缓存。
+ * 键由调用方组成并包含数据版本, 不同版本的请求互不合并, 等待者拿到的结果不会比自己到达时的数据旧。
+ * 计算抛出异常时, 所有等待者收到同一个异常。
+ */
+
+#ifndef BYD_SINGLE_FLIGHT_H
+#define BYD_SINGLE_FLIGHT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class SingleFlight {
+public:
+    using Result = std::shared_ptr<const std::string>;
+
+    struct Stats {
+        uint64_t computed;      // 实际计算的次数
+        uint64_t coalesced;     // 等待并共享了他人结果的请求数
+        size_t inflight;        // 正在计算的键
+    };
+
+    // compute: () -> std::string, 只在当前没有相同键的计算时调用
+    template <typename F>
+    Result run(const std::string& key, F&& compute) {
+        std::unique_lock<std::mutex> lk(mu_);
+        auto it = calls_.find(key);
+        if (it != calls_.end()) {
+            std::shared_ptr<Call> call = it->second;
+            coalesced_++;
+            call->cv.wait(lk, [&]() { return call->done; });
+            if (call->error) std::rethrow_exception(call->error);
+            return call->result;
+        }
+        std::shared_ptr<Call> call = std::make_shared<Call>();
+        calls_.emplace(key, call);
+        computed_++;
+        lk.unlock();
+
+        Result result;
+        std::exception_ptr error;
+        try {
+            result = std::make_shared<const std::string>(compute());
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lk.lock();
+        calls_.erase(key);
+        call->result = result;
+        call->error = error;
+        call->done = true;
+        lk.unlock();
+        call->cv.notify_all();
+        if (error) std::rethrow_exception(error);
+        return result;
+    }
+
+    // 是否有相同键正在计算 (加入它的请求只需等待, 开销很小)
+    bool inflight(const std::string& key) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return calls_.count(key) != 0;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return Stats{ computed_, coalesced_, calls_.size() };
+    }
+
+private:
+    struct Call {
+        std::condition_variable cv;
+        bool done = false;
+        Result result;
+        std::exception_ptr error;
+    };
+
+    mutable std::mutex mu_;
+    std::unordered_map<std::string, std::shared_ptr<Call>> calls_;
+    uint64_t computed_ = 0;
+    uint64_t coalesced_ = 0;
+};
+
+#endif // BYD_SINGLE_FLIGHT_H
@@ -0,0 +1,552 @@
+/**
+ * 二进制快照 (可直接 mmap)
+ *
+ * 文件布局 (小端序, 各段按 8 字节对齐):
+ *   [文件头 64B][段表 N x 40B][段数据 ...][文件尾 32B]
+ * 段类型:
+ *   - 系列 / 技术 / 车型 / 车型-技术: 定长记录数组, 按主键 (关联按 model_id, tech_id) 排序, 可直接二分查找
+ *   - 字符串堆: 记录中的字符串以 {偏移, 长度} 引用, 能源类型等重复值只存一份
+ *   - 预建索引: 各表按名称排序的下标数组 (唯一约束检查), 以及每个车型在关联数组中的 [起, 止) 区间
+ *   - 行组统计: 车型数组每 kZoneRows 行一组, 记录价格/续航/系列的最小最大值, 范围筛选据此跳过整组
+ * 读取端 mmap 后直接在映射上查找, 不做反序列化; 访问时检查越界, 损坏的文件不会导致越界读。
+ * 文件头中的版本号与当前代码不一致时拒绝加载, 由调用方回退到文本数据文件。
+ *
+ * 完整性: 文件头、段表各带 CRC32C, 每段数据单独一个 CRC32C; 文件尾重复写入序号、文件大小与文件头校验和,
+ * 最后写出, 只写了一部分的文件因缺少匹配的文件尾而被拒绝。序号由调用方在 A/B 两个槽位间递增,
+ * 两个槽位都有效时取序号大者。
+ */
+
+#ifndef BYD_SNAPSHOT_H
+#define BYD_SNAPSHOT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "crc32c.h"
+#include "mapped_file.h"
+#include "wal.h"
+
+namespace snapshot_format {
+
+const char kMagic[8] = { 'B', 'Y', 'D', 'S', 'N', 'A', 'P', '\0' };
+const char kFooterMagic[8] = { 'B', 'Y', 'D', 'S', 'E', 'N', 'D', '\0' };
+const uint32_t kVersion = 2;
+const uint32_t kMaxSections = 32;
+
+enum SectionKind : uint32_t {
+    kSeries = 1,
+    kTechs = 2,
+    kModels = 3,
+    kModelTechs = 4,
+    kStrings = 5,
+    kSeriesNameIndex = 6,
+    kTechNameIndex = 7,
+    kModelNameIndex = 8,
+    kModelTechRange = 9,    // 与车型数组一一对应
+    kModelZones = 10        // 车型行组统计 (旧快照没有此段时不做跳过)
+};
+
+const uint32_t kZoneRows = 4096;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t wal_lsn;       // 快照已包含的最大 WAL lsn
+    uint64_t file_size;
+    uint64_t sequence;      // 写入序号
+    uint32_t table_crc;     // 段表的 CRC32C
+    uint32_t header_crc;    // 文件头 (本字段置 0) 的 CRC32C
+    char reserved[16];
+};
+
+struct SectionEntry {
+    uint32_t kind;
+    uint32_t elem_size;
+    uint64_t offset;
+    uint64_t count;
+    uint64_t bytes;
+    uint32_t crc;           // 段数据的 CRC32C
+    uint32_t reserved;
+};
+
+struct FileFooter {
+    char magic[8];
+    uint64_t sequence;
+    uint64_t file_size;
+    uint32_t header_crc;
+    uint32_t footer_crc;    // 前 28 字节的 CRC32C
+};
+
+struct StrRef {
+    uint32_t off;
+    uint32_t len;
+};
+
+} // namespace snapshot_format
+
+struct SnapSeries {
+    int32_t id;
+    uint32_t pad;
+    snapshot_format::StrRef name;
+    snapshot_format::StrRef intro;
+};
+
+struct SnapTech {
+    int32_t id;
+    uint32_t pad;
+    snapshot_format::StrRef name;
+    snapshot_format::StrRef intro;
+};
+
+struct SnapModel {
+    double price;
+    double range_km;
+    int32_t id;
+    int32_t series_id;
+    int32_t seats;
+    uint32_t pad;
+    snapshot_format::StrRef name;
+    snapshot_format::StrRef energy_type;
+    snapshot_format::StrRef body_type;
+    snapshot_format::StrRef launch_year;
+};
+
+struct SnapModelTech {
+    int32_t model_id;
+    int32_t tech_id;
+};
+
+struct SnapRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// 车型数组中 [begin, end) 行的统计
+struct SnapZone {
+    double min_price, max_price;
+    double min_range, max_range;
+    int32_t min_series_id, max_series_id;
+    uint32_t begin, end;
+};
+
+static_assert(sizeof(snapshot_format::FileHeader) == 64, "snapshot header layout");
+static_assert(sizeof(snapshot_format::SectionEntry) == 40, "snapshot section layout");
+static_assert(sizeof(snapshot_format::FileFooter) == 32, "snapshot footer layout");
+static_assert(sizeof(SnapSeries) == 24 && sizeof(SnapTech) == 24, "snapshot record layout");
+static_assert(sizeof(SnapModel) == 64 && sizeof(SnapModelTech) == 8 && sizeof(SnapRange) == 8 &&
+              sizeof(SnapZone) == 48, "snapshot record layout");
+
+// 构建快照: 逐行添加记录, write() / build() 时排序并生成索引。
+// write() 经临时文件 + rename 原子写入文件, build() 生成内存中的同一份映像 (供 MappedSnapshot::openImage)
+class SnapshotBuilder {
+public:
+    void addSeries(int32_t id, std::string_view name, std::string_view intro) {
+        series_.push_back({ id, 0, addString(name), addString(intro) });
+    }
+
+    void addTech(int32_t id, std::string_view name, std::string_view intro) {
+        techs_.push_back({ id, 0, addString(name), addString(intro) });
+    }
+
+    void addModel(int32_t id, std::string_view name, int32_t series_id, double price, double range_km,
+                  std::string_view energy_type, std::string_view body_type, int32_t seats,
+                  std::string_view launch_year) {
+        SnapModel m;
+        m.price = price;
+        m.range_km = range_km;
+        m.id = id;
+        m.series_id = series_id;
+        m.seats = seats;
+        m.pad = 0;
+        m.name = addString(name);
+        m.energy_type = internString(energy_type);
+        m.body_type = internString(body_type);
+        m.launch_year = internString(launch_year);
+        models_.push_back(m);
+    }
+
+    // 字符串已由调用方放入堆 (addString / internString) 时直接添加记录
+    void addModel(const SnapModel& m) { models_.push_back(m); }
+
+    void addModelTech(int32_t model_id, int32_t tech_id) { model_techs_.push_back({ model_id, tech_id }); }
+
+    void reserveModels(size_t models, size_t model_techs, size_t heap_bytes) {
+        models_.reserve(models);
+        model_techs_.reserve(model_techs);
+        heap_.reserve(heap_bytes);
+    }
+
+    snapshot_format::StrRef addString(std::string_view s) {
+        if (heap_.size() + s.size() > UINT32_MAX) { overflow_ = true; return { 0, 0 }; }
+        snapshot_format::StrRef r = { (uint32_t)heap_.size(), (uint32_t)s.size() };
+        heap_.append(s.data(), s.size());
+        return r;
+    }
+
+    // 取值集合很小的列 (能源类型, 车身, 年份) 只存一份
+    snapshot_format::StrRef internString(std::string_view s) {
+        auto it = interned_.find(std::string(s));
+        if (it != interned_.end()) return it->second;
+        snapshot_format::StrRef r = addString(s);
+        interned_.emplace(std::string(s), r);
+        return r;
+    }
+
+    bool write(const std::string& path, uint64_t wal_lsn, uint64_t sequence, std::string& err) {
+        AtomicFileWriter out(path);
+        if (!out.isOpen()) { err = "无法创建快照文件 " + path; return false; }
+        bool ok = emit(wal_lsn, sequence, err, [&](const void* p, size_t n) {
+            out.write(std::string_view(static_cast<const char*>(p), n));
+        });
+        return ok && out.commit(err);
+    }
+
+    bool build(std::string& image, uint64_t wal_lsn, uint64_t sequence, std::string& err) {
+        image.clear();
+        return emit(wal_lsn, sequence, err, [&](const void* p, size_t n) {
+            if (image.empty()) image.reserve(imageSize());
+            image.append(static_cast<const char*>(p), n);
+        });
+    }
+
+private:
+    std::vector<SnapSeries> series_;
+    std::vector<SnapTech> techs_;
+    std::vector<SnapModel> models_;
+    std::vector<SnapModelTech> model_techs_;
+    std::string heap_;
+    std::unordered_map<std::string, snapshot_format::StrRef> interned_;
+    bool overflow_ = false;
+    uint64_t image_size_ = 0;
+
+    static uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+    size_t imageSize() const { return (size_t)image_size_; }
+
+    // 排序、生成索引并依次输出整个文件; put(const void*, size_t)
+    template <typename Put>
+    bool emit(uint64_t wal_lsn, uint64_t sequence, std::string& err, Put put) {
+        using namespace snapshot_format;
+        if (overflow_) { err = "快照字符串堆超过 4GB"; return false; }
+
+        // 从已排序的来源 (列式文件) 构建时各表已有序, 只需检查一遍
+        auto sortIfNeeded = [](auto& v, auto less) {
+            if (!std::is_sorted(v.begin(), v.end(), less)) std::sort(v.begin(), v.end(), less);
+        };
+        auto byId = [](const auto& a, const auto& b) { return a.id < b.id; };
+        sortIfNeeded(series_, byId);
+        sortIfNeeded(techs_, byId);
+        sortIfNeeded(models_, byId);
+        sortIfNeeded(model_techs_, [](const SnapModelTech& a, const SnapModelTech& b) {
+            return a.model_id != b.model_id ? a.model_id < b.model_id : a.tech_id < b.tech_id;
+        });
+        model_techs_.erase(std::unique(model_techs_.begin(), model_techs_.end(),
+                                       [](const SnapModelTech& a, const SnapModelTech& b) {
+                                           return a.model_id == b.model_id && a.tech_id == b.tech_id;
+                                       }),
+                           model_techs_.end());
+
+        std::vector<uint32_t> series_names = nameIndex(series_);
+        std::vector<uint32_t> tech_names = nameIndex(techs_);
+        std::vector<uint32_t> model_names = nameIndex(models_);
+
+        // 关联中可能有车型已不存在的孤立行, 因此每个车型单独记录区间
+        std::vector<SnapRange> mt_range(models_.size());
+        size_t j = 0;
+        for (size_t i = 0; i < models_.size(); i++) {
+            while (j < model_techs_.size() && model_techs_[j].model_id < models_[i].id) j++;
+            mt_range[i].begin = (uint32_t)j;
+            while (j < model_techs_.size() && model_techs_[j].model_id == models_[i].id) j++;
+            mt_range[i].end = (uint32_t)j;
+        }
+
+        std::vector<SnapZone> zones;
+        for (size_t b = 0; b < models_.size(); b += kZoneRows) {
+            size_t e = std::min(models_.size(), b + (size_t)kZoneRows);
+            SnapZone z = { models_[b].price, models_[b].price, models_[b].range_km, models_[b].range_km,
+                           models_[b].series_id, models_[b].series_id, (uint32_t)b, (uint32_t)e };
+            for (size_t i = b + 1; i < e; i++) {
+                const SnapModel& m = models_[i];
+                z.min_price = std::min(z.min_price, m.price);
+                z.max_price = std::max(z.max_price, m.price);
+                z.min_range = std::min(z.min_range, m.range_km);
+                z.max_range = std::max(z.max_range, m.range_km);
+                z.min_series_id = std::min(z.min_series_id, m.series_id);
+                z.max_series_id = std::max(z.max_series_id, m.series_id);
+            }
+            zones.push_back(z);
+        }
+
+        std::vector<SectionEntry> sections;
+        uint64_t offset = sizeof(FileHeader) + 10 * sizeof(SectionEntry);
+        auto add = [&](uint32_t kind, const void* body, uint32_t elem_size, size_t count) {
+            SectionEntry e = { kind, elem_size, offset, (uint64_t)count, (uint64_t)elem_size * count, 0, 0 };
+            e.crc = crc32c(body, (size_t)e.bytes);
+            sections.push_back(e);
+            offset = align8(offset + e.bytes);
+        };
+        add(kSeries, series_.data(), sizeof(SnapSeries), series_.size());
+        add(kTechs, techs_.data(), sizeof(SnapTech), techs_.size());
+        add(kModels, models_.data(), sizeof(SnapModel), models_.size());
+        add(kModelTechs, model_techs_.data(), sizeof(SnapModelTech), model_techs_.size());
+        add(kStrings, heap_.data(), 1, heap_.size());
+        add(kSeriesNameIndex, series_names.data(), sizeof(uint32_t), series_names.size());
+        add(kTechNameIndex, tech_names.data(), sizeof(uint32_t), tech_names.size());
+        add(kModelNameIndex, model_names.data(), sizeof(uint32_t), model_names.size());
+        add(kModelTechRange, mt_range.data(), sizeof(SnapRange), mt_range.size());
+        add(kModelZones, zones.data(), sizeof(SnapZone), zones.size());
+
+        FileHeader h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.section_count = (uint32_t)sections.size();
+        h.wal_lsn = wal_lsn;
+        h.file_size = offset + sizeof(FileFooter);
+        h.sequence = sequence;
+        h.table_crc = crc32c(sections.data(), sections.size() * sizeof(SectionEntry));
+        h.header_crc = crc32c(&h, sizeof(h));
+
+        FileFooter f;
+        std::memcpy(f.magic, kFooterMagic, sizeof(kFooterMagic));
+        f.sequence = sequence;
+        f.file_size = h.file_size;
+        f.header_crc = h.header_crc;
+        f.footer_crc = crc32c(&f, offsetof(FileFooter, footer_crc));
+        image_size_ = h.file_size;
+
+        uint64_t pos = 0;
+        auto padTo = [&](uint64_t target) {
+            static const char zeros[8] = {};
+            if (target > pos) put(zeros, (size_t)(target - pos));
+            pos = target;
+        };
+        put(&h, sizeof(h));
+        put(sections.data(), sections.size() * sizeof(SectionEntry));
+        pos = sizeof(h) + sections.size() * sizeof(SectionEntry);
+        const void* bodies[] = { series_.data(), techs_.data(), models_.data(), model_techs_.data(), heap_.data(),
+                                 series_names.data(), tech_names.data(), model_names.data(), mt_range.data(),
+                                 zones.data() };
+        for (size_t i = 0; i < sections.size(); i++) {
+            padTo(sections[i].offset);
+            put(bodies[i], (size_t)sections[i].bytes);
+            pos += sections[i].bytes;
+        }
+        padTo(offset);
+        put(&f, sizeof(f));
+        return true;
+    }
+
+    template <typename Rec>
+    std::vector<uint32_t> nameIndex(const std::vector<Rec>& recs) const {
+        std::vector<uint32_t> idx(recs.size());
+        for (size_t i = 0; i < idx.size(); i++) idx[i] = (uint32_t)i;
+        // 归并排序: 名称常有长公共前缀且部分有序, 快速排序在这类输入上容易退化为堆排序
+        std::stable_sort(idx.begin(), idx.end(), [&](uint32_t a, uint32_t b) {
+            return heapStr(recs[a].name) < heapStr(recs[b].name);
+        });
+        return idx;
+    }
+
+    std::string_view heapStr(snapshot_format::StrRef r) const { return std::string_view(heap_.data() + r.off, r.len); }
+};
+
+// 只读访问 mmap 的快照; 线程安全 (构建后不再修改)
+class MappedSnapshot {
+public:
+    template <typename T>
+    struct Array {
+        const T* data = nullptr;
+        size_t size = 0;
+        const T* begin() const { return data; }
+        const T* end() const { return data + size; }
+        const T& operator[](size_t i) const { return data[i]; }
+        bool empty() const { return size == 0; }
+    };
+
+    MappedSnapshot() = default;
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    // verify_data 为 false 时只校验文件头、段表与文件尾, 不读取段数据 (映射后按需换入)
+    bool open(const std::string& path, std::string& err, bool verify_data = true) {
+        if (!file_.open(path, err, verify_data)) return false;
+        return bindImage(path, err, verify_data);
+    }
+
+    // 直接使用内存中的快照映像 (SnapshotBuilder::build 的结果); name 只用于错误信息
+    bool openImage(std::string image, const std::string& name, std::string& err) {
+        file_.adopt(std::move(image));
+        return bindImage(name, err, false);
+    }
+
+    uint64_t walLsn() const { return wal_lsn_; }
+    uint64_t sequence() const { return sequence_; }
+    size_t fileSize() const { return size_; }
+    const char* imageData() const { return base_; }
+
+    Array<SnapSeries> series() const { return series_; }
+    Array<SnapTech> techs() const { return techs_; }
+    Array<SnapModel> models() const { return models_; }
+    Array<SnapModelTech> modelTechs() const { return model_techs_; }
+    Array<SnapZone> modelZones() const { return zones_; }    // 旧快照中为空, 调用方需扫描全部车型
+
+    std::string_view str(snapshot_format::StrRef r) const {
+        if (r.off > strings_.size || r.len > strings_.size - r.off) return std::string_view();
+        return std::string_view(strings_.data + r.off, r.len);
+    }
+
+    const SnapSeries* findSeries(int32_t id) const { return findById(series_, id); }
+    const SnapTech* findTech(int32_t id) const { return findById(techs_, id); }
+    const SnapModel* findModel(int32_t id) const { return findById(models_, id); }
+
+    bool hasSeriesName(std::string_view name) const { return hasName(series_, series_names_, name); }
+    bool hasTechName(std::string_view name) const { return hasName(techs_, tech_names_, name); }
+    bool hasModelName(std::string_view name) const { return hasName(models_, model_names_, name); }
+
+    // 车型 m (必须来自本快照) 绑定的技术
+    Array<SnapModelTech> techsOf(const SnapModel* m) const {
+        const SnapRange& r = mt_range_[(size_t)(m - models_.data)];
+        if (r.begin > r.end || r.end > model_techs_.size) return Array<SnapModelTech>();
+        return Array<SnapModelTech>{ model_techs_.data + r.begin, r.end - r.begin };
+    }
+
+    bool hasModelTech(int32_t model_id, int32_t tech_id) const {
+        const SnapModel* m = findModel(model_id);
+        if (!m) return false;
+        Array<SnapModelTech> mts = techsOf(m);
+        return std::binary_search(mts.begin(), mts.end(), SnapModelTech{ model_id, tech_id },
+                                  [](const SnapModelTech& a, const SnapModelTech& b) { return a.tech_id < b.tech_id; });
+    }
+
+private:
+    MappedFile file_;
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t wal_lsn_ = 0;
+    uint64_t sequence_ = 0;
+
+    Array<SnapSeries> series_;
+    Array<SnapTech> techs_;
+    Array<SnapModel> models_;
+    Array<SnapModelTech> model_techs_;
+    Array<char> strings_;
+    Array<uint32_t> series_names_;
+    Array<uint32_t> tech_names_;
+    Array<uint32_t> model_names_;
+    Array<SnapRange> mt_range_;
+    Array<SnapZone> zones_;
+
+    // 校验并绑定 file_ 中的映像
+    bool bindImage(const std::string& name, std::string& err, bool verify_data) {
+        using namespace snapshot_format;
+        base_ = file_.data();
+        size_ = file_.size();
+        if (size_ < sizeof(FileHeader) + sizeof(FileFooter)) { err = "快照文件过短: " + name; return false; }
+
+        FileHeader h;
+        std::memcpy(&h, base_, sizeof(h));
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) { err = "快照文件头无效: " + name; return false; }
+        if (h.version != kVersion) {
+            err = "快照版本 " + std::to_string(h.version) + " 与当前版本 " + std::to_string(kVersion) + " 不一致";
+            return false;
+        }
+        uint32_t header_crc = h.header_crc;
+        h.header_crc = 0;
+        if (crc32c(&h, sizeof(h)) != header_crc) { err = "快照文件已损坏 (文件头校验和不符): " + name; return false; }
+        const size_t body_end = size_ - sizeof(FileFooter);
+        if (h.file_size != size_ || h.section_count > kMaxSections ||
+            sizeof(FileHeader) + (uint64_t)h.section_count * sizeof(SectionEntry) > body_end) {
+            err = "快照文件已损坏 (大小不符): " + name;
+            return false;
+        }
+        FileFooter f;
+        std::memcpy(&f, base_ + body_end, sizeof(f));
+        if (std::memcmp(f.magic, kFooterMagic, sizeof(kFooterMagic)) != 0 ||
+            crc32c(&f, offsetof(FileFooter, footer_crc)) != f.footer_crc ||
+            f.sequence != h.sequence || f.file_size != h.file_size || f.header_crc != header_crc) {
+            err = "快照文件不完整 (文件尾无效): " + name;
+            return false;
+        }
+        const SectionEntry* sec = reinterpret_cast<const SectionEntry*>(base_ + sizeof(FileHeader));
+        if (crc32c(sec, h.section_count * sizeof(SectionEntry)) != h.table_crc) {
+            err = "快照文件已损坏 (段表校验和不符): " + name;
+            return false;
+        }
+        wal_lsn_ = h.wal_lsn;
+        sequence_ = h.sequence;
+
+        for (uint32_t i = 0; i < h.section_count; i++) {
+            const SectionEntry& e = sec[i];
+            if (e.offset % 8 != 0 || e.offset > body_end || e.bytes > body_end - e.offset ||
+                e.elem_size == 0 || e.count != e.bytes / e.elem_size || e.bytes % e.elem_size != 0) {
+                err = "快照文件已损坏 (段表越界): " + name;
+                return false;
+            }
+            if (verify_data && crc32c(base_ + e.offset, (size_t)e.bytes) != e.crc) {
+                err = "快照文件已损坏 (第 " + std::to_string(i + 1) + " 段校验和不符): " + name;
+                return false;
+            }
+            bool ok = true;
+            switch (e.kind) {
+                case kSeries:          ok = bind(e, series_); break;
+                case kTechs:           ok = bind(e, techs_); break;
+                case kModels:          ok = bind(e, models_); break;
+                case kModelTechs:      ok = bind(e, model_techs_); break;
+                case kStrings:         ok = bind(e, strings_); break;
+                case kSeriesNameIndex: ok = bind(e, series_names_); break;
+                case kTechNameIndex:   ok = bind(e, tech_names_); break;
+                case kModelNameIndex:  ok = bind(e, model_names_); break;
+                case kModelTechRange:  ok = bind(e, mt_range_); break;
+                case kModelZones:      ok = bind(e, zones_); break;
+                default: break;        // 未知段: 向前兼容, 忽略
+            }
+            if (!ok) { err = "快照文件已损坏 (记录长度不符): " + name; return false; }
+        }
+        if (mt_range_.size != models_.size) { err = "快照文件缺少车型-技术索引: " + name; return false; }
+        // 行组统计可以缺失 (旧快照), 存在时必须依次覆盖全部车型
+        uint32_t covered = 0;
+        for (const SnapZone& z : zones_) {
+            if (z.begin != covered || z.end < z.begin || z.end > models_.size) {
+                err = "快照文件已损坏 (行组统计越界): " + name;
+                return false;
+            }
+            covered = z.end;
+        }
+        if (zones_.size && covered != models_.size) { err = "快照文件已损坏 (行组统计越界): " + name; return false; }
+        if (verify_data) file_.adviseNormal();
+        return true;
+    }
+
+    template <typename T>
+    bool bind(const snapshot_format::SectionEntry& e, Array<T>& out) {
+        if (e.elem_size != sizeof(T)) return false;
+        out.data = reinterpret_cast<const T*>(base_ + e.offset);
+        out.size = (size_t)e.count;
+        return true;
+    }
+
+    template <typename Rec>
+    static const Rec* findById(const Array<Rec>& recs, int32_t id) {
+        const Rec* it = std::lower_bound(recs.begin(), recs.end(), id,
+                                         [](const Rec& r, int32_t v) { return r.id < v; });
+        return (it != recs.end() && it->id == id) ? it : nullptr;
+    }
+
+    template <typename Rec>
+    bool hasName(const Array<Rec>& recs, const Array<uint32_t>& idx, std::string_view name) const {
+        auto nameAt = [&](uint32_t i) { return i < recs.size ? str(recs[i].name) : std::string_view(); };
+        const uint32_t* it = std::lower_bound(idx.begin(), idx.end(), name,
+                                              [&](uint32_t i, std::string_view v) { return nameAt(i) < v; });
+        return it != idx.end() && nameAt(*it) == name;
+    }
+};
+
+#endif // BYD_SNAPSHOT_H
@@ -0,0 +1,329 @@
+/**
+ * 内存中的静态资源缓存
+ *
+ * 启动时把 web/ 目录整体读入内存 (目录内文件变化时由调用方重新 load), 之后的请求只查哈希表、不访问文件系统:
+ *   - 文本类文件预先压缩出 gzip (编译时定义 BYD_WITH_ZSTD 并链接 -lzstd 时另有 zstd) 版本,
+ *     按 Accept-Encoding 选用 zstd > gzip > 原文; 压缩后没有变小的只保留原文
+ *   - ETag 取内容哈希, If-None-Match 命中时返回 304
+ *   - 每个非 HTML 文件另有一个带内容哈希的名字 (app.js -> app.1a2b3c4d5e6f7a8b.js), HTML 中对它们的
+ *     src / href 引用改写为这个名字。带哈希的名字内容不会变, 返回一年的 immutable 缓存;
+ *     其他名字 (包括 HTML) 返回 no-cache, 浏览器每次用 ETag 重新验证
+ * load 生成新表后整体替换, 正在发送的响应仍持有旧表。
+ */
+
+#ifndef BYD_STATIC_ASSETS_H
+#define BYD_STATIC_ASSETS_H
+
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "httplib.h"
+#include "gzip.h"
+
+#ifdef BYD_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+class StaticAssets {
+public:
+    struct Stats {
+        size_t files = 0;
+        size_t bytes = 0;           // 原文总大小
+        size_t gzip_bytes = 0;      // 按实际发送的最小版本计
+    };
+
+    // 失败时保留当前内容
+    bool load(const std::string& dir, std::string& err) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        if (!fs::is_directory(dir, ec)) {
+            err = "静态资源目录不存在: " + dir;
+            return false;
+        }
+        std::vector<std::pair<std::string, std::string>> files;     // 相对路径, 内容
+        for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (!name.empty() && name[0] == '.') {
+                if (it->is_directory(ec)) it.disable_recursion_pending();
+                continue;
+            }
+            if (!it->is_regular_file(ec)) continue;
+            std::ifstream in(it->path(), std::ios::binary);
+            std::stringstream ss;
+            if (!in || !(ss << in.rdbuf())) {
+                err = "无法读取静态资源 " + it->path().string();
+                return false;
+            }
+            files.push_back({ fs::relative(it->path(), dir, ec).generic_string(), ss.str() });
+        }
+        if (ec) {
+            err = "无法遍历静态资源目录 " + dir;
+            return false;
+        }
+
+        auto table = std::make_shared<Table>();
+        Stats stats;
+        // 先处理非 HTML 文件得到带哈希的名字, HTML 改写引用后再计算自己的哈希
+        std::unordered_map<std::string, std::string> fingerprinted;     // 相对路径 -> 带哈希的相对路径
+        for (int pass = 0; pass < 2; pass++) {
+            for (auto& f : files) {
+                bool html = isHtml(f.first);
+                if (html != (pass == 1)) continue;
+                if (html) f.second = rewriteReferences(f.first, f.second, fingerprinted);
+                auto content = makeContent(f.first, std::move(f.second));
+                table->emplace("/" + f.first, Entry{ content, false });
+                if (!html) {
+                    std::string alias = fingerprint(f.first, content->hash);
+                    fingerprinted[f.first] = alias;
+                    table->emplace("/" + alias, Entry{ content, true });
+                }
+                stats.files++;
+                stats.bytes += content->identity.size();
+                stats.gzip_bytes += std::min(content->identity.size(),
+                                             content->gzip.empty() ? SIZE_MAX : content->gzip.size());
+            }
+        }
+        std::atomic_store(&table_, std::shared_ptr<const Table>(table));
+        std::atomic_store(&stats_, std::make_shared<const Stats>(stats));
+        return true;
+    }
+
+    Stats stats() const {
+        auto s = std::atomic_load(&stats_);
+        return s ? *s : Stats();
+    }
+
+    // 找到资源时写好响应并返回 true; 目录路径映射到其中的 index.html
+    bool serve(const httplib::Request& req, httplib::Response& res) const {
+        if (req.method != "GET" && req.method != "HEAD") return false;
+        std::shared_ptr<const Table> table = std::atomic_load(&table_);
+        if (!table) return false;
+        auto it = table->find(req.path.empty() || req.path.back() == '/' ? req.path + "index.html" : req.path);
+        if (it == table->end()) return false;
+        const Entry& e = it->second;
+        const Content& c = *e.content;
+
+        res.set_header("Cache-Control", e.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+        if (!c.gzip.empty() || !c.zstd.empty()) res.set_header("Vary", "Accept-Encoding");
+        if (etagMatches(req.get_header_value("If-None-Match"), c.etag)) {
+            res.set_header("ETag", c.etag);
+            res.status = 304;
+            return true;
+        }
+
+        const std::string* body = &c.identity;
+        const char* encoding = nullptr;
+        const std::string& accept = req.get_header_value("Accept-Encoding");
+        if (!c.zstd.empty() && accepts(accept, "zstd")) {
+            body = &c.zstd;
+            encoding = "zstd";
+        } else if (!c.gzip.empty() && accepts(accept, "gzip")) {
+            body = &c.gzip;
+            encoding = "gzip";
+        }
+        // 不同编码是不同的表示, ETag 加上编码后缀
+        res.set_header("ETag", encoding ? c.etag.substr(0, c.etag.size() - 1) + "-" + encoding + "\"" : c.etag);
+        if (encoding) res.set_header("Content-Encoding", encoding);
+        // 直接从缓存的内存写出, 不复制到 res.body; 闭包持有整张表, 替换后旧内容在发送完之前不会释放
+        res.set_content_provider(body->size(), c.content_type,
+                                 [table, body](size_t offset, size_t length, httplib::DataSink& sink) {
+                                     return sink.write(body->data() + offset, length);
+                                 });
+        return true;
+    }
+
+private:
+    struct Content {
+        std::string content_type;
+        uint64_t hash = 0;
+        std::string etag;           // "<16 位十六进制哈希>"
+        std::string identity;
+        std::string gzip;
+        std::string zstd;
+    };
+    struct Entry {
+        std::shared_ptr<const Content> content;
+        bool immutable;             // 带内容哈希的名字
+    };
+    using Table = std::unordered_map<std::string, Entry>;
+
+    std::shared_ptr<const Table> table_;
+    std::shared_ptr<const Stats> stats_;
+
+    static const size_t kMinCompressBytes = 256;
+
+    static uint64_t contentHash(const std::string& s) {
+        uint64_t h = 1469598103934665603ull;     // FNV-1a
+        for (unsigned char c : s) h = (h ^ c) * 1099511628211ull;
+        return h;
+    }
+
+    static std::string hex(uint64_t v) {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+        return buf;
+    }
+
+    static std::string extension(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+        std::string ext = path.substr(dot + 1);
+        for (char& c : ext) c = (char)tolower((unsigned char)c);
+        return ext;
+    }
+
+    static bool isHtml(const std::string& path) {
+        std::string ext = extension(path);
+        return ext == "html" || ext == "htm";
+    }
+
+    static std::string contentType(const std::string& path) {
+        static const std::unordered_map<std::string, std::string> types = {
+            { "html", "text/html; charset=utf-8" },     { "htm", "text/html; charset=utf-8" },
+            { "js", "application/javascript; charset=utf-8" }, { "mjs", "application/javascript; charset=utf-8" },
+            { "css", "text/css; charset=utf-8" },       { "json", "application/json" },
+            { "map", "application/json" },              { "txt", "text/plain; charset=utf-8" },
+            { "svg", "image/svg+xml" },                 { "xml", "application/xml" },
+            { "png", "image/png" },                     { "jpg", "image/jpeg" },
+            { "jpeg", "image/jpeg" },                   { "gif", "image/gif" },
+            { "webp", "image/webp" },                   { "ico", "image/x-icon" },
+            { "woff", "font/woff" },                    { "woff2", "font/woff2" },
+            { "ttf", "font/ttf" },                      { "wasm", "application/wasm" },
+        };
+        auto it = types.find(extension(path));
+        return it == types.end() ? "application/octet-stream" : it->second;
+    }
+
+    static bool compressible(const std::string& type) {
+        return type.compare(0, 5, "text/") == 0 || type.find("javascript") != std::string::npos ||
+               type.find("json") != std::string::npos || type.find("xml") != std::string::npos ||
+               type == "application/wasm" || type == "font/ttf";
+    }
+
+    static std::shared_ptr<const Content> makeContent(const std::string& path, std::string data) {
+        auto c = std::make_shared<Content>();
+        c->content_type = contentType(path);
+        c->hash = contentHash(data);
+        c->etag = "\"" + hex(c->hash) + "\"";
+        if (data.size() >= kMinCompressBytes && compressible(c->content_type)) {
+            c->gzip = gzipCompress(data);
+            if (c->gzip.size() >= data.size()) c->gzip.clear();
+#ifdef BYD_WITH_ZSTD
+            c->zstd.resize(ZSTD_compressBound(data.size()));
+            size_t n = ZSTD_compress(&c->zstd[0], c->zstd.size(), data.data(), data.size(), 19);
+            if (ZSTD_isError(n) || n >= data.size()) c->zstd.clear();
+            else c->zstd.resize(n);
+#endif
+        }
+        c->identity = std::move(data);
+        return c;
+    }
+
+    // dir/app.js -> dir/app.<hash>.js
+    static std::string fingerprint(const std::string& path, uint64_t hash) {
+        size_t slash = path.find_last_of('/');
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + "." + hex(hash);
+        return path.substr(0, dot) + "." + hex(hash) + path.substr(dot);
+    }
+
+    // 把 HTML 中 src="..." / href="..." 指向本目录资源的引用换成带哈希的名字, 只替换文件名部分
+    static std::string rewriteReferences(const std::string& html_path, const std::string& html,
+                                         const std::unordered_map<std::string, std::string>& fingerprinted) {
+        size_t slash = html_path.find_last_of('/');
+        std::string base_dir = slash == std::string::npos ? "" : html_path.substr(0, slash + 1);
+        std::string out;
+        out.reserve(html.size());
+        size_t pos = 0;
+        for (;;) {
+            size_t attr = std::string::npos;
+            size_t value_start = 0;
+            for (const char* name : { "src=", "href=" }) {
+                size_t p = html.find(name, pos);
+                while (p != std::string::npos && p > 0 && isalnum((unsigned char)html[p - 1])) p = html.find(name, p + 1);
+                if (p != std::string::npos && p < attr) {
+                    attr = p;
+                    value_start = p + strlen(name);
+                }
+            }
+            if (attr == std::string::npos || value_start >= html.size()) break;
+            char quote = html[value_start];
+            size_t value_end = quote == '"' || quote == '\'' ? html.find(quote, value_start + 1) : std::string::npos;
+            if (value_end == std::string::npos) {
+                out.append(html, pos, value_start - pos);
+                pos = value_start;
+                continue;
+            }
+            std::string value = html.substr(value_start + 1, value_end - value_start - 1);
+            std::string target;
+            if (!value.empty() && value[0] == '/') target = value.substr(1);
+            else target = base_dir + (value.compare(0, 2, "./") == 0 ? value.substr(2) : value);
+            out.append(html, pos, value_start + 1 - pos);
+            auto it = fingerprinted.find(target);
+            if (it != fingerprinted.end()) {
+                size_t name_at = value.find_last_of('/');
+                name_at = name_at == std::string::npos ? 0 : name_at + 1;
+                size_t alias_at = it->second.find_last_of('/');
+                alias_at = alias_at == std::string::npos ? 0 : alias_at + 1;
+                out += value.substr(0, name_at) + it->second.substr(alias_at);
+            } else {
+                out += value;
+            }
+            pos = value_end;
+        }
+        out.append(html, pos, std::string::npos);
+        return out;
+    }
+
+    static bool etagMatches(const std::string& header, const std::string& etag) {
+        if (header.empty()) return false;
+        // etag 形如 "hash", 客户端可能带回 "hash-gzip" 等编码后缀或 W/ 前缀
+        std::string hash = etag.substr(1, etag.size() - 2);
+        std::stringstream ss(header);
+        std::string tok;
+        while (std::getline(ss, tok, ',')) {
+            size_t b = tok.find_first_not_of(" \t");
+            if (b == std::string::npos) continue;
+            tok = tok.substr(b, tok.find_last_not_of(" \t") - b + 1);
+            if (tok == "*") return true;
+            if (tok.compare(0, 2, "W/") == 0) tok = tok.substr(2);
+            if (tok.size() < 2 || tok.front() != '"' || tok.back() != '"') continue;
+            tok = tok.substr(1, tok.size() - 2);
+            if (tok == hash || tok == hash + "-gzip" || tok == hash + "-zstd") return true;
+        }
+        return false;
+    }
+
+    // Accept-Encoding 中是否接受 coding (q=0 表示拒绝)
+    static bool accepts(const std::string& header, const char* coding) {
+        std::stringstream ss(header);
+        std::string tok;
+        while (std::getline(ss, tok, ',')) {
+            size_t b = tok.find_first_not_of(" \t");
+            if (b == std::string::npos) continue;
+            size_t semi = tok.find(';');
+            std::string name = tok.substr(b, semi == std::string::npos ? std::string::npos : semi - b);
+            name = name.substr(0, name.find_last_not_of(" \t") + 1);
+            if (name != coding) continue;
+            if (semi == std::string::npos) return true;
+            size_t q = tok.find("q=", semi);
+            return q == std::string::npos || atof(tok.c_str() + q + 2) > 0;
+        }
+        return false;
+    }
+};
+
+#endif // BYD_STATIC_ASSETS_H
@@ -0,0 +1,431 @@
+/**
+ * 多进程模式的主进程 (Linux)
+ *
+ * 主进程不处理请求, 只持有监听套接字并管理工作进程:
+ *   监听套接字   每个工作进程槽位一个, 都以 SO_REUSEPORT 绑定同一端口, 由内核在槽位间分配新连接。
+ *                套接字在主进程的整个生命周期内保持打开, 槽位上的工作进程更替时, 已排在其接受队列中的连接
+ *                由接替的进程接受, 不会因为关闭监听套接字而被重置。
+ *   工作进程     fork 后 exec 当前可执行文件, 通过参数得到槽位、监听套接字与就绪管道的描述符;
+ *                加载完数据、即将开始接受连接时向管道写一个字节。主进程退出时工作进程收到 SIGTERM。
+ *   滚动重启     SIGHUP: 先重新整理数据 (prepare), 然后逐个槽位启动新工作进程, 新进程就绪后才向旧进程发 SIGTERM;
+ *                旧进程停止接受连接、处理完已接受的请求后退出, 超过排空时间仍未退出时 SIGKILL。
+ *                新进程启动失败或超时未就绪时中止滚动, 旧进程继续服务。替换可执行文件后发 SIGHUP 即完成部署。
+ *   停止         SIGTERM / SIGINT: 向全部工作进程转发 SIGTERM, 等它们排空退出后返回。
+ * 工作进程意外退出时在同一槽位重新启动 (启动后 1 秒内退出的, 间隔 1 秒再试)。
+ * 主进程是单线程的: 信号处理函数只向自管道写入信号编号, 由主循环 poll 后处理。其他平台上 supported() 返回 false。
+ */
+
+#ifndef BYD_SUPERVISOR_H
+#define BYD_SUPERVISOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class Supervisor {
+public:
+    struct Options {
+        int workers = 2;
+        int ready_timeout_ms = 60000;   // 新工作进程从启动到就绪的最长时间
+        int drain_timeout_ms = 30000;   // 旧工作进程排空的最长时间, 超过后 SIGKILL
+    };
+
+    static bool supported() { return true; }
+
+    Supervisor() = default;
+    Supervisor(const Supervisor&) = delete;
+    Supervisor& operator=(const Supervisor&) = delete;
+    ~Supervisor() {
+        for (int fd : listen_fds_) ::close(fd);
+        if (sig_pipe_[0] >= 0) ::close(sig_pipe_[0]);
+        if (sig_pipe_[1] >= 0) ::close(sig_pipe_[1]);
+    }
+
+    // 为每个槽位创建并监听一个 SO_REUSEPORT 套接字
+    bool listen(const Options& opt, int port, std::string& err) {
+        opt_ = opt;
+        char buf[4096];
+        ssize_t n = ::readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+        if (n <= 0) { err = "无法取得可执行文件路径"; return false; }
+        exe_.assign(buf, (size_t)n);
+        for (int i = 0; i < opt_.workers; i++) {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int on = 1;
+            sockaddr_in addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)port);
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+                ::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+                err = "无法监听端口 " + std::to_string(port) + ": " + std::strerror(errno);
+                if (fd >= 0) ::close(fd);
+                return false;
+            }
+            listen_fds_.push_back(fd);
+        }
+        return true;
+    }
+
+    // 启动全部工作进程并处理信号, 收到 SIGTERM / SIGINT 且工作进程全部退出后返回。
+    // args: 工作进程的命令行参数 (不含程序名), 会追加 --worker=<槽位>,<监听描述符>,<就绪描述符>;
+    // prepare: 滚动重启前调用, 返回 false 时不重启
+    int run(const std::vector<std::string>& args, const std::function<bool()>& prepare) {
+        args_ = args;
+        if (!installSignals()) {
+            std::fprintf(stderr, "Supervisor: cannot install signal handlers\n");
+            return 1;
+        }
+        std::printf("Supervisor: pid %d\n", (int)::getpid());
+        for (int slot = 0; slot < opt_.workers; slot++) spawn(slot);
+
+        while (!stopping_ || !workers_.empty()) {
+            std::vector<pollfd> fds;
+            fds.push_back(pollfd{ sig_pipe_[0], POLLIN, 0 });
+            for (const Worker& w : workers_) {
+                if (w.state == Starting) fds.push_back(pollfd{ w.ready_fd, POLLIN, 0 });
+            }
+            int n = ::poll(fds.data(), fds.size(), 200);
+            if (n < 0 && errno != EINTR) break;
+            if (n > 0) {
+                for (size_t i = 1; i < fds.size(); i++) {
+                    if (fds[i].revents) onReadyFd(fds[i].fd);
+                }
+                if (fds[0].revents) handleSignals(prepare);
+            }
+            checkTimers();
+        }
+        std::printf("Supervisor: all workers stopped\n");
+        std::fflush(stdout);
+        return 0;
+    }
+
+    // 工作进程: 加载完成、即将接受连接时通知主进程
+    static void notifyReady(int fd) {
+        char c = 1;
+        while (::write(fd, &c, 1) < 0 && errno == EINTR) {}
+        ::close(fd);
+    }
+
+    // 工作进程的 SIGTERM / SIGINT 处理: 不带 SA_RESTART 安装, 使阻塞在 accept 中的线程被信号打断后返回
+    static void installStopHandler(void (*handler)(int)) {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handler;
+        sigemptyset(&sa.sa_mask);
+        ::sigaction(SIGTERM, &sa, nullptr);
+        ::sigaction(SIGINT, &sa, nullptr);
+    }
+
+private:
+    enum State { Starting, Ready, Draining };
+
+    struct Worker {
+        pid_t pid;
+        int slot;
+        State state;
+        int ready_fd;           // Starting 时有效
+        int64_t started_ms;
+        int64_t deadline_ms;    // Starting: 就绪期限; Draining: 排空期限
+    };
+
+    Options opt_;
+    std::string exe_;
+    std::vector<std::string> args_;
+    std::vector<int> listen_fds_;
+    std::vector<Worker> workers_;
+    std::vector<int64_t> respawn_at_;   // 槽位等待重新启动的时间, 0 表示不等待
+    int sig_pipe_[2] = { -1, -1 };
+    bool stopping_ = false;
+    int rolling_slot_ = -1;             // 正在滚动重启的槽位, -1 表示没有进行中的滚动
+    pid_t rolling_pid_ = 0;             // 该槽位上新启动的工作进程
+
+    static int& signalFd() {
+        static int fd = -1;
+        return fd;
+    }
+
+    static void onSignal(int sig) {
+        int saved = errno;
+        unsigned char c = (unsigned char)sig;
+        ssize_t r = ::write(signalFd(), &c, 1);
+        (void)r;
+        errno = saved;
+    }
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool installSignals() {
+        if (::pipe2(sig_pipe_, O_CLOEXEC | O_NONBLOCK) != 0) return false;
+        signalFd() = sig_pipe_[1];
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = onSignal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        for (int sig : { SIGTERM, SIGINT, SIGHUP, SIGCHLD }) {
+            if (::sigaction(sig, &sa, nullptr) != 0) return false;
+        }
+        respawn_at_.assign((size_t)opt_.workers, 0);
+        return true;
+    }
+
+    Worker* find(pid_t pid) {
+        for (Worker& w : workers_) if (w.pid == pid) return &w;
+        return nullptr;
+    }
+
+    // 在槽位上启动一个工作进程, 失败时返回 0
+    pid_t spawn(int slot) {
+        int ready[2];
+        if (::pipe2(ready, O_CLOEXEC) != 0) {
+            std::fprintf(stderr, "Supervisor: pipe failed: %s\n", std::strerror(errno));
+            return 0;
+        }
+        ::fcntl(ready[0], F_SETFL, O_NONBLOCK);
+        std::vector<std::string> args = args_;
+        args.push_back("--worker=" + std::to_string(slot) + "," + std::to_string(listen_fds_[slot]) + "," +
+                       std::to_string(ready[1]));
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(exe_.c_str()));
+        for (std::string& a : args) argv.push_back(&a[0]);
+        argv.push_back(nullptr);
+
+        pid_t parent = ::getpid();
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            // 子进程: 主进程退出时收到 SIGTERM; 只让本槽位的套接字与就绪管道跨过 exec
+            ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (::getppid() != parent) ::_exit(1);
+            struct sigaction sa;
+            std::memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = SIG_DFL;
+            for (int sig : { SIGTERM, SIGINT, SIGHUP, SIGCHLD }) ::sigaction(sig, &sa, nullptr);
+            ::fcntl(listen_fds_[slot], F_SETFD, 0);
+            ::fcntl(ready[1], F_SETFD, 0);
+            ::execv(exe_.c_str(), argv.data());
+            std::fprintf(stderr, "Supervisor: exec %s failed: %s\n", exe_.c_str(), std::strerror(errno));
+            ::_exit(127);
+        }
+        ::close(ready[1]);
+        if (pid < 0) {
+            std::fprintf(stderr, "Supervisor: fork failed: %s\n", std::strerror(errno));
+            ::close(ready[0]);
+            return 0;
+        }
+        int64_t now = nowMs();
+        workers_.push_back(Worker{ pid, slot, Starting, ready[0], now, now + opt_.ready_timeout_ms });
+        std::printf("Supervisor: worker %d started (pid %d)\n", slot, (int)pid);
+        std::fflush(stdout);
+        return pid;
+    }
+
+    void onReadyFd(int fd) {
+        for (Worker& w : workers_) {
+            if (w.state != Starting || w.ready_fd != fd) continue;
+            char c;
+            ssize_t r = ::read(fd, &c, 1);
+            if (r < 0 && (errno == EINTR || errno == EAGAIN)) return;
+            ::close(fd);
+            w.ready_fd = -1;
+            if (r != 1) {
+                // 就绪前退出: 由 SIGCHLD 回收并处理
+                w.state = Ready;
+                return;
+            }
+            w.state = Ready;
+            std::printf("Supervisor: worker %d ready (pid %d)\n", w.slot, (int)w.pid);
+            std::fflush(stdout);
+            if (w.pid == rolling_pid_) retireOld(w);
+            return;
+        }
+    }
+
+    // 滚动重启中新进程已就绪: 让同槽位的旧进程排空, 然后继续下一个槽位
+    void retireOld(const Worker& fresh) {
+        for (Worker& w : workers_) {
+            if (w.slot != fresh.slot || w.pid == fresh.pid || w.state == Draining) continue;
+            drain(w);
+        }
+        rolling_pid_ = 0;
+        nextRollingSlot(fresh.slot + 1);
+    }
+
+    void drain(Worker& w) {
+        if (w.state == Starting) {
+            ::close(w.ready_fd);
+            w.ready_fd = -1;
+        }
+        w.state = Draining;
+        w.deadline_ms = nowMs() + opt_.drain_timeout_ms;
+        ::kill(w.pid, SIGTERM);
+        std::printf("Supervisor: worker %d draining (pid %d)\n", w.slot, (int)w.pid);
+        std::fflush(stdout);
+    }
+
+    void nextRollingSlot(int slot) {
+        if (slot >= opt_.workers) {
+            rolling_slot_ = -1;
+            std::printf("Supervisor: rolling restart finished\n");
+            std::fflush(stdout);
+            return;
+        }
+        rolling_slot_ = slot;
+        rolling_pid_ = spawn(slot);
+        if (rolling_pid_ == 0) abortRolling("cannot start worker");
+    }
+
+    void abortRolling(const char* why) {
+        std::fprintf(stderr, "Supervisor: rolling restart aborted at worker %d: %s, old workers keep serving\n",
+                     rolling_slot_, why);
+        rolling_slot_ = -1;
+        rolling_pid_ = 0;
+    }
+
+    void handleSignals(const std::function<bool()>& prepare) {
+        unsigned char sigs[64];
+        ssize_t n;
+        while ((n = ::read(sig_pipe_[0], sigs, sizeof(sigs))) > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                int sig = sigs[i];
+                if (sig == SIGCHLD) reap();
+                else if (sig == SIGHUP) startRolling(prepare);
+                else if (!stopping_) stopAll();
+            }
+        }
+    }
+
+    void startRolling(const std::function<bool()>& prepare) {
+        if (stopping_) return;
+        if (rolling_slot_ >= 0) {
+            std::printf("Supervisor: rolling restart already in progress\n");
+            std::fflush(stdout);
+            return;
+        }
+        std::printf("Supervisor: rolling restart\n");
+        std::fflush(stdout);
+        if (prepare && !prepare()) {
+            std::fprintf(stderr, "Supervisor: data not prepared, workers not restarted\n");
+            return;
+        }
+        nextRollingSlot(0);
+    }
+
+    void stopAll() {
+        stopping_ = true;
+        rolling_slot_ = -1;
+        rolling_pid_ = 0;
+        std::printf("Supervisor: stopping %zu workers\n", workers_.size());
+        std::fflush(stdout);
+        for (Worker& w : workers_) {
+            if (w.state != Draining) drain(w);
+        }
+    }
+
+    void reap() {
+        int status;
+        pid_t pid;
+        while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+            Worker* w = find(pid);
+            if (!w) continue;
+            Worker dead = *w;
+            if (dead.ready_fd >= 0) ::close(dead.ready_fd);
+            workers_.erase(workers_.begin() + (w - workers_.data()));
+            if (dead.state == Draining) {
+                std::printf("Supervisor: worker %d exited (pid %d)\n", dead.slot, (int)pid);
+                std::fflush(stdout);
+                continue;
+            }
+            if (WIFSIGNALED(status)) {
+                std::fprintf(stderr, "Supervisor: worker %d (pid %d) killed by signal %d\n", dead.slot, (int)pid,
+                             WTERMSIG(status));
+            } else {
+                std::fprintf(stderr, "Supervisor: worker %d (pid %d) exited with status %d\n", dead.slot, (int)pid,
+                             WEXITSTATUS(status));
+            }
+            if (pid == rolling_pid_) {
+                // 新进程没能就绪: 旧进程仍在该槽位上服务
+                abortRolling("new worker exited before ready");
+                continue;
+            }
+            if (stopping_ || slotServed(dead.slot)) continue;
+            int64_t now = nowMs();
+            respawn_at_[(size_t)dead.slot] = now - dead.started_ms < 1000 ? now + 1000 : now;
+        }
+    }
+
+    bool slotServed(int slot) const {
+        for (const Worker& w : workers_) {
+            if (w.slot == slot && w.state != Draining) return true;
+        }
+        return false;
+    }
+
+    void checkTimers() {
+        int64_t now = nowMs();
+        for (Worker& w : workers_) {
+            if (now < w.deadline_ms) continue;
+            if (w.state == Starting) {
+                std::fprintf(stderr, "Supervisor: worker %d (pid %d) not ready in %d ms, killing\n", w.slot,
+                             (int)w.pid, opt_.ready_timeout_ms);
+                ::close(w.ready_fd);
+                w.ready_fd = -1;
+                w.state = Ready;    // 回收时按意外退出处理
+                w.deadline_ms = INT64_MAX;
+                ::kill(w.pid, SIGKILL);
+            } else if (w.state == Draining) {
+                std::fprintf(stderr, "Supervisor: worker %d (pid %d) not drained in %d ms, killing\n", w.slot,
+                             (int)w.pid, opt_.drain_timeout_ms);
+                w.deadline_ms = INT64_MAX;
+                ::kill(w.pid, SIGKILL);
+            }
+        }
+        if (stopping_) return;
+        for (int slot = 0; slot < opt_.workers; slot++) {
+            int64_t& at = respawn_at_[(size_t)slot];
+            if (at != 0 && now >= at) {
+                at = 0;
+                if (!slotServed(slot)) spawn(slot);
+            }
+        }
+    }
+};
+
+#else
+
+class Supervisor {
+public:
+    struct Options {
+        int workers = 2;
+        int ready_timeout_ms = 60000;
+        int drain_timeout_ms = 30000;
+    };
+    static bool supported() { return false; }
+    bool listen(const Options&, int, std::string& err) { err = "多进程模式仅支持 Linux"; return false; }
+    int run(const std::vector<std::string>&, const std::function<bool()>&) { return 1; }
+    static void notifyReady(int) {}
+    static void installStopHandler(void (*)(int)) {}
+};
+
+#endif // __linux__
+
+#endif // BYD_SUPERVISOR_H
@@ -0,0 +1,246 @@
+/**
+ * HTTP 服务端的连接任务队列 (替换 httplib::ThreadPool, 经 Server::new_task_queue 安装)
+ *
+ * httplib::ThreadPool 的每个任务都要分配一个 std::list 节点, 入队与出队竞争同一把锁。这里:
+ *   MpmcRing           有界无锁环形队列 (每个槽一个序号, 入队/出队各一次 CAS), 多生产者多消费者
+ *   WorkStealingQueue  每个工作线程一个 MpmcRing, 入队轮流放入各线程的队列 (满了换下一个);
+ *                      工作线程先取自己的队列, 空了再从其他线程的队列窃取。
+ *                      连接任务会在 keep-alive 期间长时间占用线程, 窃取让排在忙碌线程后面的连接不必等待。
+ * 过载时: 各线程队列全满的连接放入溢出队列, 在队列中等待超过 max_wait 的连接也一样, 以"拒绝模式"执行
+ * (shedding() 为 true, 由请求处理方直接返回 503); 溢出队列也满时拒绝, 由 httplib 关闭连接。
+ * 队列操作不加锁; 只有工作线程无事可做进入休眠、以及入队时发现有线程在休眠需要唤醒时才用互斥量。
+ */
+
+#ifndef BYD_TASK_QUEUE_H
+#define BYD_TASK_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "httplib.h"
+
+// 容量取不小于 capacity 的 2 的幂
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // 队列满时返回 false, v 保持不变
+    bool tryPush(T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(v);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(c.value);
+                    c.value = T();
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 并发修改时只是近似值
+    size_t sizeApprox() const {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{ 0 };
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+};
+
+class WorkStealingQueue final : public httplib::TaskQueue {
+public:
+    // max_queued: 所有线程队列的总容量 (已被工作线程取走的任务不计); max_wait_ms 为 0 时不限排队时间
+    WorkStealingQueue(size_t workers, size_t max_queued, int max_wait_ms = 0)
+        : overflow_(std::max<size_t>(64, max_queued / 8)),
+          max_wait_ns_((int64_t)max_wait_ms * 1000000) {
+        if (workers == 0) workers = 1;
+        size_t per_worker = (max_queued + workers - 1) / workers;
+        for (size_t i = 0; i < workers; i++) queues_.emplace_back(new Ring(per_worker < 2 ? 2 : per_worker));
+        threads_.reserve(workers);
+        for (size_t i = 0; i < workers; i++) threads_.emplace_back([this, i]() { run(i); });
+    }
+
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+    ~WorkStealingQueue() override { shutdown(); }
+
+    bool enqueue(std::function<void()> fn) override {
+        Task task = { std::move(fn), max_wait_ns_ > 0 ? nowNs() : 0 };
+        size_t n = queues_.size();
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        bool pushed = false;
+        for (size_t k = 0; k < n && !pushed; k++) pushed = queues_[(start + k) % n]->tryPush(task);
+        if (!pushed && !overflow_.tryPush(task)) return false;
+        pending_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lk(mu_);
+            cv_.notify_one();
+        }
+        return true;
+    }
+
+    // 已入队的任务执行完后工作线程退出
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    size_t workerCount() const { return threads_.size(); }
+    uint64_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+    // 已入队、尚未被工作线程取走的任务数 (近似值)
+    size_t queued() const {
+        int64_t n = pending_.load(std::memory_order_relaxed);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    // 当前线程正在以拒绝模式执行任务
+    static bool shedding() { return shedFlag(); }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        int64_t enqueued_ns;
+    };
+    using Ring = MpmcRing<Task>;
+    static const int kSpinRounds = 64;      // 休眠前空转检查的次数
+
+    std::vector<std::unique_ptr<Ring>> queues_;
+    Ring overflow_;             // 各线程队列都满时的任务, 优先以拒绝模式处理
+    int64_t max_wait_ns_;
+    std::vector<std::thread> threads_;
+    alignas(64) std::atomic<size_t> next_{ 0 };
+    alignas(64) std::atomic<int64_t> pending_{ 0 };  // 已入队未取走的任务数 (入队与计数之间可能短暂为负)
+    std::atomic<int> sleepers_{ 0 };
+    std::atomic<uint64_t> stolen_{ 0 };
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;     // mu_
+
+    static bool& shedFlag() {
+        static thread_local bool shedding = false;
+        return shedding;
+    }
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // shed 返回是否应以拒绝模式执行
+    bool take(size_t self, Task& task, bool& shed) {
+        shed = true;
+        if (overflow_.tryPop(task)) return true;
+        shed = false;
+        if (!queues_[self]->tryPop(task) && !steal(self, task)) return false;
+        shed = max_wait_ns_ > 0 && nowNs() - task.enqueued_ns > max_wait_ns_;
+        return true;
+    }
+
+    bool steal(size_t self, Task& task) {
+        size_t n = queues_.size();
+        for (size_t k = 1; k < n; k++) {
+            if (queues_[(self + k) % n]->tryPop(task)) {
+                stolen_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        Task task;
+        bool shed;
+        int idle = 0;
+        for (;;) {
+            if (take(self, task, shed)) {
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                idle = 0;
+                shedFlag() = shed;
+                task.fn();
+                shedFlag() = false;
+                task.fn = nullptr;
+                continue;
+            }
+            if (++idle < kSpinRounds) {
+                std::this_thread::yield();
+                continue;
+            }
+            // 先登记为休眠再检查 pending_, 与 enqueue 中先加 pending_ 再检查 sleepers_ 配对, 不会漏掉唤醒
+            std::unique_lock<std::mutex> lk(mu_);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            cv_.wait(lk, [&]() { return pending_.load(std::memory_order_seq_cst) > 0 || stopping_; });
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            if (stopping_ && pending_.load(std::memory_order_seq_cst) <= 0) break;
+            idle = 0;
+        }
+#if defined(CPPHTTPLIB_OPENSSL_SUPPORT) && !defined(OPENSSL_IS_BORINGSSL) && !defined(LIBRESSL_VERSION_NUMBER)
+        OPENSSL_thread_stop();
+#endif
+    }
+};
+
+#endif // BYD_TASK_QUEUE_H
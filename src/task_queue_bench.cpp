@@ -0,0 +1,151 @@
+// 连接任务队列基准: httplib::ThreadPool 与 WorkStealingQueue 对比 (Linux / macOS)
+//
+//   g++ -std=c++17 -O2 -pthread -o task_queue_bench task_queue_bench.cpp
+//   ./task_queue_bench [--threads=N] [--tasks=N] [--clients=N] [--connections=N]
+//
+// queue:  单个生产者 (与 httplib 的 accept 线程相同) 连续入队空任务, 计时到全部执行完
+// accept: 在回环地址上启动只有 /ping 的 httplib 服务端, 多个客户端线程各自反复
+//         "建立连接 - 请求 - 关闭", 统计每秒完成的连接数与延迟分位
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "httplib.h"
+#include "task_queue.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct BenchOptions {
+    unsigned threads = CPPHTTPLIB_THREAD_POOL_COUNT;
+    size_t tasks = 1000000;
+    unsigned clients = 4;
+    size_t connections = 20000;     // 每种队列的总连接数
+    int port = 18080;
+};
+
+httplib::TaskQueue* newQueue(bool stock, const BenchOptions& opt) {
+    if (stock) return new httplib::ThreadPool(opt.threads);
+    return new WorkStealingQueue(opt.threads, 1 << 16);
+}
+
+double secondsSince(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+void benchQueue(bool stock, const BenchOptions& opt) {
+    unique_ptr<httplib::TaskQueue> q(newQueue(stock, opt));
+    atomic<size_t> done{ 0 };
+    size_t rejected = 0;
+    auto t0 = chrono::steady_clock::now();
+    for (size_t i = 0; i < opt.tasks; i++) {
+        while (!q->enqueue([&done]() { done.fetch_add(1, memory_order_relaxed); })) {
+            rejected++;
+            this_thread::yield();
+        }
+    }
+    while (done.load(memory_order_relaxed) < opt.tasks) this_thread::yield();
+    double s = secondsSince(t0);
+    q->shutdown();
+    cout << "  queue  " << (stock ? "pool " : "steal") << "  " << opt.tasks / s / 1e6 << " M tasks/s ("
+         << s * 1e9 / opt.tasks << " ns/task, producer retried " << rejected << "x)" << endl;
+}
+
+// 一次完整的短连接请求, 返回是否收到响应
+bool pingOnce(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = false;
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+        static const char req[] = "GET /ping HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+        if (::send(fd, req, sizeof(req) - 1, 0) == (ssize_t)(sizeof(req) - 1)) {
+            string resp;
+            char buf[512];
+            ssize_t n;
+            while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) resp.append(buf, (size_t)n);
+            ok = resp.compare(0, 12, "HTTP/1.1 200") == 0;
+        }
+    }
+    // 主动关闭方进入 TIME_WAIT; 用 RST 关闭以免大量短连接耗尽本地端口
+    linger lg = { 1, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    ::close(fd);
+    return ok;
+}
+
+void benchAccept(bool stock, const BenchOptions& opt) {
+    httplib::Server svr;
+    svr.new_task_queue = [&]() { return newQueue(stock, opt); };
+    svr.Get("/ping", [](const httplib::Request&, httplib::Response& res) { res.set_content("pong", "text/plain"); });
+    if (!svr.bind_to_port("127.0.0.1", opt.port)) {
+        cerr << "Cannot bind to port " << opt.port << endl;
+        return;
+    }
+    thread server([&]() { svr.listen_after_bind(); });
+    svr.wait_until_ready();
+
+    size_t per_client = opt.connections / opt.clients;
+    vector<vector<double>> latencies(opt.clients);
+    atomic<size_t> failed{ 0 };
+    auto t0 = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (unsigned c = 0; c < opt.clients; c++) {
+        clients.emplace_back([&, c]() {
+            latencies[c].reserve(per_client);
+            for (size_t i = 0; i < per_client; i++) {
+                auto r0 = chrono::steady_clock::now();
+                if (!pingOnce(opt.port)) failed++;
+                latencies[c].push_back(secondsSince(r0) * 1e6);
+            }
+        });
+    }
+    for (auto& t : clients) t.join();
+    double s = secondsSince(t0);
+    svr.stop();
+    server.join();
+
+    vector<double> all;
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+    sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all.empty() ? 0.0 : all[min(all.size() - 1, (size_t)(p * all.size()))]; };
+    cout << "  accept " << (stock ? "pool " : "steal") << "  " << all.size() / s << " conn/s, p50 " << pct(0.5)
+         << " us, p99 " << pct(0.99) << " us, failed " << failed << endl;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        long v = eq == string::npos ? 0 : atol(arg.c_str() + eq + 1);
+        if (key == "--threads" && v > 0) opt.threads = (unsigned)v;
+        else if (key == "--tasks" && v > 0) opt.tasks = (size_t)v;
+        else if (key == "--clients" && v > 0) opt.clients = (unsigned)v;
+        else if (key == "--connections" && v > 0) opt.connections = (size_t)v;
+        else if (key == "--port" && v > 0) opt.port = (int)v;
+        else {
+            cerr << "Usage: " << argv[0] << " [--threads=N] [--tasks=N] [--clients=N] [--connections=N] [--port=N]" << endl;
+            return 1;
+        }
+    }
+    cout << "workers " << opt.threads << ", hardware threads " << thread::hardware_concurrency() << endl;
+    for (bool stock : { true, false }) benchQueue(stock, opt);
+    for (bool stock : { true, false }) benchAccept(stock, opt);
+    return 0;
+}
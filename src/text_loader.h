@@ -0,0 +1,284 @@
+/**
+ * 分段文本数据文件加载器 (Web 服务端与 CLI 共用)
+ *
+ * 数据文件由 [SERIES] / [TECH] / [MODEL] / [MODEL_TECH] 等段组成, 每行逗号分隔。
+ * 加载器映射整个文件后用 memchr 逐行切分, 字段以 string_view 直接指向映射内容 (去除首尾空白),
+ * 数值用 std::from_chars 解析。格式错误的行记录 (行号, 原因) 后跳过, 不会因一行出错而中止加载。
+ */
+
+#ifndef BYD_TEXT_LOADER_H
+#define BYD_TEXT_LOADER_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+enum class TextSection { None, Series, Tech, Model, ModelTech, Unknown };
+
+struct TextLoadError {
+    size_t line;
+    std::string message;
+};
+
+inline std::string_view trimView(std::string_view s) {
+    size_t b = 0, e = s.size();
+    while (b < e && (s[b] == ' ' || s[b] == '\t' || s[b] == '\r' || s[b] == '\n')) b++;
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r' || s[e - 1] == '\n')) e--;
+    return s.substr(b, e - b);
+}
+
+// 整段匹配的数值解析, 不接受前后多余字符
+template <typename T>
+inline bool parseNumber(std::string_view s, T& out) {
+    if (s.empty()) return false;
+    if (s[0] == '+') s.remove_prefix(1);    // from_chars 不接受前导 '+'
+    auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
+
+// 一行数据, 按逗号切分为字段; 超过 kMaxFields 的部分并入最后一个字段
+class TextRecord {
+public:
+    static const size_t kMaxFields = 16;
+
+    TextSection section = TextSection::None;
+    size_t line = 0;            // 文件中的行号 (从 1 开始)
+    std::string_view text;      // 去除首尾空白后的整行
+
+    void assign(std::string_view line_text) {
+        text = trimView(line_text);
+        count_ = 0;
+        size_t pos = 0;
+        while (count_ + 1 < kMaxFields) {
+            size_t comma = text.find(',', pos);
+            if (comma == std::string_view::npos) break;
+            fields_[count_++] = trimView(text.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        fields_[count_++] = trimView(text.substr(pos));
+    }
+
+    size_t size() const { return count_; }
+    std::string_view operator[](size_t i) const { return i < count_ ? fields_[i] : std::string_view(); }
+
+    bool requireFields(size_t n, std::string& err) const {
+        if (count_ >= n) return true;
+        err = "字段数不足: 需要 " + std::to_string(n) + " 个, 实际 " + std::to_string(count_) + " 个";
+        return false;
+    }
+
+    bool getInt(size_t i, const char* name, int& out, std::string& err) const {
+        if (parseNumber((*this)[i], out)) return true;
+        err = std::string(name) + " 不是有效的整数: '" + std::string((*this)[i]) + "'";
+        return false;
+    }
+
+    bool getDouble(size_t i, const char* name, double& out, std::string& err) const {
+        if (parseNumber((*this)[i], out)) return true;
+        err = std::string(name) + " 不是有效的数值: '" + std::string((*this)[i]) + "'";
+        return false;
+    }
+
+private:
+    std::string_view fields_[kMaxFields];
+    size_t count_ = 0;
+};
+
+// 在 threads 个线程上执行 fn(0..n-1), 任务按下标动态领取; threads <= 1 时在当前线程顺序执行
+template <typename F>
+inline void parallelFor(size_t n, unsigned threads, F fn) {
+    if (threads <= 1 || n <= 1) {
+        for (size_t i = 0; i < n; i++) fn(i);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < n;) fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < n; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+// 文件中属于同一段的一段连续行
+struct TextChunk {
+    TextSection section;
+    const char* begin;
+    const char* end;
+    size_t first_line;      // begin 所在行的行号
+};
+
+class TextDataLoader {
+public:
+    static const size_t kMaxErrors = 100;           // 只保留前若干条错误详情, 总数照常统计
+    static const size_t kChunkBytes = 4u << 20;     // 并行解析时每块的大致大小
+
+    bool open(const std::string& path, std::string& err) { return file_.open(path, err, true); }
+
+    // 逐行解析已打开的文件; on_record(const TextRecord&, std::string& err) 返回 false 时记录该行错误
+    template <typename F>
+    void parse(F on_record) {
+        splitChunks(SIZE_MAX);
+        parseChunks(1, [&](size_t, const TextRecord& r, std::string& err) { return on_record(r, err); });
+    }
+
+    // 按段头把文件切成行对齐的块 (每块约 chunk_bytes), 返回块数。段头在此串行处理
+    size_t splitChunks(size_t chunk_bytes = kChunkBytes) {
+        std::string_view text = file_.view();
+        if (text.size() >= 3 && std::memcmp(text.data(), "\xEF\xBB\xBF", 3) == 0) text.remove_prefix(3);
+        const char* begin = text.data();
+        const char* p = begin;
+        const char* end = begin + text.size();
+        const char* counted = begin;    // 已统计行号的位置
+        size_t line_no = 1;
+        TextSection section = TextSection::None;
+        chunks_.clear();
+        bytes_ = text.size();
+
+        auto lineAt = [&](const char* q) {
+            line_no += (size_t)std::count(counted, q, '\n');
+            counted = q;
+            return line_no;
+        };
+        auto emit = [&](const char* from, const char* to) {
+            while (from < to) {
+                const char* cut = to;
+                if ((size_t)(to - from) > chunk_bytes) {
+                    const char* nl = static_cast<const char*>(std::memchr(from + chunk_bytes, '\n', (size_t)(to - from - chunk_bytes)));
+                    cut = nl ? nl + 1 : to;
+                }
+                chunks_.push_back({ section, from, cut, lineAt(from) });
+                from = cut;
+            }
+        };
+
+        // 段头是首个非空白字符为 '[' 的行; '[' 在数据中很少出现, 直接按字符查找
+        const char* q = p;
+        while (q < end && (q = static_cast<const char*>(std::memchr(q, '[', (size_t)(end - q)))) != nullptr) {
+            const char* ls = q;
+            while (ls > begin && (ls[-1] == ' ' || ls[-1] == '\t')) ls--;
+            if (ls > begin && ls[-1] != '\n') { q++; continue; }
+
+            const char* nl = static_cast<const char*>(std::memchr(q, '\n', (size_t)(end - q)));
+            const char* le = nl ? nl : end;
+            emit(p, ls);
+            std::string_view header = trimView(std::string_view(q, (size_t)(le - q)));
+            section = sectionOf(header);
+            if (section == TextSection::Unknown) addError(lineAt(ls), "未知的段 " + std::string(header));
+            p = q = nl ? nl + 1 : end;
+        }
+        emit(p, end);
+        lines_ = lineAt(end) - (end > begin && end[-1] == '\n' ? 1 : 0);
+        return chunks_.size();
+    }
+
+    size_t chunkCount() const { return chunks_.size(); }
+    const TextChunk& chunk(size_t i) const { return chunks_[i]; }
+
+    // 在 threads 个线程上解析 splitChunks() 切出的块。
+    // on_record(size_t chunk, const TextRecord&, std::string& err) 在工作线程中调用, 同一块内按行序;
+    // 调用方按块下标各自输出, 再按块下标顺序合并即为文件顺序。错误按块顺序合并, 与线程调度无关
+    template <typename F>
+    void parseChunks(unsigned threads, F on_record) {
+        std::vector<ChunkResult> results(chunks_.size());
+        parallelFor(chunks_.size(), threads, [&](size_t i) { parseChunk(i, results[i], on_record); });
+        for (const ChunkResult& r : results) {
+            records_ += r.records;
+            if (r.has_wal_lsn) wal_lsn_ = r.wal_lsn;
+            for (const TextLoadError& e : r.errors) addError(e.line, e.message);
+            error_count_ += r.error_count - r.errors.size();
+        }
+        // 段头错误在切块时已加入, 统一按行号排序
+        std::stable_sort(errors_.begin(), errors_.end(),
+                         [](const TextLoadError& a, const TextLoadError& b) { return a.line < b.line; });
+    }
+
+    uint64_t walLsn() const { return wal_lsn_; }
+    size_t bytes() const { return bytes_; }
+    size_t lines() const { return lines_; }
+    size_t records() const { return records_; }
+    size_t errorCount() const { return error_count_; }
+    const std::vector<TextLoadError>& errors() const { return errors_; }
+
+    void addError(size_t line, const std::string& message) {
+        error_count_++;
+        if (errors_.size() < kMaxErrors) errors_.push_back({ line, message });
+    }
+
+    static TextSection sectionOf(std::string_view header) {
+        if (header == "[SERIES]") return TextSection::Series;
+        if (header == "[TECH]") return TextSection::Tech;
+        if (header == "[MODEL]") return TextSection::Model;
+        if (header == "[MODEL_TECH]") return TextSection::ModelTech;
+        return TextSection::Unknown;
+    }
+
+private:
+    struct ChunkResult {
+        size_t records = 0;
+        bool has_wal_lsn = false;
+        uint64_t wal_lsn = 0;
+        size_t error_count = 0;
+        std::vector<TextLoadError> errors;
+    };
+
+    MappedFile file_;
+    std::vector<TextChunk> chunks_;
+    uint64_t wal_lsn_ = 0;
+    size_t bytes_ = 0;
+    size_t lines_ = 0;
+    size_t records_ = 0;
+    size_t error_count_ = 0;
+    std::vector<TextLoadError> errors_;
+
+    template <typename F>
+    void parseChunk(size_t index, ChunkResult& out, F& on_record) const {
+        auto fail = [&](size_t line, std::string msg) {
+            out.error_count++;
+            if (out.errors.size() < kMaxErrors) out.errors.push_back({ line, std::move(msg) });
+        };
+        const TextChunk& c = chunks_[index];
+        const char* p = c.begin;
+        size_t line_no = c.first_line;
+        TextRecord rec;
+        std::string err;
+
+        for (; p < c.end; line_no++) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(c.end - p)));
+            const char* line_end = nl ? nl : c.end;
+            std::string_view line = trimView(std::string_view(p, (size_t)(line_end - p)));
+            p = nl ? nl + 1 : c.end;
+
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                // 快照已包含的 WAL 位置
+                const std::string_view tag = "# WAL_LSN:";
+                if (line.compare(0, tag.size(), tag) == 0) {
+                    if (parseNumber(trimView(line.substr(tag.size())), out.wal_lsn)) out.has_wal_lsn = true;
+                    else fail(line_no, "WAL_LSN 不是有效的整数");
+                }
+                continue;
+            }
+            if (c.section == TextSection::Unknown) continue;   // 段头已报告过
+            if (c.section == TextSection::None) { fail(line_no, "数据行不在任何段中"); continue; }
+
+            rec.assign(line);
+            rec.section = c.section;
+            rec.line = line_no;
+            err.clear();
+            if (on_record(index, static_cast<const TextRecord&>(rec), err)) out.records++;
+            else fail(line_no, err);
+        }
+    }
+};
+
+#endif // BYD_TEXT_LOADER_H
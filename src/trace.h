@@ -0,0 +1,214 @@
+/**
+ * 请求分阶段追踪 (Chrome trace-event JSON, 可在 Perfetto / chrome://tracing 中查看)
+ *
+ * 按采样率 (每 N 个请求 1 个) 选中请求, 选中的请求在处理线程上记录各阶段的耗时区间 (TraceSpan):
+ * 区间名是静态字符串, 记录时复制定长事件到本线程的环形缓冲 (首次记录时分配并登记, 写满后覆盖最旧的事件)。
+ * 缓冲的互斥量只在导出时与记录线程竞争。未开启或请求未被选中时, TraceSpan 只读一次线程局部变量,
+ * 不取时间也不写缓冲。导出时合并各线程缓冲, 每个事件带所属请求的编号, 请求的根区间以 "方法 路径" 命名。
+ */
+
+#ifndef BYD_TRACE_H
+#define BYD_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+    const char* name;       // 静态字符串; 为空时使用 detail (请求根区间)
+    uint64_t start_ns;      // 相对 Tracer 创建时刻
+    uint64_t dur_ns;
+    uint64_t request;       // 所属请求的编号
+    char detail[64];
+};
+
+class Tracer {
+public:
+    static const size_t kRingEvents = 4096;     // 每个线程保留的最近事件数
+
+    Tracer() : base_(std::chrono::steady_clock::now()) {}
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // 每 n 个请求采样 1 个, 0 表示关闭
+    void setSampleEvery(uint32_t n) { sample_every_.store(n, std::memory_order_relaxed); }
+    uint32_t sampleEvery() const { return sample_every_.load(std::memory_order_relaxed); }
+
+    // 请求开始: 按采样率决定本线程当前请求是否记录
+    void beginRequest() {
+        Local& t = local();
+        uint32_t n = sample_every_.load(std::memory_order_relaxed);
+        if (n == 0 || requests_.fetch_add(1, std::memory_order_relaxed) % n != 0) {
+            t.sampled = nullptr;
+            return;
+        }
+        t.sampled = this;
+        t.request = next_request_.fetch_add(1, std::memory_order_relaxed) + 1;
+        t.request_start = nowNs();
+    }
+
+    // 请求处理完 (写出响应头之前): 记录根区间, name 为 "方法 路径"
+    void endRequest(const std::string& method, const std::string& path) {
+        Local& t = local();
+        if (t.sampled != this) return;
+        record(nullptr, t.request_start, nowNs(), (method + " " + path).c_str());
+    }
+
+    // 本线程当前的请求是否被采样
+    bool sampling() const { return local().sampled == this; }
+
+    uint64_t nowNs() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - base_).count();
+    }
+
+    void record(const char* name, uint64_t start_ns, uint64_t end_ns, const char* detail = nullptr) {
+        Local& t = local();
+        Ring& r = ring();
+        std::lock_guard<std::mutex> lk(r.mu);
+        TraceEvent& e = r.events[r.next % kRingEvents];
+        e.name = name;
+        e.start_ns = start_ns;
+        e.dur_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+        e.request = t.request;
+        size_t n = detail ? std::strlen(detail) : 0;
+        if (n >= sizeof(e.detail)) {
+            n = sizeof(e.detail) - 1;
+            while (n > 0 && ((unsigned char)detail[n] & 0xC0) == 0x80) n--;     // 不截断在 UTF-8 字符中间
+        }
+        if (n) std::memcpy(e.detail, detail, n);
+        e.detail[n] = '\0';
+        r.next++;
+    }
+
+    // 以 Chrome trace-event JSON 输出各线程缓冲中的事件
+    void exportJson(std::string& out) const {
+        std::vector<Ring*> rings;
+        {
+            std::lock_guard<std::mutex> lk(rings_mu_);
+            for (const auto& r : rings_) rings.push_back(r.get());
+        }
+        out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char buf[160];
+        std::vector<TraceEvent> events;
+        for (size_t tid = 0; tid < rings.size(); tid++) {
+            {
+                std::lock_guard<std::mutex> lk(rings[tid]->mu);
+                uint64_t next = rings[tid]->next;
+                uint64_t n = std::min<uint64_t>(next, kRingEvents);
+                events.clear();
+                for (uint64_t i = next - n; i < next; i++) events.push_back(rings[tid]->events[i % kRingEvents]);
+            }
+            if (events.empty()) continue;
+            std::snprintf(buf, sizeof(buf),
+                          "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"thread %zu\"}}",
+                          first ? "" : ",", tid + 1, tid + 1);
+            out += buf;
+            first = false;
+            for (const TraceEvent& e : events) {
+                out += ",{\"name\":";
+                appendString(out, e.name ? e.name : e.detail);
+                std::snprintf(buf, sizeof(buf),
+                              ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%zu,"
+                              "\"args\":{\"request\":%llu}}",
+                              e.name ? "stage" : "request", e.start_ns / 1e3, e.dur_ns / 1e3, tid + 1,
+                              (unsigned long long)e.request);
+                out += buf;
+            }
+        }
+        out += "]}";
+    }
+
+    // 丢弃已记录的事件
+    void clear() {
+        std::lock_guard<std::mutex> lk(rings_mu_);
+        for (const auto& r : rings_) {
+            std::lock_guard<std::mutex> rl(r->mu);
+            r->next = 0;
+        }
+    }
+
+private:
+    struct Ring {
+        std::mutex mu;
+        std::unique_ptr<TraceEvent[]> events{ new TraceEvent[kRingEvents] };
+        uint64_t next = 0;      // mu: 已写入的事件总数
+    };
+
+    struct Local {
+        const Tracer* sampled = nullptr;    // 当前请求被采样时指向该 Tracer
+        uint64_t request = 0;
+        uint64_t request_start = 0;
+        const Tracer* owner = nullptr;
+        Ring* ring = nullptr;
+    };
+
+    std::chrono::steady_clock::time_point base_;
+    std::atomic<uint32_t> sample_every_{ 0 };
+    std::atomic<uint64_t> requests_{ 0 };
+    std::atomic<uint64_t> next_request_{ 0 };
+    mutable std::mutex rings_mu_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    static Local& local() {
+        static thread_local Local t;
+        return t;
+    }
+
+    Ring& ring() {
+        Local& t = local();
+        if (t.owner != this) {
+            std::unique_ptr<Ring> r(new Ring());
+            std::lock_guard<std::mutex> lk(rings_mu_);
+            t.ring = r.get();
+            t.owner = this;
+            rings_.push_back(std::move(r));
+        }
+        return *t.ring;
+    }
+
+    static void appendString(std::string& out, const char* s) {
+        out += '"';
+        for (; *s; s++) {
+            unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c < 0x20) {
+                char esc[8];
+                std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            } else {
+                out += (char)c;
+            }
+        }
+        out += '"';
+    }
+};
+
+// 作用域内的一个阶段: 当前请求被采样时记录从构造到析构的耗时
+class TraceSpan {
+public:
+    TraceSpan(Tracer& tracer, const char* name)
+        : tracer_(tracer), name_(tracer.sampling() ? name : nullptr), start_(name_ ? tracer.nowNs() : 0) {}
+    ~TraceSpan() {
+        if (name_) tracer_.record(name_, start_, tracer_.nowNs());
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    Tracer& tracer_;
+    const char* name_;
+    uint64_t start_;
+};
+
+#endif // BYD_TRACE_H
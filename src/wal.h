@@ -0,0 +1,469 @@
+/**
+ * 追加写日志 (Write-Ahead Log)
+ *
+ * 文件格式: 8 字节文件头 "BYDWAL01", 之后是连续的记录:
+ *   [u32 payload 长度][u32 CRC32C(lsn + payload)][u64 lsn][payload]
+ * 整数均为小端序。每次变更追加一条记录, 按同步策略 fsync;
+ * 启动时在最近一次快照之上回放 lsn 更大的记录。压缩时先 rotate() 把当前日志改名为
+ * <path>.old, 快照写完后再 removeRotated() 删除。
+ *
+ * 服务端通过 startWriter() 启用组提交: 请求线程只把记录放入缓冲,
+ * 后台写线程把同一时间段内的多条记录合并为一次 write + 一次 fsync。
+ */
+
+#ifndef BYD_WAL_H
+#define BYD_WAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "crc32c.h"
+
+enum class WalSyncPolicy {
+    Always,     // 每次提交都 fsync
+    Interval,   // 距上次 fsync 超过 sync_interval_ms 时才 fsync
+    None        // 只写入页缓存, 由操作系统决定落盘时机
+};
+
+namespace wal_detail {
+
+#ifdef _WIN32
+inline int openAppend(const char* path) { return _open(path, _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE); }
+inline int openRead(const char* path) { return _open(path, _O_RDONLY | _O_BINARY); }
+inline long long writeSome(int fd, const char* p, size_t n) { return _write(fd, p, (unsigned)n); }
+inline long long readSome(int fd, char* p, size_t n) { return _read(fd, p, (unsigned)n); }
+inline int closeFd(int fd) { return _close(fd); }
+inline bool syncFd(int fd) { return _commit(fd) == 0; }
+inline bool truncateFile(const char* path, long long size) {
+    int fd = _open(path, _O_WRONLY | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = _chsize_s(fd, size) == 0;
+    _close(fd);
+    return ok;
+}
+#else
+inline int openAppend(const char* path) { return ::open(path, O_WRONLY | O_APPEND | O_CREAT, 0644); }
+inline int openRead(const char* path) { return ::open(path, O_RDONLY); }
+inline long long writeSome(int fd, const char* p, size_t n) { return ::write(fd, p, n); }
+inline long long readSome(int fd, char* p, size_t n) { return ::read(fd, p, n); }
+inline int closeFd(int fd) { return ::close(fd); }
+inline bool syncFd(int fd) {
+#if defined(__linux__)
+    return ::fdatasync(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+inline bool truncateFile(const char* path, long long size) { return ::truncate(path, (off_t)size) == 0; }
+#endif
+
+inline bool writeAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        long long w = writeSome(fd, p, n);
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+inline void putU32(std::string& out, uint32_t v) {
+    char b[4] = { (char)(v & 0xFF), (char)((v >> 8) & 0xFF), (char)((v >> 16) & 0xFF), (char)(v >> 24) };
+    out.append(b, 4);
+}
+
+inline void putU64(std::string& out, uint64_t v) {
+    putU32(out, (uint32_t)(v & 0xFFFFFFFFu));
+    putU32(out, (uint32_t)(v >> 32));
+}
+
+inline uint32_t getU32(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+inline uint64_t getU64(const char* p) {
+    return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+const char kMagic[8] = { 'B', 'Y', 'D', 'W', 'A', 'L', '0', '1' };
+const size_t kHeaderSize = 8;
+const size_t kRecordHeaderSize = 16;             // 长度 + CRC + LSN
+const uint32_t kMaxPayload = 64u * 1024 * 1024;  // 单条记录上限, 超过视为损坏
+
+} // namespace wal_detail
+
+// 原子写文件: 先写 <path>.tmp 并 fsync, 再 rename 覆盖目标文件。
+// 中途崩溃时目标文件保持旧内容不变。
+class AtomicFileWriter {
+public:
+    explicit AtomicFileWriter(const std::string& path) : path_(path), tmp_(path + ".tmp") {
+        std::remove(tmp_.c_str());
+        fd_ = wal_detail::openAppend(tmp_.c_str());
+    }
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+    ~AtomicFileWriter() {
+        if (fd_ >= 0) wal_detail::closeFd(fd_);
+        if (!committed_) std::remove(tmp_.c_str());
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // 缓冲写入, 缓冲超过 1MB 时落到临时文件
+    bool write(std::string_view data) {
+        buf_.append(data.data(), data.size());
+        if (buf_.size() >= (1u << 20)) return flush();
+        return ok_;
+    }
+
+    bool commit(std::string& err) {
+        if (fd_ < 0) { err = "无法创建临时文件 " + tmp_; return false; }
+        if (!flush() || !wal_detail::syncFd(fd_)) { err = "写入临时文件失败 " + tmp_; return false; }
+        wal_detail::closeFd(fd_);
+        fd_ = -1;
+#ifdef _WIN32
+        if (!MoveFileExA(tmp_.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+        if (std::rename(tmp_.c_str(), path_.c_str()) != 0) {
+#endif
+            err = "无法替换文件 " + path_;
+            return false;
+        }
+        committed_ = true;
+        syncParentDir();
+        return true;
+    }
+
+private:
+    std::string path_;
+    std::string tmp_;
+    std::string buf_;
+    int fd_ = -1;
+    bool ok_ = true;
+    bool committed_ = false;
+
+    bool flush() {
+        if (fd_ < 0) return ok_ = false;
+        if (!buf_.empty()) {
+            ok_ = ok_ && wal_detail::writeAll(fd_, buf_.data(), buf_.size());
+            buf_.clear();
+        }
+        return ok_;
+    }
+
+    // rename 之后同步目录项, 保证掉电后新文件名可见
+    void syncParentDir() {
+#ifndef _WIN32
+        size_t slash = path_.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : path_.substr(0, slash);
+        int dfd = ::open(dir.c_str(), O_RDONLY);
+        if (dfd >= 0) { ::fsync(dfd); ::close(dfd); }
+#endif
+    }
+};
+
+class WriteAheadLog {
+public:
+    struct Options {
+        WalSyncPolicy sync = WalSyncPolicy::Always;
+        int sync_interval_ms = 100;
+    };
+
+    // 回放统计
+    struct ReplayStats {
+        size_t records = 0;         // 回放的记录数 (lsn > after_lsn)
+        size_t skipped = 0;         // 已包含在快照中的记录数
+        uint64_t first_lsn = 0;     // 回放的第一条记录的 lsn, 大于 after_lsn + 1 说明中间的记录已丢失
+        uint64_t last_lsn = 0;      // 日志中最大的 lsn
+        bool truncated_tail = false; // 尾部存在被截断/校验失败的记录
+    };
+
+    WriteAheadLog() = default;
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    ~WriteAheadLog() { close(); }
+
+    void setOptions(const Options& opt) { std::lock_guard<std::mutex> lk(mu_); opt_ = opt; }
+
+    // 打开 (必要时创建) 日志文件; last_lsn 为回放得到的最大 lsn
+    bool open(const std::string& path, uint64_t last_lsn, std::string& err) {
+        std::lock_guard<std::mutex> io(io_mu_);
+        std::lock_guard<std::mutex> lk(mu_);
+        path_ = path;
+        last_lsn_ = last_lsn;
+        durable_lsn_ = last_lsn;
+        return openLocked(err);
+    }
+
+    // 停止写线程, 写出剩余记录并关闭文件
+    void close() {
+        stopWriter();
+        std::lock_guard<std::mutex> io(io_mu_);
+        if (fd_ < 0) return;
+        flushPending(true);
+        std::lock_guard<std::mutex> lk(mu_);
+        wal_detail::closeFd(fd_);
+        fd_ = -1;
+        done_cv_.notify_all();
+    }
+
+    bool isOpen() const { std::lock_guard<std::mutex> lk(mu_); return fd_ >= 0; }
+
+    // 追加一条记录到内存缓冲并分配 lsn; 由 commit() 或写线程写入文件
+    uint64_t append(std::string_view payload) {
+        uint64_t lsn;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            lsn = ++last_lsn_;
+            std::string hdr_lsn;
+            wal_detail::putU64(hdr_lsn, lsn);
+            uint32_t crc = crc32c(hdr_lsn.data(), hdr_lsn.size());
+            crc = crc32c(payload.data(), payload.size(), crc);
+            wal_detail::putU32(pending_, (uint32_t)payload.size());
+            wal_detail::putU32(pending_, crc);
+            pending_ += hdr_lsn;
+            pending_.append(payload.data(), payload.size());
+        }
+        work_cv_.notify_one();
+        return lsn;
+    }
+
+    // 同步提交: 在调用线程中把缓冲写入文件, 并按同步策略 fsync
+    bool commit() {
+        std::lock_guard<std::mutex> io(io_mu_);
+        return flushPending(false);
+    }
+
+    // 启动组提交写线程: 各请求线程 append() 后调用 waitDurable() 等待,
+    // 写线程每轮把积累的全部记录一次写入并只 fsync 一次
+    void startWriter() {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (writer_.joinable()) return;
+        writer_stop_ = false;
+        writer_ = std::thread([this]() { writerLoop(); });
+    }
+
+    void stopWriter() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (!writer_.joinable()) return;
+            writer_stop_ = true;
+        }
+        work_cv_.notify_all();
+        writer_.join();
+    }
+
+    // 等待 lsn 及之前的记录按同步策略提交完成; 写入失败返回 false。
+    // 未启动写线程时退化为同步 commit()
+    bool waitDurable(uint64_t lsn) {
+        std::unique_lock<std::mutex> lk(mu_);
+        if (!writer_.joinable()) {
+            lk.unlock();
+            return commit();
+        }
+        done_cv_.wait(lk, [&]() { return durable_lsn_ >= lsn || io_failed_ || fd_ < 0; });
+        return durable_lsn_ >= lsn;
+    }
+
+    // 立即 fsync (Interval 策略下由后台线程定期调用)
+    bool sync() {
+        std::lock_guard<std::mutex> io(io_mu_);
+        return flushPending(true);
+    }
+
+    uint64_t lastLsn() const { std::lock_guard<std::mutex> lk(mu_); return last_lsn_; }
+    uint64_t durableLsn() const { std::lock_guard<std::mutex> lk(mu_); return durable_lsn_; }
+    uint64_t bytes() const { std::lock_guard<std::mutex> lk(mu_); return bytes_; }
+    uint64_t groupCommits() const { std::lock_guard<std::mutex> lk(mu_); return group_commits_; }
+    const std::string& path() const { return path_; }
+    std::string rotatedPath() const { return path_ + ".old"; }
+
+    // 压缩开始: 当前日志改名为 <path>.old, 新建空日志继续追加。
+    // 若上次压缩失败留下的 .old 仍在, 则不轮转 (其中的记录尚未进入快照)
+    bool rotate(std::string& err) {
+        std::lock_guard<std::mutex> io(io_mu_);
+        struct stat st;
+        if (::stat(rotatedPath().c_str(), &st) == 0) { err = "旧日志 " + rotatedPath() + " 尚未合并"; return false; }
+        if (!flushPending(true)) { err = "WAL 刷盘失败"; return false; }
+        std::lock_guard<std::mutex> lk(mu_);
+        wal_detail::closeFd(fd_);
+        fd_ = -1;
+        if (std::rename(path_.c_str(), rotatedPath().c_str()) != 0) {
+            err = "无法重命名 WAL 文件 " + path_;
+            openLocked(err);
+            return false;
+        }
+        return openLocked(err);
+    }
+
+    // 快照已安全落盘, 删除轮转出的旧日志
+    void removeRotated() { std::remove(rotatedPath().c_str()); }
+
+    // 依次回放 <path>.old 与 <path> 中 lsn > after_lsn 的记录。
+    // 当前日志尾部若有写了一半的记录则截掉, 以免新记录追加在损坏数据之后;
+    // 日志仍在被写入时 (运行中重新加载) 传 repair_tail = false, 只读不截断。
+    static bool replay(const std::string& path, uint64_t after_lsn,
+                       const std::function<void(uint64_t, std::string_view)>& apply,
+                       ReplayStats& stats, std::string& err, bool repair_tail = true) {
+        stats = ReplayStats();
+        stats.last_lsn = after_lsn;
+        if (!replayFile(path + ".old", after_lsn, apply, stats, false, err)) return false;
+        return replayFile(path, after_lsn, apply, stats, repair_tail, err);
+    }
+
+private:
+    // 锁顺序: io_mu_ -> mu_。io_mu_ 串行化文件读写与 fd_ 变更,
+    // mu_ 只保护缓冲与计数, 写线程做 fsync 时不阻塞 append()
+    mutable std::mutex mu_;
+    std::mutex io_mu_;
+    std::condition_variable work_cv_;   // 有新记录待写
+    std::condition_variable done_cv_;   // durable_lsn_ 前进
+    std::thread writer_;
+    bool writer_stop_ = false;
+    Options opt_;
+    std::string path_;
+    int fd_ = -1;
+    uint64_t last_lsn_ = 0;      // 已分配的最大 lsn
+    uint64_t durable_lsn_ = 0;   // 已按同步策略提交的最大 lsn
+    uint64_t bytes_ = 0;
+    uint64_t group_commits_ = 0;
+    bool io_failed_ = false;
+    std::string pending_;
+    std::chrono::steady_clock::time_point last_sync_ = std::chrono::steady_clock::now();
+
+    // 需持有 mu_ 与 io_mu_
+    bool openLocked(std::string& err) {
+        fd_ = wal_detail::openAppend(path_.c_str());
+        if (fd_ < 0) { err = "无法打开 WAL 文件 " + path_; return false; }
+        struct stat st;
+        bytes_ = (::stat(path_.c_str(), &st) == 0) ? (uint64_t)st.st_size : 0;
+        if (bytes_ == 0) {
+            if (!wal_detail::writeAll(fd_, wal_detail::kMagic, wal_detail::kHeaderSize) || !wal_detail::syncFd(fd_)) {
+                err = "无法写入 WAL 文件头 " + path_;
+                return false;
+            }
+            bytes_ = wal_detail::kHeaderSize;
+        }
+        return true;
+    }
+
+    // 需持有 io_mu_ (不持有 mu_): 取出全部缓冲一次写入, 按策略 (或 force_sync) fsync
+    bool flushPending(bool force_sync) {
+        std::string batch;
+        uint64_t upto;
+        WalSyncPolicy policy;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            batch.swap(pending_);
+            upto = last_lsn_;
+            policy = opt_.sync;
+            if (policy == WalSyncPolicy::Interval &&
+                std::chrono::steady_clock::now() - last_sync_ >= std::chrono::milliseconds(opt_.sync_interval_ms)) {
+                force_sync = true;
+            }
+        }
+        bool ok = fd_ >= 0 && (batch.empty() || wal_detail::writeAll(fd_, batch.data(), batch.size()));
+        if (ok && (force_sync || policy == WalSyncPolicy::Always)) {
+            ok = wal_detail::syncFd(fd_);
+            if (ok) last_sync_ = std::chrono::steady_clock::now();
+        }
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (ok) {
+                bytes_ += batch.size();
+                if (upto > durable_lsn_) durable_lsn_ = upto;
+                if (!batch.empty()) group_commits_++;
+            } else {
+                io_failed_ = true;
+            }
+        }
+        done_cv_.notify_all();
+        return ok;
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lk(mu_);
+        for (;;) {
+            work_cv_.wait(lk, [&]() { return writer_stop_ || !pending_.empty(); });
+            if (pending_.empty() && writer_stop_) break;
+            lk.unlock();
+            {
+                std::lock_guard<std::mutex> io(io_mu_);
+                flushPending(false);
+            }
+            lk.lock();
+        }
+    }
+
+    static bool replayFile(const std::string& path, uint64_t after_lsn,
+                           const std::function<void(uint64_t, std::string_view)>& apply,
+                           ReplayStats& stats, bool truncate_tail, std::string& err) {
+        int fd = wal_detail::openRead(path.c_str());
+        if (fd < 0) return true;   // 不存在视为空日志
+
+        std::string data;
+        char buf[1 << 16];
+        for (;;) {
+            long long n = wal_detail::readSome(fd, buf, sizeof(buf));
+            if (n < 0) { wal_detail::closeFd(fd); err = "读取 WAL 失败: " + path; return false; }
+            if (n == 0) break;
+            data.append(buf, (size_t)n);
+        }
+        wal_detail::closeFd(fd);
+
+        if (data.empty()) return true;
+        if (data.size() < wal_detail::kHeaderSize || std::memcmp(data.data(), wal_detail::kMagic, wal_detail::kHeaderSize) != 0) {
+            err = "WAL 文件头无效: " + path;
+            return false;
+        }
+
+        size_t pos = wal_detail::kHeaderSize;
+        while (pos < data.size()) {
+            if (data.size() - pos < wal_detail::kRecordHeaderSize) break;
+            uint32_t len = wal_detail::getU32(data.data() + pos);
+            uint32_t crc = wal_detail::getU32(data.data() + pos + 4);
+            if (len > wal_detail::kMaxPayload || data.size() - pos - wal_detail::kRecordHeaderSize < len) break;
+            const char* body = data.data() + pos + 8;    // lsn + payload
+            if (crc32c(body, 8 + (size_t)len) != crc) break;
+
+            uint64_t lsn = wal_detail::getU64(body);
+            if (lsn > after_lsn) {
+                apply(lsn, std::string_view(body + 8, len));
+                if (stats.records++ == 0) stats.first_lsn = lsn;
+            } else {
+                stats.skipped++;
+            }
+            if (lsn > stats.last_lsn) stats.last_lsn = lsn;
+            pos += wal_detail::kRecordHeaderSize + len;
+        }
+
+        if (pos < data.size()) {
+            stats.truncated_tail = true;
+            if (truncate_tail && !wal_detail::truncateFile(path.c_str(), (long long)pos)) {
+                err = "无法截断损坏的 WAL 尾部: " + path;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif // BYD_WAL_H